@@ -1,9 +1,28 @@
+// Avec MOTION_CORE_ONLY, seuls la configuration, la sortie STEP/DIR, le
+// générateur de pas, les impulsions de mise en forme, l'estimation de
+// durée, l'odomètre, le suiveur d'engrenage, le flux PVT, la
+// synchronisation d'horloge, les profils de calibration, la rampe de
+// correction d'avance, la surveillance d'écart de poursuite, le profil de
+// démarrage, le curseur des événements sur position, les trames Modbus
+// TCP, les réponses du portail captif, l'admission des requêtes et la
+// session du jog UDP sont compilés, pour les outils hôte
+// (tools/host_core.h)
+#ifndef MOTION_CORE_ONLY
 #include <WiFi.h>
+#include <WiFiUdp.h>
 #include <WebServer.h>
-#include <AccelStepper.h>
 #include <SPIFFS.h>
-#include <DNSServer.h>
 #include <Preferences.h>
+#endif
+#ifdef ARDUINO
+#include <soc/gpio_struct.h>
+#include <driver/pcnt.h>
+#include <esp_timer.h>
+#include <esp_heap_caps.h>
+#include <esp_system.h>
+#include <lwip/sockets.h>
+#endif
+#include <limits.h>
 
 // ===== CONFIGURATION RÉSEAU =====
 const char* ap_ssid = "ESP32-Stepper";
@@ -13,29 +32,1945 @@ const char* admin_password = "admin123";
 // ===== PINS MOTEUR =====
 #define PULSE_PIN 4
 #define DIR_PIN 2
+#define STEP_PULSE_US 2       // Largeur d'impulsion STEP (driver: min 1.9µs DRV8825, 2.5µs TB6600)
+#define STEP_DIR_SETUP_US 5   // Attente entre changement de DIR et impulsion STEP
+
+// ===== PINS CODEUR (optionnel) =====
+#define ENCODER_A_PIN 18
+#define ENCODER_B_PIN 19
 
 // ===== CONFIGURATION MOTEUR (sauvegardée) =====
 float STEPS_PER_REVOLUTION = 200.0;  // Steps moteur (200 = 1.8°)
 float MICROSTEPS = 1.0;               // Microstepping driver
 float LEAD_SCREW_PITCH = 2.0;         // Pas de vis en mm
 float STEPS_PER_MM = 100.0;           // Calculé automatiquement
+float BACKLASH_MM = 0.0;              // Jeu de la vis, rattrapé aux inversions
+#define BACKLASH_MAX_MM 5.0
 
 // ===== CONFIGURATION VITESSES (sauvegardée) =====
 float SPEED_MIN = 50.0;       // Vitesse minimale mm/min
 float SPEED_MAX = 2000.0;     // Vitesse maximale mm/min
 float SPEED_DEFAULT = 300.0;  // Vitesse par défaut
 float SPEED_HOME = 600.0;     // Vitesse retour origine
+float ACCEL_FACTOR = 2.0;     // Accélération = vitesse × facteur (steps/s²)
+
+// ===== MISE EN FORME DE CONSIGNE (sauvegardée) =====
+#define SHAPER_NONE 0
+#define SHAPER_ZV 1
+#define SHAPER_ZVD 2
+#define SHAPER_EI 3
+int SHAPER_TYPE = SHAPER_NONE;
+float SHAPER_FREQ = 40.0;     // Fréquence de résonance mesurée (Hz)
+float SHAPER_DAMPING = 0.1;   // Taux d'amortissement
+unsigned long shaperDelayUs = 0;  // Retard de la dernière impulsion (calculé)
 
 // ===== LIMITES LOGICIELLES =====
 float SOFT_LIMIT_MIN = -100.0;
 float SOFT_LIMIT_MAX = 100.0;
 bool SOFT_LIMITS_ENABLED = true;
 
+// ===== CODEUR (sauvegardé) =====
+bool ENCODER_ENABLED = false;
+float ENCODER_COUNTS_PER_REV = 4000.0;  // Fronts par tour moteur (quadrature x4)
+float FOLLOWING_WARN_MM = 0.05;         // Écart consigne/codeur signalé dans les logs
+float FOLLOWING_FAULT_MM = 0.5;         // Écart qui arrête l'axe
+
+// ===== ENGRENAGE ÉLECTRONIQUE (sauvegardé) =====
+#define GEAR_STEP_PIN 34                // Entrées seules: STEP/DIR de la machine maître
+#define GEAR_DIR_PIN 35
+int32_t GEAR_NUM = 1;                   // Pas axe = impulsions maître × NUM / DEN
+int32_t GEAR_DEN = 1;
+float GEAR_FILTER_MS = 2.0;             // Lissage de la consigne (0 = aucun)
+float GEAR_FAULT_MM = 1.0;              // Écart consigne/axe qui arrête l'axe
+
+// ===== JOG UDP (sauvegardé) =====
+#define JOG_UDP_PORT 4210
+unsigned long JOG_HEARTBEAT_MS = 250;  // Fenêtre homme-mort: arrêt si aucun paquet
+
+// ===== RÉSEAU STATION / MQTT (sauvegardé) =====
+String STA_SSID = "";            // Vide: point d'accès seul
+String STA_PASSWORD = "";
+String MQTT_HOST = "";           // Vide: MQTT désactivé
+uint16_t MQTT_PORT = 1883;
+String MQTT_BASE = "stepper";    // Préfixe des topics
+String SYNC_MASTER = "";         // Unité de référence d'horloge; vide: cette unité
+
+// ===== SORTIE STEP/DIR =====
+// Les broches sont des paramètres de template: chaque front se compile en
+// une seule écriture dans le registre set/clear du GPIO, sans passer par
+// digitalWrite(). Le port est une politique pour pouvoir instancier le
+// même driver sur Linux avec un port qui enregistre les fronts.
+#ifdef ARDUINO
+struct Esp32GpioPort {
+  template <uint8_t PIN> static inline void output() { pinMode(PIN, OUTPUT); }
+  template <uint8_t PIN> static inline void set() {
+    if (PIN < 32) GPIO.out_w1ts = 1UL << PIN;
+    else GPIO.out1_w1ts.val = 1UL << ((PIN - 32) & 31);
+  }
+  template <uint8_t PIN> static inline void clear() {
+    if (PIN < 32) GPIO.out_w1tc = 1UL << PIN;
+    else GPIO.out1_w1tc.val = 1UL << ((PIN - 32) & 31);
+  }
+  static inline void wait(uint32_t us) { delayMicroseconds(us); }
+};
+#else
+// Port hôte: horloge virtuelle avancée par wait(), fronts horodatés
+struct RecordingGpioPort {
+  struct Edge {
+    uint32_t timeUs;
+    uint8_t pin;
+    uint8_t level;
+  };
+  static const size_t CAPACITY = 4096;
+  static Edge edges[CAPACITY];
+  static size_t count;
+  static uint32_t clockUs;
+
+  static void record(uint8_t pin, uint8_t level) {
+    if (count < CAPACITY) edges[count++] = { clockUs, pin, level };
+  }
+  template <uint8_t PIN> static void output() {}
+  template <uint8_t PIN> static void set() { record(PIN, 1); }
+  template <uint8_t PIN> static void clear() { record(PIN, 0); }
+  static void wait(uint32_t us) { clockUs += us; }
+};
+RecordingGpioPort::Edge RecordingGpioPort::edges[RecordingGpioPort::CAPACITY];
+size_t RecordingGpioPort::count = 0;
+uint32_t RecordingGpioPort::clockUs = 0;
+#endif
+
+template <uint8_t STEP, uint8_t DIR, class Port,
+          uint32_t PULSE_US = STEP_PULSE_US, uint32_t DIR_SETUP_US = STEP_DIR_SETUP_US>
+class StepDirDriver {
+ public:
+  void begin() {
+    Port::template output<STEP>();
+    Port::template output<DIR>();
+    Port::template clear<STEP>();
+    Port::template set<DIR>();
+    _dir = 1;
+  }
+
+  inline void step(int dir) {
+    if (dir != _dir) {
+      if (dir > 0) Port::template set<DIR>();
+      else Port::template clear<DIR>();
+      Port::wait(DIR_SETUP_US);
+      _dir = dir;
+    }
+    Port::template set<STEP>();
+    Port::wait(PULSE_US);
+    Port::template clear<STEP>();
+  }
+
+ private:
+  int _dir = 1;
+};
+
+#ifdef ARDUINO
+typedef StepDirDriver<PULSE_PIN, DIR_PIN, Esp32GpioPort> MotorDriver;
+#else
+typedef StepDirDriver<PULSE_PIN, DIR_PIN, RecordingGpioPort> MotorDriver;
+#endif
+
+// Appelé par le générateur après chaque pas émis (position déjà mise à jour)
+void onStep(long position, int dir);
+
+// ===== GÉNÉRATEUR DE PAS =====
+// Remplace AccelStepper: même interface, mais les intervalles de rampe sont
+// précalculés pour l'accélération courante au lieu d'être recalculés en
+// flottant à chaque pas. Pour une accélération constante a, le pas n part
+// de l'arrêt à t = sqrt(2n/a), donc l'intervalle n -> n+1 vaut
+// K·(sqrt(n+1) - sqrt(n)) avec K = sqrt(2/a).
+//
+// Table en µs virgule fixe 24.8: valeurs exactes pour les RAMP_HEAD_STEPS
+// premiers pas, puis 32 entrées par octave (pas de table doublant à chaque
+// octave) avec interpolation linéaire entière. L'octave se trouve avec un
+// comptage de zéros de tête: aucune division ni flottant par pas.
+//
+// Compensation du jeu: les positions internes sont celles du moteur; les
+// positions publiques sont logiques (celles de la charge). Le décalage
+// moteur - charge reste dans [-jeu, 0]: à chaque pas vers l'autre flanc, il
+// se rattrape d'abord, sans déplacer la charge. La cible moteur dépend du
+// sens d'approche final, recalculée à chaque inversion: les pas de
+// rattrapage font partie de la même rampe, sans arrêt.
+#define RAMP_HEAD_STEPS 64
+#define RAMP_HEAD_SHIFT 6
+#define RAMP_SEGMENT_SHIFT 5
+#define RAMP_OCTAVES 14
+#define RAMP_TABLE_SIZE (RAMP_HEAD_STEPS + (RAMP_OCTAVES << RAMP_SEGMENT_SHIFT) + 1)
+
+// Mise en forme de la consigne (input shaping): la position planifiée est
+// échantillonnée toutes les 128 µs, et la position émise est la somme
+// pondérée de copies retardées de cette consigne (impulsions ZV/ZVD/EI).
+// Le calcul se fait une fois par échantillon, pas à chaque pas.
+#define SHAPER_MAX_IMPULSES 4
+#define SHAPER_TICK_SHIFT 7
+#define SHAPER_TICK_US (1UL << SHAPER_TICK_SHIFT)
+#define SHAPER_HISTORY 1024        // 131 ms d'historique
+#define SHAPER_HISTORY_MASK (SHAPER_HISTORY - 1)
+#define SHAPER_MAX_DELAY_US ((SHAPER_HISTORY - 3) * SHAPER_TICK_US)
+
+template <class Driver>
+class RampStepper {
+ public:
+  void begin() { _driver.begin(); }
+
+  // Position réellement émise (en retard sur la consigne si mise en forme active)
+  long currentPosition() { return _outPos - _lashOut; }
+  long motorPosition() { return _outPos; }
+  long targetPosition() { return _logicalTarget; }
+  long distanceToGo() { return _logicalTarget - currentPosition(); }
+  long backlash() { return _lash; }
+  long backlashOffset() { return _lashPlan; }  // Moteur - charge de la consigne, dans [-jeu, 0]
+  bool backlashStep() { return _lashStep; }   // Dernier pas émis: rattrapage du jeu
+  float maxSpeed() { return _maxSpeed; }
+  float acceleration() { return _accel; }
+
+  // Arrêt immédiat à la position donnée (vide la rampe), jeu conservé
+  void setCurrentPosition(long position) {
+    _lashPlan = _lashOut;
+    _pos = position + _lashOut;
+    _outPos = _pos;
+    _target = _pos;
+    _logicalTarget = position;
+    resetShaper();
+    _rampN = 0;
+    _moving = false;
+    _intervalUs = 0;
+    _carry = 0;
+    _speedIntervalUs = 0;
+  }
+
+  void moveTo(long absolute) {
+    long planned = _pos - _lashPlan;
+    _logicalTarget = absolute;
+    if (absolute == planned && !_moving) _target = _pos;
+    else _target = motorTarget(absolute, absolute > planned ? 1 : absolute < planned ? -1 : _dir);
+  }
+  void move(long relative) { moveTo(_pos - _lashPlan + relative); }
+
+  // Jeu en pas, à l'arrêt; la position logique est conservée
+  void setBacklash(long steps) {
+    steps = max(0L, steps);
+    if (steps == _lash) return;
+    long position = currentPosition();
+    _lash = steps;
+    _lashOut = max(-_lash, min(0L, _lashOut));
+    setCurrentPosition(position);
+  }
+
+  void setMaxSpeed(float speed) {
+    if (speed <= 0 || speed == _maxSpeed) return;
+    _maxSpeed = speed;
+    _cminFx = (uint32_t)(256000000.0 / speed);
+    updateRampLimit();
+  }
+
+  void setAcceleration(float accel) {
+    if (accel <= 0 || accel == _accel) return;
+    // En mouvement, le rang dans la rampe est converti pour garder la même
+    // vitesse (v = sqrt(2·a·n)): pas de saut de vitesse au changement
+    if (_moving && _accel > 0) _rampN = (uint32_t)(_rampN * _accel / accel);
+    _accel = accel;
+    buildTable();
+    updateRampLimit();
+  }
+
+  // Vitesse constante pour runSpeed() (steps/s, signe = direction)
+  void setSpeed(float speed) {
+    _speed = speed;
+    _speedDir = speed >= 0 ? 1 : -1;
+    _speedIntervalUs = speed == 0 ? 0 : (uint32_t)(1000000.0 / abs(speed));
+  }
+
+  float speed() {
+    if (_speedIntervalUs != 0) return _speed;
+    if (!_moving || _intervalUs == 0) return 0;
+    return _dir * 1000000.0 / _intervalUs;
+  }
+
+  bool isRunning() { return _moving || _target != _pos || shaping(); }
+
+  // Impulsions de mise en forme: amplitudes Q16 (somme 65536), retards en µs.
+  // count = 0 désactive (pas émis directement par le planificateur).
+  void setShaper(int count, const int32_t* amplitudes, const uint32_t* delaysUs) {
+    _shaperCount = min(count, SHAPER_MAX_IMPULSES);
+    for (int i = 0; i < _shaperCount; i++) {
+      _shaperAmp[i] = amplitudes[i];
+      uint32_t delayUs = delaysUs[i] < SHAPER_MAX_DELAY_US ? delaysUs[i] : SHAPER_MAX_DELAY_US;
+      _shaperLag[i] = (delayUs << 8) >> SHAPER_TICK_SHIFT;
+    }
+    _pos = _outPos;
+    _lashPlan = _lashOut;
+    resetShaper();
+  }
+
+  // Intervalle commandé du pas en cours (µs), sans division
+  uint32_t stepInterval() { return _speedIntervalUs != 0 ? _speedIntervalUs : _intervalUs; }
+
+  // Décélère jusqu'à l'arrêt en suivant la rampe
+  void stop() {
+    _speedIntervalUs = 0;
+    if (!_moving) {
+      holdTarget();
+      return;
+    }
+    // Pas de freinage: le pas déjà programmé, puis un par rang de rampe
+    // (plan() arrive sur la cible avec _rampN == 0 au pas précédent).
+    // Charge déplacée d'autant, moins le jeu restant à rattraper.
+    long braking = (long)_rampN + 1;
+    long slack = _dir > 0 ? -_lashPlan : _lashPlan + _lash;
+    _target = _pos + _dir * braking;
+    _logicalTarget = _pos - _lashPlan + _dir * max(0L, braking - slack);
+  }
+
+  // Retourne true si un pas a été émis
+  bool runSpeed() {
+    if (_shaperCount == 0) return speedStep();
+    speedStep();
+    return shapeOutput();
+  }
+
+  // Suiveur (engrenage): un pas au plus vers la cible, espacés d'au moins
+  // minIntervalUs. Pas de rampe: la cible est déjà lissée par l'appelant.
+  bool follow(long target, uint32_t minIntervalUs) {
+    bool stepped = false;
+    unsigned long now = micros();
+    long planned = _pos - _lashPlan;
+    if (target != planned && now - _lastStepTime >= minIntervalUs) {
+      _intervalUs = now - _lastStepTime;
+      _lastStepTime = now;
+      outputStep(target > planned ? 1 : -1);
+      stepped = true;
+    }
+    holdTarget();
+    if (_shaperCount != 0) shapeOutput();
+    return stepped;
+  }
+
+  // Un pas au plus par appel; retourne false une fois la cible atteinte
+  bool run() {
+    bool planning = plan();
+    if (_shaperCount == 0) return planning;
+    shapeOutput();
+    return planning || shaping();
+  }
+
+  // Intervalle n -> n+1 en µs 24.8, interpolé entre les entrées de la table
+  uint32_t interval(uint32_t n) {
+    if (n < RAMP_HEAD_STEPS) return _table[n];
+    int octave = 31 - __builtin_clz(n >> RAMP_HEAD_SHIFT);
+    if (octave >= RAMP_OCTAVES) return _table[RAMP_TABLE_SIZE - 1];
+
+    int shift = RAMP_HEAD_SHIFT - RAMP_SEGMENT_SHIFT + octave;
+    uint32_t offset = n - ((uint32_t)RAMP_HEAD_STEPS << octave);
+    uint32_t index = RAMP_HEAD_STEPS + (octave << RAMP_SEGMENT_SHIFT) + (offset >> shift);
+    uint32_t frac = offset & ((1UL << shift) - 1);
+    uint32_t a = _table[index];
+    uint32_t b = _table[index + 1];
+    return a - (((a - b) * frac) >> shift);
+  }
+
+ private:
+  bool speedStep() {
+    if (_speedIntervalUs == 0) return false;
+    unsigned long now = micros();
+    if (now - _lastStepTime < _speedIntervalUs) return false;
+    _lastStepTime = now;
+    outputStep(_speedDir);
+    holdTarget();
+    return true;
+  }
+
+  // Cible moteur pour une cible logique atteinte dans le sens dir
+  long motorTarget(long logical, int dir) { return dir > 0 ? logical : logical - _lash; }
+
+  void holdTarget() {
+    _target = _pos;
+    _logicalTarget = _pos - _lashPlan;
+  }
+
+  bool plan() {
+    unsigned long now = micros();
+    if (!_moving) {
+      if (_target == _pos) return false;
+      _dir = _target > _pos ? 1 : -1;
+      _rampN = 0;
+      _carry = 0;
+      _moving = true;
+    } else if (now - _lastStepTime < _intervalUs) {
+      return true;
+    }
+
+    _lastStepTime = now;
+    outputStep(_dir);
+
+    long remaining = (_target - _pos) * _dir;
+    uint32_t fx;
+    if (remaining == 0 && _rampN == 0) {
+      // Arrivé
+      _moving = false;
+      _intervalUs = 0;
+      return false;
+    } else if (remaining < 0 && _rampN == 0) {
+      // Cible passée derrière: vitesse nulle atteinte, le premier pas dans
+      // l'autre sens attend l'intervalle du premier pas de rampe. Le sens
+      // d'approche change: la cible moteur inclut ou non le jeu.
+      _dir = -_dir;
+      _target = motorTarget(_logicalTarget, _dir);
+      fx = interval(0);
+    } else if (remaining <= (long)_rampN || _rampN > _rampMax) {
+      _rampN--;
+      fx = interval(_rampN);
+    } else if (_rampN < _rampMax && remaining > (long)_rampN + 1) {
+      // N'accélère que s'il reste de quoi redescendre à zéro sur la cible
+      fx = max(interval(_rampN), _cminFx);
+      _rampN++;
+    } else {
+      fx = max(interval(_rampN), _cminFx);
+    }
+
+    fx += _carry;
+    _intervalUs = fx >> 8;
+    _carry = fx & 0xFF;
+    return true;
+  }
+
+  bool shaping() {
+    if (_shaperCount == 0) return false;
+    int64_t rest = (int64_t)_pos << 8;
+    return _outPos != _pos || _shapedPrev != rest || _shapedNext != rest;
+  }
+
+  void resetShaper() {
+    for (int i = 0; i < SHAPER_HISTORY; i++) _hist[i] = _pos;
+    _histHead = 0;
+    _histTime = micros();
+    _shapedPrev = (int64_t)_pos << 8;
+    _shapedNext = _shapedPrev;
+  }
+
+  // Position mise en forme (steps 24.8) à "back" échantillons du plus récent
+  int64_t shapedAt(uint32_t back) {
+    int64_t sum = 0;
+    for (int i = 0; i < _shaperCount; i++) {
+      uint32_t lag = _shaperLag[i] + (back << 8);
+      uint32_t k = lag >> 8;
+      int32_t frac = lag & 0xFF;
+      int32_t a = _hist[(_histHead - k) & SHAPER_HISTORY_MASK];
+      int32_t b = _hist[(_histHead - k - 1) & SHAPER_HISTORY_MASK];
+      sum += (int64_t)_shaperAmp[i] * (((int64_t)a << 8) + (int64_t)(b - a) * frac);
+    }
+    return sum >> 16;
+  }
+
+  // Échantillonne la consigne, puis émet au plus un pas vers la position
+  // mise en forme, interpolée sur l'échantillon en cours (retard d'un tick)
+  bool shapeOutput() {
+    unsigned long now = micros();
+    uint32_t elapsed = now - _histTime;
+    if (elapsed >= SHAPER_TICK_US) {
+      uint32_t ticks = elapsed >> SHAPER_TICK_SHIFT;
+      if (ticks >= SHAPER_HISTORY) ticks = SHAPER_HISTORY;
+      for (uint32_t i = 0; i < ticks; i++) {
+        _histHead = (_histHead + 1) & SHAPER_HISTORY_MASK;
+        _hist[_histHead] = _pos;
+      }
+      _histTime += (elapsed >> SHAPER_TICK_SHIFT) << SHAPER_TICK_SHIFT;
+      _shapedPrev = shapedAt(1);
+      _shapedNext = shapedAt(0);
+      elapsed = now - _histTime;
+    }
+
+    int64_t target = _shapedPrev + (((_shapedNext - _shapedPrev) * (int64_t)elapsed) >> SHAPER_TICK_SHIFT);
+    long targetSteps = (long)((target + 128) >> 8);
+    if (targetSteps == _outPos) return false;
+    emitStep(targetSteps > _outPos ? 1 : -1);
+    return true;
+  }
+
+  void buildTable() {
+    float k = sqrt(2.0 / _accel) * 256000000.0;
+    for (uint32_t i = 0; i < RAMP_TABLE_SIZE; i++) {
+      uint32_t n = i;
+      if (i >= RAMP_HEAD_STEPS) {
+        uint32_t octave = (i - RAMP_HEAD_STEPS) >> RAMP_SEGMENT_SHIFT;
+        uint32_t slot = (i - RAMP_HEAD_STEPS) & ((1 << RAMP_SEGMENT_SHIFT) - 1);
+        n = ((uint32_t)RAMP_HEAD_STEPS << octave) + (slot << (RAMP_HEAD_SHIFT - RAMP_SEGMENT_SHIFT + octave));
+      }
+      _table[i] = (uint32_t)(k / (sqrt((float)n + 1) + sqrt((float)n)));
+    }
+  }
+
+  void updateRampLimit() {
+    if (_accel <= 0 || _maxSpeed <= 0) return;
+    _rampMax = (uint32_t)((_maxSpeed * _maxSpeed) / (2.0 * _accel));
+  }
+
+  // Pas planifié: émis directement, ou via la mise en forme si active
+  inline void outputStep(int dir) {
+    _pos += dir;
+    if (dir > 0 ? _lashPlan < 0 : _lashPlan > -_lash) _lashPlan += dir;
+    if (_shaperCount == 0) emitStep(dir);
+  }
+
+  inline void emitStep(int dir) {
+    _outPos += dir;
+    _lashStep = dir > 0 ? _lashOut < 0 : _lashOut > -_lash;
+    if (_lashStep) _lashOut += dir;
+    _driver.step(dir);
+    onStep(_outPos - _lashOut, dir);
+  }
+
+  Driver _driver;
+  uint32_t _table[RAMP_TABLE_SIZE];
+  long _pos = 0;
+  long _target = 0;
+  long _logicalTarget = 0;
+  long _lash = 0;            // Jeu (pas moteur)
+  long _lashPlan = 0;        // Décalage moteur - charge de la consigne, dans [-_lash, 0]
+  long _lashOut = 0;         // Idem pour les pas émis
+  bool _lashStep = false;
+  float _maxSpeed = 0;
+  float _accel = 0;
+  float _speed = 0;
+  uint32_t _cminFx = 0;
+  uint32_t _rampN = 0;       // Index dans la rampe (vitesse ≈ sqrt(2·a·n))
+  uint32_t _rampMax = 0;     // Index correspondant à la vitesse max
+  uint32_t _intervalUs = 0;
+  uint32_t _carry = 0;       // Reste 1/256 µs reporté au pas suivant
+  uint32_t _speedIntervalUs = 0;
+  unsigned long _lastStepTime = 0;
+  int _dir = 1;
+  int _speedDir = 1;
+  bool _moving = false;
+
+  long _outPos = 0;
+  int _shaperCount = 0;
+  int32_t _shaperAmp[SHAPER_MAX_IMPULSES];
+  uint32_t _shaperLag[SHAPER_MAX_IMPULSES];   // Retard en échantillons 24.8
+  int32_t _hist[SHAPER_HISTORY];
+  uint32_t _histHead = 0;
+  unsigned long _histTime = 0;
+  int64_t _shapedPrev = 0;
+  int64_t _shapedNext = 0;
+};
+
+// ===== IMPULSIONS DE MISE EN FORME =====
+// Amplitudes normalisées (Q16, somme 65536) et retards en fractions de la
+// période amortie du mode à filtrer.
+struct ShaperDesign {
+  // Nombre d'impulsions (0 sans filtre), -1 si le retard total dépasse
+  // l'historique du générateur
+  static int impulses(int type, float freq, float damping, int32_t* amplitudes, uint32_t* delays) {
+    if (type == SHAPER_NONE) return 0;
+    float root = sqrt(1.0 - damping * damping);
+    float k = exp(-damping * M_PI / root);
+    float halfPeriodUs = 500000.0 / (freq * root);
+    float weights[3];
+    int count;
+
+    if (type == SHAPER_ZV) {
+      weights[0] = 1.0;
+      weights[1] = k;
+      count = 2;
+    } else if (type == SHAPER_ZVD) {
+      weights[0] = 1.0;
+      weights[1] = 2.0 * k;
+      weights[2] = k * k;
+      count = 3;
+    } else {
+      const float vtol = 0.05;  // Vibration résiduelle tolérée (EI)
+      weights[0] = 0.25 * (1.0 + vtol);
+      weights[1] = 0.5 * (1.0 - vtol) * k;
+      weights[2] = weights[0] * k * k;
+      count = 3;
+    }
+
+    if (halfPeriodUs * (count - 1) > SHAPER_MAX_DELAY_US) return -1;
+
+    float total = 0;
+    for (int i = 0; i < count; i++) total += weights[i];
+    int32_t assigned = 0;
+    for (int i = 0; i < count; i++) {
+      amplitudes[i] = (i == count - 1) ? 65536 - assigned : lround(weights[i] / total * 65536.0);
+      assigned += amplitudes[i];
+      delays[i] = (uint32_t)(halfPeriodUs * i);
+    }
+    return count;
+  }
+};
+
+// ===== PLANIFICATION À BLANC =====
+// Durée d'un déplacement avec la logique de run(): premier pas immédiat,
+// m intervalles d'accélération (n < rampMax, en gardant de quoi freiner),
+// croisière, puis m intervalles de décélération. La somme des intervalles
+// d'accélération se télescope: sum(K·(sqrt(n+1)-sqrt(n)), n<m) = K·sqrt(m).
+// Le rattrapage du jeu à une inversion fait partie de la même rampe: le
+// moteur fait |steps| + takeup pas.
+struct MovePlan {
+  long steps;
+  long backlashSteps;       // Pas de rattrapage du jeu inclus dans la rampe
+  float peakSpeed;          // steps/s
+  unsigned long accelUs;
+  unsigned long cruiseUs;
+  unsigned long decelUs;
+  unsigned long settleUs;   // Retard de la mise en forme
+  unsigned long totalUs;
+};
+
+struct MovePlanner {
+  // Pas de rattrapage d'un déplacement dans le sens dir, depuis un décalage
+  // moteur - charge offset (dans [-lash, 0], cf. RampStepper)
+  static long takeup(long offset, long lash, int dir) { return dir > 0 ? -offset : offset + lash; }
+  // Décalage une fois le déplacement terminé dans le sens dir
+  static long offsetAfter(long lash, int dir) { return dir > 0 ? 0 : -lash; }
+
+  template <class Stepper>
+  static MovePlan estimate(Stepper& stepper, long steps, long takeup, float maxSpeed, float accel,
+                           unsigned long settleUs) {
+    MovePlan plan = {};
+    plan.steps = steps;
+    if (steps == 0 || maxSpeed <= 0 || accel <= 0) return plan;
+    plan.backlashSteps = takeup;
+    long intervals = abs(steps) + takeup - 1;
+
+    float k = sqrt(2.0 / accel) * 1000000.0;     // µs
+    long rampMax = (long)((maxSpeed * maxSpeed) / (2.0 * accel));
+
+    long m = min(rampMax, intervals / 2);
+    long cruise = intervals - 2 * m;
+    float rampUs = k * sqrt((float)m);
+
+    // Croisière: même intervalle 24.8 que run(), max(table(m), cmin), la
+    // table interpolée étant remise à l'échelle si elle a été construite
+    // pour une autre accélération. L'erreur par pas se cumule sur les longues
+    // croisières, d'où le calcul entier.
+    uint32_t cruiseFx = (uint32_t)(k * (sqrt((float)m + 1) - sqrt((float)m)) * 256.0);
+    if (stepper.acceleration() > 0) {
+      cruiseFx = (uint32_t)(stepper.interval(m) * sqrt(stepper.acceleration() / accel));
+    }
+    uint32_t cminFx = (uint32_t)(256000000.0 / maxSpeed);
+    if (cruiseFx < cminFx) cruiseFx = cminFx;
+    float cruiseInterval = cruiseFx / 256.0;
+
+    plan.accelUs = (unsigned long)rampUs;
+    plan.decelUs = (unsigned long)rampUs;
+    plan.cruiseUs = (unsigned long)(((uint64_t)cruise * cruiseFx) >> 8);
+    plan.settleUs = settleUs;
+    plan.totalUs = plan.accelUs + plan.cruiseUs + plan.decelUs + plan.settleUs;
+    if (cruise > 0) {
+      plan.peakSpeed = 1000000.0 / cruiseInterval;
+    } else if (m > 0) {
+      plan.peakSpeed = 1000000.0 / (k * (sqrt((float)m) - sqrt((float)m - 1)));
+    }
+    return plan;
+  }
+};
+
+// ===== ODOMÈTRE =====
+// Compteurs d'usure sur la vie de l'axe. Le chemin de pas n'incrémente que
+// des compteurs de session (pas, inversions, intervalle le plus court);
+// tick() les reporte chaque seconde dans les totaux et dit quand écrire en
+// NVS: au repos après ODOMETER_SAVE_INTERVAL_MS, en mouvement seulement
+// après ODOMETER_SAVE_MAX_MS (l'écriture flash suspend le pas). Au plus
+// 3600000 / ODOMETER_SAVE_INTERVAL_MS écritures par heure, d'un seul blob;
+// la NVS répartit elle-même les écritures sur ses pages.
+#define ODOMETER_VERSION 1
+#define ODOMETER_TICK_MS 1000
+#define ODOMETER_SAVE_INTERVAL_MS 900000UL  // 15 min
+#define ODOMETER_SAVE_MAX_MS 3600000UL      // Écriture forcée en mouvement
+
+struct OdometerTotals {
+  uint32_t version = ODOMETER_VERSION;
+  uint32_t saves = 0;     // Écritures NVS, celle-ci comprise
+  uint64_t steps = 0;
+  uint64_t distanceUm = 0;
+  uint64_t motionMs = 0;
+  uint32_t reversals = 0;
+  uint32_t moves = 0;
+  float peakSpeed = 0;    // mm/min
+  uint32_t reserved = 0;
+};
+
+struct Odometer {
+  OdometerTotals totals;
+  uint32_t sessionSteps = 0;
+  uint32_t sessionReversals = 0;
+  uint32_t minIntervalUs = UINT32_MAX;
+  int lastDir = 0;
+  bool running = false;
+  bool dirty = false;
+  unsigned long runStartMs = 0;
+  unsigned long lastTickMs = 0;
+  unsigned long lastSaveMs = 0;
+  double umCarry = 0;     // Fraction de µm reportée
+
+  // Chemin de pas: intervalle commandé avant ce pas (µs, 0 si inconnu)
+  inline void step(int dir, uint32_t intervalUs) {
+    sessionSteps++;
+    if (dir != lastDir) {
+      if (lastDir != 0) sessionReversals++;
+      lastDir = dir;
+    }
+    if (intervalUs != 0 && intervalUs < minIntervalUs) minIntervalUs = intervalUs;
+  }
+
+  void moveStarted() {
+    totals.moves++;
+    dirty = true;
+  }
+
+  // Reporte la session dans les totaux; à appeler aussi avant de changer
+  // de pas/mm, la distance étant comptée au pas/mm du moment
+  void fold(float stepsPerMm, unsigned long nowMs) {
+    if (running) {
+      totals.motionMs += nowMs - runStartMs;
+      runStartMs = nowMs;
+      dirty = true;
+    }
+    if (sessionSteps > 0) {
+      double um = sessionSteps * 1000.0 / stepsPerMm + umCarry;
+      uint64_t whole = (uint64_t)um;
+      umCarry = um - whole;
+      totals.steps += sessionSteps;
+      totals.distanceUm += whole;
+      totals.reversals += sessionReversals;
+      sessionSteps = 0;
+      sessionReversals = 0;
+      dirty = true;
+    }
+    if (minIntervalUs != UINT32_MAX) {
+      totals.peakSpeed = max(totals.peakSpeed, (float)(60000000.0 / (minIntervalUs * (double)stepsPerMm)));
+      minIntervalUs = UINT32_MAX;
+    }
+  }
+
+  // Appelé à chaque tour de boucle; true quand les totaux sont à écrire
+  bool tick(unsigned long nowMs, bool isRunning, float stepsPerMm) {
+    if (isRunning != running) {
+      if (isRunning) runStartMs = nowMs;
+      else fold(stepsPerMm, nowMs);
+      running = isRunning;
+    }
+    if (nowMs - lastTickMs < ODOMETER_TICK_MS) return false;
+    lastTickMs = nowMs;
+    fold(stepsPerMm, nowMs);
+    if (!dirty) return false;
+    return nowMs - lastSaveMs >= (running ? ODOMETER_SAVE_MAX_MS : ODOMETER_SAVE_INTERVAL_MS);
+  }
+
+  void saved(unsigned long nowMs) {
+    dirty = false;
+    lastSaveMs = nowMs;
+  }
+};
+
+// ===== ENGRENAGE ÉLECTRONIQUE =====
+// L'axe suit un compteur d'impulsions maître. Consigne exacte en entiers,
+// origine + (maître - origine maître) × num / den (aucune dérive, quelle
+// que soit la durée), bornée aux limites logicielles, puis lissée par un
+// premier ordre de constante filterUs (reste de division reporté: la
+// consigne lissée rejoint exactement la consigne). L'écart surveillé est
+// consigne bornée - position: il comprend le retard du filtre, v × filterUs.
+#define GEAR_RATE_WINDOW_US 10000
+
+struct GearFollower {
+  int32_t num = 1;
+  int32_t den = 1;          // > 0
+  uint32_t filterUs = 2000;
+  long faultSteps = 100;
+  long minSteps = LONG_MIN;
+  long maxSteps = LONG_MAX;
+  long masterOrigin = 0;
+  long axisOrigin = 0;
+  long command = 0;         // Consigne exacte, bornée
+  bool limited = false;     // Consigne maître hors limites (axe tenu sur la limite)
+  long error = 0;
+  long peakError = 0;
+  int64_t smoothed = 0;     // Consigne lissée, steps 24.8
+  int64_t filterRem = 0;
+  uint32_t lastUs = 0;
+  long rateMaster = 0;
+  uint32_t rateStartUs = 0;
+  float inputRate = 0;      // Impulsions maître/s sur la dernière fenêtre
+  float peakInputRate = 0;
+
+  void engage(long master, long axis, uint32_t nowUs) {
+    masterOrigin = master;
+    axisOrigin = axis;
+    command = axis;
+    limited = false;
+    error = 0;
+    peakError = 0;
+    smoothed = (int64_t)axis << 8;
+    filterRem = 0;
+    lastUs = nowUs;
+    rateMaster = master;
+    rateStartUs = nowUs;
+    inputRate = 0;
+    peakInputRate = 0;
+  }
+
+  // Division arrondie vers -infini: pas de palier double en passant l'origine
+  long geared(long master) {
+    int64_t scaled = (int64_t)(master - masterOrigin) * num;
+    int64_t q = scaled / den;
+    if (scaled % den != 0 && scaled < 0) q--;
+    return axisOrigin + (long)q;
+  }
+
+  // Retourne la cible lissée (steps) à donner au générateur
+  long update(long master, long axis, uint32_t nowUs) {
+    long exact = geared(master);
+    limited = exact < minSteps || exact > maxSteps;
+    command = exact < minSteps ? minSteps : (exact > maxSteps ? maxSteps : exact);
+
+    uint32_t dt = nowUs - lastUs;
+    lastUs = nowUs;
+    int64_t target = (int64_t)command << 8;
+    if (filterUs == 0 || dt >= filterUs) {
+      smoothed = target;
+      filterRem = 0;
+    } else {
+      int64_t scaled = (target - smoothed) * dt + filterRem;
+      int64_t delta = scaled / filterUs;
+      filterRem = scaled - delta * filterUs;
+      smoothed += delta;
+    }
+
+    error = command - axis;
+    peakError = max(peakError, labs(error));
+
+    uint32_t window = nowUs - rateStartUs;
+    if (window >= GEAR_RATE_WINDOW_US) {
+      inputRate = labs(master - rateMaster) * 1000000.0 / window;
+      peakInputRate = max(peakInputRate, inputRate);
+      rateMaster = master;
+      rateStartUs = nowUs;
+    }
+    return (long)((smoothed + 128) >> 8);
+  }
+
+  bool fault() { return labs(error) >= faultSteps; }
+};
+
+// ===== TRAJECTOIRE PVT =====
+// File de points position/vitesse/durée, chacun atteint depuis le précédent
+// par un segment d'Hermite cubique: position et vitesse continues à chaque
+// point. Coefficients calculés une fois par segment; par tour de boucle, un
+// polynôme de degré 3 en flottant, relatif au début du segment (précision
+// conservée loin de l'origine). Le temps du segment suivant part de la fin
+// exacte du précédent: pas de dérive d'horloge sur un long flux.
+// File vide avec une vitesse finale non nulle: rupture de flux (underrun),
+// la consigne reste sur le dernier point. Une reprise (points ajoutés après
+// la fin ou la rupture) repart de l'instant présent: pas de bond de
+// rattrapage.
+#define PVT_CAPACITY 128
+#define PVT_RUNNING 0
+#define PVT_DONE 1
+#define PVT_UNDERRUN 2
+
+struct PvtPoint {
+  long position;          // Steps
+  float velocity;         // Steps/s
+  uint32_t durationUs;    // Depuis le point précédent
+};
+
+struct PvtStream {
+  PvtPoint points[PVT_CAPACITY];
+  uint16_t head = 0;
+  uint16_t count = 0;
+  long p0 = 0;            // Segment en cours: p0 + ((c3·τ + c2)·τ + c1)·τ
+  float c1 = 0;
+  float c2 = 0;
+  float c3 = 0;
+  float v1 = 0;           // Vitesse au point d'arrivée
+  long p1 = 0;
+  uint32_t segUs = 0;
+  uint32_t segStartUs = 0;
+  bool inSegment = false;
+  uint32_t segments = 0;
+  uint32_t underruns = 0;
+
+  uint16_t space() { return PVT_CAPACITY - count; }
+
+  void clear() {
+    head = 0;
+    count = 0;
+    inSegment = false;
+  }
+
+  bool push(const PvtPoint& point) {
+    if (count == PVT_CAPACITY || point.durationUs == 0) return false;
+    points[(head + count) % PVT_CAPACITY] = point;
+    count++;
+    return true;
+  }
+
+  // Départ à l'arrêt depuis la position de l'axe
+  void start(long position, uint32_t nowUs) {
+    p1 = position;
+    v1 = 0;
+    segStartUs = nowUs;
+    segUs = 0;
+    inSegment = false;
+  }
+
+  // Prochain segment depuis (p1, v1); false si la file est vide
+  bool load() {
+    if (count == 0) return false;
+    const PvtPoint& next = points[head];
+    head = (head + 1) % PVT_CAPACITY;
+    count--;
+    segStartUs += segUs;
+    segUs = next.durationUs;
+    float t = segUs * 1e-6f;
+    float delta = (float)(next.position - p1);
+    float m0 = v1 * t;
+    float m1 = next.velocity * t;
+    p0 = p1;
+    c1 = m0;
+    c2 = 3 * delta - 2 * m0 - m1;
+    c3 = -2 * delta + m0 + m1;
+    p1 = next.position;
+    v1 = next.velocity;
+    inSegment = true;
+    segments++;
+    return true;
+  }
+
+  // Consigne (steps) à l'instant nowUs
+  int update(uint32_t nowUs, long& target) {
+    if (!inSegment) {
+      if (count == 0) {
+        target = p1;
+        return PVT_DONE;
+      }
+      segStartUs = nowUs;
+      segUs = 0;
+      load();
+    }
+    while (nowUs - segStartUs >= segUs) {
+      if (!load()) {
+        inSegment = false;
+        target = p1;
+        if (v1 == 0) return PVT_DONE;
+        underruns++;
+        v1 = 0;  // Consigne tenue: une reprise part de l'arrêt
+        return PVT_UNDERRUN;
+      }
+    }
+    float tau = (float)(nowUs - segStartUs) / segUs;
+    target = p0 + lroundf(((c3 * tau + c2) * tau + c1) * tau);
+    return PVT_RUNNING;
+  }
+};
+
+// ===== SYNCHRONISATION D'HORLOGE =====
+// Échange à quatre temps avec l'unité de référence (comme NTP): t1 envoi
+// local, t2 réception et t3 réponse sur la référence, t4 réception locale.
+// Écart = ((t2 - t1) + (t3 - t4)) / 2, à ± aller-retour / 2 près (délais
+// aller et retour inconnus). Seuls les échanges récents dont l'aller-retour
+// est proche du meilleur comptent: leur moyenne donne l'écart. La dérive
+// des quartz, trop bruitée sur quelques échanges, est la pente des moindres
+// carrés sur le meilleur échange de chaque série de SYNC_SAMPLES (environ
+// deux minutes d'historique).
+#define SYNC_SAMPLES 8
+#define SYNC_HISTORY 16
+#define SYNC_RATE_MAX 0.0005          // Dérive plausible (500 ppm)
+#define SYNC_RATE_BASE_US 30000000LL  // Base minimale de mesure de la dérive
+#define SYNC_STEP_US 10000            // Saut d'écart qui relance l'estimation
+
+struct SyncSample {
+  int64_t localUs;     // Milieu de l'échange, horloge locale
+  int64_t offsetUs;    // Référence - locale
+  uint32_t delayUs;    // Aller-retour hors traitement sur la référence
+};
+
+struct ClockSync {
+  SyncSample samples[SYNC_SAMPLES];
+  uint8_t next = 0;
+  uint8_t count = 0;
+  SyncSample history[SYNC_HISTORY];  // Meilleur échange de chaque série
+  uint8_t historyNext = 0;
+  uint8_t historyCount = 0;
+  SyncSample seriesBest;
+  uint8_t seriesCount = 0;
+  int64_t baseLocalUs = 0;   // Écart(t) = baseOffsetUs + rate·(t - baseLocalUs)
+  int64_t baseOffsetUs = 0;
+  double rate = 0;
+  uint32_t errorUs = 0;      // Demi aller-retour du meilleur échange retenu
+  int64_t lastLocalUs = 0;
+  bool valid = false;
+  uint32_t exchanges = 0;
+  uint32_t rejected = 0;
+  uint32_t restarts = 0;
+
+  void reset() {
+    next = 0;
+    count = 0;
+    historyNext = 0;
+    historyCount = 0;
+    seriesCount = 0;
+    rate = 0;
+    valid = false;
+  }
+
+  int64_t offset(int64_t localUs) {
+    return baseOffsetUs + (int64_t)(rate * (double)(localUs - baseLocalUs));
+  }
+
+  // Horloge de référence estimée à l'instant local donné
+  int64_t now(int64_t localUs) { return localUs + offset(localUs); }
+
+  bool sample(int64_t t1, int64_t t2, int64_t t3, int64_t t4) {
+    int64_t delay = (t4 - t1) - (t3 - t2);
+    if (t4 < t1 || t3 < t2 || delay < 0 || delay > UINT32_MAX) {
+      rejected++;
+      return false;
+    }
+    SyncSample s;
+    s.localUs = t1 + (t4 - t1) / 2;
+    s.offsetUs = ((t2 - t1) + (t3 - t4)) / 2;
+    s.delayUs = (uint32_t)delay;
+
+    // Référence redémarrée ou remplacée: l'historique ne vaut plus rien
+    // (au-delà de l'incertitude de l'échange et de l'estimation en cours)
+    if (valid && llabs(s.offsetUs - offset(s.localUs)) > SYNC_STEP_US + delay / 2 + errorUs) {
+      reset();
+      restarts++;
+    }
+    samples[next] = s;
+    next = (next + 1) % SYNC_SAMPLES;
+    if (count < SYNC_SAMPLES) count++;
+    exchanges++;
+    lastLocalUs = t4;
+
+    if (seriesCount == 0 || s.delayUs < seriesBest.delayUs) seriesBest = s;
+    if (++seriesCount == SYNC_SAMPLES) {
+      history[historyNext] = seriesBest;
+      historyNext = (historyNext + 1) % SYNC_HISTORY;
+      if (historyCount < SYNC_HISTORY) historyCount++;
+      seriesCount = 0;
+      fitRate();
+    }
+    fit();
+    return true;
+  }
+
+  void fitRate() {
+    int64_t origin = history[0].localUs;
+    double meanX = 0, meanY = 0;
+    for (uint8_t i = 0; i < historyCount; i++) {
+      meanX += (double)(history[i].localUs - origin);
+      meanY += (double)history[i].offsetUs;
+    }
+    meanX /= historyCount;
+    meanY /= historyCount;
+    double sxx = 0, sxy = 0;
+    int64_t first = history[0].localUs;
+    int64_t last = history[0].localUs;
+    for (uint8_t i = 0; i < historyCount; i++) {
+      double x = (double)(history[i].localUs - origin) - meanX;
+      sxx += x * x;
+      sxy += x * ((double)history[i].offsetUs - meanY);
+      first = min(first, history[i].localUs);
+      last = max(last, history[i].localUs);
+    }
+    if (historyCount >= 3 && last - first >= SYNC_RATE_BASE_US) {
+      rate = max(-SYNC_RATE_MAX, min(SYNC_RATE_MAX, sxy / sxx));
+    }
+  }
+
+  void fit() {
+    uint32_t best = UINT32_MAX;
+    for (uint8_t i = 0; i < count; i++) best = min(best, samples[i].delayUs);
+    // Retenus: aller-retour à 25% (+ 50 µs) du meilleur, ramenés au dernier
+    // échange avec la dérive connue
+    uint32_t accept = best + best / 4 + 50;
+    int64_t latest = samples[(next + SYNC_SAMPLES - 1) % SYNC_SAMPLES].localUs;
+    double sum = 0;
+    int used = 0;
+    for (uint8_t i = 0; i < count; i++) {
+      if (samples[i].delayUs > accept) continue;
+      sum += (double)samples[i].offsetUs + rate * (double)(latest - samples[i].localUs);
+      used++;
+    }
+    baseLocalUs = latest;
+    baseOffsetUs = (int64_t)(sum / used);
+    errorUs = best / 2;
+    valid = true;
+  }
+};
+
+// ===== PROFILS DE CALIBRATION =====
+// Jeux de réglages nommés (moteur, vis, vitesses, limites) pour changer
+// d'outillage sans recalibrer. Les constantes dérivées sont calculées à
+// l'enregistrement: le changement de profil n'est qu'une copie, en temps
+// constant. La position physique est conservée: elle est reconvertie au
+// nouveau pas/mm (PositionCarry).
+#define PROFILE_COUNT 4
+#define PROFILE_NAME_MAX 15
+#define PROFILE_VERSION 2                // 2: jeu (dans l'ancien remplissage)
+
+struct CalibrationProfile {
+  uint32_t version = PROFILE_VERSION;
+  char name[PROFILE_NAME_MAX + 1] = "";
+  float stepsPerRev = 200.0;
+  float microsteps = 1.0;
+  float pitch = 2.0;
+  float speedMin = 50.0;
+  float speedMax = 2000.0;
+  float speedDefault = 300.0;
+  float speedHome = 600.0;
+  float limitMin = -100.0;
+  float limitMax = 100.0;
+  bool limitsEnabled = true;
+  float backlash = 0.0;       // Place du remplissage avant stepsPerMm: taille inchangée
+  // Dérivés (derive())
+  double stepsPerMm = 100.0;
+  float accelDefault = 0;     // steps/s² à la vitesse par défaut
+  long limitMinSteps = 0;
+  long limitMaxSteps = 0;
+  uint32_t minIntervalUs = 0;  // À speedMax
+
+  bool used() const { return name[0] != 0; }
+
+  bool valid() const {
+    return stepsPerRev > 0 && microsteps > 0 && pitch > 0 && speedMin > 0 && speedMin < speedMax &&
+           speedDefault > 0 && speedHome > 0 && limitMin < limitMax && backlash >= 0 && backlash <= BACKLASH_MAX_MM;
+  }
+
+  void derive(float accelFactor) {
+    stepsPerMm = (double)stepsPerRev * microsteps / pitch;
+    accelDefault = speedDefault * stepsPerMm / 60.0 * accelFactor;
+    limitMinSteps = lround(limitMin * stepsPerMm);
+    limitMaxSteps = lround(limitMax * stepsPerMm);
+    minIntervalUs = (uint32_t)(60000000.0 / (speedMax * stepsPerMm));
+  }
+};
+
+// Conversion de la position d'un pas/mm à l'autre. Chaque conversion part de
+// la position d'avant la première d'une suite de changements sans mouvement:
+// les arrondis ne s'accumulent pas (au plus un demi-pas du profil d'arrivée)
+// et revenir au profil de départ rend exactement la même position.
+struct PositionCarry {
+  bool valid = false;
+  long originSteps = 0;
+  double originStepsPerMm = 0;
+  long switchedSteps = 0;     // Position juste après le dernier changement
+
+  long rescale(long steps, double fromStepsPerMm, double toStepsPerMm) {
+    if (!valid || steps != switchedSteps) {
+      valid = true;
+      originSteps = steps;
+      originStepsPerMm = fromStepsPerMm;
+    }
+    switchedSteps = llround((double)originSteps * toStepsPerMm / originStepsPerMm);
+    return switchedSteps;
+  }
+
+  void invalidate() { valid = false; }
+};
+
+// ===== PORTAIL CAPTIF =====
+// Réponse DNS préconstruite: en-tête et question de la requête recopiés,
+// suivis d'un enregistrement A fixe (pointeur vers le nom, TTL 60 s,
+// adresse de l'AP). Les autres types reçoivent une réponse vide (NOERROR)
+// pour que le téléphone n'attende pas; le reste est ignoré.
+#define DNS_PACKET_MAX 512
+#define DNS_HEADER_SIZE 12
+#define DNS_ANSWER_SIZE 16
+#define DNS_TYPE_A 1
+#define DNS_TYPE_ANY 255
+#define DNS_CLASS_IN 1
+
+struct DnsResponder {
+  uint8_t answer[DNS_ANSWER_SIZE];
+  uint32_t queries = 0;
+  uint32_t answered = 0;
+  uint32_t empty = 0;        // Réponse sans enregistrement (AAAA, HTTPS...)
+  uint32_t ignored = 0;      // Paquet invalide ou non pris en charge
+
+  void begin(const uint8_t ip[4]) {
+    static const uint8_t record[DNS_ANSWER_SIZE - 4] = { 0xC0, 0x0C, 0, DNS_TYPE_A, 0, DNS_CLASS_IN, 0, 0, 0, 60, 0, 4 };
+    memcpy(answer, record, sizeof(record));
+    memcpy(answer + sizeof(record), ip, 4);
+  }
+
+  // Réponse dans out (DNS_PACKET_MAX + DNS_ANSWER_SIZE octets); 0: ignorée
+  size_t respond(const uint8_t* query, size_t length, uint8_t* out) {
+    queries++;
+    // Requête standard (QR = 0, OPCODE = 0) à une seule question
+    if (length < DNS_HEADER_SIZE || length > DNS_PACKET_MAX || (query[2] & 0xF8) != 0 || query[4] != 0 ||
+        query[5] != 1) {
+      ignored++;
+      return 0;
+    }
+    size_t at = DNS_HEADER_SIZE;
+    while (at < length && query[at] != 0) {
+      if ((query[at] & 0xC0) != 0) break;  // Pas de compression dans une question
+      at += query[at] + 1;
+    }
+    if (at + 5 > length || query[at] != 0) {
+      ignored++;
+      return 0;
+    }
+    size_t end = at + 5;
+    uint16_t type = (query[at + 1] << 8) | query[at + 2];
+    uint16_t qclass = (query[at + 3] << 8) | query[at + 4];
+
+    memcpy(out, query, end);           // Enregistrements additionnels (EDNS) omis
+    out[2] = 0x80 | (query[2] & 0x01);  // Réponse, RD recopié
+    out[3] = 0x80;                      // RA, NOERROR
+    memset(out + 6, 0, 6);
+    if (qclass == DNS_CLASS_IN && (type == DNS_TYPE_A || type == DNS_TYPE_ANY)) {
+      out[7] = 1;
+      memcpy(out + end, answer, DNS_ANSWER_SIZE);
+      answered++;
+      return end + DNS_ANSWER_SIZE;
+    }
+    empty++;
+    return end;
+  }
+};
+
+// Adresses de test de connectivité des systèmes (Android, Apple, Windows,
+// Firefox, ...): réponse 302 préformatée vers l'interface
+const char* const captiveProbePaths[] = {
+  "/generate_204", "/gen_204", "/hotspot-detect.html", "/library/test/success.html", "/connecttest.txt",
+  "/ncsi.txt", "/redirect", "/success.txt", "/canonical.html", "/mobile/status.php",
+  "/check_network_status.txt", "/kindle-wifi/wifistub.html",
+};
+#define CAPTIVE_PROBES (sizeof(captiveProbePaths) / sizeof(captiveProbePaths[0]))
+
+// Ligne de requête "GET <sonde> ..." (éventuellement incomplète): index de
+// la sonde, -1 sinon
+struct CaptiveProbe {
+  static int match(const char* line, size_t length) {
+    if (length < 5 || memcmp(line, "GET ", 4) != 0) return -1;
+    for (size_t i = 0; i < CAPTIVE_PROBES; i++) {
+      size_t n = strlen(captiveProbePaths[i]);
+      if (length > 4 + n && memcmp(line + 4, captiveProbePaths[i], n) == 0 &&
+          (line[4 + n] == ' ' || line[4 + n] == '?')) {
+        return i;
+      }
+    }
+    return -1;
+  }
+};
+
+// ===== CORRECTION D'AVANCE =====
+// La vitesse effective (base × correction) rejoint sa cible sans dépasser
+// l'accélération du mouvement: un changement de consigne ne provoque
+// jamais de saut de vitesse, même envoyé à haute fréquence. Recalcul au
+// plus une fois par milliseconde; après une boucle retardée, le pas de
+// temps est borné pour ne pas rattraper d'un coup.
+#define FEED_UPDATE_MIN_S 0.001f
+#define FEED_UPDATE_MAX_S 0.02f
+
+struct FeedRamp {
+  float baseSpeed = 0;         // Vitesse commandée du mouvement en cours (steps/s, sans correction)
+  float accel = 0;             // Accélération du mouvement en cours (steps/s²)
+  float applied = 0;           // Vitesse effective actuellement envoyée au stepper (steps/s)
+  unsigned long lastUpdate = 0;
+
+  float begin(float base, float accelStepsPerSec2, float overridePct, unsigned long nowUs) {
+    baseSpeed = base;
+    accel = accelStepsPerSec2;
+    applied = base * overridePct / 100.0;
+    lastUpdate = nowUs;
+    return applied;
+  }
+
+  // true si la vitesse effective a changé
+  bool update(float overridePct, unsigned long nowUs) {
+    if (baseSpeed <= 0) return false;
+    float dt = (nowUs - lastUpdate) / 1000000.0;
+    if (dt < FEED_UPDATE_MIN_S) return false;
+    lastUpdate = nowUs;
+    dt = min(dt, FEED_UPDATE_MAX_S);
+
+    float target = baseSpeed * overridePct / 100.0;
+    if (target == applied) return false;
+
+    float maxDelta = accel * dt;
+    if (target > applied) {
+      applied = min(target, applied + maxDelta);
+    } else {
+      applied = max(target, applied - maxDelta);
+    }
+    return true;
+  }
+};
+
+// ===== SURVEILLANCE D'ÉCART DE POURSUITE =====
+// Compare la position commandée (steps) à la position mesurée par le codeur.
+// Indépendant du matériel: le codeur réel (PCNT) ou simulé fournit les fronts.
+#define FOLLOWING_OK 0
+#define FOLLOWING_WARN 1
+#define FOLLOWING_FAULT 2
+
+struct FollowingMonitor {
+  float stepsPerCount = 1.0;
+  long warnSteps = 5;
+  long faultSteps = 50;
+  long offset = 0;         // Décalage commandé - mesuré au dernier recalage
+  long error = 0;          // Écart courant en steps (commandé - mesuré)
+  long peakError = 0;
+  bool warning = false;    // Avertissement en cours (hystérésis à warnSteps/2)
+  bool fault = false;      // Défaut mémorisé jusqu'au recalage (sync)
+
+  long measured(long counts) { return lround(counts * stepsPerCount) + offset; }
+
+  void sync(long commanded, long counts) {
+    offset = 0;
+    offset = commanded - measured(counts);
+    error = 0;
+    peakError = 0;
+    warning = false;
+    fault = false;
+  }
+
+  // FOLLOWING_WARN une fois par dépassement de warnSteps, FOLLOWING_FAULT
+  // une seule fois jusqu'au recalage; FOLLOWING_OK sinon
+  int update(long commanded, long counts) {
+    error = commanded - measured(counts);
+    long magnitude = abs(error);
+    peakError = max(peakError, magnitude);
+    if (fault) return FOLLOWING_OK;
+    if (magnitude >= faultSteps) {
+      fault = true;
+      return FOLLOWING_FAULT;
+    }
+    if (magnitude >= warnSteps && !warning) {
+      warning = true;
+      return FOLLOWING_WARN;
+    }
+    if (magnitude < warnSteps / 2) warning = false;
+    return FOLLOWING_OK;
+  }
+};
+
+// ===== PROFIL DE DÉMARRAGE =====
+// Phases à emplacement fixe: chacune n'est écrite que par une seule tâche
+// (setup/loop ou tâche réseau), donc sans verrou. Ordre: config et motion
+// dans setup(), storage et wifi dans la tâche réseau, services dans loop()
+// une fois le WiFi prêt.
+enum BootPhaseId { BOOT_CONFIG, BOOT_MOTION, BOOT_STORAGE, BOOT_WIFI, BOOT_SERVICES, BOOT_PHASES };
+const char* const bootPhaseNames[BOOT_PHASES] = { "config", "motion", "storage", "wifi", "services" };
+#define BOOT_PENDING 0
+#define BOOT_RUNNING 1
+#define BOOT_DONE 2
+const char* const bootStateNames[] = { "pending", "running", "done" };
+
+struct BootProfile {
+  uint32_t startUs[BOOT_PHASES] = {};
+  uint32_t endUs[BOOT_PHASES] = {};
+  volatile uint8_t state[BOOT_PHASES] = {};
+
+  void begin(BootPhaseId phase, uint32_t nowUs) {
+    startUs[phase] = nowUs;
+    state[phase] = BOOT_RUNNING;
+  }
+
+  void end(BootPhaseId phase, uint32_t nowUs) {
+    endUs[phase] = nowUs;
+    state[phase] = BOOT_DONE;
+  }
+
+  bool done(BootPhaseId phase) const { return state[phase] == BOOT_DONE; }
+  uint32_t durationUs(BootPhaseId phase) const { return done(phase) ? endUs[phase] - startUs[phase] : 0; }
+
+  // Ligne de la commande série "boot"
+  int line(BootPhaseId phase, char* out, size_t size) const {
+    if (state[phase] == BOOT_PENDING) return snprintf(out, size, "%s: en attente", bootPhaseNames[phase]);
+    if (state[phase] == BOOT_RUNNING) {
+      return snprintf(out, size, "%s: +%luus, en cours", bootPhaseNames[phase], (unsigned long)startUs[phase]);
+    }
+    return snprintf(out, size, "%s: +%luus, %luus", bootPhaseNames[phase], (unsigned long)startUs[phase],
+                    (unsigned long)durationUs(phase));
+  }
+
+  // Tableau "phases" de /api/diagnostics
+  int json(char* out, size_t size) const {
+    int length = snprintf(out, size, "[");
+    for (int i = 0; i < BOOT_PHASES && length < (int)size; i++) {
+      BootPhaseId phase = (BootPhaseId)i;
+      length += snprintf(out + length, size - length,
+                         "%s{\"name\":\"%s\",\"state\":\"%s\",\"startUs\":%lu,\"durationUs\":%lu}", i > 0 ? "," : "",
+                         bootPhaseNames[i], bootStateNames[state[phase]], (unsigned long)startUs[phase],
+                         (unsigned long)durationUs(phase));
+    }
+    if (length < (int)size) length += snprintf(out + length, size - length, "]");
+    return length;
+  }
+};
+
+// ===== ÉVÉNEMENTS SUR POSITION =====
+// Table triée par position en steps. Le curseur désigne le premier
+// événement strictement au-dessus de la position courante: à chaque pas,
+// seuls les voisins immédiats du curseur sont examinés (coût O(1)). Un
+// événement se déclenche sur le pas qui arrive sur sa position, dans les
+// sens acceptés par son filtre.
+#define MAX_POSITION_EVENTS 32
+#define EVENT_DIR_BOTH 0
+
+struct PositionEvent {
+  float positionMm;
+  long steps;
+  uint8_t pin;
+  uint32_t mask;        // Masque du registre GPIO (broches 0-31)
+  uint32_t pulseUs;
+  int8_t dirFilter;     // 0 = les deux sens, 1 = avant, -1 = arrière
+  unsigned long fired;
+};
+
+struct PositionEventCursor {
+  // Curseur après un saut de position (reset, calibration, nouvelle table)
+  static int seek(const PositionEvent* events, int count, long position) {
+    int cursor = 0;
+    while (cursor < count && events[cursor].steps <= position) cursor++;
+    return cursor;
+  }
+
+  // Tri par insertion sur steps: ordre d'origine conservé entre égaux
+  static void sort(PositionEvent* events, int count) {
+    for (int i = 1; i < count; i++) {
+      PositionEvent event = events[i];
+      int j = i - 1;
+      while (j >= 0 && events[j].steps > event.steps) {
+        events[j + 1] = events[j];
+        j--;
+      }
+      events[j + 1] = event;
+    }
+  }
+
+  // Pas émis jusqu'à position dans le sens dir: fire(index) pour chaque
+  // événement atteint que son filtre accepte. Retourne le nouveau curseur.
+  template <class Fire>
+  static inline int step(const PositionEvent* events, int count, int cursor, long position, int dir, Fire fire) {
+    if (dir > 0) {
+      while (cursor < count && events[cursor].steps == position) {
+        if (accepts(events[cursor], dir)) fire(cursor);
+        cursor++;
+      }
+    } else {
+      while (cursor > 0 && events[cursor - 1].steps > position) cursor--;
+      for (int i = cursor - 1; i >= 0 && events[i].steps == position; i--) {
+        if (accepts(events[i], dir)) fire(i);
+      }
+    }
+    return cursor;
+  }
+
+  static bool accepts(const PositionEvent& event, int dir) {
+    return event.dirFilter == EVENT_DIR_BOTH || event.dirFilter == dir;
+  }
+};
+
+// ===== MODBUS TCP =====
+// Esclave Modbus TCP natif: registres mappés directement sur l'état de
+// l'axe. Les valeurs 32 bits occupent deux registres, mot fort en premier.
+// Plusieurs maîtres sont servis sans bloquer: lecture non bloquante par
+// client et au plus une trame traitée par client et par tour de boucle.
+// Découpage des trames et traitement des PDU ici, sans accès réseau; les
+// registres sont lus et écrits par la classe Registers passée à process()
+// (firmware: ModbusAxisRegisters; tools/modbus_standin.cpp: axe simulé).
+#define MODBUS_PORT 502
+#define MODBUS_MAX_CLIENTS 4
+#define MODBUS_FRAME_MAX 260      // MBAP (7) + PDU (253)
+#define MODBUS_IDLE_MS 60000      // Libère la place d'un maître silencieux
+
+#define MB_FC_READ_HOLDING 0x03
+#define MB_FC_READ_INPUT 0x04
+#define MB_FC_WRITE_SINGLE 0x06
+#define MB_FC_WRITE_MULTIPLE 0x10
+#define MB_EX_ILLEGAL_FUNCTION 0x01
+#define MB_EX_ILLEGAL_ADDRESS 0x02
+#define MB_EX_ILLEGAL_VALUE 0x03
+
+// Registres d'entrée (FC04, lecture seule)
+#define MB_IN_POSITION 0      // steps, 32 bits
+#define MB_IN_TARGET 2        // steps, 32 bits
+#define MB_IN_REMAINING 4     // steps, 32 bits
+#define MB_IN_POSITION_UM 6   // µm, 32 bits
+#define MB_IN_SPEED 8         // Consigne mm/min
+#define MB_IN_FLAGS 9         // STATUS_FLAG_*
+#define MB_IN_OVERRIDE 10     // %
+#define MB_IN_COUNT 11
+
+// Registres de maintien (FC03/06/16). La commande est placée après ses
+// paramètres: un FC16 sur 0..9 les écrit puis l'exécute en une requête.
+#define MB_HR_DISTANCE 0      // µm, 32 bits: relatif (MOVE) ou absolu (GOTO)
+#define MB_HR_SPEED 2         // mm/min, 0 = vitesse par défaut
+#define MB_HR_OVERRIDE 3      // %
+#define MB_HR_LIMIT_MIN 4     // µm, 32 bits
+#define MB_HR_LIMIT_MAX 6     // µm, 32 bits
+#define MB_HR_LIMITS_ON 8
+#define MB_HR_COMMAND 9
+#define MB_HR_RESULT 10       // Résultat de la dernière commande (lecture seule)
+#define MB_HR_COUNT 11
+
+#define MB_CMD_NONE 0
+#define MB_CMD_MOVE 1
+#define MB_CMD_GOTO 2
+#define MB_CMD_STOP 3
+#define MB_CMD_HOME 4
+#define MB_CMD_RESET 5
+
+#define MB_RESULT_OK 0
+#define MB_RESULT_BUSY 1
+#define MB_RESULT_LIMIT 2
+
+#define MB_FRAME_PARTIAL 0
+#define MB_FRAME_COMPLETE 1
+#define MB_FRAME_INVALID 2        // Pas du Modbus TCP: impossible de resynchroniser
+
+struct ModbusSlave {
+  uint32_t requests = 0;
+  uint32_t exceptions = 0;
+
+  // Octets à lire ensuite: en-tête MBAP d'abord, puis exactement le reste
+  // de la trame (jamais au-delà du tampon)
+  static size_t needed(const uint8_t* frame, size_t length) {
+    size_t total = length < 7 ? 7 : 6 + ((frame[4] << 8) | frame[5]);
+    if (total > MODBUS_FRAME_MAX) total = MODBUS_FRAME_MAX;
+    return total > length ? total - length : 0;
+  }
+
+  static int check(const uint8_t* frame, size_t length) {
+    if (length < 7) return MB_FRAME_PARTIAL;
+    uint16_t size = (frame[4] << 8) | frame[5];
+    if (frame[2] != 0 || frame[3] != 0 || size < 2 || size > MODBUS_FRAME_MAX - 6) return MB_FRAME_INVALID;
+    return length < 6u + size ? MB_FRAME_PARTIAL : MB_FRAME_COMPLETE;
+  }
+
+  // Traite une trame MBAP complète et construit la réponse; retourne sa
+  // longueur. Registers: readInputs(regs), readHolding(regs) et
+  // writeHolding(first, count, data) -> code d'exception, 0 si accepté.
+  template <class Registers>
+  size_t process(const uint8_t* request, uint8_t* response, Registers& registers) {
+    uint16_t pduLength = ((request[4] << 8) | request[5]) - 1;
+    const uint8_t* pdu = request + 7;
+    uint8_t* out = response + 7;
+    uint8_t function = pdu[0];
+    uint8_t exception = 0;
+    size_t outLength = 0;
+
+    uint16_t address = pduLength >= 5 ? (pdu[1] << 8) | pdu[2] : 0;
+    uint16_t quantity = pduLength >= 5 ? (pdu[3] << 8) | pdu[4] : 0;
+
+    switch (function) {
+      case MB_FC_READ_HOLDING:
+      case MB_FC_READ_INPUT: {
+        int count = function == MB_FC_READ_INPUT ? MB_IN_COUNT : MB_HR_COUNT;
+        if (pduLength != 5 || quantity < 1 || quantity > 125) {
+          exception = MB_EX_ILLEGAL_VALUE;
+        } else if (address + quantity > count) {
+          exception = MB_EX_ILLEGAL_ADDRESS;
+        } else {
+          uint16_t regs[MB_HR_COUNT > MB_IN_COUNT ? MB_HR_COUNT : MB_IN_COUNT];
+          if (function == MB_FC_READ_INPUT) registers.readInputs(regs);
+          else registers.readHolding(regs);
+          out[0] = function;
+          out[1] = quantity * 2;
+          for (int i = 0; i < quantity; i++) {
+            out[2 + 2 * i] = regs[address + i] >> 8;
+            out[3 + 2 * i] = regs[address + i];
+          }
+          outLength = 2 + quantity * 2;
+        }
+        break;
+      }
+      case MB_FC_WRITE_SINGLE:
+        if (pduLength != 5) {
+          exception = MB_EX_ILLEGAL_VALUE;
+        } else {
+          exception = registers.writeHolding(address, 1, pdu + 3);
+          memcpy(out, pdu, 5);
+          outLength = 5;
+        }
+        break;
+      case MB_FC_WRITE_MULTIPLE:
+        if (pduLength < 6 || quantity < 1 || quantity > 123 || pdu[5] != quantity * 2 ||
+            pduLength != 6 + pdu[5]) {
+          exception = MB_EX_ILLEGAL_VALUE;
+        } else {
+          exception = registers.writeHolding(address, quantity, pdu + 6);
+          memcpy(out, pdu, 5);
+          outLength = 5;
+        }
+        break;
+      default:
+        exception = MB_EX_ILLEGAL_FUNCTION;
+    }
+
+    if (exception != 0) {
+      out[0] = function | 0x80;
+      out[1] = exception;
+      outLength = 2;
+      exceptions++;
+    }
+    requests++;
+
+    memcpy(response, request, 4);           // Transaction et protocole
+    response[4] = (outLength + 1) >> 8;
+    response[5] = outLength + 1;
+    response[6] = request[6];               // Unité
+    return 7 + outLength;
+  }
+};
+
+// ===== ADMISSION DES REQUÊTES =====
+// Le pas est émis par loop(): tout le temps passé dans un handler HTTP est
+// pris sur le mouvement. Pendant un mouvement, les requêtes se partagent un
+// budget par fenêtre; une route dont le coût mesuré ne tient pas dans ce
+// qui reste est refusée (503 + Retry-After) au lieu d'être servie. Les
+// routes lourdes (page, logs, téléchargements) sont estimées à leur pire
+// durée mesurée. /api/stop n'est jamais refusé et passe avant le reste.
+// /api/speed n'est jamais refusé non plus: une correction d'avance perdue
+// en mouvement laisserait l'axe à la mauvaise vitesse (son temps reste
+// décompté du budget).
+#define ROUTE_NORMAL 0
+#define ROUTE_HEAVY 1
+#define ROUTE_STOP 2
+#define ROUTE_CONTROL 3
+
+#define MOTION_BUDGET_WINDOW_US 100000UL
+#define MOTION_BUDGET_US 10000UL     // Temps HTTP toléré par fenêtre en mouvement (10 %)
+#define STOP_REQUEST_LINE "POST /api/stop "
+
+struct RequestAdmission {
+  unsigned long windowStart = 0;
+  uint32_t used = 0;               // µs consommés dans la fenêtre courante
+  unsigned long rejected = 0;
+  unsigned long fastStops = 0;     // Arrêts exécutés avant le handler /api/stop
+  uint32_t fastStopLastUs = 0;     // Connexion acceptée -> axe arrêté
+  uint32_t fastStopMaxUs = 0;
+
+  static uint8_t classify(const char* uri, bool get) {
+    if (strcmp(uri, "/api/stop") == 0) return ROUTE_STOP;
+    if (strcmp(uri, "/api/speed") == 0) return ROUTE_CONTROL;
+    if (strcmp(uri, "/") == 0 || strcmp(uri, "/api/logs") == 0 || strcmp(uri, "/api/diagnostics") == 0) {
+      return ROUTE_HEAVY;
+    }
+    if (get && (strcmp(uri, "/api/trace") == 0 || strcmp(uri, "/api/journal") == 0)) {
+      return ROUTE_HEAVY;
+    }
+    return ROUTE_NORMAL;
+  }
+
+  // Coût attendu d'une route: pire durée mesurée si lourde, moyenne sinon.
+  // Une route lourde jamais servie compte pour tout le budget.
+  static uint32_t routeCost(uint8_t routeClass, uint32_t hits, uint64_t totalUs, uint32_t maxUs) {
+    if (hits == 0) return routeClass == ROUTE_HEAVY ? MOTION_BUDGET_US : 0;
+    if (routeClass == ROUTE_HEAVY) return maxUs;
+    return (uint32_t)(totalUs / hits);
+  }
+
+  // Début d'une requête lu sans être consommé: 1 si c'est POST /api/stop,
+  // 0 sinon, -1 si trop court pour conclure
+  static int stopRequest(const char* head, int length) {
+    const int lineLength = sizeof(STOP_REQUEST_LINE) - 1;
+    if (length < lineLength) return memcmp(head, STOP_REQUEST_LINE, length) == 0 ? -1 : 0;
+    return memcmp(head, STOP_REQUEST_LINE, lineLength) == 0 ? 1 : 0;
+  }
+
+  void roll(unsigned long nowUs) {
+    if (nowUs - windowStart >= MOTION_BUDGET_WINDOW_US) {
+      windowStart = nowUs;
+      used = 0;
+    }
+  }
+
+  // false si la requête doit être refusée (comptée dans rejected)
+  bool admit(uint8_t routeClass, uint32_t cost, bool running, unsigned long nowUs) {
+    if (routeClass == ROUTE_STOP || routeClass == ROUTE_CONTROL || !running) return true;
+    roll(nowUs);
+    if (used + cost <= MOTION_BUDGET_US) return true;
+    rejected++;
+    return false;
+  }
+
+  // Temps passé à servir ou à refuser une requête, pris sur le budget en
+  // mouvement
+  void charge(uint32_t elapsedUs, bool running, unsigned long nowUs) {
+    if (!running) return;
+    roll(nowUs);
+    used += elapsedUs;
+  }
+
+  // Connexion en attente qui demande l'arrêt: stop() est appelé avant toute
+  // autre requête, le handler /api/stop répond ensuite normalement. Server
+  // fournit pendingStop() (vrai une seule fois par connexion) et
+  // pendingAgeUs() (depuis l'acceptation).
+  template <class Server, class Stop>
+  bool stopFastPath(Server& server, Stop stop) {
+    if (!server.pendingStop()) return false;
+    stop();
+    fastStops++;
+    fastStopLastUs = server.pendingAgeUs();
+    fastStopMaxUs = max(fastStopMaxUs, fastStopLastUs);
+    return true;
+  }
+};
+
+// ===== PROTOCOLE JOG BINAIRE =====
+// Paquet de 12 octets, little-endian. Tout paquet valide (JOG ou HEARTBEAT)
+// réarme la fenêtre homme-mort; le jog s'arrête si elle expire. Les numéros
+// de séquence repartent d'un nouvel expéditeur ou après un silence plus long
+// que la fenêtre; un STOP n'est jamais écarté pour sa séquence.
+#define JOG_MAGIC 0xA5
+#define JOG_VERSION 1
+#define JOG_CMD_JOG 1        // velocity = vitesse signée en 0.01 mm/min
+#define JOG_CMD_STOP 2
+#define JOG_CMD_HEARTBEAT 3
+#define JOG_ACK 0x80         // Bit ajouté au type dans la réponse
+
+struct __attribute__((packed)) JogPacket {
+  uint8_t magic;
+  uint8_t version;
+  uint8_t type;
+  uint8_t flags;       // Réponse: bit0 = en mouvement, bit1 = jog actif
+  uint16_t seq;
+  uint16_t latencyUs;  // Réponse: dernière latence commande -> premier pas (µs)
+  int32_t value;       // Commande: vitesse; réponse: position en steps
+};
+
+struct JogSession {
+  bool seqValid = false;
+  uint16_t lastSeq = 0;
+  uint32_t peerIp = 0;             // Expéditeur de la séquence en cours
+  uint16_t peerPort = 0;
+  unsigned long lastPacket = 0;    // ms
+  unsigned long packets = 0;
+  unsigned long rejected = 0;
+  unsigned long deadmanTrips = 0;
+
+  // Datagramme de size octets reçu de ip:port: true s'il est à appliquer,
+  // false s'il est écarté (compté dans rejected)
+  bool accept(const JogPacket& pkt, int size, uint32_t ip, uint16_t port, unsigned long nowMs) {
+    bool valid = size == (int)sizeof(JogPacket) && pkt.magic == JOG_MAGIC && pkt.version == JOG_VERSION &&
+                 (pkt.type == JOG_CMD_JOG || pkt.type == JOG_CMD_STOP || pkt.type == JOG_CMD_HEARTBEAT);
+    if (!valid) {
+      rejected++;
+      return false;
+    }
+
+    // Nouvelle session: autre expéditeur, ou lien muet au-delà de la fenêtre
+    if (ip != peerIp || port != peerPort || nowMs - lastPacket > JOG_HEARTBEAT_MS) seqValid = false;
+
+    // Rejeter les paquets en retard ou dupliqués (numéro de séquence 16 bits
+    // circulaire), sauf STOP
+    bool stale = seqValid && (int16_t)(pkt.seq - lastSeq) <= 0;
+    if (stale && pkt.type != JOG_CMD_STOP) {
+      rejected++;
+      return false;
+    }
+    if (!stale) {
+      seqValid = true;
+      lastSeq = pkt.seq;
+      peerIp = ip;
+      peerPort = port;
+    }
+    lastPacket = nowMs;
+    packets++;
+    return true;
+  }
+
+  // Consigne d'un paquet JOG en mm/min (signe = sens), bornée à SPEED_MAX;
+  // 0 sous SPEED_MIN: le jog s'arrête
+  static float speed(const JogPacket& pkt) {
+    float speed = pkt.value / 100.0;
+    if (abs(speed) < SPEED_MIN) return 0;
+    return max(-SPEED_MAX, min(SPEED_MAX, speed));
+  }
+
+  // Homme-mort: true si le jog actif n'a reçu aucun paquet valide depuis
+  // plus que la fenêtre (il doit être arrêté)
+  bool expired(bool active, unsigned long nowMs) {
+    if (!active || nowMs - lastPacket <= JOG_HEARTBEAT_MS) return false;
+    deadmanTrips++;
+    seqValid = false;
+    return true;
+  }
+};
+
+#ifndef MOTION_CORE_ONLY
+
+// ===== DIAGNOSTICS MÉMOIRE =====
+// Relevés bon marché: tas libre, minimum historique et plus grand bloc une
+// fois par seconde dans un petit historique, temps de boucle min/moy/max par
+// fenêtre, et coût de chaque route HTTP (durée, mémoire non rendue).
+#define DIAG_HISTORY 60
+#define DIAG_SAMPLE_US 1000000UL
+#define DIAG_MAX_ROUTES 64
+
+struct DiagSample {
+  uint32_t uptimeMs;
+  uint32_t freeHeap;
+  uint32_t minFreeHeap;
+  uint32_t largestBlock;
+  uint32_t loopAvgUs;
+  uint32_t loopMaxUs;
+};
+
+struct RouteStats {
+  const char* uri;
+  HTTPMethod method;
+  uint8_t routeClass;      // ROUTE_*
+  uint32_t hits;
+  uint64_t totalUs;
+  uint32_t maxUs;
+  int32_t bytesRetained;   // Pire écart de tas libre avant/après la réponse
+  int32_t blocksRetained;  // Pire écart de blocs alloués avant/après
+  uint32_t freeHeapLow;    // Tas libre le plus bas relevé après cette route
+};
+
+RouteStats routeStats[DIAG_MAX_ROUTES];
+int routeCount = 0;
+
+// ===== ADMISSION DES REQUÊTES =====
+// Côté serveur web de RequestAdmission: mesure des routes, refus 503,
+// connexion suivante lue d'avance pour l'arrêt.
+#define MOTION_READ_WAIT_MS 20       // Client muet abandonné en mouvement si un autre attend
+#define MOTION_RETRY_AFTER_S "1"
+
+// Entrée d'arrêt d'urgence, active à l'état bas (contact NF vers la masse);
+// -1 si absente
+#define ESTOP_PIN -1
+
+RequestAdmission admission;
+unsigned long admissionShed = 0;       // Clients muets abandonnés
+volatile bool estopLatched = false;
+unsigned long estopCount = 0;
+
+// Portail captif: les sondes de connectivité reconnues sur la connexion en
+// attente reçoivent la redirection sans passer par le serveur web
+#define CAPTIVE_PEEK 64
+#define CAPTIVE_REDIRECT "HTTP/1.1 302 Found\r\nLocation: http://192.168.4.1/\r\nContent-Length: 0\r\nConnection: close\r\n\r\n"
+unsigned long captiveProbesFast = 0;   // Répondues avant le serveur web
+unsigned long captiveProbesSlow = 0;   // Reconnues par onNotFound (ligne incomplète au coup d'œil)
+unsigned long captiveRedirects = 0;    // Autres adresses inconnues
+
+extern bool isRunning;
+bool admitRequest(RouteStats* route);
+void chargeRequest(uint32_t elapsedUs);
+
+// Chaque route enregistrée par on() est enveloppée pour être mesurée et
+// soumise à l'admission, sans toucher aux handlers eux-mêmes. La gestion
+// des clients est reprise pour que /api/stop ne reste jamais derrière un
+// client lent: la connexion suivante est acceptée d'avance et sa ligne de
+// requête lue sans être consommée.
+class DiagWebServer : public WebServer {
+ public:
+  DiagWebServer(int port) : WebServer(port) {}
+
+  void on(const char* uri, HTTPMethod method, THandlerFunction fn) {
+    WebServer::on(uri, method, instrument(uri, method, fn));
+  }
+  void on(const char* uri, THandlerFunction fn) { on(uri, HTTP_ANY, fn); }
+
+  // true une seule fois si la connexion en attente est un POST /api/stop
+  bool pendingStop() {
+    if (!_pending) {
+      if (!_server.hasClient()) return false;
+      _pending = _server.available();
+      _pendingSince = micros();
+      _pendingChecked = false;
+    }
+    if (_pendingChecked) return false;
+
+    char head[CAPTIVE_PEEK];
+    int n = recv(_pending.fd(), head, sizeof(head), MSG_PEEK | MSG_DONTWAIT);
+    if (n <= 0) return false;
+    int stop = RequestAdmission::stopRequest(head, n);
+    if (stop < 0) return false;  // Incomplet
+    _pendingChecked = true;
+    _pendingProbe = CaptiveProbe::match(head, n) >= 0;
+    return stop > 0;
+  }
+  uint32_t pendingAgeUs() { return micros() - _pendingSince; }
+
+  void handleClient() {
+    bool waiting = _pending || _server.hasClient();
+    if (_currentStatus == HC_WAIT_CLOSE && waiting) {
+      // Réponse complète déjà envoyée: inutile d'attendre la fermeture
+      _currentClient.stop();
+      _currentStatus = HC_NONE;
+    } else if (_currentStatus == HC_WAIT_READ && waiting && isRunning && !_currentClient.available() &&
+               millis() - _statusChange > MOTION_READ_WAIT_MS) {
+      _currentClient.stop();
+      _currentStatus = HC_NONE;
+      admissionShed++;
+    }
+    if (_pending && _pendingProbe) {
+      // Requête lue avant la fermeture: sinon la pile répond par un RST qui
+      // peut écraser la redirection
+      uint8_t discard[CAPTIVE_PEEK];
+      while (_pending.available() > 0 && _pending.read(discard, sizeof(discard)) > 0) {
+      }
+      _pending.write((const uint8_t*)CAPTIVE_REDIRECT, sizeof(CAPTIVE_REDIRECT) - 1);
+      _pending.stop();
+      _pending = WiFiClient();
+      _pendingProbe = false;
+      captiveProbesFast++;
+    }
+    if (_currentStatus == HC_NONE && _pending) {
+      _currentClient = _pending;
+      _pending = WiFiClient();
+      _currentStatus = HC_WAIT_READ;
+      _statusChange = millis();
+    }
+    WebServer::handleClient();
+  }
+
+ private:
+  WiFiClient _pending;
+  unsigned long _pendingSince = 0;
+  bool _pendingChecked = false;
+  bool _pendingProbe = false;
+
+  THandlerFunction instrument(const char* uri, HTTPMethod method, THandlerFunction fn) {
+    if (routeCount >= DIAG_MAX_ROUTES) return fn;
+    RouteStats* stats = &routeStats[routeCount++];
+    stats->uri = uri;
+    stats->method = method;
+    stats->routeClass = RequestAdmission::classify(uri, method == HTTP_GET);
+    stats->freeHeapLow = UINT32_MAX;
+    return [stats, fn]() {
+      if (!admitRequest(stats)) return;
+      multi_heap_info_t before, after;
+      heap_caps_get_info(&before, MALLOC_CAP_8BIT);
+      unsigned long start = micros();
+      fn();
+      uint32_t elapsed = micros() - start;
+      heap_caps_get_info(&after, MALLOC_CAP_8BIT);
+      chargeRequest(elapsed);
+
+      int32_t bytes = (int32_t)before.total_free_bytes - (int32_t)after.total_free_bytes;
+      int32_t blocks = (int32_t)after.allocated_blocks - (int32_t)before.allocated_blocks;
+      stats->hits++;
+      stats->totalUs += elapsed;
+      if (elapsed > stats->maxUs) stats->maxUs = elapsed;
+      if (bytes > stats->bytesRetained) stats->bytesRetained = bytes;
+      if (blocks > stats->blocksRetained) stats->blocksRetained = blocks;
+      if (after.total_free_bytes < stats->freeHeapLow) stats->freeHeapLow = after.total_free_bytes;
+    };
+  }
+};
+
 // ===== OBJETS =====
-AccelStepper stepper(AccelStepper::DRIVER, PULSE_PIN, DIR_PIN);
-WebServer server(80);
-DNSServer dnsServer;
+RampStepper<MotorDriver> stepper;
+DiagWebServer server(80);
+DnsResponder captiveDns;
 Preferences preferences;
+WiFiUDP jogUdp;
+WiFiUDP syncUdp;
 
 // ===== VARIABLES GLOBALES =====
 bool isRunning = false;
@@ -44,18 +1979,361 @@ bool continuousMode = false;
 bool adminUnlocked = false;
 int moveDirection = 1;
 
+// Marche continue: cible glissante posée à cette distance devant l'axe
+// quand les limites logicielles sont désactivées (sinon, sur la limite)
+#define CONTINUOUS_HORIZON_STEPS 1000000L
+
 float currentPosition = 0.0;
 float targetPosition = 0.0;
 float currentSpeed = 300.0;
 
 unsigned long sessionStart = 0;
 
+// ===== CORRECTION D'AVANCE (FEED OVERRIDE) =====
+#define FEED_OVERRIDE_MIN 10.0
+#define FEED_OVERRIDE_MAX 200.0
+
+float feedOverride = 100.0;        // Consigne en %, appliquée à tous les mouvements
+FeedRamp feedRamp;                 // Vitesse effective du mouvement en cours
+
 const byte DNS_PORT = 53;
+#define DNS_POLL_IDLE_MS 2           // Relève du port DNS: au repos
+#define DNS_POLL_MOVING_MS 20        // en mouvement (hors du chemin du pas)
+#define DNS_BATCH_IDLE 16            // Requêtes traitées par relève
+#define DNS_BATCH_MOVING 4
+
+int captiveDnsSocket = -1;
+unsigned long captiveDnsLastPoll = 0;
+uint32_t captiveDnsMaxBatch = 0;
+uint32_t captiveDnsSendErrors = 0;
+
+// ===== ÉVÉNEMENTS SUR POSITION =====
+PositionEvent positionEvents[MAX_POSITION_EVENTS];
+#ifdef ARDUINO
+esp_timer_handle_t positionEventTimers[MAX_POSITION_EVENTS];  // Fin d'impulsion, un par emplacement
+#endif
+int positionEventCount = 0;
+int positionEventCursor = 0;
+
+// ===== ENREGISTREUR DE TRACE =====
+// Échantillons dans un anneau statique: aucune allocation ni écriture flash
+// pendant le mouvement. Téléchargé tel quel en binaire little-endian,
+// décodé sur PC par tools/trace_decode.cpp.
+#define TRACE_CAPACITY 2048
+#define TRACE_MAGIC 0x31435254  // "TRC1"
+#define TRACE_VERSION 1
+
+#define TRACE_STATE_RUNNING 0x01
+#define TRACE_STATE_TARGET 0x02
+#define TRACE_STATE_CONTINUOUS 0x04
+#define TRACE_STATE_JOG 0x08
+#define TRACE_STATE_REVERSE 0x10
+
+struct __attribute__((packed)) TraceSample {
+  uint32_t timeUs;
+  int32_t steps;
+  uint32_t intervalUs;  // Intervalle commandé: vitesse = 1e6 / intervalUs steps/s
+  uint8_t state;
+  uint8_t reserved[3];
+};
+
+struct __attribute__((packed)) TraceHeader {
+  uint32_t magic;
+  uint16_t version;
+  uint16_t sampleSize;
+  uint32_t count;
+  uint32_t dropped;      // Échantillons écrasés (mode anneau)
+  float stepsPerMm;
+  uint16_t decimation;
+  uint16_t reserved;
+};
+
+TraceSample traceBuffer[TRACE_CAPACITY];
+uint32_t traceHead = 0;       // Prochain emplacement écrit
+uint32_t traceCount = 0;
+uint32_t traceDropped = 0;
+uint16_t traceDecimation = 1;
+uint16_t traceSkip = 0;
+bool traceRecording = false;
+bool traceArmed = false;      // Démarrage au premier pas du prochain mouvement
+bool traceRing = false;       // true: écrase les plus anciens, false: arrêt quand plein
+
+FollowingMonitor following;
+bool encoderStarted = false;
+unsigned long encoderFaults = 0;
+unsigned long encoderWarnings = 0;
+long encoderTotal = 0;
+int16_t encoderLastRaw = 0;
+
+// ===== ODOMÈTRE =====
+Odometer odometer;
+
+// ===== PROFILS DE CALIBRATION =====
+CalibrationProfile profiles[PROFILE_COUNT];
+int activeProfile = -1;           // -1: réglages hors profil (/api/calibration)
+PositionCarry positionCarry;
+unsigned long profileSwitches = 0;
+uint32_t profileSwitchLastUs = 0;
+
+// ===== ENGRENAGE ÉLECTRONIQUE =====
+#define GEAR_PCNT_UNIT PCNT_UNIT_1
+#define GEAR_PCNT_LIMIT 30000
+
+GearFollower gear;
+bool gearActive = false;
+bool gearStarted = false;
+long gearTotal = 0;
+int16_t gearLastRaw = 0;
+uint32_t gearMinIntervalUs = 0;    // Vitesse max de l'axe en suiveur (SPEED_MAX)
+unsigned long gearFaults = 0;
+unsigned long gearLimitHits = 0;
+bool gearWasLimited = false;
+
+// ===== TRAJECTOIRE PVT =====
+#define PVT_LAG_FAULT_MM 1.0   // Retard de l'axe sur la consigne qui arrête le flux
+
+PvtStream pvt;
+bool pvtActive = false;
+uint32_t pvtMinIntervalUs = 0;
+unsigned long pvtAccepted = 0;
+unsigned long pvtRejected = 0;
+unsigned long pvtFaults = 0;
+long pvtMaxLag = 0;
+long pvtMinSteps = 0;
+long pvtMaxSteps = 0;
+
+// ===== JOURNAL DE COMMANDES =====
+// Chaque commande acceptée (quel que soit le canal) et chaque fin de
+// mouvement, horodatées en micros() avec l'état qui en résulte. Anneau
+// statique: les plus anciennes sont écrasées. Rejoué sur PC par
+// tools/replay.cpp avec le générateur de pas de ce fichier.
+#define JOURNAL_CAPACITY 512
+#define JOURNAL_MAGIC 0x314E524A  // "JRN1"
+#define JOURNAL_VERSION 1
+
+#define JOURNAL_MOVE 1        // a = distance mm, b = vitesse mm/min
+#define JOURNAL_CONTINUOUS 2  // a = direction, b = vitesse mm/min
+#define JOURNAL_SPEED 3       // a = vitesse mm/min
+#define JOURNAL_OVERRIDE 4    // a = correction %
+#define JOURNAL_STOP 5
+#define JOURNAL_HOME 6
+#define JOURNAL_RESET 7
+#define JOURNAL_ARRIVED 8     // Destination atteinte (constatée par loop())
+#define JOURNAL_LIMIT 9       // Arrêt sur limite logicielle en mode continu
+#define JOURNAL_FAULT 10      // Arrêt sur erreur de poursuite
+
+struct __attribute__((packed)) JournalEntry {
+  uint32_t timeUs;
+  uint8_t command;
+  uint8_t reserved;
+  uint16_t overridePct;
+  float a;
+  float b;
+  int32_t position;     // Steps émis après application
+  int32_t target;       // Steps
+};
+
+struct __attribute__((packed)) JournalHeader {
+  uint32_t magic;
+  uint16_t version;
+  uint16_t entrySize;
+  uint32_t count;
+  uint32_t dropped;
+  float stepsPerMm;
+  float accelFactor;
+  float speedHome;
+  float limitMin;
+  float limitMax;
+  uint8_t limitsEnabled;
+  uint8_t shaperType;
+  uint16_t reserved;
+};
+
+JournalEntry journalBuffer[JOURNAL_CAPACITY];
+uint32_t journalHead = 0;
+uint32_t journalCount = 0;
+uint32_t journalDropped = 0;
+bool journalRecording = false;
+
+// ===== STATUT BINAIRE =====
+// Enregistrement de statut à disposition fixe, little-endian, versionné,
+// pour les passerelles qui interrogent l'axe en boucle (/api/status.bin).
+// Le même contenu est aussi servi en CBOR (/api/status.cbor). Aucun des
+// deux n'alloue: tout est écrit dans des tampons de taille fixe.
+#define STATUS_MAGIC 0x53    // 'S'
+#define STATUS_VERSION 1
+#define STATUS_CBOR_MAX 96
+
+#define STATUS_FLAG_RUNNING 0x0001
+#define STATUS_FLAG_TARGET 0x0002
+#define STATUS_FLAG_CONTINUOUS 0x0004
+#define STATUS_FLAG_JOG 0x0008
+#define STATUS_FLAG_LIMITS 0x0010
+#define STATUS_FLAG_ENCODER 0x0020
+#define STATUS_FLAG_ENCODER_FAULT 0x0040
+#define STATUS_FLAG_NETWORK 0x0080
+#define STATUS_FLAG_GEAR 0x0100
+
+struct __attribute__((packed)) StatusRecord {
+  uint8_t magic;
+  uint8_t version;
+  uint16_t size;         // sizeof(StatusRecord): un client peut lire un préfixe
+  uint32_t seq;          // Incrémenté à chaque enregistrement servi
+  uint32_t timestampMs;  // Depuis le démarrage
+  int32_t position;      // Steps émis
+  int32_t target;        // Steps
+  int32_t remaining;     // Steps
+  float speed;           // Consigne mm/min
+  float stepsPerMm;
+  uint16_t flags;
+  uint16_t overridePct;
+};
+
+uint32_t statusSeq = 0;
+
+// ===== MODBUS TCP =====
+struct ModbusClient {
+  WiFiClient client;
+  uint8_t frame[MODBUS_FRAME_MAX];
+  uint16_t length;
+  unsigned long lastActivity;
+};
+
+WiFiServer modbusServer(MODBUS_PORT);
+ModbusClient modbusClients[MODBUS_MAX_CLIENTS];
+int32_t modbusDistanceUm = 0;
+uint16_t modbusSpeed = 0;
+uint16_t modbusLastCommand = MB_CMD_NONE;
+uint16_t modbusResult = MB_RESULT_OK;
+ModbusSlave modbusSlave;
+
+// ===== MQTT =====
+// Client MQTT 3.1.1 minimal (QoS 0). Les paquets sortants passent par un
+// tampon fixe vidé en envoi non bloquant: un broker lent remplit le tampon,
+// la télémétrie est alors sautée (l'état suivant la remplace), jamais la
+// boucle de pas. Connexion et reconnexion seulement à l'arrêt, sans départ
+// programmé en attente.
+#define MQTT_KEEPALIVE_S 30
+#define MQTT_RETRY_MS 5000
+#define MQTT_CONNECT_TIMEOUT_MS 1000
+#define MQTT_TX_SIZE 2048
+#define MQTT_RX_SIZE 256
+#define MQTT_TELEMETRY_MS 200       // Fenêtre de regroupement des changements
+#define MQTT_HEARTBEAT_MS 10000     // Publication même sans changement
+
+WiFiClient mqttClient;
+bool mqttSession = false;           // CONNACK accepté
+uint8_t mqttTx[MQTT_TX_SIZE];
+uint16_t mqttTxLength = 0;
+uint8_t mqttRx[MQTT_RX_SIZE];
+uint16_t mqttRxLength = 0;
+unsigned long mqttLastAttempt = 0;
+unsigned long mqttLastSent = 0;
+unsigned long mqttLastReceived = 0;
+unsigned long mqttLastTelemetry = 0;
+unsigned long mqttLastPublish = 0;
+long mqttPublishedSteps = 0;
+uint16_t mqttPublishedFlags = 0xFFFF;
+float mqttPublishedSpeed = -1;
+uint16_t mqttPublishedOverride = 0;
+unsigned long mqttPublished = 0;
+unsigned long mqttDropped = 0;
+unsigned long mqttCommands = 0;
+
+// ===== PROTOCOLE JOG BINAIRE =====
+JogSession jog;
+bool jogActive = false;
+unsigned long jogCmdMicros = 0;     // 0 = aucune latence en cours de mesure
+unsigned long jogLatencyLast = 0;
+unsigned long jogLatencyMax = 0;
+
+// ===== PROTOCOLE DE SYNCHRONISATION =====
+// Paquet de 32 octets, little-endian. Toute unité synchronisée répond aux
+// requêtes avec son horloge de référence: les unités peuvent se chaîner,
+// chaque saut ajoutant son erreur.
+#define SYNC_UDP_PORT 4211
+#define SYNC_MAGIC 0x5C
+#define SYNC_VERSION 1
+#define SYNC_REQUEST 1
+#define SYNC_REPLY 2
+#define SYNC_INTERVAL_MS 1000
+#define SYNC_VALID_MS 10000           // Sans échange réussi depuis: non synchronisée
+
+struct __attribute__((packed)) SyncPacket {
+  uint8_t magic;
+  uint8_t version;
+  uint8_t type;
+  uint8_t flags;
+  uint32_t seq;
+  int64_t t1;          // Envoi de la requête, horloge du demandeur
+  int64_t t2;          // Réception sur la référence
+  int64_t t3;          // Envoi de la réponse, horloge de référence
+};
+
+ClockSync clockSync;
+uint32_t syncSeq = 0;
+bool syncPending = false;
+unsigned long syncLastRequest = 0;
+unsigned long syncServed = 0;
+unsigned long syncRejected = 0;
+
+// ===== DÉPART PROGRAMMÉ =====
+// Déplacement, marche continue ou flux PVT lancé à un instant de l'horloge
+// de référence ("startAt", µs): plusieurs unités démarrent ensemble quel que
+// soit le délai de leur requête. Le service réseau est suspendu dans les
+// dernières ms pour que la boucle soit libre à l'instant du départ.
+#define START_NONE 0
+#define START_MOVE 1
+#define START_CONTINUOUS 2
+#define START_PVT 3
+#define START_AHEAD_MAX_US 60000000LL  // Au plus 60 s à l'avance
+#define START_GUARD_US 5000
+
+uint8_t pendingStart = START_NONE;
+int64_t pendingStartAt = 0;
+float pendingDistance = 0;
+float pendingSpeed = 0;
+int pendingDirection = 1;
+unsigned long scheduledStarts = 0;
+unsigned long scheduledMissed = 0;
+int32_t startLateLastUs = 0;          // Retard du dernier départ sur l'instant demandé
+int32_t startLateMaxUs = 0;
+
+DiagSample diagHistory[DIAG_HISTORY];
+int diagHead = 0;
+int diagCount = 0;
+unsigned long diagLastSample = 0;
+unsigned long diagLoopLast = 0;
+uint32_t diagLoopMin = UINT32_MAX;
+uint32_t diagLoopMax = 0;
+uint32_t diagLoopMaxEver = 0;
+uint64_t diagLoopSum = 0;
+uint32_t diagLoopCount = 0;
+unsigned long loopOverruns = 0;   // Boucles plus longues que l'intervalle de pas en cours
+
+// ===== DÉMARRAGE =====
+BootProfile bootProfile;
+uint32_t bootSetupUs = 0;           // Entrée dans setup() depuis le reset
+volatile bool storageReady = false; // SPIFFS monté (écrit par la tâche réseau)
+volatile bool wifiReady = false;    // AP démarré (écrit par la tâche réseau)
+bool networkReady = false;          // Serveurs démarrés (loop)
+
+#define SERIAL_LINE_MAX 64
+char serialLine[SERIAL_LINE_MAX];
+int serialLineLength = 0;
 
 // ===== FONCTIONS UTILITAIRES =====
 
 void calculateStepsPerMm() {
+  odometer.fold(STEPS_PER_MM, millis());  // Distance parcourue à l'ancien pas/mm
   STEPS_PER_MM = (STEPS_PER_REVOLUTION * MICROSTEPS) / LEAD_SCREW_PITCH;
+  // Table de rampe prête pour la vitesse par défaut
+  stepper.setAcceleration((SPEED_DEFAULT * STEPS_PER_MM) / 60.0 * ACCEL_FACTOR);
+  stepper.setBacklash(lround(BACKLASH_MM * STEPS_PER_MM));
+  following.stepsPerCount = (STEPS_PER_REVOLUTION * MICROSTEPS) / ENCODER_COUNTS_PER_REV;
+  following.warnSteps = max(1L, lround(FOLLOWING_WARN_MM * STEPS_PER_MM));
+  following.faultSteps = max(2L, lround(FOLLOWING_FAULT_MM * STEPS_PER_MM));
+  positionEventsRebuild();
   Serial.println("Steps/mm calculé: " + String(STEPS_PER_MM));
 }
 
@@ -64,10 +2342,30 @@ void saveConfig() {
   preferences.putFloat("steps_rev", STEPS_PER_REVOLUTION);
   preferences.putFloat("microsteps", MICROSTEPS);
   preferences.putFloat("pitch", LEAD_SCREW_PITCH);
+  preferences.putFloat("backlash", BACKLASH_MM);
   preferences.putFloat("speed_min", SPEED_MIN);
   preferences.putFloat("speed_max", SPEED_MAX);
   preferences.putFloat("speed_def", SPEED_DEFAULT);
   preferences.putFloat("speed_home", SPEED_HOME);
+  preferences.putULong("jog_hb", JOG_HEARTBEAT_MS);
+  preferences.putFloat("accel_fact", ACCEL_FACTOR);
+  preferences.putInt("shaper", SHAPER_TYPE);
+  preferences.putFloat("shaper_freq", SHAPER_FREQ);
+  preferences.putFloat("shaper_zeta", SHAPER_DAMPING);
+  preferences.putBool("enc_on", ENCODER_ENABLED);
+  preferences.putFloat("enc_cpr", ENCODER_COUNTS_PER_REV);
+  preferences.putFloat("enc_warn", FOLLOWING_WARN_MM);
+  preferences.putFloat("enc_fault", FOLLOWING_FAULT_MM);
+  preferences.putInt("gear_num", GEAR_NUM);
+  preferences.putInt("gear_den", GEAR_DEN);
+  preferences.putFloat("gear_filt", GEAR_FILTER_MS);
+  preferences.putFloat("gear_fault", GEAR_FAULT_MM);
+  preferences.putString("sta_ssid", STA_SSID);
+  preferences.putString("sta_pass", STA_PASSWORD);
+  preferences.putString("mqtt_host", MQTT_HOST);
+  preferences.putUShort("mqtt_port", MQTT_PORT);
+  preferences.putString("mqtt_base", MQTT_BASE);
+  preferences.putString("sync_master", SYNC_MASTER);
   preferences.end();
   Serial.println("✅ Configuration sauvegardée");
 }
@@ -77,10 +2375,30 @@ void loadConfig() {
   STEPS_PER_REVOLUTION = preferences.getFloat("steps_rev", 200.0);
   MICROSTEPS = preferences.getFloat("microsteps", 1.0);
   LEAD_SCREW_PITCH = preferences.getFloat("pitch", 2.0);
+  BACKLASH_MM = max(0.0f, min((float)BACKLASH_MAX_MM, preferences.getFloat("backlash", 0.0)));
   SPEED_MIN = preferences.getFloat("speed_min", 50.0);
   SPEED_MAX = preferences.getFloat("speed_max", 2000.0);
   SPEED_DEFAULT = preferences.getFloat("speed_def", 300.0);
   SPEED_HOME = preferences.getFloat("speed_home", 600.0);
+  JOG_HEARTBEAT_MS = preferences.getULong("jog_hb", 250);
+  ACCEL_FACTOR = preferences.getFloat("accel_fact", 2.0);
+  SHAPER_TYPE = constrain(preferences.getInt("shaper", SHAPER_NONE), SHAPER_NONE, SHAPER_EI);
+  SHAPER_FREQ = preferences.getFloat("shaper_freq", 40.0);
+  SHAPER_DAMPING = preferences.getFloat("shaper_zeta", 0.1);
+  ENCODER_ENABLED = preferences.getBool("enc_on", false);
+  ENCODER_COUNTS_PER_REV = preferences.getFloat("enc_cpr", 4000.0);
+  FOLLOWING_WARN_MM = preferences.getFloat("enc_warn", 0.05);
+  FOLLOWING_FAULT_MM = preferences.getFloat("enc_fault", 0.5);
+  GEAR_NUM = preferences.getInt("gear_num", 1);
+  GEAR_DEN = max(1, (int)preferences.getInt("gear_den", 1));
+  GEAR_FILTER_MS = preferences.getFloat("gear_filt", 2.0);
+  GEAR_FAULT_MM = preferences.getFloat("gear_fault", 1.0);
+  STA_SSID = preferences.getString("sta_ssid", "");
+  STA_PASSWORD = preferences.getString("sta_pass", "");
+  MQTT_HOST = preferences.getString("mqtt_host", "");
+  MQTT_PORT = preferences.getUShort("mqtt_port", 1883);
+  MQTT_BASE = preferences.getString("mqtt_base", "stepper");
+  SYNC_MASTER = preferences.getString("sync_master", "");
   preferences.end();
   
   calculateStepsPerMm();
@@ -89,6 +2407,7 @@ void loadConfig() {
 }
 
 void logToFile(String message) {
+  if (!storageReady) return;
   File logFile = SPIFFS.open("/stepper.log", "a");
   if (logFile) {
     String timestamp = String(millis() - sessionStart);
@@ -103,1102 +2422,4140 @@ bool checkLimits(float pos) {
 }
 
 void stopMotor() {
-  stepper.stop();
+  stepper.setCurrentPosition(stepper.currentPosition());
+  pendingStart = START_NONE;
   isRunning = false;
   movingToTarget = false;
   continuousMode = false;
+  jogActive = false;
+  jogCmdMicros = 0;
+  gearActive = false;
+  if (pvtActive) pvt.clear();
+  pvtActive = false;
   currentPosition = (float)stepper.currentPosition() / STEPS_PER_MM;
   targetPosition = currentPosition;
   Serial.println("MOTEUR ARRÊTÉ - Position: " + String(currentPosition, 3) + "mm");
 }
 
-// ===== SETUP =====
+// Axe tenu par l'engrenage ou le flux PVT: code d'erreur des commandes de
+// mouvement, NULL si l'axe est libre (sinon la branche de suivi de loop()
+// les écraserait)
+const char* axisOwner() {
+  if (gearActive) return "gear_active";
+  if (pvtActive) return "pvt_active";
+  return NULL;
+}
 
-void setup() {
-  Serial.begin(115200);
-  
-  if (!SPIFFS.begin(true)) {
-    Serial.println("❌ Erreur SPIFFS");
+// Déplacement relatif (mm) à la vitesse donnée (mm/min); false si hors
+// limites ou axe tenu (axisOwner())
+bool startMove(float distance, float speed) {
+  if (axisOwner() != NULL) return false;
+  currentPosition = (float)stepper.currentPosition() / STEPS_PER_MM;
+  float newTarget = currentPosition + distance;
+  if (!checkLimits(newTarget)) return false;
+
+  float speedStepsPerSec = (speed * STEPS_PER_MM) / 60.0;
+  currentSpeed = speed;
+  stepper.setMaxSpeed(beginFeed(speedStepsPerSec));
+  stepper.setAcceleration(speedStepsPerSec * ACCEL_FACTOR);
+  long steps = (long)(distance * STEPS_PER_MM);
+  stepper.move(steps);
+  targetPosition = newTarget;
+  movingToTarget = true;
+  isRunning = true;
+  odometer.moveStarted();
+  journalRecord(JOURNAL_MOVE, distance, speed);
+  logToFile("Distance " + String(distance) + "mm");
+  return true;
+}
+
+// Cible de la marche continue: la limite logicielle dans le sens de marche,
+// que la rampe rejoint en décélérant, ou l'horizon glissant
+long continuousTarget(int direction) {
+  if (SOFT_LIMITS_ENABLED) {
+    return lround((direction > 0 ? SOFT_LIMIT_MAX : SOFT_LIMIT_MIN) * STEPS_PER_MM);
   }
-  
-  sessionStart = millis();
-  loadConfig();
-  logToFile("=== DÉMARRAGE ESP32 ===");
+  return stepper.currentPosition() + direction * CONTINUOUS_HORIZON_STEPS;
+}
 
-  stepper.setMaxSpeed(10000);
-  stepper.setAcceleration(5000);
+// Marche continue (steps/s) par le générateur à rampe: démarrage accéléré,
+// et depuis un mouvement en cours, changement de cible sans arrêt (la rampe
+// décélère puis repart dans l'autre sens). false si la limite est atteinte.
+bool startContinuous(int direction, float speedStepsPerSec) {
+  if (axisOwner() != NULL) return false;
+  long target = continuousTarget(direction);
+  if ((target - stepper.currentPosition()) * direction <= 0) return false;
+
+  moveDirection = direction;
+  stepper.setMaxSpeed(beginFeed(speedStepsPerSec));
+  stepper.setAcceleration(speedStepsPerSec * ACCEL_FACTOR);
+  stepper.moveTo(target);
+  movingToTarget = false;
+  continuousMode = true;
+  isRunning = true;
+  odometer.moveStarted();
+  return true;
+}
+
+// Fin de marche continue sur la rampe: l'axe termine comme un déplacement
+// vers son point d'arrêt
+void stopContinuous() {
+  if (!continuousMode) return;
+  stepper.stop();
+  continuousMode = false;
+  jogActive = false;
+  jogCmdMicros = 0;
+  movingToTarget = true;
+  targetPosition = (float)stepper.targetPosition() / STEPS_PER_MM;
+}
+
+// Nouvelle vitesse de consigne (mm/min); en mouvement, elle est rejointe
+// par la rampe de updateFeedOverride()
+void applySpeed(float newSpeed) {
+  currentSpeed = newSpeed;
+  if (isRunning && (continuousMode || movingToTarget)) {
+    feedRamp.baseSpeed = (newSpeed * STEPS_PER_MM) / 60.0;
+  }
+  journalRecord(JOURNAL_SPEED, newSpeed, 0);
+}
+
+// Arrête l'axe et prend la position courante comme origine
+void resetPosition() {
+  stopMotor();
   stepper.setCurrentPosition(0);
   currentPosition = 0.0;
   targetPosition = 0.0;
+  encoderSync();
+  positionEventsSeek(0);
+  journalRecord(JOURNAL_RESET, 0, 0);
+}
 
-  Serial.println("=== STEPPER ESP32 DÉMARRÉ ===");
-  Serial.println("Steps/mm: " + String(STEPS_PER_MM));
+void startHoming() {
+  stopMotor();
+  delay(10);
+  float distanceToHome = -currentPosition;
 
-  WiFi.mode(WIFI_AP);
-  WiFi.softAP(ap_ssid, ap_password);
+  float homeSpeed = (SPEED_HOME * STEPS_PER_MM) / 60.0;
+  stepper.setMaxSpeed(beginFeed(homeSpeed));
+  stepper.setAcceleration(homeSpeed * ACCEL_FACTOR);
 
-  IPAddress local_IP(192, 168, 4, 1);
-  IPAddress gateway(192, 168, 4, 1);
-  IPAddress subnet(255, 255, 255, 0);
-  WiFi.softAPConfig(local_IP, gateway, subnet);
+  long steps = (long)(distanceToHome * STEPS_PER_MM);
+  stepper.move(steps);
 
-  Serial.println("WiFi AP: " + String(ap_ssid));
-  Serial.println("IP: " + WiFi.softAPIP().toString());
+  targetPosition = 0.0;
+  movingToTarget = true;
+  isRunning = true;
+  currentSpeed = SPEED_HOME;
+  odometer.moveStarted();
+  journalRecord(JOURNAL_HOME, 0, 0);
+  logToFile("Retour origine");
+}
 
-  dnsServer.start(DNS_PORT, "*", WiFi.softAPIP());
-  
-  setupWebServer();
-  server.begin();
-  Serial.println("Interface: http://192.168.4.1");
+// ===== MISE EN FORME DE CONSIGNE =====
+
+// Calcule les impulsions du filtre configuré et les transmet au générateur
+bool configureShaper() {
+  int32_t amplitudes[SHAPER_MAX_IMPULSES];
+  uint32_t delays[SHAPER_MAX_IMPULSES];
+  int count = ShaperDesign::impulses(SHAPER_TYPE, SHAPER_FREQ, SHAPER_DAMPING, amplitudes, delays);
+  if (count < 0) return false;
+
+  shaperDelayUs = count > 0 ? delays[count - 1] + SHAPER_TICK_US : 0;
+  stepper.setShaper(count, amplitudes, delays);
+  return true;
 }
 
-// ===== WEB SERVER =====
+// ===== PLANIFICATION À BLANC =====
 
-void setupWebServer() {
-  
-  server.onNotFound([]() {
-    server.sendHeader("Location", "http://192.168.4.1/", true);
-    server.send(302, "text/plain", "");
-  });
+// Estimation avec la correction d'avance et la mise en forme en vigueur
+MovePlan planMove(long steps, float speedStepsPerSec, long takeup) {
+  return MovePlanner::estimate(stepper, steps, takeup, speedStepsPerSec * feedOverride / 100.0,
+                               speedStepsPerSec * ACCEL_FACTOR, shaperDelayUs);
+}
 
-  server.on("/", []() {
-    String html = R"rawliteral(
-<!DOCTYPE html>
-<html>
-<head>
-    <meta charset="UTF-8">
-    <meta name="viewport" content="width=device-width, initial-scale=1.0">
-    <title>Stepper Controller</title>
-    <style>
-        * { box-sizing: border-box; }
-        body { 
-            font-family: Arial, sans-serif; 
-            margin: 0; 
-            padding: 20px; 
-            background: #f0f0f0; 
-        }
-        .container { 
-            max-width: 900px; 
-            margin: 0 auto; 
-            background: white; 
-            padding: 20px; 
-            border-radius: 10px; 
-            box-shadow: 0 2px 10px rgba(0,0,0,0.1);
-        }
-        h1 { 
-            color: #333; 
-            margin-top: 0; 
-        }
-        .tabs { 
-            display: flex; 
-            border-bottom: 2px solid #dee2e6; 
-            margin-bottom: 20px; 
-        }
-        .tab { 
-            padding: 12px 24px; 
-            cursor: pointer; 
-            background: #f8f9fa; 
-            border: none; 
-            border-bottom: 3px solid transparent; 
-            font-weight: bold; 
-            font-size: 15px;
-        }
-        .tab.active { 
-            border-bottom-color: #007bff; 
-            color: #007bff; 
-            background: white; 
-        }
-        .tab-content { 
-            display: none; 
-        }
-        .tab-content.active { 
-            display: block; 
-        }
-        .panel { 
-            background: #f8f9fa; 
-            padding: 20px; 
-            border-radius: 8px; 
-            margin-bottom: 20px; 
-        }
-        .panel h3 { 
-            margin-top: 0; 
-            color: #495057;
-        }
-        .status-panel { 
-            background: #e8f4fd; 
-        }
-        .admin-panel { 
-            background: #fff3cd; 
-            border: 2px solid #ffc107; 
-        }
-        .admin-locked { 
-            background: #f8d7da; 
-            padding: 30px; 
-            text-align: center; 
-            border: 2px solid #dc3545; 
-        }
-        input[type="number"], input[type="password"] { 
-            padding: 10px; 
-            margin: 5px; 
-            border: 1px solid #ccc; 
-            border-radius: 5px; 
-            font-size: 14px;
-        }
-        input[type="number"] { 
-            width: 120px; 
-        }
-        input[type="password"] { 
-            width: 200px; 
-            font-size: 16px;
-        }
-        button { 
-            padding: 10px 20px; 
-            margin: 5px; 
-            border: none; 
-            border-radius: 5px; 
-            cursor: pointer; 
-            font-weight: bold; 
-            font-size: 14px;
-        }
-        .btn-primary { background: #007bff; color: white; }
-        .btn-success { background: #28a745; color: white; }
-        .btn-danger { background: #dc3545; color: white; }
-        .btn-warning { background: #ffc107; color: black; }
-        .btn-primary:hover { background: #0056b3; }
-        .btn-success:hover { background: #1e7e34; }
-        .btn-danger:hover { background: #bd2130; }
-        .btn-warning:hover { background: #e0a800; }
-        .status-value { 
-            font-weight: bold; 
-            font-size: 18px;
-        }
-        .running { color: #28a745; }
-        .stopped { color: #dc3545; }
-        .info-box { 
-            background: #d1ecf1; 
-            border: 1px solid #bee5eb; 
-            padding: 15px; 
-            border-radius: 5px; 
-            margin: 15px 0; 
-        }
-        .formula { 
-            font-family: monospace; 
-            background: #f8f9fa; 
-            padding: 5px 10px; 
-            border-radius: 3px; 
-            display: inline-block; 
-        }
-        .log { 
-            background: #2d3748; 
-            color: #e2e8f0; 
-            padding: 15px; 
-            border-radius: 5px; 
-            font-family: monospace; 
-            font-size: 12px; 
-            max-height: 300px; 
-            overflow-y: auto; 
-        }
-        .grid { 
-            display: grid; 
-            grid-template-columns: 1fr 1fr; 
-            gap: 15px; 
-        }
-        @media (max-width: 768px) {
-            .grid { 
-                grid-template-columns: 1fr; 
-            }
-        }
-        label { 
-            display: block; 
-            margin-bottom: 5px; 
-            font-weight: 600; 
-            color: #495057;
-        }
-        small { 
-            color: #6c757d; 
-            font-size: 12px;
-        }
-    </style>
-</head>
-<body>
-    <div class="container">
-        <h1>🔧 Stepper ESP32 Controller</h1>
-        
-        <div class="tabs">
-            <button class="tab active" onclick="switchTab('control')">🎮 Contrôle</button>
-            <button class="tab" onclick="switchTab('admin')">⚙️ Admin</button>
-            <button class="tab" onclick="switchTab('logs')">📄 Logs</button>
-        </div>
+// ===== CORRECTION D'AVANCE =====
 
-        <!-- ONGLET CONTROLE -->
-        <div id="tab-control" class="tab-content active">
-            <div class="panel status-panel">
-                <h3>📊 État du moteur</h3>
-                <div class="grid">
-                    <div>
-                        <strong>État:</strong> <span id="status" class="status-value stopped">Arrêté</span><br>
-                        <strong>Position:</strong> <span id="position" class="status-value">0.000</span> mm<br>
-                        <strong>Cible:</strong> <span id="target" class="status-value">0.000</span> mm
-                    </div>
-                    <div>
-                        <strong>Vitesse:</strong> <span id="speed" class="status-value">0</span> mm/min<br>
-                        <strong>Steps/mm:</strong> <span id="stepsPerMm" class="status-value">100.00</span><br>
-                        <strong>Limites:</strong> <span id="limitsStatus">Activées</span>
-                    </div>
-                </div>
-            </div>
+// Démarre le suivi d'un nouveau mouvement et retourne la vitesse effective
+// (corrigée) à programmer dans le stepper.
+float beginFeed(float baseStepsPerSec) {
+  return feedRamp.begin(baseStepsPerSec, baseStepsPerSec * ACCEL_FACTOR, feedOverride, micros());
+}
 
-            <div class="panel">
-                <h3>🎮 Contrôles</h3>
-                <div>
-                    <label>Vitesse (mm/min):</label>
-                    <input type="number" id="speedInput" value="300" step="50">
-                    <button class="btn-primary" onclick="updateSpeedNow()">⚡ Appliquer</button>
-                </div>
-                <div style="margin-top: 15px;">
-                    <label>Distance (mm):</label>
-                    <input type="number" id="distanceInput" value="10" step="0.1">
-                    <button class="btn-primary" onclick="moveDistance()">📏 Déplacer</button>
-                </div>
-                <div style="margin-top: 15px;">
-                    <button class="btn-success" onclick="moveForward()">➡️ Avant Continu</button>
-                    <button class="btn-success" onclick="moveBackward()">⬅️ Arrière Continu</button>
-                </div>
-                <div style="margin-top: 15px;">
-                    <button class="btn-danger" onclick="stopMotor()">⏹️ ARRÊT</button>
-                    <button class="btn-warning" onclick="homeMotor()">🏠 Origine</button>
-                    <button class="btn-warning" onclick="resetPosition()">🔄 Reset</button>
-                </div>
-            </div>
+void updateFeedOverride() {
+  if (!isRunning) return;
+  if (!feedRamp.update(feedOverride, micros())) return;
+  if (continuousMode || movingToTarget) {
+    stepper.setMaxSpeed(feedRamp.applied);
+  }
+}
 
-            <div class="panel">
-                <h3>📏 Limites de sécurité</h3>
-                <div>
-                    <label>Min (mm):</label>
-                    <input type="number" id="limitMin" value="-100" step="1">
-                    <label>Max (mm):</label>
-                    <input type="number" id="limitMax" value="100" step="1">
-                </div>
-                <div style="margin-top: 10px;">
+// ===== CODEUR =====
+
+#define ENCODER_PCNT_UNIT PCNT_UNIT_0
+#define ENCODER_PCNT_LIMIT 30000
+
+void encoderBegin() {
+  if (encoderStarted) return;
+
+  // Quadrature x4: chaque voie compte sur ses deux fronts, l'autre donne le sens
+  pcnt_config_t config = {};
+  config.pulse_gpio_num = ENCODER_A_PIN;
+  config.ctrl_gpio_num = ENCODER_B_PIN;
+  config.channel = PCNT_CHANNEL_0;
+  config.unit = ENCODER_PCNT_UNIT;
+  config.pos_mode = PCNT_COUNT_DEC;
+  config.neg_mode = PCNT_COUNT_INC;
+  config.lctrl_mode = PCNT_MODE_REVERSE;
+  config.hctrl_mode = PCNT_MODE_KEEP;
+  config.counter_h_lim = ENCODER_PCNT_LIMIT;
+  config.counter_l_lim = -ENCODER_PCNT_LIMIT;
+  pcnt_unit_config(&config);
+
+  config.pulse_gpio_num = ENCODER_B_PIN;
+  config.ctrl_gpio_num = ENCODER_A_PIN;
+  config.channel = PCNT_CHANNEL_1;
+  config.pos_mode = PCNT_COUNT_INC;
+  config.neg_mode = PCNT_COUNT_DEC;
+  pcnt_unit_config(&config);
+
+  pcnt_set_filter_value(ENCODER_PCNT_UNIT, 100);
+  pcnt_filter_enable(ENCODER_PCNT_UNIT);
+  pcnt_counter_pause(ENCODER_PCNT_UNIT);
+  pcnt_counter_clear(ENCODER_PCNT_UNIT);
+  pcnt_counter_resume(ENCODER_PCNT_UNIT);
+  encoderLastRaw = 0;
+  encoderTotal = 0;
+
+  encoderStarted = true;
+  Serial.println("Codeur: PCNT démarré");
+}
+
+// Le compteur PCNT (16 bits) repart à 0 en atteignant ±ENCODER_PCNT_LIMIT:
+// on cumule les écarts entre lectures, appelé à chaque loop()
+long encoderCount() {
+  int16_t raw = 0;
+  pcnt_get_counter_value(ENCODER_PCNT_UNIT, &raw);
+  long delta = raw - encoderLastRaw;
+  if (delta > ENCODER_PCNT_LIMIT / 2) delta -= ENCODER_PCNT_LIMIT;
+  else if (delta < -ENCODER_PCNT_LIMIT / 2) delta += ENCODER_PCNT_LIMIT;
+  encoderLastRaw = raw;
+  encoderTotal += delta;
+  return encoderTotal;
+}
+
+// Recale le codeur sur la position commandée (après reset ou calibration)
+void encoderSync() {
+  if (!encoderStarted) return;
+  following.sync(stepper.motorPosition(), encoderCount());
+}
+
+void checkFollowingError() {
+  if (!ENCODER_ENABLED || !encoderStarted) return;
+
+  int result = following.update(stepper.motorPosition(), encoderCount());
+  if (result == FOLLOWING_FAULT) {
+    encoderFaults++;
+    float errorMm = following.error / STEPS_PER_MM;
+    stopMotor();
+    journalRecord(JOURNAL_FAULT, errorMm, 0);
+    Serial.println("ERREUR DE POURSUITE: " + String(errorMm, 3) + "mm");
+    logToFile("Erreur poursuite " + String(errorMm, 3) + "mm - axe arrêté");
+  } else if (result == FOLLOWING_WARN) {
+    encoderWarnings++;
+    logToFile("Écart poursuite " + String(following.error / STEPS_PER_MM, 3) + "mm");
+  }
+}
+
+// ===== ENGRENAGE ÉLECTRONIQUE =====
+
+void gearBegin() {
+  if (gearStarted) return;
+
+  // Front montant de STEP compté, DIR bas inverse le sens
+  pcnt_config_t config = {};
+  config.pulse_gpio_num = GEAR_STEP_PIN;
+  config.ctrl_gpio_num = GEAR_DIR_PIN;
+  config.channel = PCNT_CHANNEL_0;
+  config.unit = GEAR_PCNT_UNIT;
+  config.pos_mode = PCNT_COUNT_INC;
+  config.neg_mode = PCNT_COUNT_DIS;
+  config.lctrl_mode = PCNT_MODE_REVERSE;
+  config.hctrl_mode = PCNT_MODE_KEEP;
+  config.counter_h_lim = GEAR_PCNT_LIMIT;
+  config.counter_l_lim = -GEAR_PCNT_LIMIT;
+  pcnt_unit_config(&config);
+
+  pcnt_set_filter_value(GEAR_PCNT_UNIT, 100);
+  pcnt_filter_enable(GEAR_PCNT_UNIT);
+  pcnt_counter_pause(GEAR_PCNT_UNIT);
+  pcnt_counter_clear(GEAR_PCNT_UNIT);
+  pcnt_counter_resume(GEAR_PCNT_UNIT);
+  gearLastRaw = 0;
+  gearTotal = 0;
+
+  gearStarted = true;
+  Serial.println("Engrenage: PCNT démarré");
+}
+
+// Même cumul que encoderCount(): lu à chaque loop(), bien avant
+// GEAR_PCNT_LIMIT / 2 impulsions entre deux lectures
+long gearCount() {
+  int16_t raw = 0;
+  pcnt_get_counter_value(GEAR_PCNT_UNIT, &raw);
+  long delta = raw - gearLastRaw;
+  if (delta > GEAR_PCNT_LIMIT / 2) delta -= GEAR_PCNT_LIMIT;
+  else if (delta < -GEAR_PCNT_LIMIT / 2) delta += GEAR_PCNT_LIMIT;
+  gearLastRaw = raw;
+  gearTotal += delta;
+  return gearTotal;
+}
+
+// L'axe prend la position courante comme origine de la consigne maître
+bool gearEngage() {
+  if (isRunning) return false;
+  gearBegin();
+  gear.num = GEAR_NUM;
+  gear.den = GEAR_DEN;
+  gear.filterUs = (uint32_t)(GEAR_FILTER_MS * 1000);
+  gear.faultSteps = max(1L, lround(GEAR_FAULT_MM * STEPS_PER_MM));
+  gear.minSteps = SOFT_LIMITS_ENABLED ? lround(SOFT_LIMIT_MIN * STEPS_PER_MM) : LONG_MIN;
+  gear.maxSteps = SOFT_LIMITS_ENABLED ? lround(SOFT_LIMIT_MAX * STEPS_PER_MM) : LONG_MAX;
+  gear.engage(gearCount(), stepper.currentPosition(), micros());
+  gearMinIntervalUs = (uint32_t)(60000000.0 / (SPEED_MAX * STEPS_PER_MM));
+  gearWasLimited = false;
+  gearActive = true;
+  isRunning = true;
+  odometer.moveStarted();
+  return true;
+}
+
+void gearFollow() {
+  long target = gear.update(gearCount(), stepper.currentPosition(), micros());
+  stepper.follow(target, gearMinIntervalUs);
+
+  if (gear.limited != gearWasLimited) {
+    gearWasLimited = gear.limited;
+    if (gear.limited) {
+      gearLimitHits++;
+      logToFile("Engrenage: consigne hors limites, axe tenu");
+    }
+  }
+
+  if (gear.fault()) {
+    float errorMm = gear.error / STEPS_PER_MM;
+    gearFaults++;
+    stopMotor();
+    journalRecord(JOURNAL_FAULT, errorMm, 0);
+    Serial.println("ENGRENAGE: ÉCART " + String(errorMm, 3) + "mm");
+    logToFile("Engrenage: écart " + String(errorMm, 3) + "mm - axe arrêté");
+  }
+}
+
+// ===== TRAJECTOIRE PVT =====
+
+// Point en unités de l'API (mm, mm/min, ms); false si hors limites ou file pleine
+bool pvtQueue(float positionMm, float speedMmMin, float durationMs) {
+  if (durationMs <= 0 || durationMs > 60000 || abs(speedMmMin) > SPEED_MAX || !checkLimits(positionMm)) {
+    pvtRejected++;
+    return false;
+  }
+  PvtPoint point;
+  point.position = lround(positionMm * STEPS_PER_MM);
+  point.velocity = speedMmMin * STEPS_PER_MM / 60.0;
+  point.durationUs = (uint32_t)(durationMs * 1000);
+  if (!pvt.push(point)) {
+    pvtRejected++;
+    return false;
+  }
+  pvtAccepted++;
+  return true;
+}
+
+bool pvtStart() {
+  if (isRunning || pvt.count == 0) return false;
+  pvt.start(stepper.currentPosition(), micros());
+  pvtMinIntervalUs = (uint32_t)(60000000.0 / (SPEED_MAX * STEPS_PER_MM));
+  pvtMinSteps = SOFT_LIMITS_ENABLED ? lround(SOFT_LIMIT_MIN * STEPS_PER_MM) : LONG_MIN;
+  pvtMaxSteps = SOFT_LIMITS_ENABLED ? lround(SOFT_LIMIT_MAX * STEPS_PER_MM) : LONG_MAX;
+  pvtMaxLag = 0;
+  pvtActive = true;
+  isRunning = true;
+  odometer.moveStarted();
+  return true;
+}
+
+void pvtFollow() {
+  long target;
+  int state = pvt.update(micros(), target);
+  // Les points sont dans les limites, un segment d'Hermite peut les déborder
+  target = constrain(target, pvtMinSteps, pvtMaxSteps);
+  stepper.follow(target, pvtMinIntervalUs);
+
+  long lag = labs(target - stepper.currentPosition());
+  pvtMaxLag = max(pvtMaxLag, lag);
+  if (state == PVT_RUNNING && lag >= lround(PVT_LAG_FAULT_MM * STEPS_PER_MM)) {
+    pvtFaults++;
+    stopMotor();
+    journalRecord(JOURNAL_FAULT, lag / STEPS_PER_MM, 0);
+    logToFile("PVT: retard " + String(lag / STEPS_PER_MM, 3) + "mm - flux arrêté");
+    return;
+  }
+  if (state == PVT_RUNNING || lag != 0) return;
+
+  // Dernier point atteint: fin normale (vitesse nulle) ou rupture de flux
+  pvtActive = false;
+  isRunning = false;
+  currentPosition = (float)stepper.currentPosition() / STEPS_PER_MM;
+  targetPosition = currentPosition;
+  if (state == PVT_UNDERRUN) {
+    Serial.println("PVT: RUPTURE DE FLUX");
+    logToFile("PVT: rupture de flux à " + String(currentPosition, 3) + "mm");
+    journalRecord(JOURNAL_STOP, 0, 0);
+  } else {
+    journalRecord(JOURNAL_ARRIVED, 0, 0);
+  }
+}
+
+// ===== ÉVÉNEMENTS SUR POSITION =====
+
+#ifdef ARDUINO
+void positionEventPulseEnd(void* arg) {
+  GPIO.out_w1tc = positionEvents[(intptr_t)arg].mask;
+}
+#endif
+
+void positionEventsBegin() {
+#ifdef ARDUINO
+  for (intptr_t i = 0; i < MAX_POSITION_EVENTS; i++) {
+    esp_timer_create_args_t timerArgs = {};
+    timerArgs.callback = positionEventPulseEnd;
+    timerArgs.arg = (void*)i;
+    timerArgs.name = "pos_event";
+    esp_timer_create(&timerArgs, &positionEventTimers[i]);
+  }
+#endif
+}
+
+// Front montant immédiat (exact au pas près), fin d'impulsion par temporisateur
+inline void firePositionEvent(int index) {
+  PositionEvent& event = positionEvents[index];
+#ifdef ARDUINO
+  GPIO.out_w1ts = event.mask;
+  esp_timer_stop(positionEventTimers[index]);
+  esp_timer_start_once(positionEventTimers[index], event.pulseUs);
+#endif
+  event.fired++;
+}
+
+void positionEventsSeek(long position) {
+  positionEventCursor = PositionEventCursor::seek(positionEvents, positionEventCount, position);
+}
+
+// Convertit les positions mm en steps et retrie (après calibration)
+void positionEventsRebuild() {
+  for (int i = 0; i < positionEventCount; i++) {
+    positionEvents[i].steps = lround(positionEvents[i].positionMm * STEPS_PER_MM);
+  }
+  PositionEventCursor::sort(positionEvents, positionEventCount);
+  positionEventsSeek(stepper.currentPosition());
+}
+
+inline void positionEventsStep(long position, int dir) {
+  positionEventCursor = PositionEventCursor::step(positionEvents, positionEventCount, positionEventCursor, position,
+                                                  dir, firePositionEvent);
+}
+
+// ===== ENREGISTREUR DE TRACE =====
+
+void traceStart() {
+  traceHead = 0;
+  traceCount = 0;
+  traceDropped = 0;
+  traceSkip = 0;
+  traceArmed = false;
+  traceRecording = true;
+}
+
+inline void traceRecord(long position, int dir) {
+  if (traceSkip > 0) {
+    traceSkip--;
+    return;
+  }
+  traceSkip = traceDecimation - 1;
+
+  TraceSample& sample = traceBuffer[traceHead];
+  sample.timeUs = micros();
+  sample.steps = position;
+  sample.intervalUs = stepper.stepInterval();
+  sample.state = (isRunning ? TRACE_STATE_RUNNING : 0) |
+                 (movingToTarget ? TRACE_STATE_TARGET : 0) |
+                 (continuousMode ? TRACE_STATE_CONTINUOUS : 0) |
+                 (jogActive ? TRACE_STATE_JOG : 0) |
+                 (dir < 0 ? TRACE_STATE_REVERSE : 0);
+
+  traceHead = (traceHead + 1) % TRACE_CAPACITY;
+  if (traceCount < TRACE_CAPACITY) {
+    traceCount++;
+  } else {
+    traceDropped++;
+  }
+  if (!traceRing && traceCount == TRACE_CAPACITY) {
+    traceRecording = false;
+  }
+}
+
+// ===== ODOMÈTRE =====
+
+void odometerLoad() {
+  OdometerTotals stored;
+  preferences.begin("odometer", true);
+  size_t size = preferences.getBytes("totals", &stored, sizeof(stored));
+  preferences.end();
+  if (size == sizeof(stored) && stored.version == ODOMETER_VERSION) odometer.totals = stored;
+}
+
+void odometerSave() {
+  odometer.fold(STEPS_PER_MM, millis());
+  odometer.totals.saves++;
+  preferences.begin("odometer", false);
+  preferences.putBytes("totals", &odometer.totals, sizeof(OdometerTotals));
+  preferences.end();
+  odometer.saved(millis());
+}
+
+String odometerJson() {
+  odometer.fold(STEPS_PER_MM, millis());
+  const OdometerTotals& t = odometer.totals;
+  String json = "{";
+  json += "\"steps\":" + String((double)t.steps, 0) + ",";
+  json += "\"distanceM\":" + String(t.distanceUm / 1000000.0, 3) + ",";
+  json += "\"reversals\":" + String(t.reversals) + ",";
+  json += "\"moves\":" + String(t.moves) + ",";
+  json += "\"motionHours\":" + String(t.motionMs / 3600000.0, 3) + ",";
+  json += "\"peakSpeed\":" + String(t.peakSpeed, 1) + ",";
+  json += "\"saves\":" + String(t.saves) + ",";
+  json += "\"unsaved\":" + String(odometer.dirty ? "true" : "false") + ",";
+  json += "\"lastSaveAgoS\":" + String((millis() - odometer.lastSaveMs) / 1000) + "}";
+  return json;
+}
+
+// ===== PROFILS DE CALIBRATION =====
+
+String profileKey(int slot) {
+  return "p" + String(slot);
+}
+
+// Pas/mm de la configuration en cours, en double comme les profils
+double currentStepsPerMm() {
+  if (activeProfile >= 0) return profiles[activeProfile].stepsPerMm;
+  return (double)STEPS_PER_REVOLUTION * MICROSTEPS / LEAD_SCREW_PITCH;
+}
+
+CalibrationProfile profileFromCurrent() {
+  CalibrationProfile profile;
+  profile.stepsPerRev = STEPS_PER_REVOLUTION;
+  profile.microsteps = MICROSTEPS;
+  profile.pitch = LEAD_SCREW_PITCH;
+  profile.speedMin = SPEED_MIN;
+  profile.speedMax = SPEED_MAX;
+  profile.speedDefault = SPEED_DEFAULT;
+  profile.speedHome = SPEED_HOME;
+  profile.limitMin = SOFT_LIMIT_MIN;
+  profile.limitMax = SOFT_LIMIT_MAX;
+  profile.limitsEnabled = SOFT_LIMITS_ENABLED;
+  profile.backlash = BACKLASH_MM;
+  return profile;
+}
+
+void profilesDerive() {
+  for (int i = 0; i < PROFILE_COUNT; i++) {
+    if (profiles[i].used()) profiles[i].derive(ACCEL_FACTOR);
+  }
+}
+
+void profileStore(int slot, const CalibrationProfile& profile) {
+  profiles[slot] = profile;
+  profiles[slot].derive(ACCEL_FACTOR);
+  preferences.begin("profiles", false);
+  preferences.putBytes(profileKey(slot).c_str(), &profiles[slot], sizeof(CalibrationProfile));
+  preferences.end();
+}
+
+void profileDelete(int slot) {
+  profiles[slot] = CalibrationProfile();
+  preferences.begin("profiles", false);
+  preferences.remove(profileKey(slot).c_str());
+  if (activeProfile == slot) preferences.putInt("active", -1);
+  preferences.end();
+  if (activeProfile == slot) activeProfile = -1;
+}
+
+// Copie des constantes précalculées; la position est reconvertie au nouveau
+// pas/mm, l'axe ne bouge pas
+void profileApply(int slot) {
+  const CalibrationProfile& p = profiles[slot];
+  long steps = positionCarry.rescale(stepper.currentPosition(), currentStepsPerMm(), p.stepsPerMm);
+  odometer.fold(STEPS_PER_MM, millis());  // Distance parcourue à l'ancien pas/mm
+
+  STEPS_PER_REVOLUTION = p.stepsPerRev;
+  MICROSTEPS = p.microsteps;
+  LEAD_SCREW_PITCH = p.pitch;
+  SPEED_MIN = p.speedMin;
+  SPEED_MAX = p.speedMax;
+  SPEED_DEFAULT = p.speedDefault;
+  SPEED_HOME = p.speedHome;
+  SOFT_LIMIT_MIN = p.limitMin;
+  SOFT_LIMIT_MAX = p.limitMax;
+  SOFT_LIMITS_ENABLED = p.limitsEnabled;
+  BACKLASH_MM = p.backlash;
+  STEPS_PER_MM = p.stepsPerMm;
+  activeProfile = slot;
+
+  stepper.setCurrentPosition(steps);
+  stepper.setBacklash(lround(BACKLASH_MM * STEPS_PER_MM));
+  stepper.setAcceleration(p.accelDefault);
+  following.stepsPerCount = (STEPS_PER_REVOLUTION * MICROSTEPS) / ENCODER_COUNTS_PER_REV;
+  following.warnSteps = max(1L, lround(FOLLOWING_WARN_MM * STEPS_PER_MM));
+  following.faultSteps = max(2L, lround(FOLLOWING_FAULT_MM * STEPS_PER_MM));
+  positionEventsRebuild();  // Ordre conservé: tri en une passe
+  encoderSync();
+  currentPosition = (float)steps / STEPS_PER_MM;
+  targetPosition = currentPosition;
+  currentSpeed = SPEED_DEFAULT;
+}
+
+// Changement à l'arrêt; seule la clé du profil actif est écrite
+bool profileSelect(int slot) {
+  if (isRunning || pendingStart != START_NONE) return false;
+  unsigned long start = micros();
+  profileApply(slot);
+  profileSwitchLastUs = micros() - start;
+  profileSwitches++;
+  preferences.begin("profiles", false);
+  preferences.putInt("active", slot);
+  preferences.end();
+  logToFile("Profil '" + String(profiles[slot].name) + "': " + String(STEPS_PER_MM, 2) + " steps/mm, position " +
+            String(currentPosition, 3) + "mm");
+  return true;
+}
+
+void profilesLoad() {
+  preferences.begin("profiles", true);
+  for (int i = 0; i < PROFILE_COUNT; i++) {
+    CalibrationProfile stored;
+    size_t size = preferences.getBytes(profileKey(i).c_str(), &stored, sizeof(stored));
+    if (size == sizeof(stored) && stored.version == 1) {
+      stored.version = PROFILE_VERSION;  // Sans jeu: remplissage non initialisé
+      stored.backlash = 0;
+    }
+    if (size == sizeof(stored) && stored.version == PROFILE_VERSION && stored.valid()) {
+      stored.name[PROFILE_NAME_MAX] = 0;
+      profiles[i] = stored;
+    }
+  }
+  int active = preferences.getInt("active", -1);
+  preferences.end();
+  profilesDerive();
+  if (active >= 0 && active < PROFILE_COUNT && profiles[active].used()) profileApply(active);
+}
+
+String profileJson(int slot) {
+  const CalibrationProfile& p = profiles[slot];
+  String json = "{\"slot\":" + String(slot) + ",";
+  json += "\"name\":\"" + String(p.name) + "\",";
+  json += "\"stepsPerRev\":" + String(p.stepsPerRev, 1) + ",";
+  json += "\"microsteps\":" + String(p.microsteps, 1) + ",";
+  json += "\"pitch\":" + String(p.pitch, 3) + ",";
+  json += "\"stepsPerMm\":" + String(p.stepsPerMm, 4) + ",";
+  json += "\"speedMin\":" + String(p.speedMin, 0) + ",";
+  json += "\"speedMax\":" + String(p.speedMax, 0) + ",";
+  json += "\"speedDefault\":" + String(p.speedDefault, 0) + ",";
+  json += "\"speedHome\":" + String(p.speedHome, 0) + ",";
+  json += "\"limitMin\":" + String(p.limitMin, 3) + ",";
+  json += "\"limitMax\":" + String(p.limitMax, 3) + ",";
+  json += "\"limitsEnabled\":" + String(p.limitsEnabled ? "true" : "false") + ",";
+  json += "\"backlash\":" + String(p.backlash, 3) + "}";
+  return json;
+}
+
+// ===== JOURNAL DE COMMANDES =====
+
+void journalClear() {
+  journalHead = 0;
+  journalCount = 0;
+  journalDropped = 0;
+}
+
+// Appelé après application de la commande: position et cible sont celles
+// que le générateur va suivre
+void journalRecord(uint8_t command, float a, float b) {
+  if (!journalRecording) return;
+
+  JournalEntry& entry = journalBuffer[journalHead];
+  entry.timeUs = micros();
+  entry.command = command;
+  entry.reserved = 0;
+  entry.overridePct = (uint16_t)feedOverride;
+  entry.a = a;
+  entry.b = b;
+  entry.position = stepper.currentPosition();
+  entry.target = stepper.targetPosition();
+
+  journalHead = (journalHead + 1) % JOURNAL_CAPACITY;
+  if (journalCount < JOURNAL_CAPACITY) {
+    journalCount++;
+  } else {
+    journalDropped++;
+  }
+}
+
+// ===== DIAGNOSTICS MÉMOIRE =====
+
+const char* resetReasonName() {
+  switch (esp_reset_reason()) {
+    case ESP_RST_POWERON: return "poweron";
+    case ESP_RST_EXT: return "external";
+    case ESP_RST_SW: return "software";
+    case ESP_RST_PANIC: return "panic";
+    case ESP_RST_INT_WDT: return "int_wdt";
+    case ESP_RST_TASK_WDT: return "task_wdt";
+    case ESP_RST_WDT: return "wdt";
+    case ESP_RST_DEEPSLEEP: return "deepsleep";
+    case ESP_RST_BROWNOUT: return "brownout";
+    default: return "unknown";
+  }
+}
+
+// Clôt la fenêtre de mesure de boucle et l'ajoute à l'historique
+void diagSample() {
+  DiagSample& sample = diagHistory[diagHead];
+  sample.uptimeMs = millis() - sessionStart;
+  sample.freeHeap = ESP.getFreeHeap();
+  sample.minFreeHeap = ESP.getMinFreeHeap();
+  sample.largestBlock = ESP.getMaxAllocHeap();
+  sample.loopAvgUs = diagLoopCount > 0 ? diagLoopSum / diagLoopCount : 0;
+  sample.loopMaxUs = diagLoopMax;
+  diagHead = (diagHead + 1) % DIAG_HISTORY;
+  if (diagCount < DIAG_HISTORY) diagCount++;
+
+  diagLoopMin = UINT32_MAX;
+  diagLoopMax = 0;
+  diagLoopSum = 0;
+  diagLoopCount = 0;
+}
+
+// Appelée une fois par tour de boucle: deux lectures d'horloge, pas d'allocation
+void diagLoopTick() {
+  unsigned long now = micros();
+  uint32_t elapsed = now - diagLoopLast;
+  diagLoopLast = now;
+
+  if (elapsed < diagLoopMin) diagLoopMin = elapsed;
+  if (elapsed > diagLoopMax) diagLoopMax = elapsed;
+  if (elapsed > diagLoopMaxEver) diagLoopMaxEver = elapsed;
+  diagLoopSum += elapsed;
+  diagLoopCount++;
+
+  // Une boucle plus longue que l'intervalle de pas retarde le pas suivant
+  uint32_t budget = isRunning ? stepper.stepInterval() : 0;
+  if (budget != 0 && elapsed > budget) loopOverruns++;
+
+  if (now - diagLastSample >= DIAG_SAMPLE_US) {
+    diagLastSample = now;
+    diagSample();
+  }
+}
+
+// ===== ADMISSION DES REQUÊTES =====
+
+// Appelé par l'enveloppe de chaque route avant le handler; false si la
+// requête a été refusée (réponse 503 déjà envoyée)
+bool admitRequest(RouteStats* route) {
+  stopFastPath();
+  uint32_t cost = RequestAdmission::routeCost(route->routeClass, route->hits, route->totalUs, route->maxUs);
+  if (admission.admit(route->routeClass, cost, isRunning, micros())) return true;
+
+  unsigned long start = micros();
+  server.sendHeader("Access-Control-Allow-Origin", "*");
+  server.sendHeader("Retry-After", MOTION_RETRY_AFTER_S);
+  server.send(503, "application/json", "{\"error\":\"busy_moving\"}");
+  admission.charge(micros() - start, isRunning, micros());
+  return false;
+}
+
+void chargeRequest(uint32_t elapsedUs) {
+  admission.charge(elapsedUs, isRunning, micros());
+}
+
+void stopFastPath() {
+  admission.stopFastPath(server, stopMotor);
+}
+
+void IRAM_ATTR estopIsr() {
+  estopLatched = true;
+}
+
+// Front mémorisé par l'interruption, niveau relu à chaque tour: tant que
+// l'entrée est active, aucun mouvement ne peut reprendre
+void checkEmergencyStop() {
+#if ESTOP_PIN >= 0
+  if (!estopLatched && digitalRead(ESTOP_PIN) != LOW) return;
+  estopLatched = false;
+  if (!isRunning) return;
+  stopMotor();
+  estopCount++;
+  journalRecord(JOURNAL_STOP, 0, 0);
+  logToFile("ARRÊT D'URGENCE (entrée)");
+#endif
+}
+
+// ===== CHEMIN DE PAS =====
+
+void onStep(long position, int dir) {
+  odometer.step(dir, stepper.stepInterval());
+  if (positionEventCount > 0 && !stepper.backlashStep()) positionEventsStep(position, dir);
+  if (traceArmed) traceStart();
+  if (traceRecording) traceRecord(position, dir);
+}
+
+// ===== STATUT BINAIRE =====
+
+uint16_t statusFlags() {
+  uint16_t flags = 0;
+  if (isRunning) flags |= STATUS_FLAG_RUNNING;
+  if (movingToTarget) flags |= STATUS_FLAG_TARGET;
+  if (continuousMode) flags |= STATUS_FLAG_CONTINUOUS;
+  if (jogActive) flags |= STATUS_FLAG_JOG;
+  if (SOFT_LIMITS_ENABLED) flags |= STATUS_FLAG_LIMITS;
+  if (ENCODER_ENABLED) flags |= STATUS_FLAG_ENCODER;
+  if (following.fault) flags |= STATUS_FLAG_ENCODER_FAULT;
+  if (networkReady) flags |= STATUS_FLAG_NETWORK;
+  if (gearActive) flags |= STATUS_FLAG_GEAR;
+  return flags;
+}
+
+void fillStatusRecord(StatusRecord& rec) {
+  rec.magic = STATUS_MAGIC;
+  rec.version = STATUS_VERSION;
+  rec.size = sizeof(StatusRecord);
+  rec.seq = ++statusSeq;
+  rec.timestampMs = millis() - sessionStart;
+  rec.position = stepper.currentPosition();
+  rec.target = stepper.targetPosition();
+  rec.remaining = stepper.distanceToGo();
+  rec.speed = currentSpeed;
+  rec.stepsPerMm = STEPS_PER_MM;
+  rec.flags = statusFlags();
+  rec.overridePct = (uint16_t)lround(feedOverride);
+}
+
+// Tête CBOR: type majeur + argument sur la plus courte longueur possible
+uint8_t* cborHead(uint8_t* out, uint8_t major, uint32_t value) {
+  major <<= 5;
+  if (value < 24) {
+    *out++ = major | value;
+  } else if (value <= 0xFF) {
+    *out++ = major | 24;
+    *out++ = value;
+  } else if (value <= 0xFFFF) {
+    *out++ = major | 25;
+    *out++ = value >> 8;
+    *out++ = value;
+  } else {
+    *out++ = major | 26;
+    *out++ = value >> 24;
+    *out++ = value >> 16;
+    *out++ = value >> 8;
+    *out++ = value;
+  }
+  return out;
+}
+
+uint8_t* cborInt(uint8_t* out, int32_t value) {
+  if (value >= 0) return cborHead(out, 0, value);
+  return cborHead(out, 1, (uint32_t)(-1 - value));
+}
+
+uint8_t* cborFloat(uint8_t* out, float value) {
+  uint32_t bits;
+  memcpy(&bits, &value, sizeof(bits));
+  *out++ = 0xFA;
+  *out++ = bits >> 24;
+  *out++ = bits >> 16;
+  *out++ = bits >> 8;
+  *out++ = bits;
+  return out;
+}
+
+uint8_t* cborKey(uint8_t* out, const char* key) {
+  size_t length = strlen(key);
+  out = cborHead(out, 3, length);
+  memcpy(out, key, length);
+  return out + length;
+}
+
+// Map CBOR à clés courtes, mêmes champs que StatusRecord
+size_t encodeStatusCbor(const StatusRecord& rec, uint8_t* out) {
+  uint8_t* p = cborHead(out, 5, 10);
+  p = cborKey(p, "v");   p = cborInt(p, rec.version);
+  p = cborKey(p, "seq"); p = cborHead(p, 0, rec.seq);
+  p = cborKey(p, "t");   p = cborHead(p, 0, rec.timestampMs);
+  p = cborKey(p, "pos"); p = cborInt(p, rec.position);
+  p = cborKey(p, "tgt"); p = cborInt(p, rec.target);
+  p = cborKey(p, "rem"); p = cborInt(p, rec.remaining);
+  p = cborKey(p, "spd"); p = cborFloat(p, rec.speed);
+  p = cborKey(p, "spm"); p = cborFloat(p, rec.stepsPerMm);
+  p = cborKey(p, "flg"); p = cborHead(p, 0, rec.flags);
+  p = cborKey(p, "ovr"); p = cborHead(p, 0, rec.overridePct);
+  return p - out;
+}
+
+// ===== MODBUS TCP =====
+
+void modbusReadInputs(uint16_t* regs) {
+  long position = stepper.currentPosition();
+  long target = stepper.targetPosition();
+  long remaining = stepper.distanceToGo();
+  int32_t positionUm = lround(position * 1000.0 / STEPS_PER_MM);
+
+  regs[MB_IN_POSITION] = (uint32_t)position >> 16;
+  regs[MB_IN_POSITION + 1] = position;
+  regs[MB_IN_TARGET] = (uint32_t)target >> 16;
+  regs[MB_IN_TARGET + 1] = target;
+  regs[MB_IN_REMAINING] = (uint32_t)remaining >> 16;
+  regs[MB_IN_REMAINING + 1] = remaining;
+  regs[MB_IN_POSITION_UM] = (uint32_t)positionUm >> 16;
+  regs[MB_IN_POSITION_UM + 1] = positionUm;
+  regs[MB_IN_SPEED] = (uint16_t)lround(currentSpeed);
+  // Pas de fillStatusRecord(): une scrutation Modbus ne doit pas avancer
+  // statusSeq, numéro des enregistrements servis aux clients de statut
+  regs[MB_IN_FLAGS] = statusFlags();
+  regs[MB_IN_OVERRIDE] = (uint16_t)lround(feedOverride);
+}
+
+void modbusReadHolding(uint16_t* regs) {
+  int32_t limitMin = lround(SOFT_LIMIT_MIN * 1000.0);
+  int32_t limitMax = lround(SOFT_LIMIT_MAX * 1000.0);
+
+  regs[MB_HR_DISTANCE] = (uint32_t)modbusDistanceUm >> 16;
+  regs[MB_HR_DISTANCE + 1] = modbusDistanceUm;
+  regs[MB_HR_SPEED] = modbusSpeed;
+  regs[MB_HR_OVERRIDE] = (uint16_t)lround(feedOverride);
+  regs[MB_HR_LIMIT_MIN] = (uint32_t)limitMin >> 16;
+  regs[MB_HR_LIMIT_MIN + 1] = limitMin;
+  regs[MB_HR_LIMIT_MAX] = (uint32_t)limitMax >> 16;
+  regs[MB_HR_LIMIT_MAX + 1] = limitMax;
+  regs[MB_HR_LIMITS_ON] = SOFT_LIMITS_ENABLED ? 1 : 0;
+  regs[MB_HR_COMMAND] = modbusLastCommand;
+  regs[MB_HR_RESULT] = modbusResult;
+}
+
+int32_t modbusGet32(const uint16_t* regs, int address) {
+  return (int32_t)(((uint32_t)regs[address] << 16) | regs[address + 1]);
+}
+
+void modbusExecute(uint16_t command) {
+  float speed = modbusSpeed != 0 ? modbusSpeed : SPEED_DEFAULT;
+  float distance = modbusDistanceUm / 1000.0;
+  modbusLastCommand = command;
+  modbusResult = MB_RESULT_OK;
+
+  switch (command) {
+    case MB_CMD_MOVE:
+    case MB_CMD_GOTO:
+      if (isRunning) {
+        modbusResult = MB_RESULT_BUSY;
+        break;
+      }
+      if (command == MB_CMD_GOTO) {
+        distance -= (float)stepper.currentPosition() / STEPS_PER_MM;
+      }
+      if (!startMove(distance, speed)) modbusResult = MB_RESULT_LIMIT;
+      break;
+    case MB_CMD_STOP:
+      stopMotor();
+      journalRecord(JOURNAL_STOP, 0, 0);
+      logToFile("ARRÊT (Modbus)");
+      break;
+    case MB_CMD_HOME:
+      if (isRunning) modbusResult = MB_RESULT_BUSY;
+      else startHoming();
+      break;
+    case MB_CMD_RESET:
+      resetPosition();
+      logToFile("Position reset (Modbus)");
+      break;
+  }
+}
+
+// Écrit des registres de maintien (valeurs big-endian de la trame).
+// Tout est validé avant d'appliquer quoi que ce soit; retourne un code
+// d'exception Modbus, 0 si accepté.
+uint8_t modbusWriteHolding(uint16_t first, uint16_t count, const uint8_t* data) {
+  if (first + count > MB_HR_RESULT) return MB_EX_ILLEGAL_ADDRESS;
+
+  uint16_t current[MB_HR_COUNT];
+  uint16_t regs[MB_HR_COUNT];
+  modbusReadHolding(current);
+  memcpy(regs, current, sizeof(regs));
+  for (int i = 0; i < count; i++) {
+    regs[first + i] = (data[2 * i] << 8) | data[2 * i + 1];
+  }
+  auto touches = [first, count](int address, int size) {
+    return first < address + size && first + count > address;
+  };
+
+  int32_t limitMin = modbusGet32(regs, MB_HR_LIMIT_MIN);
+  int32_t limitMax = modbusGet32(regs, MB_HR_LIMIT_MAX);
+  if (regs[MB_HR_SPEED] != 0 && (regs[MB_HR_SPEED] < SPEED_MIN || regs[MB_HR_SPEED] > SPEED_MAX)) {
+    return MB_EX_ILLEGAL_VALUE;
+  }
+  if (regs[MB_HR_OVERRIDE] < FEED_OVERRIDE_MIN || regs[MB_HR_OVERRIDE] > FEED_OVERRIDE_MAX) {
+    return MB_EX_ILLEGAL_VALUE;
+  }
+  if (limitMin >= limitMax || regs[MB_HR_LIMITS_ON] > 1) return MB_EX_ILLEGAL_VALUE;
+  if (touches(MB_HR_COMMAND, 1) && regs[MB_HR_COMMAND] > MB_CMD_RESET) return MB_EX_ILLEGAL_VALUE;
+
+  modbusDistanceUm = modbusGet32(regs, MB_HR_DISTANCE);
+  modbusSpeed = regs[MB_HR_SPEED];
+  // Correction d'avance: écrite à haute fréquence, donc sans log
+  if (touches(MB_HR_OVERRIDE, 1)) {
+    feedOverride = regs[MB_HR_OVERRIDE];
+    journalRecord(JOURNAL_OVERRIDE, feedOverride, 0);
+  }
+  // Un maître relit puis réécrit souvent tout le bloc: ne journalise que les vrais changements
+  if (memcmp(&regs[MB_HR_LIMIT_MIN], &current[MB_HR_LIMIT_MIN], 5 * sizeof(uint16_t)) != 0) {
+    SOFT_LIMIT_MIN = limitMin / 1000.0;
+    SOFT_LIMIT_MAX = limitMax / 1000.0;
+    SOFT_LIMITS_ENABLED = regs[MB_HR_LIMITS_ON] != 0;
+    logToFile("Limites (Modbus): " + String(SOFT_LIMIT_MIN) + " à " + String(SOFT_LIMIT_MAX) +
+              (SOFT_LIMITS_ENABLED ? " ON" : " OFF"));
+  }
+  if (touches(MB_HR_COMMAND, 1)) modbusExecute(regs[MB_HR_COMMAND]);
+  return 0;
+}
+
+// Registres de l'axe pour ModbusSlave::process()
+struct ModbusAxisRegisters {
+  void readInputs(uint16_t* regs) { modbusReadInputs(regs); }
+  void readHolding(uint16_t* regs) { modbusReadHolding(regs); }
+  uint8_t writeHolding(uint16_t first, uint16_t count, const uint8_t* data) {
+    return modbusWriteHolding(first, count, data);
+  }
+};
+
+void handleModbus() {
+  if (modbusServer.hasClient()) {
+    WiFiClient incoming = modbusServer.available();
+    int slot = -1;
+    for (int i = 0; i < MODBUS_MAX_CLIENTS; i++) {
+      if (!modbusClients[i].client.connected()) {
+        slot = i;
+        break;
+      }
+    }
+    if (slot < 0) {
+      incoming.stop();
+    } else {
+      modbusClients[slot].client = incoming;
+      modbusClients[slot].client.setNoDelay(true);
+      modbusClients[slot].length = 0;
+      modbusClients[slot].lastActivity = millis();
+    }
+  }
+
+  for (int i = 0; i < MODBUS_MAX_CLIENTS; i++) {
+    ModbusClient& mb = modbusClients[i];
+    if (!mb.client.connected()) continue;
+
+    if (millis() - mb.lastActivity > MODBUS_IDLE_MS) {
+      mb.client.stop();
+      continue;
+    }
+
+    int available = mb.client.available();
+    if (available <= 0) continue;
+    size_t chunk = ModbusSlave::needed(mb.frame, mb.length);
+    if ((size_t)available < chunk) chunk = available;
+    int n = mb.client.read(mb.frame + mb.length, chunk);
+    if (n <= 0) {
+      mb.client.stop();  // Erreur de lecture: trame partielle inexploitable
+      continue;
+    }
+    mb.length += n;
+    mb.lastActivity = millis();
+
+    int frame = ModbusSlave::check(mb.frame, mb.length);
+    if (frame == MB_FRAME_INVALID) {
+      mb.client.stop();
+      continue;
+    }
+    if (frame == MB_FRAME_PARTIAL) continue;
+
+    uint8_t response[MODBUS_FRAME_MAX];
+    ModbusAxisRegisters registers;
+    size_t responseLength = modbusSlave.process(mb.frame, response, registers);
+    mb.client.write(response, responseLength);
+    mb.length = 0;
+  }
+}
+
+// ===== MQTT =====
+
+void mqttDisconnect() {
+  mqttClient.stop();
+  mqttSession = false;
+  mqttTxLength = 0;
+  mqttRxLength = 0;
+}
+
+// Réserve un paquet complet dans le tampon de sortie et écrit son en-tête
+// fixe; NULL (rien n'est réservé) s'il ne tient pas.
+uint8_t* mqttReserve(uint8_t header, size_t remaining) {
+  size_t lengthBytes = remaining < 128 ? 1 : remaining < 16384 ? 2 : 3;
+  if (mqttTxLength + 1 + lengthBytes + remaining > MQTT_TX_SIZE) return NULL;
+
+  uint8_t* p = mqttTx + mqttTxLength;
+  mqttTxLength += 1 + lengthBytes + remaining;
+  *p++ = header;
+  do {
+    uint8_t digit = remaining & 0x7F;
+    remaining >>= 7;
+    *p++ = remaining > 0 ? digit | 0x80 : digit;
+  } while (remaining > 0);
+  return p;
+}
+
+uint8_t* mqttPutString(uint8_t* p, const char* text, size_t length) {
+  *p++ = length >> 8;
+  *p++ = length;
+  memcpy(p, text, length);
+  return p + length;
+}
+
+// QoS 0; false si le tampon est plein (la publication est perdue)
+bool mqttPublish(const char* suffix, const char* payload, bool retain) {
+  char topic[64];
+  snprintf(topic, sizeof(topic), "%s/%s", MQTT_BASE.c_str(), suffix);
+  size_t topicLength = strlen(topic);
+  size_t payloadLength = strlen(payload);
+
+  uint8_t* p = mqttReserve(0x30 | (retain ? 0x01 : 0), 2 + topicLength + payloadLength);
+  if (p == NULL) {
+    mqttDropped++;
+    return false;
+  }
+  p = mqttPutString(p, topic, topicLength);
+  memcpy(p, payload, payloadLength);
+  mqttPublished++;
+  return true;
+}
+
+// Appelée à l'arrêt seulement: connect() peut bloquer jusqu'au délai
+bool mqttConnect() {
+  if (!mqttClient.connect(MQTT_HOST.c_str(), MQTT_PORT, MQTT_CONNECT_TIMEOUT_MS)) return false;
+  mqttClient.setNoDelay(true);
+  mqttTxLength = 0;
+  mqttRxLength = 0;
+  mqttSession = false;
+
+  String clientId = "stepper-" + WiFi.macAddress();
+  clientId.replace(":", "");
+  char willTopic[64];
+  snprintf(willTopic, sizeof(willTopic), "%s/online", MQTT_BASE.c_str());
+  size_t idLength = clientId.length();
+  size_t willLength = strlen(willTopic);
+
+  // Session propre, testament "0" retenu sur <base>/online
+  uint8_t* p = mqttReserve(0x10, 10 + 2 + idLength + 2 + willLength + 2 + 1);
+  p = mqttPutString(p, "MQTT", 4);
+  *p++ = 4;
+  *p++ = 0x02 | 0x04 | 0x20;
+  *p++ = MQTT_KEEPALIVE_S >> 8;
+  *p++ = MQTT_KEEPALIVE_S & 0xFF;
+  p = mqttPutString(p, clientId.c_str(), idLength);
+  p = mqttPutString(p, willTopic, willLength);
+  mqttPutString(p, "0", 1);
+
+  mqttLastReceived = millis();
+  return true;
+}
+
+void mqttSubscribe() {
+  char topic[64];
+  snprintf(topic, sizeof(topic), "%s/cmd/+", MQTT_BASE.c_str());
+  size_t topicLength = strlen(topic);
+  uint8_t* p = mqttReserve(0x82, 2 + 2 + topicLength + 1);
+  if (p == NULL) return;
+  *p++ = 0;
+  *p++ = 1;  // Identifiant de paquet
+  p = mqttPutString(p, topic, topicLength);
+  *p = 0;    // QoS 0
+}
+
+// Nombre après "key" dans un JSON, ou charge utile numérique seule
+bool mqttNumber(const char* payload, const char* key, float& value) {
+  const char* at = strstr(payload, key);
+  const char* start = at != NULL ? at + strlen(key) : payload;
+  char* end;
+  value = strtod(start, &end);
+  return end != start;
+}
+
+// <base>/cmd/move  {"distance":10,"speed":300} ou 10
+// <base>/cmd/speed {"speed":600} ou 600
+// <base>/cmd/stop, <base>/cmd/home
+// Le résultat est publié sur <base>/ack.
+void mqttHandleCommand(const char* action, const char* payload) {
+  const char* result = "ok";
+  float value;
+  mqttCommands++;
+
+  if (strcmp(action, "stop") == 0) {
+    stopMotor();
+    journalRecord(JOURNAL_STOP, 0, 0);
+    logToFile("ARRÊT (MQTT)");
+  } else if (strcmp(action, "home") == 0) {
+    if (isRunning) result = "motor_running";
+    else startHoming();
+  } else if (strcmp(action, "move") == 0) {
+    float speed = SPEED_DEFAULT;
+    if (strstr(payload, "\"speed\":") != NULL) mqttNumber(payload, "\"speed\":", speed);
+    if (!mqttNumber(payload, "\"distance\":", value)) result = "invalid_distance";
+    else if (speed < SPEED_MIN || speed > SPEED_MAX) result = "invalid_speed";
+    else if (isRunning) result = "motor_running";
+    else if (!startMove(value, speed)) result = "limit_exceeded";
+  } else if (strcmp(action, "speed") == 0) {
+    if (!mqttNumber(payload, "\"speed\":", value) || value < SPEED_MIN || value > SPEED_MAX) {
+      result = "invalid_speed";
+    } else {
+      applySpeed(value);
+    }
+  } else {
+    result = "unknown_command";
+  }
+
+  char ack[96];
+  snprintf(ack, sizeof(ack), "{\"cmd\":\"%s\",\"result\":\"%s\"}", action, result);
+  mqttPublish("ack", ack, false);
+}
+
+void mqttHandlePacket(uint8_t header, const uint8_t* body, size_t length) {
+  uint8_t type = header >> 4;
+  if (type == 2) {
+    // CONNACK
+    if (length < 2 || body[1] != 0) {
+      Serial.println("MQTT: connexion refusée (" + String(length >= 2 ? body[1] : 0) + ")");
+      mqttDisconnect();
+      return;
+    }
+    mqttSession = true;
+    mqttSubscribe();
+    mqttPublish("online", "1", true);
+    mqttPublishedFlags = 0xFFFF;  // Force une publication d'état
+    logToFile("MQTT connecté: " + MQTT_HOST);
+  } else if (type == 3) {
+    // PUBLISH: sujet <base>/cmd/<action>
+    if (length < 2) return;
+    size_t topicLength = (body[0] << 8) | body[1];
+    size_t offset = 2 + topicLength + (((header >> 1) & 0x03) != 0 ? 2 : 0);
+    size_t baseLength = MQTT_BASE.length();
+    const char* topic = (const char*)body + 2;
+    if (offset > length || topicLength <= baseLength + 5) return;
+    if (memcmp(topic, MQTT_BASE.c_str(), baseLength) != 0 || memcmp(topic + baseLength, "/cmd/", 5) != 0) return;
+
+    char action[16];
+    char payload[96];
+    size_t actionLength = min(topicLength - baseLength - 5, sizeof(action) - 1);
+    size_t payloadLength = min(length - offset, sizeof(payload) - 1);
+    memcpy(action, topic + baseLength + 5, actionLength);
+    action[actionLength] = '\0';
+    memcpy(payload, body + offset, payloadLength);
+    payload[payloadLength] = '\0';
+    mqttHandleCommand(action, payload);
+  }
+}
+
+void mqttReceive() {
+  int available = mqttClient.available();
+  if (available <= 0) return;
+  size_t chunk = min((size_t)available, (size_t)(MQTT_RX_SIZE - mqttRxLength));
+  int n = mqttClient.read(mqttRx + mqttRxLength, chunk);
+  if (n <= 0) {
+    mqttDisconnect();  // Erreur de lecture: paquet partiel inexploitable
+    return;
+  }
+  mqttRxLength += n;
+  mqttLastReceived = millis();
+
+  while (mqttRxLength >= 2) {
+    size_t remaining = 0;
+    size_t index = 1;
+    int shift = 0;
+    bool complete = false;
+    while (index < mqttRxLength && index <= 4) {
+      uint8_t digit = mqttRx[index++];
+      remaining |= (size_t)(digit & 0x7F) << shift;
+      shift += 7;
+      if ((digit & 0x80) == 0) {
+        complete = true;
+        break;
+      }
+    }
+    if (!complete) {
+      if (index > 4) mqttDisconnect();  // Longueur invalide
+      return;
+    }
+    size_t total = index + remaining;
+    if (total > MQTT_RX_SIZE) {
+      mqttDisconnect();  // Commande trop longue pour le tampon
+      return;
+    }
+    if (mqttRxLength < total) return;
+
+    mqttHandlePacket(mqttRx[0], mqttRx + index, remaining);
+    if (!mqttClient.connected()) return;
+    memmove(mqttRx, mqttRx + total, mqttRxLength - total);
+    mqttRxLength -= total;
+  }
+}
+
+// Vide le tampon de sortie sans jamais attendre le broker
+void mqttFlush() {
+  if (mqttTxLength == 0) return;
+  int sent = send(mqttClient.fd(), mqttTx, mqttTxLength, MSG_DONTWAIT);
+  if (sent > 0) {
+    memmove(mqttTx, mqttTx + sent, mqttTxLength - sent);
+    mqttTxLength -= sent;
+    mqttLastSent = millis();
+  } else if (sent < 0 && errno != EAGAIN && errno != EWOULDBLOCK) {
+    mqttDisconnect();
+  }
+}
+
+// Au plus un message d'état par fenêtre, et seulement si quelque chose a
+// changé (ou pour le battement de cœur). Une publication perdue faute de
+// place n'est pas retentée: la fenêtre suivante publie l'état à jour.
+void mqttTelemetry() {
+  unsigned long now = millis();
+  if (now - mqttLastTelemetry < MQTT_TELEMETRY_MS) return;
+  mqttLastTelemetry = now;
+
+  long steps = stepper.currentPosition();
+  uint16_t flags = statusFlags();
+  uint16_t overridePct = (uint16_t)lround(feedOverride);
+  bool changed = steps != mqttPublishedSteps || flags != mqttPublishedFlags ||
+                 currentSpeed != mqttPublishedSpeed || overridePct != mqttPublishedOverride;
+  if (!changed && now - mqttLastPublish < MQTT_HEARTBEAT_MS) return;
+
+  StatusRecord rec;
+  fillStatusRecord(rec);
+  char payload[224];
+  snprintf(payload, sizeof(payload),
+           "{\"seq\":%u,\"t\":%u,\"position\":%.3f,\"steps\":%ld,\"target\":%ld,\"remaining\":%ld,"
+           "\"speed\":%.1f,\"override\":%u,\"running\":%s,\"flags\":%u}",
+           (unsigned)rec.seq, (unsigned)rec.timestampMs, rec.position / STEPS_PER_MM, (long)rec.position,
+           (long)rec.target, (long)rec.remaining, rec.speed, rec.overridePct, isRunning ? "true" : "false",
+           rec.flags);
+  if (!mqttPublish("status", payload, true)) return;
+
+  mqttPublishedSteps = steps;
+  mqttPublishedFlags = flags;
+  mqttPublishedSpeed = currentSpeed;
+  mqttPublishedOverride = overridePct;
+  mqttLastPublish = now;
+}
+
+void handleMqtt() {
+  if (MQTT_HOST.length() == 0 || WiFi.status() != WL_CONNECTED) {
+    if (mqttClient.connected()) mqttDisconnect();
+    return;
+  }
+  if (!mqttClient.connected()) {
+    mqttSession = false;
+    // connect() bloque jusqu'à MQTT_CONNECT_TIMEOUT_MS: pas pendant qu'un
+    // départ programmé attend son échéance
+    if (isRunning || pendingStart != START_NONE) return;
+    if (mqttLastAttempt != 0 && millis() - mqttLastAttempt < MQTT_RETRY_MS) return;
+    mqttLastAttempt = millis();
+    if (!mqttConnect()) return;
+  }
+
+  mqttReceive();
+  if (!mqttClient.connected()) return;
+
+  unsigned long now = millis();
+  if (now - mqttLastReceived > MQTT_KEEPALIVE_S * 1500UL) {
+    mqttDisconnect();  // Broker muet: ni réponse ni PINGRESP
+    return;
+  }
+  if (mqttSession) {
+    mqttTelemetry();
+    if (mqttTxLength == 0 && now - mqttLastSent > MQTT_KEEPALIVE_S * 500UL) {
+      mqttReserve(0xC0, 0);  // PINGREQ
+    }
+  }
+  mqttFlush();
+}
+
+// ===== JOG UDP =====
+
+void startJog(float speed) {
+  // speed en mm/min, signe = direction
+  if (axisOwner() != NULL) return;
+  int direction = speed >= 0 ? 1 : -1;
+  float speedStepsPerSec = (abs(speed) * STEPS_PER_MM) / 60.0;
+  currentSpeed = abs(speed);
+
+  // En cours de jog dans le même sens: la rampe de correction d'avance
+  // absorbe le changement de vitesse
+  if (jogActive && moveDirection == direction) {
+    feedRamp.baseSpeed = speedStepsPerSec;
+    return;
+  }
+
+  // Sinon (départ, inversion, reprise d'un déplacement): nouvelle cible,
+  // la rampe raccorde la vitesse courante
+  if (!startContinuous(direction, speedStepsPerSec)) {
+    stopContinuous();
+    return;
+  }
+  jogCmdMicros = micros();
+  jogActive = true;
+}
+
+void handleJogUdp() {
+  int size = jogUdp.parsePacket();
+  while (size > 0) {
+    JogPacket pkt;
+    int length = size == sizeof(pkt) ? jogUdp.read((uint8_t*)&pkt, sizeof(pkt)) : size;
+    if (jog.accept(pkt, length, (uint32_t)jogUdp.remoteIP(), jogUdp.remotePort(), millis())) {
+      if (pkt.type == JOG_CMD_JOG) {
+        float speed = JogSession::speed(pkt);
+        if (speed == 0) {
+          if (jogActive) stopContinuous();
+        } else {
+          startJog(speed);
+        }
+      } else if (pkt.type == JOG_CMD_STOP) {
+        stopMotor();
+      }
+
+      JogPacket ack;
+      ack.magic = JOG_MAGIC;
+      ack.version = JOG_VERSION;
+      ack.type = pkt.type | JOG_ACK;
+      ack.flags = (isRunning ? 0x01 : 0) | (jogActive ? 0x02 : 0);
+      ack.seq = pkt.seq;
+      ack.latencyUs = (uint16_t)min(jogLatencyLast, 65535UL);
+      ack.value = stepper.currentPosition();
+      jogUdp.beginPacket(jogUdp.remoteIP(), jogUdp.remotePort());
+      jogUdp.write((const uint8_t*)&ack, sizeof(ack));
+      jogUdp.endPacket();
+    }
+
+    size = jogUdp.parsePacket();
+  }
+
+  // Homme-mort: le jog ne continue que tant que les paquets arrivent
+  if (jog.expired(jogActive, millis())) {
+    Serial.println("JOG: HEARTBEAT PERDU");
+    stopContinuous();
+    logToFile("Jog arrêté: heartbeat perdu");
+  }
+}
+
+// ===== PORTAIL CAPTIF =====
+
+// Socket UDP non bloquant: ni tampon alloué par paquet, ni attente
+void captiveDnsBegin() {
+  captiveDnsSocket = socket(AF_INET, SOCK_DGRAM, 0);
+  if (captiveDnsSocket < 0) return;
+  sockaddr_in addr;
+  memset(&addr, 0, sizeof(addr));
+  addr.sin_family = AF_INET;
+  addr.sin_port = htons(DNS_PORT);
+  addr.sin_addr.s_addr = htonl(INADDR_ANY);
+  if (bind(captiveDnsSocket, (sockaddr*)&addr, sizeof(addr)) < 0) {
+    close(captiveDnsSocket);
+    captiveDnsSocket = -1;
+    Serial.println("❌ DNS: port 53 indisponible");
+    return;
+  }
+  fcntl(captiveDnsSocket, F_SETFL, O_NONBLOCK);
+  IPAddress ip = WiFi.softAPIP();
+  const uint8_t bytes[4] = { ip[0], ip[1], ip[2], ip[3] };
+  captiveDns.begin(bytes);
+}
+
+// Relève espacée et bornée: une rafale de requêtes à l'association d'un
+// téléphone attend dans le tampon du socket au lieu de prendre la boucle
+void captiveDnsPoll() {
+  if (captiveDnsSocket < 0) return;
+  if (millis() - captiveDnsLastPoll < (isRunning ? DNS_POLL_MOVING_MS : DNS_POLL_IDLE_MS)) return;
+  captiveDnsLastPoll = millis();
+
+  static uint8_t query[DNS_PACKET_MAX];
+  static uint8_t reply[DNS_PACKET_MAX + DNS_ANSWER_SIZE];
+  int batch = isRunning ? DNS_BATCH_MOVING : DNS_BATCH_IDLE;
+  uint32_t handled = 0;
+  while (handled < (uint32_t)batch) {
+    sockaddr_in from;
+    socklen_t fromLength = sizeof(from);
+    int n = recvfrom(captiveDnsSocket, query, sizeof(query), MSG_DONTWAIT, (sockaddr*)&from, &fromLength);
+    if (n <= 0) break;
+    handled++;
+    size_t length = captiveDns.respond(query, n, reply);
+    if (length > 0 && sendto(captiveDnsSocket, reply, length, 0, (sockaddr*)&from, fromLength) < 0) {
+      captiveDnsSendErrors++;
+    }
+  }
+  captiveDnsMaxBatch = max(captiveDnsMaxBatch, handled);
+}
+
+// ===== SYNCHRONISATION =====
+
+bool syncIsReference() {
+  return SYNC_MASTER.length() == 0;
+}
+
+// Horloge de référence (µs): locale sur la référence, estimée ailleurs
+int64_t syncNowUs() {
+  int64_t local = esp_timer_get_time();
+  return syncIsReference() ? local : clockSync.now(local);
+}
+
+bool syncReady() {
+  if (syncIsReference()) return true;
+  return clockSync.valid && esp_timer_get_time() - clockSync.lastLocalUs < SYNC_VALID_MS * 1000LL;
+}
+
+void handleSyncUdp() {
+  int size = syncUdp.parsePacket();
+  while (size > 0) {
+    int64_t received = esp_timer_get_time();
+    SyncPacket pkt;
+    bool valid = size == sizeof(SyncPacket) &&
+                 syncUdp.read((uint8_t*)&pkt, sizeof(pkt)) == sizeof(pkt) &&
+                 pkt.magic == SYNC_MAGIC && pkt.version == SYNC_VERSION;
+
+    if (valid && pkt.type == SYNC_REQUEST) {
+      // Sans horloge utilisable, pas de réponse: le demandeur garde la sienne
+      if (syncReady()) {
+        pkt.type = SYNC_REPLY;
+        pkt.t2 = syncIsReference() ? received : clockSync.now(received);
+        pkt.t3 = syncNowUs();
+        syncUdp.beginPacket(syncUdp.remoteIP(), syncUdp.remotePort());
+        syncUdp.write((const uint8_t*)&pkt, sizeof(pkt));
+        syncUdp.endPacket();
+        syncServed++;
+      }
+    } else if (valid && pkt.type == SYNC_REPLY && syncPending && pkt.seq == syncSeq) {
+      syncPending = false;
+      clockSync.sample(pkt.t1, pkt.t2, pkt.t3, received);
+    } else {
+      syncRejected++;
+    }
+
+    size = syncUdp.parsePacket();
+  }
+
+  if (syncIsReference() || millis() - syncLastRequest < SYNC_INTERVAL_MS) return;
+  syncLastRequest = millis();
+  SyncPacket req;
+  memset(&req, 0, sizeof(req));
+  req.magic = SYNC_MAGIC;
+  req.version = SYNC_VERSION;
+  req.type = SYNC_REQUEST;
+  req.seq = ++syncSeq;
+  syncPending = true;
+  syncUdp.beginPacket(SYNC_MASTER.c_str(), SYNC_UDP_PORT);
+  req.t1 = esp_timer_get_time();
+  syncUdp.write((const uint8_t*)&req, sizeof(req));
+  syncUdp.endPacket();
+}
+
+// "startAt" du corps de requête (µs, horloge de référence); 0 si absent
+int64_t parseStartAt(const String& body) {
+  int start = body.indexOf("\"startAt\":");
+  if (start < 0) return 0;
+  start += 10;
+  int end = body.indexOf(",", start);
+  if (end == -1) end = body.indexOf("}", start);
+  return (int64_t)body.substring(start, end).toDouble();
+}
+
+// Programme un départ; retourne le code d'erreur, vide si accepté
+String scheduleStart(int64_t at, uint8_t kind, float distance, float speed, int direction) {
+  if (!syncReady()) return "not_synced";
+  int64_t ahead = at - syncNowUs();
+  if (ahead <= 0) return "start_in_past";
+  if (ahead > START_AHEAD_MAX_US) return "start_too_far";
+  pendingStart = kind;
+  pendingStartAt = at;
+  pendingDistance = distance;
+  pendingSpeed = speed;
+  pendingDirection = direction;
+  logToFile("Départ programmé dans " + String((double)ahead / 1000.0, 1) + "ms");
+  return "";
+}
+
+bool startImminent() {
+  return pendingStart != START_NONE && pendingStartAt - syncNowUs() < START_GUARD_US;
+}
+
+void runPendingStart() {
+  if (pendingStart == START_NONE) return;
+  int64_t late = syncNowUs() - pendingStartAt;
+  if (late < 0) return;
+
+  uint8_t kind = pendingStart;
+  pendingStart = START_NONE;
+  startLateLastUs = (int32_t)min(late, (int64_t)INT32_MAX);
+  startLateMaxUs = max(startLateMaxUs, startLateLastUs);
+
+  bool started = false;
+  if (isRunning) {
+    started = false;
+  } else if (kind == START_MOVE) {
+    started = startMove(pendingDistance, pendingSpeed);
+  } else if (kind == START_CONTINUOUS) {
+    jogActive = false;
+    currentSpeed = pendingSpeed;
+    started = startContinuous(pendingDirection, (pendingSpeed * STEPS_PER_MM) / 60.0);
+    if (started) journalRecord(JOURNAL_CONTINUOUS, pendingDirection, pendingSpeed);
+  } else if (kind == START_PVT) {
+    started = pvtStart();
+  }
+
+  if (started) {
+    scheduledStarts++;
+  } else {
+    scheduledMissed++;
+    logToFile("Départ programmé annulé (axe occupé ou limite)");
+  }
+}
+
+// ===== DÉMARRAGE =====
+
+void bootPhaseBegin(BootPhaseId phase) {
+  bootProfile.begin(phase, micros());
+}
+
+void bootPhaseEnd(BootPhaseId phase) {
+  bootProfile.end(phase, micros());
+}
+
+// Montage SPIFFS (peut formater) et AP WiFi hors de la tâche de boucle:
+// l'axe et les commandes série sont disponibles pendant ce temps.
+void networkBootTask(void* arg) {
+  bootPhaseBegin(BOOT_STORAGE);
+  if (SPIFFS.begin(true)) {
+    storageReady = true;
+  } else {
+    Serial.println("❌ Erreur SPIFFS");
+  }
+  bootPhaseEnd(BOOT_STORAGE);
+
+  // Le point d'accès reste actif en mode station: l'accès local est conservé
+  bootPhaseBegin(BOOT_WIFI);
+  WiFi.mode(STA_SSID.length() > 0 ? WIFI_AP_STA : WIFI_AP);
+  WiFi.softAP(ap_ssid, ap_password);
+
+  IPAddress local_IP(192, 168, 4, 1);
+  IPAddress gateway(192, 168, 4, 1);
+  IPAddress subnet(255, 255, 255, 0);
+  WiFi.softAPConfig(local_IP, gateway, subnet);
+  if (STA_SSID.length() > 0) {
+    WiFi.setAutoReconnect(true);
+    WiFi.begin(STA_SSID.c_str(), STA_PASSWORD.c_str());
+  }
+  bootPhaseEnd(BOOT_WIFI);
+
+  wifiReady = true;
+  vTaskDelete(NULL);
+}
+
+// Démarre les serveurs depuis loop() une fois l'AP prêt: ils sont ensuite
+// servis par la même tâche que les handlers.
+void startNetworkServices() {
+  bootPhaseBegin(BOOT_SERVICES);
+  Serial.println("WiFi AP: " + String(ap_ssid));
+  Serial.println("IP: " + WiFi.softAPIP().toString());
+
+  captiveDnsBegin();
+  jogUdp.begin(JOG_UDP_PORT);
+  Serial.println("Jog UDP: port " + String(JOG_UDP_PORT));
+  syncUdp.begin(SYNC_UDP_PORT);
+  modbusServer.begin();
+  modbusServer.setNoDelay(true);
+  Serial.println("Modbus TCP: port " + String(MODBUS_PORT));
+
+  setupWebServer();
+  server.begin();
+  networkReady = true;
+  bootPhaseEnd(BOOT_SERVICES);
+  Serial.println("Interface: http://192.168.4.1");
+
+  logToFile("=== DÉMARRAGE ESP32 ===");
+  logToFile("Cause du redémarrage: " + String(resetReasonName()));
+  logToFile("Boot: moteur prêt " + String(bootProfile.endUs[BOOT_MOTION] / 1000) + "ms, réseau prêt " +
+            String(bootProfile.endUs[BOOT_SERVICES] / 1000) + "ms");
+}
+
+void printBootProfile() {
+  Serial.println("setup: " + String(bootSetupUs) + "µs");
+  char line[64];
+  for (int i = 0; i < BOOT_PHASES; i++) {
+    bootProfile.line((BootPhaseId)i, line, sizeof(line));
+    Serial.println(line);
+  }
+}
+
+// ===== COMMANDES SÉRIE =====
+// Contrôle local disponible dès que l'axe est prêt, avant le WiFi.
+// Une commande par ligne: status, move <mm> [mm/min], home, stop, reset, boot.
+
+void handleSerialCommand(char* line) {
+  char* command = strtok(line, " \t");
+  if (command == NULL) return;
+  char* arg1 = strtok(NULL, " \t");
+  char* arg2 = strtok(NULL, " \t");
+
+  if (strcmp(command, "status") == 0) {
+    currentPosition = (float)stepper.currentPosition() / STEPS_PER_MM;
+    Serial.println("OK pos=" + String(currentPosition, 3) + " target=" + String(targetPosition, 3) +
+                   " running=" + String(isRunning ? 1 : 0) + " wifi=" + String(networkReady ? 1 : 0));
+  } else if (strcmp(command, "move") == 0) {
+    if (arg1 == NULL) {
+      Serial.println("ERR usage: move <mm> [mm/min]");
+    } else if (isRunning) {
+      Serial.println("ERR motor_running");
+    } else {
+      float speed = arg2 != NULL ? atof(arg2) : SPEED_DEFAULT;
+      if (speed < SPEED_MIN || speed > SPEED_MAX) {
+        Serial.println("ERR invalid_speed");
+      } else if (!startMove(atof(arg1), speed)) {
+        Serial.println("ERR limit_exceeded");
+      } else {
+        Serial.println("OK moving");
+      }
+    }
+  } else if (strcmp(command, "home") == 0) {
+    if (isRunning) {
+      Serial.println("ERR motor_running");
+    } else {
+      startHoming();
+      Serial.println("OK homing");
+    }
+  } else if (strcmp(command, "stop") == 0) {
+    stopMotor();
+    journalRecord(JOURNAL_STOP, 0, 0);
+    logToFile("ARRÊT (série)");
+    Serial.println("OK stopped");
+  } else if (strcmp(command, "reset") == 0) {
+    resetPosition();
+    Serial.println("OK reset");
+  } else if (strcmp(command, "boot") == 0) {
+    printBootProfile();
+  } else {
+    Serial.println("ERR commandes: status, move <mm> [mm/min], home, stop, reset, boot");
+  }
+}
+
+// Lecture non bloquante, caractère par caractère, sans String
+void handleSerial() {
+  while (Serial.available() > 0) {
+    char c = Serial.read();
+    if (c == '\n' || c == '\r') {
+      if (serialLineLength == 0) continue;
+      serialLine[serialLineLength] = '\0';
+      serialLineLength = 0;
+      handleSerialCommand(serialLine);
+    } else if (serialLineLength < SERIAL_LINE_MAX - 1) {
+      serialLine[serialLineLength++] = c;
+    }
+  }
+}
+
+// ===== SETUP =====
+
+void setup() {
+  bootSetupUs = micros();
+  Serial.begin(115200);
+  sessionStart = millis();
+
+  bootPhaseBegin(BOOT_CONFIG);
+  loadConfig();
+  profilesLoad();
+  odometerLoad();
+  bootPhaseEnd(BOOT_CONFIG);
+
+  bootPhaseBegin(BOOT_MOTION);
+  stepper.begin();
+  stepper.setMaxSpeed(10000);
+  stepper.setCurrentPosition(0);
+  if (!configureShaper()) {
+    SHAPER_TYPE = SHAPER_NONE;
+    configureShaper();
+  }
+  currentPosition = 0.0;
+  targetPosition = 0.0;
+
+  if (ENCODER_ENABLED) {
+    encoderBegin();
+    encoderSync();
+  }
+#if ESTOP_PIN >= 0
+  pinMode(ESTOP_PIN, INPUT_PULLUP);
+  attachInterrupt(digitalPinToInterrupt(ESTOP_PIN), estopIsr, FALLING);
+#endif
+  positionEventsBegin();
+  bootPhaseEnd(BOOT_MOTION);
+
+  Serial.println("=== STEPPER ESP32 DÉMARRÉ ===");
+  Serial.println("Steps/mm: " + String(STEPS_PER_MM));
+  Serial.println("Moteur prêt en " + String(bootProfile.endUs[BOOT_MOTION] / 1000) + "ms - commandes série actives");
+
+  // Cœur 0, celui de la pile WiFi; loop() tourne sur le cœur 1
+  xTaskCreatePinnedToCore(networkBootTask, "netBoot", 4096, NULL, 1, NULL, 0);
+
+  diagLoopLast = micros();
+  diagLastSample = diagLoopLast;
+}
+
+// ===== WEB SERVER =====
+
+void setupWebServer() {
+  
+  // Sonde dont la ligne de requête n'était pas complète au coup d'œil, ou
+  // adresse inconnue: même redirection préformatée
+  server.onNotFound([]() {
+    if (CaptiveProbe::match(("GET " + server.uri() + " ").c_str(), server.uri().length() + 5) >= 0) {
+      captiveProbesSlow++;
+    } else {
+      captiveRedirects++;
+    }
+    server.sendContent(CAPTIVE_REDIRECT, sizeof(CAPTIVE_REDIRECT) - 1);
+  });
+
+  server.on("/", []() {
+    String html = R"rawliteral(
+<!DOCTYPE html>
+<html>
+<head>
+    <meta charset="UTF-8">
+    <meta name="viewport" content="width=device-width, initial-scale=1.0">
+    <title>Stepper Controller</title>
+    <style>
+        * { box-sizing: border-box; }
+        body { 
+            font-family: Arial, sans-serif; 
+            margin: 0; 
+            padding: 20px; 
+            background: #f0f0f0; 
+        }
+        .container { 
+            max-width: 900px; 
+            margin: 0 auto; 
+            background: white; 
+            padding: 20px; 
+            border-radius: 10px; 
+            box-shadow: 0 2px 10px rgba(0,0,0,0.1);
+        }
+        h1 { 
+            color: #333; 
+            margin-top: 0; 
+        }
+        .tabs { 
+            display: flex; 
+            border-bottom: 2px solid #dee2e6; 
+            margin-bottom: 20px; 
+        }
+        .tab { 
+            padding: 12px 24px; 
+            cursor: pointer; 
+            background: #f8f9fa; 
+            border: none; 
+            border-bottom: 3px solid transparent; 
+            font-weight: bold; 
+            font-size: 15px;
+        }
+        .tab.active { 
+            border-bottom-color: #007bff; 
+            color: #007bff; 
+            background: white; 
+        }
+        .tab-content { 
+            display: none; 
+        }
+        .tab-content.active { 
+            display: block; 
+        }
+        .panel { 
+            background: #f8f9fa; 
+            padding: 20px; 
+            border-radius: 8px; 
+            margin-bottom: 20px; 
+        }
+        .panel h3 { 
+            margin-top: 0; 
+            color: #495057;
+        }
+        .status-panel { 
+            background: #e8f4fd; 
+        }
+        .admin-panel { 
+            background: #fff3cd; 
+            border: 2px solid #ffc107; 
+        }
+        .admin-locked { 
+            background: #f8d7da; 
+            padding: 30px; 
+            text-align: center; 
+            border: 2px solid #dc3545; 
+        }
+        input[type="number"], input[type="password"] { 
+            padding: 10px; 
+            margin: 5px; 
+            border: 1px solid #ccc; 
+            border-radius: 5px; 
+            font-size: 14px;
+        }
+        input[type="number"] { 
+            width: 120px; 
+        }
+        input[type="password"] { 
+            width: 200px; 
+            font-size: 16px;
+        }
+        button { 
+            padding: 10px 20px; 
+            margin: 5px; 
+            border: none; 
+            border-radius: 5px; 
+            cursor: pointer; 
+            font-weight: bold; 
+            font-size: 14px;
+        }
+        .btn-primary { background: #007bff; color: white; }
+        .btn-success { background: #28a745; color: white; }
+        .btn-danger { background: #dc3545; color: white; }
+        .btn-warning { background: #ffc107; color: black; }
+        .btn-primary:hover { background: #0056b3; }
+        .btn-success:hover { background: #1e7e34; }
+        .btn-danger:hover { background: #bd2130; }
+        .btn-warning:hover { background: #e0a800; }
+        .status-value { 
+            font-weight: bold; 
+            font-size: 18px;
+        }
+        .running { color: #28a745; }
+        .stopped { color: #dc3545; }
+        .info-box { 
+            background: #d1ecf1; 
+            border: 1px solid #bee5eb; 
+            padding: 15px; 
+            border-radius: 5px; 
+            margin: 15px 0; 
+        }
+        .formula { 
+            font-family: monospace; 
+            background: #f8f9fa; 
+            padding: 5px 10px; 
+            border-radius: 3px; 
+            display: inline-block; 
+        }
+        .log { 
+            background: #2d3748; 
+            color: #e2e8f0; 
+            padding: 15px; 
+            border-radius: 5px; 
+            font-family: monospace; 
+            font-size: 12px; 
+            max-height: 300px; 
+            overflow-y: auto; 
+        }
+        .grid { 
+            display: grid; 
+            grid-template-columns: 1fr 1fr; 
+            gap: 15px; 
+        }
+        @media (max-width: 768px) {
+            .grid { 
+                grid-template-columns: 1fr; 
+            }
+        }
+        label { 
+            display: block; 
+            margin-bottom: 5px; 
+            font-weight: 600; 
+            color: #495057;
+        }
+        small { 
+            color: #6c757d; 
+            font-size: 12px;
+        }
+    </style>
+</head>
+<body>
+    <div class="container">
+        <h1>🔧 Stepper ESP32 Controller</h1>
+        
+        <div class="tabs">
+            <button class="tab active" onclick="switchTab('control')">🎮 Contrôle</button>
+            <button class="tab" onclick="switchTab('admin')">⚙️ Admin</button>
+            <button class="tab" onclick="switchTab('logs')">📄 Logs</button>
+        </div>
+
+        <!-- ONGLET CONTROLE -->
+        <div id="tab-control" class="tab-content active">
+            <div class="panel status-panel">
+                <h3>📊 État du moteur</h3>
+                <div class="grid">
+                    <div>
+                        <strong>État:</strong> <span id="status" class="status-value stopped">Arrêté</span><br>
+                        <strong>Position:</strong> <span id="position" class="status-value">0.000</span> mm<br>
+                        <strong>Cible:</strong> <span id="target" class="status-value">0.000</span> mm
+                    </div>
+                    <div>
+                        <strong>Vitesse:</strong> <span id="speed" class="status-value">0</span> mm/min<br>
+                        <strong>Steps/mm:</strong> <span id="stepsPerMm" class="status-value">100.00</span><br>
+                        <strong>Limites:</strong> <span id="limitsStatus">Activées</span>
+                    </div>
+                </div>
+            </div>
+
+            <div class="panel">
+                <h3>🎮 Contrôles</h3>
+                <div>
+                    <label>Vitesse (mm/min):</label>
+                    <input type="number" id="speedInput" value="300" step="50">
+                    <button class="btn-primary" onclick="updateSpeedNow()">⚡ Appliquer</button>
+                </div>
+                <div style="margin-top: 15px;">
+                    <label>Correction d'avance: <span id="overrideValue">100</span>%</label>
+                    <input type="range" id="overrideInput" min="10" max="200" value="100" step="5" style="width: 300px;" oninput="setOverride(this.value)">
+                    <button class="btn-warning" onclick="setOverride(100)">100%</button>
+                </div>
+                <div style="margin-top: 15px;">
+                    <label>Distance (mm):</label>
+                    <input type="number" id="distanceInput" value="10" step="0.1">
+                    <button class="btn-primary" onclick="moveDistance()">📏 Déplacer</button>
+                </div>
+                <div style="margin-top: 15px;">
+                    <button class="btn-success" onclick="moveForward()">➡️ Avant Continu</button>
+                    <button class="btn-success" onclick="moveBackward()">⬅️ Arrière Continu</button>
+                </div>
+                <div style="margin-top: 15px;">
+                    <button class="btn-danger" onclick="stopMotor()">⏹️ ARRÊT</button>
+                    <button class="btn-warning" onclick="homeMotor()">🏠 Origine</button>
+                    <button class="btn-warning" onclick="resetPosition()">🔄 Reset</button>
+                </div>
+            </div>
+
+            <div class="panel">
+                <h3>📏 Limites de sécurité</h3>
+                <div>
+                    <label>Min (mm):</label>
+                    <input type="number" id="limitMin" value="-100" step="1">
+                    <label>Max (mm):</label>
+                    <input type="number" id="limitMax" value="100" step="1">
+                </div>
+                <div style="margin-top: 10px;">
                     <button class="btn-primary" onclick="setLimits()">✅ Appliquer Limites</button>
                     <button class="btn-warning" onclick="toggleLimits()">🔄 ON/OFF</button>
                 </div>
             </div>
         </div>
 
-        <!-- ONGLET ADMIN -->
-        <div id="tab-admin" class="tab-content">
-            <!-- Écran de verrouillage -->
-            <div id="admin-lock" class="panel admin-locked">
-                <h3>🔒 Accès Administrateur</h3>
-                <p>Entrez le mot de passe pour accéder aux réglages avancés</p>
-                <input type="password" id="adminPassword" placeholder="Mot de passe">
-                <br>
-                <button class="btn-primary" onclick="unlockAdmin()">🔓 Déverrouiller</button>
-                <p style="margin-top: 20px; color: #6c757d;">
-                    <small>Par défaut: admin123</small>
-                </p>
-            </div>
+        <!-- ONGLET ADMIN -->
+        <div id="tab-admin" class="tab-content">
+            <!-- Écran de verrouillage -->
+            <div id="admin-lock" class="panel admin-locked">
+                <h3>🔒 Accès Administrateur</h3>
+                <p>Entrez le mot de passe pour accéder aux réglages avancés</p>
+                <input type="password" id="adminPassword" placeholder="Mot de passe">
+                <br>
+                <button class="btn-primary" onclick="unlockAdmin()">🔓 Déverrouiller</button>
+                <p style="margin-top: 20px; color: #6c757d;">
+                    <small>Par défaut: admin123</small>
+                </p>
+            </div>
+
+            <!-- Contenu admin -->
+            <div id="admin-content" style="display: none;">
+                
+                <!-- CALIBRATION MOTEUR -->
+                <div class="panel admin-panel">
+                    <h3>🔧 Calibration Moteur</h3>
+                    <div>
+                        <label>Steps par révolution moteur:</label>
+                        <input type="number" id="stepsPerRev" value="200" min="1" step="1">
+                        <small>(200 = 1.8°, 400 = 0.9°)</small>
+                    </div>
+                    <div style="margin-top: 10px;">
+                        <label>Microstepping du driver:</label>
+                        <input type="number" id="microsteps" value="1" min="1" step="1">
+                        <small>(1, 2, 4, 8, 16, 32...)</small>
+                    </div>
+                    <div style="margin-top: 10px;">
+                        <label>Pas de vis (mm/tour):</label>
+                        <input type="number" id="leadScrewPitch" value="2" min="0.1" step="0.1">
+                        <small>(Distance en 1 tour)</small>
+                    </div>
+                    <div style="margin-top: 10px;">
+                        <label>Jeu de la vis (mm):</label>
+                        <input type="number" id="backlash" value="0" min="0" max="5" step="0.01">
+                        <small>(Rattrapé à chaque inversion)</small>
+                    </div>
+                    <div class="info-box">
+                        <strong>Calcul:</strong> 
+                        <span class="formula">Steps/mm = (Steps/rev × Microsteps) ÷ Pas de vis</span>
+                        <br><br>
+                        <strong>Résultat:</strong> 
+                        <span id="calculatedSteps" style="font-size: 20px; color: #007bff;">100.00</span> steps/mm
+                    </div>
+                </div>
+
+                <!-- CONFIGURATION VITESSES -->
+                <div class="panel admin-panel">
+                    <h3>⚡ Configuration des Vitesses</h3>
+                    <div class="grid">
+                        <div>
+                            <label>Vitesse MINIMALE:</label>
+                            <input type="number" id="speedMin" value="50" min="1" step="10">
+                            <small>mm/min - Limite basse</small>
+                        </div>
+                        <div>
+                            <label>Vitesse MAXIMALE:</label>
+                            <input type="number" id="speedMax" value="2000" min="100" step="100">
+                            <small>mm/min - Limite haute</small>
+                        </div>
+                        <div>
+                            <label>Vitesse PAR DÉFAUT:</label>
+                            <input type="number" id="speedDefault" value="300" min="1" step="50">
+                            <small>mm/min - Au démarrage</small>
+                        </div>
+                        <div>
+                            <label>Vitesse RETOUR ORIGINE:</label>
+                            <input type="number" id="speedHome" value="600" min="1" step="50">
+                            <small>mm/min - Bouton 🏠</small>
+                        </div>
+                    </div>
+                    <div class="info-box" style="background: #fff3cd; border-color: #ffc107;">
+                        <strong>💡 Vitesses typiques:</strong><br>
+                        • <strong>Précision:</strong> 50-200 mm/min<br>
+                        • <strong>Normal:</strong> 300-600 mm/min<br>
+                        • <strong>Rapide:</strong> 800-1500 mm/min<br>
+                        • <strong>Maximum:</strong> 2000-5000 mm/min
+                    </div>
+                </div>
+
+                <!-- BOUTONS ADMIN -->
+                <div style="text-align: center; margin-top: 20px;">
+                    <button class="btn-success" style="font-size: 16px; padding: 15px 30px;" onclick="applyCalibration()">
+                        ✅ APPLIQUER ET SAUVEGARDER
+                    </button>
+                    <button class="btn-warning" onclick="loadCalibration()">🔄 Recharger</button>
+                    <button class="btn-danger" onclick="lockAdmin()">🔒 Verrouiller</button>
+                </div>
+
+                <!-- EXEMPLES -->
+                <div class="info-box" style="background: #d4edda; border-color: #c3e6cb; margin-top: 20px;">
+                    <strong>💡 Exemples de configurations:</strong><br><br>
+                    <strong>Config 1 - Précision haute:</strong><br>
+                    • Nema 17 + 1/16 microstep + vis M8 (1.25mm) = 2560 steps/mm<br>
+                    • Vitesses: Min=20, Max=500, Défaut=100, Origine=200<br><br>
+                    <strong>Config 2 - Polyvalent:</strong><br>
+                    • Nema 17 + 1/8 microstep + vis trapèze (2mm) = 800 steps/mm<br>
+                    • Vitesses: Min=50, Max=2000, Défaut=300, Origine=600<br><br>
+                    <strong>Config 3 - Rapide:</strong><br>
+                    • Nema 17 + pas entier + courroie GT2 (2mm) = 100 steps/mm<br>
+                    • Vitesses: Min=100, Max=5000, Défaut=1000, Origine=2000
+                </div>
+            </div>
+        </div>
+
+        <!-- ONGLET LOGS -->
+        <div id="tab-logs" class="tab-content">
+            <div class="panel">
+                <h3>📄 Logs système</h3>
+                <div class="info-box">
+                    <strong>ℹ️ Les logs sont permanents</strong><br>
+                    Stockés dans la mémoire Flash - Conservés après redémarrage
+                </div>
+                <div id="logs" class="log">Chargement...</div>
+                <div style="margin-top: 10px;">
+                    <button class="btn-primary" onclick="loadLogs()">🔄 Actualiser</button>
+                    <button class="btn-danger" onclick="clearLogs()">🗑️ Effacer</button>
+                </div>
+            </div>
+
+            <div class="panel">
+                <h3>🩺 Diagnostics mémoire</h3>
+                <canvas id="diagChart" width="600" height="140" style="width: 100%; background: #2d3748; border-radius: 5px;"></canvas>
+                <div id="diagSummary" class="log" style="margin-top: 10px;">Chargement...</div>
+                <div style="margin-top: 10px;">
+                    <button class="btn-primary" onclick="loadDiagnostics()">🔄 Actualiser</button>
+                </div>
+            </div>
+        </div>
+    </div>
+
+    <script>
+        let currentTab = 'control';
+        let adminUnlocked = false;
+
+        // ===== GESTION DES ONGLETS =====
+        function switchTab(tabName) {
+            document.querySelectorAll('.tab-content').forEach(el => el.classList.remove('active'));
+            document.querySelectorAll('.tab').forEach(el => el.classList.remove('active'));
+            document.getElementById('tab-' + tabName).classList.add('active');
+            event.target.classList.add('active');
+            currentTab = tabName;
+
+            if (tabName === 'logs') { loadLogs(); loadDiagnostics(); }
+            if (tabName === 'admin' && adminUnlocked) loadCalibration();
+        }
+
+        // ===== ADMIN =====
+        function unlockAdmin() {
+            const password = document.getElementById('adminPassword').value;
+            fetch('/api/admin/unlock', {
+                method: 'POST',
+                headers: { 'Content-Type': 'application/json' },
+                body: JSON.stringify({ password: password })
+            })
+            .then(res => res.json())
+            .then(data => {
+                if (data.status === 'unlocked') {
+                    adminUnlocked = true;
+                    document.getElementById('admin-lock').style.display = 'none';
+                    document.getElementById('admin-content').style.display = 'block';
+                    alert('✅ Accès déverrouillé');
+                    loadCalibration();
+                } else {
+                    alert('❌ Mot de passe incorrect');
+                    document.getElementById('adminPassword').value = '';
+                }
+            });
+        }
+
+        function lockAdmin() {
+            adminUnlocked = false;
+            document.getElementById('admin-lock').style.display = 'block';
+            document.getElementById('admin-content').style.display = 'none';
+            document.getElementById('adminPassword').value = '';
+            fetch('/api/admin/lock', { method: 'POST' });
+        }
+
+        // Touche Entrée pour déverrouiller
+        document.addEventListener('DOMContentLoaded', () => {
+            const pwdInput = document.getElementById('adminPassword');
+            if (pwdInput) {
+                pwdInput.addEventListener('keypress', (e) => {
+                    if (e.key === 'Enter') unlockAdmin();
+                });
+            }
+            ['stepsPerRev', 'microsteps', 'leadScrewPitch'].forEach(id => {
+                const el = document.getElementById(id);
+                if (el) el.addEventListener('input', updateCalculatedSteps);
+            });
+        });
+
+        // ===== CALCUL STEPS/MM =====
+        function updateCalculatedSteps() {
+            const stepsRev = parseFloat(document.getElementById('stepsPerRev').value);
+            const microsteps = parseFloat(document.getElementById('microsteps').value);
+            const pitch = parseFloat(document.getElementById('leadScrewPitch').value);
+            
+            if (!isNaN(stepsRev) && !isNaN(microsteps) && !isNaN(pitch) && pitch > 0) {
+                const result = (stepsRev * microsteps) / pitch;
+                document.getElementById('calculatedSteps').textContent = result.toFixed(2);
+            }
+        }
+
+        // ===== CALIBRATION =====
+        async function applyCalibration() {
+            const stepsRev = parseFloat(document.getElementById('stepsPerRev').value);
+            const microsteps = parseFloat(document.getElementById('microsteps').value);
+            const pitch = parseFloat(document.getElementById('leadScrewPitch').value);
+            const backlash = parseFloat(document.getElementById('backlash').value);
+            const speedMin = parseFloat(document.getElementById('speedMin').value);
+            const speedMax = parseFloat(document.getElementById('speedMax').value);
+            const speedDefault = parseFloat(document.getElementById('speedDefault').value);
+            const speedHome = parseFloat(document.getElementById('speedHome').value);
+
+            if (isNaN(stepsRev) || isNaN(microsteps) || isNaN(pitch) || isNaN(backlash) ||
+                isNaN(speedMin) || isNaN(speedMax) || isNaN(speedDefault) || isNaN(speedHome)) {
+                alert('❌ Valeurs invalides');
+                return;
+            }
+
+            if (speedMin >= speedMax) {
+                alert('❌ Vitesse min doit être < max');
+                return;
+            }
+
+            if (speedDefault < speedMin || speedDefault > speedMax) {
+                alert('❌ Vitesse par défaut doit être entre min et max');
+                return;
+            }
+
+            const stepsPerMm = ((stepsRev * microsteps) / pitch).toFixed(2);
+
+            if (!confirm('⚠️ Appliquer cette configuration?\n\n' +
+                `Steps/mm: ${stepsPerMm}\n` +
+                `Vitesses: ${speedMin} - ${speedMax} mm/min\n` +
+                `Défaut: ${speedDefault} mm/min\n\n` +
+                'Le moteur sera arrêté et remis à 0.')) {
+                return;
+            }
+
+            const result = await apiCall('calibration', {
+                stepsPerRev: stepsRev,
+                microsteps: microsteps,
+                pitch: pitch,
+                backlash: backlash,
+                speedMin: speedMin,
+                speedMax: speedMax,
+                speedDefault: speedDefault,
+                speedHome: speedHome
+            });
+
+            if (result && result.status === 'calibration_updated') {
+                alert(`✅ Configuration sauvegardée!\n\nSteps/mm: ${result.stepsPerMm}`);
+                document.getElementById('speedInput').value = speedDefault;
+                document.getElementById('speedInput').min = speedMin;
+                document.getElementById('speedInput').max = speedMax;
+                updateStatus();
+            }
+        }
+
+        async function loadCalibration() {
+            const result = await apiCall('calibration');
+            if (result) {
+                document.getElementById('stepsPerRev').value = result.stepsPerRev;
+                document.getElementById('microsteps').value = result.microsteps;
+                document.getElementById('leadScrewPitch').value = result.pitch;
+                document.getElementById('backlash').value = result.backlash;
+                document.getElementById('speedMin').value = result.speedMin;
+                document.getElementById('speedMax').value = result.speedMax;
+                document.getElementById('speedDefault').value = result.speedDefault;
+                document.getElementById('speedHome').value = result.speedHome;
+                
+                document.getElementById('speedInput').min = result.speedMin;
+                document.getElementById('speedInput').max = result.speedMax;
+                document.getElementById('speedInput').value = result.speedDefault;
+                
+                updateCalculatedSteps();
+            }
+        }
+
+        // ===== CONTRÔLES MOTEUR =====
+        async function moveDistance() {
+            const distance = parseFloat(document.getElementById('distanceInput').value);
+            const speed = parseFloat(document.getElementById('speedInput').value);
+            
+            if (isNaN(distance) || distance === 0) {
+                alert('Distance invalide');
+                return;
+            }
+            
+            await apiCall('move', { distance: distance, speed: speed });
+        }
+
+        async function moveForward() {
+            const speed = parseFloat(document.getElementById('speedInput').value);
+            await apiCall('move', { continuous: true, direction: 1, speed: speed });
+        }
+
+        async function moveBackward() {
+            const speed = parseFloat(document.getElementById('speedInput').value);
+            await apiCall('move', { continuous: true, direction: -1, speed: speed });
+        }
+
+        async function stopMotor() {
+            await apiCall('stop', { action: 'stop' });
+        }
+
+        async function homeMotor() {
+            if (confirm('Retourner à la position 0mm ?')) {
+                await apiCall('home', { action: 'home' });
+            }
+        }
+
+        async function resetPosition() {
+            if (confirm('Définir la position actuelle comme 0mm ?')) {
+                await apiCall('reset', { action: 'reset' });
+            }
+        }
+
+        async function updateSpeedNow() {
+            const speed = parseFloat(document.getElementById('speedInput').value);
+            const status = await apiCall('status');
+            const speedMin = status ? status.speedMin : 50;
+            const speedMax = status ? status.speedMax : 2000;
+            
+            if (isNaN(speed) || speed < speedMin || speed > speedMax) {
+                alert(`Vitesse invalide! (${speedMin}-${speedMax} mm/min)`);
+                return;
+            }
+            
+            const result = await apiCall('speed', { speed: speed });
+            if (result && result.status === 'speed_updated') {
+                alert(`✅ Vitesse: ${speed} mm/min`);
+            }
+        }
+
+        // ===== CORRECTION D'AVANCE =====
+        // Une seule requête en vol: les positions intermédiaires du curseur
+        // sont fusionnées, seule la dernière valeur est envoyée.
+        let overridePending = null;
+        let overrideInFlight = false;
+
+        function setOverride(value) {
+            document.getElementById('overrideValue').textContent = value;
+            document.getElementById('overrideInput').value = value;
+            overridePending = parseFloat(value);
+            if (!overrideInFlight) sendOverride();
+        }
+
+        function sendOverride() {
+            const value = overridePending;
+            overridePending = null;
+            overrideInFlight = true;
+            fetch('/api/speed', {
+                method: 'POST',
+                headers: { 'Content-Type': 'application/json' },
+                body: JSON.stringify({ override: value })
+            }).catch(() => {}).finally(() => {
+                overrideInFlight = false;
+                if (overridePending !== null) sendOverride();
+            });
+        }
+
+        // ===== LIMITES =====
+        async function setLimits() {
+            const min = parseFloat(document.getElementById('limitMin').value);
+            const max = parseFloat(document.getElementById('limitMax').value);
+            
+            if (min >= max) {
+                alert('Min doit être < Max');
+                return;
+            }
+            
+            await apiCall('limits', { min: min, max: max });
+        }
+
+        async function toggleLimits() {
+            await apiCall('limits/toggle', { action: 'toggle' });
+        }
+
+        // ===== LOGS =====
+        async function loadLogs() {
+            try {
+                const response = await fetch('/api/logs');
+                const text = await response.text();
+                const logsDiv = document.getElementById('logs');
+                
+                if (text && text.length > 0) {
+                    logsDiv.innerHTML = text.replace(/\n/g, '<br>');
+                    logsDiv.scrollTop = logsDiv.scrollHeight;
+                } else {
+                    logsDiv.innerHTML = '<em>Aucun log</em>';
+                }
+            } catch (error) {
+                document.getElementById('logs').innerHTML = 'Erreur: ' + error.message;
+            }
+        }
+
+        // ===== DIAGNOSTICS =====
+        async function loadDiagnostics() {
+            try {
+                const response = await fetch('/api/diagnostics');
+                const d = await response.json();
+                drawDiagChart(d.history);
+
+                let text = 'Redémarrage: ' + d.resetReason + ' - uptime ' + Math.round(d.uptimeMs / 1000) + 's<br>';
+                text += 'Tas: ' + d.heap.free + ' libres (min ' + d.heap.minFree + '), plus grand bloc ' + d.heap.largestBlock + '<br>';
+                text += 'Boot: ' + d.boot.phases.map(p => p.name + ' ' + Math.round(p.durationUs / 1000) + 'ms').join(', ') + '<br>';
+                text += 'Boucle: ' + d.loop.minUs + '/' + d.loop.avgUs + '/' + d.loop.maxUs + ' µs (max ' + d.loop.maxEverUs + ', dépassements ' + d.loop.overruns + ')<br>';
+                text += 'Piles: ' + d.stacks.map(s => s.task + ' ' + s.freeMin).join(', ') + '<br>';
+                d.routes.filter(r => r.hits > 0).forEach(r => {
+                    text += r.uri + ': ' + r.hits + 'x, ' + r.avgUs + '/' + r.maxUs + ' µs, retenu ' + r.bytesRetained + ' o / ' + r.blocksRetained + ' blocs<br>';
+                });
+                document.getElementById('diagSummary').innerHTML = text;
+            } catch (error) {
+                document.getElementById('diagSummary').innerHTML = 'Erreur: ' + error.message;
+            }
+        }
+
+        // Tas libre (vert) et plus grand bloc (orange) sur l'historique
+        function drawDiagChart(history) {
+            const canvas = document.getElementById('diagChart');
+            const ctx = canvas.getContext('2d');
+            ctx.clearRect(0, 0, canvas.width, canvas.height);
+            if (history.length < 2) return;
+            const top = Math.max(...history.map(h => h[1])) * 1.1;
+            [[1, '#48bb78'], [3, '#ed8936']].forEach(([col, color]) => {
+                ctx.strokeStyle = color;
+                ctx.beginPath();
+                history.forEach((h, i) => {
+                    const x = i * canvas.width / (history.length - 1);
+                    const y = canvas.height - h[col] / top * canvas.height;
+                    if (i === 0) ctx.moveTo(x, y); else ctx.lineTo(x, y);
+                });
+                ctx.stroke();
+            });
+        }
+
+        async function clearLogs() {
+            if (!confirm('⚠️ Effacer tous les logs?\nIrréversible!')) {
+                return;
+            }
+            
+            try {
+                const response = await fetch('/api/logs/clear', { method: 'POST' });
+                const result = await response.json();
+                
+                if (result.status === 'cleared') {
+                    alert('✅ Logs effacés');
+                    loadLogs();
+                }
+            } catch (error) {
+                alert('Erreur: ' + error.message);
+            }
+        }
+
+        // ===== STATUT =====
+        async function updateStatus() {
+            const status = await apiCall('status');
+            if (status) {
+                document.getElementById('status').textContent = status.running ? 'En mouvement' : 'Arrêté';
+                document.getElementById('status').className = 'status-value ' + (status.running ? 'running' : 'stopped');
+                document.getElementById('position').textContent = status.position.toFixed(3);
+                document.getElementById('target').textContent = status.target.toFixed(3);
+                document.getElementById('speed').textContent = status.speed.toFixed(0);
+                if (!overrideInFlight && document.activeElement.id !== 'overrideInput') {
+                    document.getElementById('overrideValue').textContent = status.override;
+                    document.getElementById('overrideInput').value = status.override;
+                }
+                document.getElementById('stepsPerMm').textContent = status.stepsPerMm.toFixed(2);
+                document.getElementById('limitsStatus').textContent = status.limitsEnabled ? 'Activées' : 'Désactivées';
+                document.getElementById('limitsStatus').style.color = status.limitsEnabled ? '#28a745' : '#dc3545';
+                
+                const speedInput = document.getElementById('speedInput');
+                if (speedInput && status.speedMin && status.speedMax) {
+                    speedInput.min = status.speedMin;
+                    speedInput.max = status.speedMax;
+                }
+            }
+        }
+
+        // ===== API =====
+        async function apiCall(endpoint, data = null) {
+            try {
+                const config = { method: data ? 'POST' : 'GET' };
+                if (data) {
+                    config.headers = { 'Content-Type': 'application/json' };
+                    config.body = JSON.stringify(data);
+                }
+                const response = await fetch('/api/' + endpoint, config);
+                if (!response.ok) throw new Error(`HTTP ${response.status}`);
+                const result = await response.json();
+                return result;
+            } catch (error) {
+                console.error('Erreur API:', error);
+                alert('Erreur: ' + error.message);
+                return null;
+            }
+        }
+
+        // ===== INITIALISATION =====
+        setInterval(updateStatus, 300);
+        setTimeout(() => {
+            updateStatus();
+            updateCalculatedSteps();
+            
+            apiCall('calibration').then(result => {
+                if (result) {
+                    const speedInput = document.getElementById('speedInput');
+                    if (speedInput) {
+                        speedInput.min = result.speedMin;
+                        speedInput.max = result.speedMax;
+                        speedInput.value = result.speedDefault;
+                    }
+                }
+            });
+        }, 500);
+    </script>
+</body>
+</html>
+)rawliteral";
+    server.send(200, "text/html", html);
+  });
+
+  // ===== API STATUS =====
+  server.on("/api/status", HTTP_GET, []() {
+    server.sendHeader("Access-Control-Allow-Origin", "*");
+    String json = "{";
+    json += "\"running\":" + String(isRunning ? "true" : "false") + ",";
+    json += "\"position\":" + String(currentPosition, 3) + ",";
+    json += "\"target\":" + String(targetPosition, 3) + ",";
+    json += "\"speed\":" + String(currentSpeed) + ",";
+    json += "\"override\":" + String(feedOverride, 0) + ",";
+    if (ENCODER_ENABLED) {
+      json += "\"followingError\":" + String(following.error / STEPS_PER_MM, 3) + ",";
+      json += "\"encoderFault\":" + String(following.fault ? "true" : "false") + ",";
+    }
+    json += "\"steps\":" + String(stepper.currentPosition()) + ",";
+    json += "\"remaining\":" + String(stepper.distanceToGo()) + ",";
+    json += "\"stepsPerMm\":" + String(STEPS_PER_MM, 2) + ",";
+    json += "\"speedMin\":" + String(SPEED_MIN) + ",";
+    json += "\"speedMax\":" + String(SPEED_MAX) + ",";
+    json += "\"speedDefault\":" + String(SPEED_DEFAULT) + ",";
+    json += "\"limitsEnabled\":" + String(SOFT_LIMITS_ENABLED ? "true" : "false") + ",";
+    json += "\"synced\":" + String(syncReady() ? "true" : "false") + ",";
+    json += "\"syncErrorUs\":" + String(syncIsReference() ? 0 : clockSync.errorUs) + ",";
+    json += "\"startPending\":" + String(pendingStart != START_NONE ? "true" : "false") + ",";
+    json += "\"startLateUs\":" + String(startLateLastUs);
+    json += "}";
+    server.send(200, "application/json", json);
+  });
+
+  // ===== API STATUS BINAIRE =====
+  server.on("/api/status.bin", HTTP_GET, []() {
+    server.sendHeader("Access-Control-Allow-Origin", "*");
+    StatusRecord rec;
+    fillStatusRecord(rec);
+    server.setContentLength(sizeof(rec));
+    server.send(200, "application/octet-stream", "");
+    server.sendContent((const char*)&rec, sizeof(rec));
+  });
+
+  server.on("/api/status.cbor", HTTP_GET, []() {
+    server.sendHeader("Access-Control-Allow-Origin", "*");
+    StatusRecord rec;
+    fillStatusRecord(rec);
+    uint8_t buffer[STATUS_CBOR_MAX];
+    size_t length = encodeStatusCbor(rec, buffer);
+    server.setContentLength(length);
+    server.send(200, "application/cbor", "");
+    server.sendContent((const char*)buffer, length);
+  });
+
+  // ===== API ADMIN UNLOCK =====
+  server.on("/api/admin/unlock", HTTP_POST, []() {
+    server.sendHeader("Access-Control-Allow-Origin", "*");
+    String body = server.arg("plain");
+
+    String password = "";
+    if (body.indexOf("\"password\":\"") >= 0) {
+      int start = body.indexOf("\"password\":\"") + 12;
+      int end = body.indexOf("\"", start);
+      password = body.substring(start, end);
+    }
+
+    if (password == admin_password) {
+      adminUnlocked = true;
+      Serial.println("✅ Admin déverrouillé");
+      logToFile("Admin déverrouillé");
+      server.send(200, "application/json", "{\"status\":\"unlocked\"}");
+    } else {
+      Serial.println("❌ Mot de passe incorrect");
+      logToFile("Tentative accès admin échouée");
+      server.send(403, "application/json", "{\"status\":\"wrong_password\"}");
+    }
+  });
+
+  // ===== API ADMIN LOCK =====
+  server.on("/api/admin/lock", HTTP_POST, []() {
+    server.sendHeader("Access-Control-Allow-Origin", "*");
+    adminUnlocked = false;
+    Serial.println("🔒 Admin verrouillé");
+    logToFile("Admin verrouillé");
+    server.send(200, "application/json", "{\"status\":\"locked\"}");
+  });
+
+  // ===== API CALIBRATION GET =====
+  server.on("/api/calibration", HTTP_GET, []() {
+    server.sendHeader("Access-Control-Allow-Origin", "*");
+    String json = "{";
+    json += "\"stepsPerRev\":" + String(STEPS_PER_REVOLUTION, 1) + ",";
+    json += "\"microsteps\":" + String(MICROSTEPS, 1) + ",";
+    json += "\"pitch\":" + String(LEAD_SCREW_PITCH, 2) + ",";
+    json += "\"stepsPerMm\":" + String(STEPS_PER_MM, 2) + ",";
+    json += "\"backlash\":" + String(BACKLASH_MM, 3) + ",";
+    json += "\"backlashSteps\":" + String(stepper.backlash()) + ",";
+    json += "\"speedMin\":" + String(SPEED_MIN, 0) + ",";
+    json += "\"speedMax\":" + String(SPEED_MAX, 0) + ",";
+    json += "\"speedDefault\":" + String(SPEED_DEFAULT, 0) + ",";
+    json += "\"speedHome\":" + String(SPEED_HOME, 0);
+    json += "}";
+    server.send(200, "application/json", json);
+  });
+
+  // ===== API CALIBRATION POST =====
+  server.on("/api/calibration", HTTP_POST, []() {
+    server.sendHeader("Access-Control-Allow-Origin", "*");
+    
+    if (!adminUnlocked) {
+      Serial.println("❌ Accès refusé");
+      server.send(403, "application/json", "{\"error\":\"admin_locked\"}");
+      return;
+    }
+    
+    String body = server.arg("plain");
+    stopMotor();
+
+    float newStepsRev = STEPS_PER_REVOLUTION;
+    float newMicrosteps = MICROSTEPS;
+    float newPitch = LEAD_SCREW_PITCH;
+    float newBacklash = BACKLASH_MM;
+    float newSpeedMin = SPEED_MIN;
+    float newSpeedMax = SPEED_MAX;
+    float newSpeedDefault = SPEED_DEFAULT;
+    float newSpeedHome = SPEED_HOME;
+
+    // Parse JSON
+    if (body.indexOf("\"stepsPerRev\":") >= 0) {
+      int start = body.indexOf("\"stepsPerRev\":") + 14;
+      int end = body.indexOf(",", start);
+      if (end == -1) end = body.indexOf("}", start);
+      newStepsRev = body.substring(start, end).toFloat();
+    }
+
+    if (body.indexOf("\"microsteps\":") >= 0) {
+      int start = body.indexOf("\"microsteps\":") + 13;
+      int end = body.indexOf(",", start);
+      if (end == -1) end = body.indexOf("}", start);
+      newMicrosteps = body.substring(start, end).toFloat();
+    }
+
+    if (body.indexOf("\"pitch\":") >= 0) {
+      int start = body.indexOf("\"pitch\":") + 8;
+      int end = body.indexOf(",", start);
+      if (end == -1) end = body.indexOf("}", start);
+      newPitch = body.substring(start, end).toFloat();
+    }
+
+    if (body.indexOf("\"backlash\":") >= 0) {
+      int start = body.indexOf("\"backlash\":") + 11;
+      int end = body.indexOf(",", start);
+      if (end == -1) end = body.indexOf("}", start);
+      newBacklash = body.substring(start, end).toFloat();
+    }
+
+    if (body.indexOf("\"speedMin\":") >= 0) {
+      int start = body.indexOf("\"speedMin\":") + 11;
+      int end = body.indexOf(",", start);
+      if (end == -1) end = body.indexOf("}", start);
+      newSpeedMin = body.substring(start, end).toFloat();
+    }
+
+    if (body.indexOf("\"speedMax\":") >= 0) {
+      int start = body.indexOf("\"speedMax\":") + 11;
+      int end = body.indexOf(",", start);
+      if (end == -1) end = body.indexOf("}", start);
+      newSpeedMax = body.substring(start, end).toFloat();
+    }
+
+    if (body.indexOf("\"speedDefault\":") >= 0) {
+      int start = body.indexOf("\"speedDefault\":") + 15;
+      int end = body.indexOf(",", start);
+      if (end == -1) end = body.indexOf("}", start);
+      newSpeedDefault = body.substring(start, end).toFloat();
+    }
+
+    if (body.indexOf("\"speedHome\":") >= 0) {
+      int start = body.indexOf("\"speedHome\":") + 12;
+      int end = body.indexOf(",", start);
+      if (end == -1) end = body.indexOf("}", start);
+      newSpeedHome = body.substring(start, end).toFloat();
+    }
+
+    // Validation
+    if (newStepsRev <= 0 || newMicrosteps <= 0 || newPitch <= 0) {
+      server.send(400, "application/json", "{\"error\":\"invalid_calibration\"}");
+      return;
+    }
+
+    if (newSpeedMin <= 0 || newSpeedMax <= 0 || newSpeedMin >= newSpeedMax) {
+      server.send(400, "application/json", "{\"error\":\"invalid_speed\"}");
+      return;
+    }
+
+    if (newBacklash < 0 || newBacklash > BACKLASH_MAX_MM) {
+      server.send(400, "application/json", "{\"error\":\"invalid_backlash\"}");
+      return;
+    }
+
+    // Appliquer
+    STEPS_PER_REVOLUTION = newStepsRev;
+    MICROSTEPS = newMicrosteps;
+    LEAD_SCREW_PITCH = newPitch;
+    BACKLASH_MM = newBacklash;
+    SPEED_MIN = newSpeedMin;
+    SPEED_MAX = newSpeedMax;
+    SPEED_DEFAULT = newSpeedDefault;
+    SPEED_HOME = newSpeedHome;
+    
+    calculateStepsPerMm();
+    saveConfig();
+    if (activeProfile >= 0) {
+      CalibrationProfile profile = profileFromCurrent();
+      strcpy(profile.name, profiles[activeProfile].name);
+      profileStore(activeProfile, profile);
+    }
+
+    stepper.setCurrentPosition(0);
+    positionCarry.invalidate();
+    currentPosition = 0.0;
+    targetPosition = 0.0;
+    currentSpeed = SPEED_DEFAULT;
+    encoderSync();
+    positionEventsSeek(0);
+
+    Serial.println("✅ Configuration appliquée");
+    logToFile("Config: " + String(STEPS_PER_MM, 2) + " steps/mm");
+
+    String json = "{";
+    json += "\"status\":\"calibration_updated\",";
+    json += "\"stepsPerMm\":" + String(STEPS_PER_MM, 2) + ",";
+    json += "\"backlashSteps\":" + String(stepper.backlash()) + ",";
+    json += "\"speedDefault\":" + String(SPEED_DEFAULT, 0);
+    json += "}";
+    
+    server.send(200, "application/json", json);
+  });
+
+  // ===== API PROFILS =====
+  server.on("/api/profiles", HTTP_GET, []() {
+    server.sendHeader("Access-Control-Allow-Origin", "*");
+    String json = "{\"active\":" + String(activeProfile) + ",";
+    json += "\"switches\":" + String(profileSwitches) + ",";
+    json += "\"switchLastUs\":" + String(profileSwitchLastUs) + ",";
+    json += "\"profiles\":[";
+    bool first = true;
+    for (int i = 0; i < PROFILE_COUNT; i++) {
+      if (!profiles[i].used()) continue;
+      if (!first) json += ",";
+      json += profileJson(i);
+      first = false;
+    }
+    json += "]}";
+    server.send(200, "application/json", json);
+  });
+
+  // {"slot":1,"name":"fine",...}: enregistre (champs absents: réglages en
+  // cours); {"slot":1,"delete":true}: efface
+  server.on("/api/profiles", HTTP_POST, []() {
+    server.sendHeader("Access-Control-Allow-Origin", "*");
+    if (!adminUnlocked) {
+      server.send(403, "application/json", "{\"error\":\"admin_locked\"}");
+      return;
+    }
+
+    String body = server.arg("plain");
+    auto numberField = [&body](const char* key, float& value) {
+      String pattern = "\"" + String(key) + "\":";
+      int start = body.indexOf(pattern);
+      if (start < 0) return;
+      start += pattern.length();
+      int end = body.indexOf(",", start);
+      if (end == -1) end = body.indexOf("}", start);
+      value = body.substring(start, end).toFloat();
+    };
+
+    float slotValue = -1;
+    numberField("slot", slotValue);
+    int slot = (int)slotValue;
+    if (slotValue != slot || slot < 0 || slot >= PROFILE_COUNT) {
+      server.send(400, "application/json", "{\"error\":\"invalid_slot\"}");
+      return;
+    }
 
-            <!-- Contenu admin -->
-            <div id="admin-content" style="display: none;">
-                
-                <!-- CALIBRATION MOTEUR -->
-                <div class="panel admin-panel">
-                    <h3>🔧 Calibration Moteur</h3>
-                    <div>
-                        <label>Steps par révolution moteur:</label>
-                        <input type="number" id="stepsPerRev" value="200" min="1" step="1">
-                        <small>(200 = 1.8°, 400 = 0.9°)</small>
-                    </div>
-                    <div style="margin-top: 10px;">
-                        <label>Microstepping du driver:</label>
-                        <input type="number" id="microsteps" value="1" min="1" step="1">
-                        <small>(1, 2, 4, 8, 16, 32...)</small>
-                    </div>
-                    <div style="margin-top: 10px;">
-                        <label>Pas de vis (mm/tour):</label>
-                        <input type="number" id="leadScrewPitch" value="2" min="0.1" step="0.1">
-                        <small>(Distance en 1 tour)</small>
-                    </div>
-                    <div class="info-box">
-                        <strong>Calcul:</strong> 
-                        <span class="formula">Steps/mm = (Steps/rev × Microsteps) ÷ Pas de vis</span>
-                        <br><br>
-                        <strong>Résultat:</strong> 
-                        <span id="calculatedSteps" style="font-size: 20px; color: #007bff;">100.00</span> steps/mm
-                    </div>
-                </div>
+    if (body.indexOf("\"delete\":true") >= 0) {
+      if (slot == activeProfile && isRunning) {
+        server.send(409, "application/json", "{\"error\":\"motor_running\"}");
+        return;
+      }
+      logToFile("Profil " + String(slot) + " effacé");
+      profileDelete(slot);
+      server.send(200, "application/json", "{\"status\":\"profile_deleted\"}");
+      return;
+    }
+
+    CalibrationProfile profile = profiles[slot].used() ? profiles[slot] : profileFromCurrent();
+    int nameStart = body.indexOf("\"name\":\"");
+    if (nameStart >= 0) {
+      nameStart += 8;
+      int nameEnd = body.indexOf("\"", nameStart);
+      String name = body.substring(nameStart, nameEnd);
+      if (nameEnd < 0 || name.length() == 0 || name.length() > PROFILE_NAME_MAX || name.indexOf('\\') >= 0) {
+        server.send(400, "application/json", "{\"error\":\"invalid_name\"}");
+        return;
+      }
+      strcpy(profile.name, name.c_str());
+    }
+    numberField("stepsPerRev", profile.stepsPerRev);
+    numberField("microsteps", profile.microsteps);
+    numberField("pitch", profile.pitch);
+    numberField("speedMin", profile.speedMin);
+    numberField("speedMax", profile.speedMax);
+    numberField("speedDefault", profile.speedDefault);
+    numberField("speedHome", profile.speedHome);
+    numberField("limitMin", profile.limitMin);
+    numberField("limitMax", profile.limitMax);
+    numberField("backlash", profile.backlash);
+    if (body.indexOf("\"limitsEnabled\":true") >= 0) profile.limitsEnabled = true;
+    if (body.indexOf("\"limitsEnabled\":false") >= 0) profile.limitsEnabled = false;
+
+    if (!profile.used() || !profile.valid()) {
+      server.send(400, "application/json", "{\"error\":\"invalid_profile\"}");
+      return;
+    }
+    // Le profil actif ne change qu'à l'arrêt: ses constantes sont appliquées
+    if (slot == activeProfile && isRunning) {
+      server.send(409, "application/json", "{\"error\":\"motor_running\"}");
+      return;
+    }
+
+    profileStore(slot, profile);
+    if (slot == activeProfile) profileApply(slot);
+    logToFile("Profil " + String(slot) + " '" + String(profile.name) + "' enregistré");
+    server.send(200, "application/json", profileJson(slot));
+  });
+
+  // {"slot":1} ou {"name":"fine"}: changement à l'arrêt, position conservée
+  server.on("/api/profiles/select", HTTP_POST, []() {
+    server.sendHeader("Access-Control-Allow-Origin", "*");
+    if (!adminUnlocked) {
+      server.send(403, "application/json", "{\"error\":\"admin_locked\"}");
+      return;
+    }
+
+    String body = server.arg("plain");
+    int slot = -1;
+    if (body.indexOf("\"slot\":") >= 0) {
+      int start = body.indexOf("\"slot\":") + 7;
+      int end = body.indexOf(",", start);
+      if (end == -1) end = body.indexOf("}", start);
+      slot = body.substring(start, end).toInt();
+    } else if (body.indexOf("\"name\":\"") >= 0) {
+      int start = body.indexOf("\"name\":\"") + 8;
+      String name = body.substring(start, body.indexOf("\"", start));
+      for (int i = 0; i < PROFILE_COUNT; i++) {
+        if (profiles[i].used() && name == profiles[i].name) slot = i;
+      }
+    }
+    if (slot < 0 || slot >= PROFILE_COUNT || !profiles[slot].used()) {
+      server.send(404, "application/json", "{\"error\":\"unknown_profile\"}");
+      return;
+    }
+    if (!profileSelect(slot)) {
+      server.send(409, "application/json", "{\"error\":\"motor_running\"}");
+      return;
+    }
+
+    String json = "{\"status\":\"profile_selected\",";
+    json += "\"active\":" + String(activeProfile) + ",";
+    json += "\"position\":" + String(currentPosition, 4) + ",";
+    json += "\"steps\":" + String(stepper.currentPosition()) + ",";
+    json += "\"stepsPerMm\":" + String(STEPS_PER_MM, 4) + ",";
+    json += "\"switchUs\":" + String(profileSwitchLastUs) + "}";
+    server.send(200, "application/json", json);
+  });
+
+  // ===== API MOVE =====
+  server.on("/api/move", HTTP_POST, []() {
+    server.sendHeader("Access-Control-Allow-Origin", "*");
+    const char* owner = axisOwner();
+    if (owner != NULL) {
+      server.send(409, "application/json", "{\"error\":\"" + String(owner) + "\"}");
+      return;
+    }
+    String body = server.arg("plain");
+
+    float speed = SPEED_DEFAULT;
+    float distance = 0;
+    int direction = 1;
+    bool continuous = false;
+
+    if (body.indexOf("\"speed\":") >= 0) {
+      int start = body.indexOf("\"speed\":") + 8;
+      int end = body.indexOf(",", start);
+      if (end == -1) end = body.indexOf("}", start);
+      speed = body.substring(start, end).toFloat();
+    }
+
+    if (body.indexOf("\"distance\":") >= 0) {
+      int start = body.indexOf("\"distance\":") + 11;
+      int end = body.indexOf(",", start);
+      if (end == -1) end = body.indexOf("}", start);
+      distance = body.substring(start, end).toFloat();
+    }
+
+    if (body.indexOf("\"direction\":") >= 0) {
+      int start = body.indexOf("\"direction\":") + 12;
+      int end = body.indexOf(",", start);
+      if (end == -1) end = body.indexOf("}", start);
+      direction = body.substring(start, end).toInt();
+    }
+
+    if (body.indexOf("\"continuous\":true") >= 0) {
+      continuous = true;
+    }
+
+    if (speed < SPEED_MIN || speed > SPEED_MAX) {
+      server.send(400, "application/json", "{\"error\":\"invalid_speed\"}");
+      return;
+    }
+
+    int64_t startAt = parseStartAt(body);
+    if (startAt != 0) {
+      if (isRunning) {
+        server.send(409, "application/json", "{\"error\":\"motor_running\"}");
+        return;
+      }
+      direction = direction > 0 ? 1 : -1;
+      float position = (float)stepper.currentPosition() / STEPS_PER_MM;
+      bool reachable = continuous ? (continuousTarget(direction) - stepper.currentPosition()) * direction > 0
+                                  : checkLimits(position + distance);
+      if (!reachable) {
+        server.send(400, "application/json", "{\"error\":\"limit_exceeded\"}");
+        return;
+      }
+      String error = scheduleStart(startAt, continuous ? START_CONTINUOUS : START_MOVE, distance, speed, direction);
+      if (error.length() > 0) {
+        server.send(error == "not_synced" ? 409 : 400, "application/json", "{\"error\":\"" + error + "\"}");
+        return;
+      }
+      server.send(200, "application/json", "{\"status\":\"scheduled\",\"startAt\":" + String((double)startAt, 0) + "}");
+      return;
+    }
+
+    // Marche continue: pas de décélération préalable, la rampe raccorde le
+    // mouvement en cours (y compris une inversion)
+    if (continuous) {
+      direction = direction > 0 ? 1 : -1;
+      jogActive = false;
+      currentSpeed = speed;
+      if (!startContinuous(direction, (speed * STEPS_PER_MM) / 60.0)) {
+        server.send(400, "application/json", "{\"error\":\"limit_exceeded\"}");
+        return;
+      }
+      journalRecord(JOURNAL_CONTINUOUS, direction, speed);
+      logToFile("Continu " + String(direction > 0 ? "avant" : "arrière"));
+      server.send(200, "application/json", "{\"status\":\"continuous\"}");
+      return;
+    }
+
+    // Déplacement: depuis un mouvement en cours, changement de cible sur la
+    // rampe comme la marche continue, loop() se charge de l'éventuelle
+    // inversion
+    if (!startMove(distance, speed)) {
+      server.send(400, "application/json", "{\"error\":\"limit_exceeded\"}");
+      return;
+    }
+    continuousMode = false;
+    jogActive = false;
+    jogCmdMicros = 0;
+    server.send(200, "application/json", "{\"status\":\"moving\"}");
+  });
+
+  // ===== API SPEED =====
+  server.on("/api/speed", HTTP_POST, []() {
+    server.sendHeader("Access-Control-Allow-Origin", "*");
+    String body = server.arg("plain");
+
+    // Correction d'avance seule: appelée à haute fréquence par le curseur,
+    // donc ni log ni écriture flash
+    if (body.indexOf("\"override\":") >= 0) {
+      int start = body.indexOf("\"override\":") + 11;
+      int end = body.indexOf(",", start);
+      if (end == -1) end = body.indexOf("}", start);
+      float newOverride = body.substring(start, end).toFloat();
+
+      if (newOverride < FEED_OVERRIDE_MIN || newOverride > FEED_OVERRIDE_MAX) {
+        server.send(400, "application/json", "{\"error\":\"invalid_override\"}");
+        return;
+      }
+      feedOverride = newOverride;
+      journalRecord(JOURNAL_OVERRIDE, feedOverride, 0);
+
+      if (body.indexOf("\"speed\":") < 0) {
+        server.send(200, "application/json", "{\"status\":\"override_updated\",\"override\":" + String(feedOverride, 0) + "}");
+        return;
+      }
+    }
+
+    float newSpeed = SPEED_DEFAULT;
+    if (body.indexOf("\"speed\":") >= 0) {
+      int start = body.indexOf("\"speed\":") + 8;
+      int end = body.indexOf(",", start);
+      if (end == -1) end = body.indexOf("}", start);
+      newSpeed = body.substring(start, end).toFloat();
+    }
+
+    if (newSpeed < SPEED_MIN || newSpeed > SPEED_MAX) {
+      server.send(400, "application/json", "{\"error\":\"invalid_speed\"}");
+      return;
+    }
+
+    applySpeed(newSpeed);
+
+    logToFile("Vitesse: " + String(newSpeed) + "mm/min");
+    server.send(200, "application/json", "{\"status\":\"speed_updated\",\"speed\":" + String(newSpeed) + "}");
+  });
+
+  // ===== API STOP =====
+  server.on("/api/stop", HTTP_POST, []() {
+    server.sendHeader("Access-Control-Allow-Origin", "*");
+    stopMotor();
+    journalRecord(JOURNAL_STOP, 0, 0);
+    logToFile("ARRÊT");
+    server.send(200, "application/json", "{\"status\":\"stopped\"}");
+  });
+
+  // ===== API HOME =====
+  server.on("/api/home", HTTP_POST, []() {
+    server.sendHeader("Access-Control-Allow-Origin", "*");
+
+    currentPosition = (float)stepper.currentPosition() / STEPS_PER_MM;
+    float distanceToHome = -currentPosition;
+
+    if (abs(distanceToHome) < 0.001) {
+      server.send(200, "application/json", "{\"status\":\"already_home\"}");
+      return;
+    }
+
+    startHoming();
+    server.send(200, "application/json", "{\"status\":\"homing\"}");
+  });
+
+  // ===== API RESET =====
+  server.on("/api/reset", HTTP_POST, []() {
+    server.sendHeader("Access-Control-Allow-Origin", "*");
+    resetPosition();
+    logToFile("Position reset");
+    server.send(200, "application/json", "{\"status\":\"reset\"}");
+  });
+
+  // ===== API LIMITS =====
+  server.on("/api/limits", HTTP_POST, []() {
+    server.sendHeader("Access-Control-Allow-Origin", "*");
+    String body = server.arg("plain");
+
+    float newMin = SOFT_LIMIT_MIN;
+    float newMax = SOFT_LIMIT_MAX;
+
+    if (body.indexOf("\"min\":") >= 0) {
+      int start = body.indexOf("\"min\":") + 6;
+      int end = body.indexOf(",", start);
+      if (end == -1) end = body.indexOf("}", start);
+      newMin = body.substring(start, end).toFloat();
+    }
+
+    if (body.indexOf("\"max\":") >= 0) {
+      int start = body.indexOf("\"max\":") + 6;
+      int end = body.indexOf(",", start);
+      if (end == -1) end = body.indexOf("}", start);
+      newMax = body.substring(start, end).toFloat();
+    }
+
+    if (newMin < newMax) {
+      SOFT_LIMIT_MIN = newMin;
+      SOFT_LIMIT_MAX = newMax;
+      logToFile("Limites: " + String(newMin) + " à " + String(newMax));
+      server.send(200, "application/json", "{\"status\":\"limits_updated\"}");
+    } else {
+      server.send(400, "application/json", "{\"error\":\"invalid_limits\"}");
+    }
+  });
+
+  // ===== API LIMITS TOGGLE =====
+  server.on("/api/limits/toggle", HTTP_POST, []() {
+    server.sendHeader("Access-Control-Allow-Origin", "*");
+    SOFT_LIMITS_ENABLED = !SOFT_LIMITS_ENABLED;
+    logToFile("Limites " + String(SOFT_LIMITS_ENABLED ? "ON" : "OFF"));
+    server.send(200, "application/json", "{\"status\":\"" + String(SOFT_LIMITS_ENABLED ? "enabled" : "disabled") + "\"}");
+  });
+
+  // ===== API JOG =====
+  server.on("/api/jog", HTTP_GET, []() {
+    server.sendHeader("Access-Control-Allow-Origin", "*");
+    String json = "{";
+    json += "\"port\":" + String(JOG_UDP_PORT) + ",";
+    json += "\"heartbeatMs\":" + String(JOG_HEARTBEAT_MS) + ",";
+    json += "\"active\":" + String(jogActive ? "true" : "false") + ",";
+    json += "\"packets\":" + String(jog.packets) + ",";
+    json += "\"rejected\":" + String(jog.rejected) + ",";
+    json += "\"deadmanTrips\":" + String(jog.deadmanTrips) + ",";
+    json += "\"latencyUs\":" + String(jogLatencyLast) + ",";
+    json += "\"latencyMaxUs\":" + String(jogLatencyMax);
+    json += "}";
+    server.send(200, "application/json", json);
+  });
 
-                <!-- CONFIGURATION VITESSES -->
-                <div class="panel admin-panel">
-                    <h3>⚡ Configuration des Vitesses</h3>
-                    <div class="grid">
-                        <div>
-                            <label>Vitesse MINIMALE:</label>
-                            <input type="number" id="speedMin" value="50" min="1" step="10">
-                            <small>mm/min - Limite basse</small>
-                        </div>
-                        <div>
-                            <label>Vitesse MAXIMALE:</label>
-                            <input type="number" id="speedMax" value="2000" min="100" step="100">
-                            <small>mm/min - Limite haute</small>
-                        </div>
-                        <div>
-                            <label>Vitesse PAR DÉFAUT:</label>
-                            <input type="number" id="speedDefault" value="300" min="1" step="50">
-                            <small>mm/min - Au démarrage</small>
-                        </div>
-                        <div>
-                            <label>Vitesse RETOUR ORIGINE:</label>
-                            <input type="number" id="speedHome" value="600" min="1" step="50">
-                            <small>mm/min - Bouton 🏠</small>
-                        </div>
-                    </div>
-                    <div class="info-box" style="background: #fff3cd; border-color: #ffc107;">
-                        <strong>💡 Vitesses typiques:</strong><br>
-                        • <strong>Précision:</strong> 50-200 mm/min<br>
-                        • <strong>Normal:</strong> 300-600 mm/min<br>
-                        • <strong>Rapide:</strong> 800-1500 mm/min<br>
-                        • <strong>Maximum:</strong> 2000-5000 mm/min
-                    </div>
-                </div>
+  server.on("/api/jog", HTTP_POST, []() {
+    server.sendHeader("Access-Control-Allow-Origin", "*");
+    String body = server.arg("plain");
 
-                <!-- BOUTONS ADMIN -->
-                <div style="text-align: center; margin-top: 20px;">
-                    <button class="btn-success" style="font-size: 16px; padding: 15px 30px;" onclick="applyCalibration()">
-                        ✅ APPLIQUER ET SAUVEGARDER
-                    </button>
-                    <button class="btn-warning" onclick="loadCalibration()">🔄 Recharger</button>
-                    <button class="btn-danger" onclick="lockAdmin()">🔒 Verrouiller</button>
-                </div>
+    unsigned long newHeartbeat = JOG_HEARTBEAT_MS;
+    if (body.indexOf("\"heartbeatMs\":") >= 0) {
+      int start = body.indexOf("\"heartbeatMs\":") + 14;
+      int end = body.indexOf(",", start);
+      if (end == -1) end = body.indexOf("}", start);
+      newHeartbeat = body.substring(start, end).toInt();
+    }
 
-                <!-- EXEMPLES -->
-                <div class="info-box" style="background: #d4edda; border-color: #c3e6cb; margin-top: 20px;">
-                    <strong>💡 Exemples de configurations:</strong><br><br>
-                    <strong>Config 1 - Précision haute:</strong><br>
-                    • Nema 17 + 1/16 microstep + vis M8 (1.25mm) = 2560 steps/mm<br>
-                    • Vitesses: Min=20, Max=500, Défaut=100, Origine=200<br><br>
-                    <strong>Config 2 - Polyvalent:</strong><br>
-                    • Nema 17 + 1/8 microstep + vis trapèze (2mm) = 800 steps/mm<br>
-                    • Vitesses: Min=50, Max=2000, Défaut=300, Origine=600<br><br>
-                    <strong>Config 3 - Rapide:</strong><br>
-                    • Nema 17 + pas entier + courroie GT2 (2mm) = 100 steps/mm<br>
-                    • Vitesses: Min=100, Max=5000, Défaut=1000, Origine=2000
-                </div>
-            </div>
-        </div>
+    if (newHeartbeat < 20 || newHeartbeat > 5000) {
+      server.send(400, "application/json", "{\"error\":\"invalid_heartbeat\"}");
+      return;
+    }
 
-        <!-- ONGLET LOGS -->
-        <div id="tab-logs" class="tab-content">
-            <div class="panel">
-                <h3>📄 Logs système</h3>
-                <div class="info-box">
-                    <strong>ℹ️ Les logs sont permanents</strong><br>
-                    Stockés dans la mémoire Flash - Conservés après redémarrage
-                </div>
-                <div id="logs" class="log">Chargement...</div>
-                <div style="margin-top: 10px;">
-                    <button class="btn-primary" onclick="loadLogs()">🔄 Actualiser</button>
-                    <button class="btn-danger" onclick="clearLogs()">🗑️ Effacer</button>
-                </div>
-            </div>
-        </div>
-    </div>
+    JOG_HEARTBEAT_MS = newHeartbeat;
+    saveConfig();
+    logToFile("Jog heartbeat: " + String(JOG_HEARTBEAT_MS) + "ms");
+    server.send(200, "application/json", "{\"status\":\"jog_updated\",\"heartbeatMs\":" + String(JOG_HEARTBEAT_MS) + "}");
+  });
 
-    <script>
-        let currentTab = 'control';
-        let adminUnlocked = false;
+  // ===== API CODEUR =====
+  server.on("/api/encoder", HTTP_GET, []() {
+    server.sendHeader("Access-Control-Allow-Origin", "*");
+    String json = "{";
+    json += "\"enabled\":" + String(ENCODER_ENABLED ? "true" : "false") + ",";
+    json += "\"countsPerRev\":" + String(ENCODER_COUNTS_PER_REV, 0) + ",";
+    json += "\"warnMm\":" + String(FOLLOWING_WARN_MM, 3) + ",";
+    json += "\"faultMm\":" + String(FOLLOWING_FAULT_MM, 3) + ",";
+    json += "\"counts\":" + String(encoderStarted ? encoderCount() : 0) + ",";
+    json += "\"error\":" + String(following.error / STEPS_PER_MM, 3) + ",";
+    json += "\"peakError\":" + String(following.peakError / STEPS_PER_MM, 3) + ",";
+    json += "\"warnings\":" + String(encoderWarnings) + ",";
+    json += "\"faults\":" + String(encoderFaults) + ",";
+    json += "\"fault\":" + String(following.fault ? "true" : "false");
+    json += "}";
+    server.send(200, "application/json", json);
+  });
 
-        // ===== GESTION DES ONGLETS =====
-        function switchTab(tabName) {
-            document.querySelectorAll('.tab-content').forEach(el => el.classList.remove('active'));
-            document.querySelectorAll('.tab').forEach(el => el.classList.remove('active'));
-            document.getElementById('tab-' + tabName).classList.add('active');
-            event.target.classList.add('active');
-            currentTab = tabName;
+  server.on("/api/encoder", HTTP_POST, []() {
+    server.sendHeader("Access-Control-Allow-Origin", "*");
 
-            if (tabName === 'logs') loadLogs();
-            if (tabName === 'admin' && adminUnlocked) loadCalibration();
-        }
+    if (!adminUnlocked) {
+      server.send(403, "application/json", "{\"error\":\"admin_locked\"}");
+      return;
+    }
 
-        // ===== ADMIN =====
-        function unlockAdmin() {
-            const password = document.getElementById('adminPassword').value;
-            fetch('/api/admin/unlock', {
-                method: 'POST',
-                headers: { 'Content-Type': 'application/json' },
-                body: JSON.stringify({ password: password })
-            })
-            .then(res => res.json())
-            .then(data => {
-                if (data.status === 'unlocked') {
-                    adminUnlocked = true;
-                    document.getElementById('admin-lock').style.display = 'none';
-                    document.getElementById('admin-content').style.display = 'block';
-                    alert('✅ Accès déverrouillé');
-                    loadCalibration();
-                } else {
-                    alert('❌ Mot de passe incorrect');
-                    document.getElementById('adminPassword').value = '';
-                }
-            });
-        }
+    String body = server.arg("plain");
 
-        function lockAdmin() {
-            adminUnlocked = false;
-            document.getElementById('admin-lock').style.display = 'block';
-            document.getElementById('admin-content').style.display = 'none';
-            document.getElementById('adminPassword').value = '';
-            fetch('/api/admin/lock', { method: 'POST' });
-        }
+    bool newEnabled = ENCODER_ENABLED;
+    float newCpr = ENCODER_COUNTS_PER_REV;
+    float newWarn = FOLLOWING_WARN_MM;
+    float newFault = FOLLOWING_FAULT_MM;
 
-        // Touche Entrée pour déverrouiller
-        document.addEventListener('DOMContentLoaded', () => {
-            const pwdInput = document.getElementById('adminPassword');
-            if (pwdInput) {
-                pwdInput.addEventListener('keypress', (e) => {
-                    if (e.key === 'Enter') unlockAdmin();
-                });
-            }
-            ['stepsPerRev', 'microsteps', 'leadScrewPitch'].forEach(id => {
-                const el = document.getElementById(id);
-                if (el) el.addEventListener('input', updateCalculatedSteps);
-            });
-        });
+    if (body.indexOf("\"enabled\":true") >= 0) newEnabled = true;
+    if (body.indexOf("\"enabled\":false") >= 0) newEnabled = false;
 
-        // ===== CALCUL STEPS/MM =====
-        function updateCalculatedSteps() {
-            const stepsRev = parseFloat(document.getElementById('stepsPerRev').value);
-            const microsteps = parseFloat(document.getElementById('microsteps').value);
-            const pitch = parseFloat(document.getElementById('leadScrewPitch').value);
-            
-            if (!isNaN(stepsRev) && !isNaN(microsteps) && !isNaN(pitch) && pitch > 0) {
-                const result = (stepsRev * microsteps) / pitch;
-                document.getElementById('calculatedSteps').textContent = result.toFixed(2);
-            }
-        }
+    if (body.indexOf("\"countsPerRev\":") >= 0) {
+      int start = body.indexOf("\"countsPerRev\":") + 15;
+      int end = body.indexOf(",", start);
+      if (end == -1) end = body.indexOf("}", start);
+      newCpr = body.substring(start, end).toFloat();
+    }
 
-        // ===== CALIBRATION =====
-        async function applyCalibration() {
-            const stepsRev = parseFloat(document.getElementById('stepsPerRev').value);
-            const microsteps = parseFloat(document.getElementById('microsteps').value);
-            const pitch = parseFloat(document.getElementById('leadScrewPitch').value);
-            const speedMin = parseFloat(document.getElementById('speedMin').value);
-            const speedMax = parseFloat(document.getElementById('speedMax').value);
-            const speedDefault = parseFloat(document.getElementById('speedDefault').value);
-            const speedHome = parseFloat(document.getElementById('speedHome').value);
+    if (body.indexOf("\"warnMm\":") >= 0) {
+      int start = body.indexOf("\"warnMm\":") + 9;
+      int end = body.indexOf(",", start);
+      if (end == -1) end = body.indexOf("}", start);
+      newWarn = body.substring(start, end).toFloat();
+    }
 
-            if (isNaN(stepsRev) || isNaN(microsteps) || isNaN(pitch) || 
-                isNaN(speedMin) || isNaN(speedMax) || isNaN(speedDefault) || isNaN(speedHome)) {
-                alert('❌ Valeurs invalides');
-                return;
-            }
+    if (body.indexOf("\"faultMm\":") >= 0) {
+      int start = body.indexOf("\"faultMm\":") + 10;
+      int end = body.indexOf(",", start);
+      if (end == -1) end = body.indexOf("}", start);
+      newFault = body.substring(start, end).toFloat();
+    }
 
-            if (speedMin >= speedMax) {
-                alert('❌ Vitesse min doit être < max');
-                return;
-            }
+    if (newCpr <= 0 || newWarn <= 0 || newFault <= newWarn) {
+      server.send(400, "application/json", "{\"error\":\"invalid_encoder\"}");
+      return;
+    }
 
-            if (speedDefault < speedMin || speedDefault > speedMax) {
-                alert('❌ Vitesse par défaut doit être entre min et max');
-                return;
-            }
+    ENCODER_ENABLED = newEnabled;
+    ENCODER_COUNTS_PER_REV = newCpr;
+    FOLLOWING_WARN_MM = newWarn;
+    FOLLOWING_FAULT_MM = newFault;
+    calculateStepsPerMm();
+    saveConfig();
 
-            const stepsPerMm = ((stepsRev * microsteps) / pitch).toFixed(2);
+    if (ENCODER_ENABLED) encoderBegin();
+    encoderSync();
 
-            if (!confirm('⚠️ Appliquer cette configuration?\n\n' +
-                `Steps/mm: ${stepsPerMm}\n` +
-                `Vitesses: ${speedMin} - ${speedMax} mm/min\n` +
-                `Défaut: ${speedDefault} mm/min\n\n` +
-                'Le moteur sera arrêté et remis à 0.')) {
-                return;
-            }
+    logToFile("Codeur " + String(ENCODER_ENABLED ? "ON" : "OFF") + ", seuil " + String(FOLLOWING_FAULT_MM, 3) + "mm");
+    server.send(200, "application/json", "{\"status\":\"encoder_updated\"}");
+  });
 
-            const result = await apiCall('calibration', {
-                stepsPerRev: stepsRev,
-                microsteps: microsteps,
-                pitch: pitch,
-                speedMin: speedMin,
-                speedMax: speedMax,
-                speedDefault: speedDefault,
-                speedHome: speedHome
-            });
+  // ===== API ENGRENAGE =====
+  server.on("/api/gear", HTTP_GET, []() {
+    server.sendHeader("Access-Control-Allow-Origin", "*");
+    String json = "{";
+    json += "\"active\":" + String(gearActive ? "true" : "false") + ",";
+    json += "\"num\":" + String(GEAR_NUM) + ",";
+    json += "\"den\":" + String(GEAR_DEN) + ",";
+    json += "\"filterMs\":" + String(GEAR_FILTER_MS, 2) + ",";
+    json += "\"faultMm\":" + String(GEAR_FAULT_MM, 3) + ",";
+    json += "\"master\":" + String(gearStarted ? gearCount() : 0) + ",";
+    json += "\"command\":" + String(gear.command) + ",";
+    json += "\"limited\":" + String(gear.limited ? "true" : "false") + ",";
+    json += "\"error\":" + String(gear.error / STEPS_PER_MM, 3) + ",";
+    json += "\"peakError\":" + String(gear.peakError / STEPS_PER_MM, 3) + ",";
+    json += "\"inputRate\":" + String(gear.inputRate, 0) + ",";
+    json += "\"peakInputRate\":" + String(gear.peakInputRate, 0) + ",";
+    json += "\"limitHits\":" + String(gearLimitHits) + ",";
+    json += "\"faults\":" + String(gearFaults);
+    json += "}";
+    server.send(200, "application/json", json);
+  });
 
-            if (result && result.status === 'calibration_updated') {
-                alert(`✅ Configuration sauvegardée!\n\nSteps/mm: ${result.stepsPerMm}`);
-                document.getElementById('speedInput').value = speedDefault;
-                document.getElementById('speedInput').min = speedMin;
-                document.getElementById('speedInput').max = speedMax;
-                updateStatus();
-            }
-        }
+  // {"action":"engage"|"disengage"}; désengager arrête l'axe sur place,
+  // à faire maître arrêté
+  server.on("/api/gear", HTTP_POST, []() {
+    server.sendHeader("Access-Control-Allow-Origin", "*");
+    String body = server.arg("plain");
 
-        async function loadCalibration() {
-            const result = await apiCall('calibration');
-            if (result) {
-                document.getElementById('stepsPerRev').value = result.stepsPerRev;
-                document.getElementById('microsteps').value = result.microsteps;
-                document.getElementById('leadScrewPitch').value = result.pitch;
-                document.getElementById('speedMin').value = result.speedMin;
-                document.getElementById('speedMax').value = result.speedMax;
-                document.getElementById('speedDefault').value = result.speedDefault;
-                document.getElementById('speedHome').value = result.speedHome;
-                
-                document.getElementById('speedInput').min = result.speedMin;
-                document.getElementById('speedInput').max = result.speedMax;
-                document.getElementById('speedInput').value = result.speedDefault;
-                
-                updateCalculatedSteps();
-            }
-        }
+    if (body.indexOf("\"action\":\"engage\"") >= 0) {
+      if (!gearEngage()) {
+        server.send(409, "application/json", "{\"error\":\"motor_running\"}");
+        return;
+      }
+      logToFile("Engrenage engagé " + String(GEAR_NUM) + "/" + String(GEAR_DEN));
+    } else if (body.indexOf("\"action\":\"disengage\"") >= 0) {
+      if (gearActive) {
+        stopMotor();
+        journalRecord(JOURNAL_STOP, 0, 0);
+        logToFile("Engrenage désengagé");
+      }
+    } else {
+      server.send(400, "application/json", "{\"error\":\"invalid_action\"}");
+      return;
+    }
+
+    server.send(200, "application/json", "{\"status\":\"gear_updated\",\"active\":" + String(gearActive ? "true" : "false") + "}");
+  });
+
+  server.on("/api/gear/config", HTTP_POST, []() {
+    server.sendHeader("Access-Control-Allow-Origin", "*");
+
+    if (!adminUnlocked) {
+      server.send(403, "application/json", "{\"error\":\"admin_locked\"}");
+      return;
+    }
+    if (gearActive) {
+      server.send(409, "application/json", "{\"error\":\"motor_running\"}");
+      return;
+    }
 
-        // ===== CONTRÔLES MOTEUR =====
-        async function moveDistance() {
-            const distance = parseFloat(document.getElementById('distanceInput').value);
-            const speed = parseFloat(document.getElementById('speedInput').value);
-            
-            if (isNaN(distance) || distance === 0) {
-                alert('Distance invalide');
-                return;
-            }
-            
-            await apiCall('move', { distance: distance, speed: speed });
-        }
+    String body = server.arg("plain");
 
-        async function moveForward() {
-            const speed = parseFloat(document.getElementById('speedInput').value);
-            await apiCall('move', { continuous: true, direction: 1, speed: speed });
-        }
+    long newNum = GEAR_NUM;
+    long newDen = GEAR_DEN;
+    float newFilter = GEAR_FILTER_MS;
+    float newFault = GEAR_FAULT_MM;
 
-        async function moveBackward() {
-            const speed = parseFloat(document.getElementById('speedInput').value);
-            await apiCall('move', { continuous: true, direction: -1, speed: speed });
-        }
+    if (body.indexOf("\"num\":") >= 0) {
+      int start = body.indexOf("\"num\":") + 6;
+      int end = body.indexOf(",", start);
+      if (end == -1) end = body.indexOf("}", start);
+      newNum = body.substring(start, end).toInt();
+    }
 
-        async function stopMotor() {
-            await apiCall('stop', { action: 'stop' });
-        }
+    if (body.indexOf("\"den\":") >= 0) {
+      int start = body.indexOf("\"den\":") + 6;
+      int end = body.indexOf(",", start);
+      if (end == -1) end = body.indexOf("}", start);
+      newDen = body.substring(start, end).toInt();
+    }
 
-        async function homeMotor() {
-            if (confirm('Retourner à la position 0mm ?')) {
-                await apiCall('home', { action: 'home' });
-            }
-        }
+    if (body.indexOf("\"filterMs\":") >= 0) {
+      int start = body.indexOf("\"filterMs\":") + 11;
+      int end = body.indexOf(",", start);
+      if (end == -1) end = body.indexOf("}", start);
+      newFilter = body.substring(start, end).toFloat();
+    }
 
-        async function resetPosition() {
-            if (confirm('Définir la position actuelle comme 0mm ?')) {
-                await apiCall('reset', { action: 'reset' });
-            }
-        }
+    if (body.indexOf("\"faultMm\":") >= 0) {
+      int start = body.indexOf("\"faultMm\":") + 10;
+      int end = body.indexOf(",", start);
+      if (end == -1) end = body.indexOf("}", start);
+      newFault = body.substring(start, end).toFloat();
+    }
 
-        async function updateSpeedNow() {
-            const speed = parseFloat(document.getElementById('speedInput').value);
-            const status = await apiCall('status');
-            const speedMin = status ? status.speedMin : 50;
-            const speedMax = status ? status.speedMax : 2000;
-            
-            if (isNaN(speed) || speed < speedMin || speed > speedMax) {
-                alert(`Vitesse invalide! (${speedMin}-${speedMax} mm/min)`);
-                return;
-            }
-            
-            const result = await apiCall('speed', { speed: speed });
-            if (result && result.status === 'speed_updated') {
-                alert(`✅ Vitesse: ${speed} mm/min`);
-            }
-        }
+    // Rapport borné: le produit impulsions × num reste sur 64 bits
+    if (newNum == 0 || labs(newNum) > 10000 || newDen < 1 || newDen > 10000 ||
+        newFilter < 0 || newFilter > 100 || newFault <= 0) {
+      server.send(400, "application/json", "{\"error\":\"invalid_gear\"}");
+      return;
+    }
 
-        // ===== LIMITES =====
-        async function setLimits() {
-            const min = parseFloat(document.getElementById('limitMin').value);
-            const max = parseFloat(document.getElementById('limitMax').value);
-            
-            if (min >= max) {
-                alert('Min doit être < Max');
-                return;
-            }
-            
-            await apiCall('limits', { min: min, max: max });
-        }
+    GEAR_NUM = newNum;
+    GEAR_DEN = newDen;
+    GEAR_FILTER_MS = newFilter;
+    GEAR_FAULT_MM = newFault;
+    saveConfig();
 
-        async function toggleLimits() {
-            await apiCall('limits/toggle', { action: 'toggle' });
-        }
+    logToFile("Engrenage " + String(GEAR_NUM) + "/" + String(GEAR_DEN) + ", lissage " + String(GEAR_FILTER_MS, 1) + "ms");
+    server.send(200, "application/json", "{\"status\":\"gear_config_updated\"}");
+  });
 
-        // ===== LOGS =====
-        async function loadLogs() {
-            try {
-                const response = await fetch('/api/logs');
-                const text = await response.text();
-                const logsDiv = document.getElementById('logs');
-                
-                if (text && text.length > 0) {
-                    logsDiv.innerHTML = text.replace(/\n/g, '<br>');
-                    logsDiv.scrollTop = logsDiv.scrollHeight;
-                } else {
-                    logsDiv.innerHTML = '<em>Aucun log</em>';
-                }
-            } catch (error) {
-                document.getElementById('logs').innerHTML = 'Erreur: ' + error.message;
-            }
-        }
+  // ===== API PVT =====
+  server.on("/api/pvt", HTTP_GET, []() {
+    server.sendHeader("Access-Control-Allow-Origin", "*");
+    String json = "{";
+    json += "\"active\":" + String(pvtActive ? "true" : "false") + ",";
+    json += "\"queued\":" + String(pvt.count) + ",";
+    json += "\"free\":" + String(pvt.space()) + ",";
+    json += "\"accepted\":" + String(pvtAccepted) + ",";
+    json += "\"rejected\":" + String(pvtRejected) + ",";
+    json += "\"segments\":" + String(pvt.segments) + ",";
+    json += "\"underruns\":" + String(pvt.underruns) + ",";
+    json += "\"faults\":" + String(pvtFaults) + ",";
+    json += "\"maxLag\":" + String(pvtMaxLag / STEPS_PER_MM, 3);
+    json += "}";
+    server.send(200, "application/json", json);
+  });
 
-        async function clearLogs() {
-            if (!confirm('⚠️ Effacer tous les logs?\nIrréversible!')) {
-                return;
-            }
-            
-            try {
-                const response = await fetch('/api/logs/clear', { method: 'POST' });
-                const result = await response.json();
-                
-                if (result.status === 'cleared') {
-                    alert('✅ Logs effacés');
-                    loadLogs();
-                }
-            } catch (error) {
-                alert('Erreur: ' + error.message);
-            }
-        }
+  // {"points":[[mm,mm/min,ms],...]} ajoute à la file (absolu, durée depuis
+  // le point précédent); {"action":"start"|"stop"|"clear"}. La réponse
+  // donne les points acceptés et la place libre: le client n'envoie la
+  // suite qu'une fois la place revenue (contrôle de flux).
+  server.on("/api/pvt", HTTP_POST, []() {
+    server.sendHeader("Access-Control-Allow-Origin", "*");
+    String body = server.arg("plain");
 
-        // ===== STATUT =====
-        async function updateStatus() {
-            const status = await apiCall('status');
-            if (status) {
-                document.getElementById('status').textContent = status.running ? 'En mouvement' : 'Arrêté';
-                document.getElementById('status').className = 'status-value ' + (status.running ? 'running' : 'stopped');
-                document.getElementById('position').textContent = status.position.toFixed(3);
-                document.getElementById('target').textContent = status.target.toFixed(3);
-                document.getElementById('speed').textContent = status.speed.toFixed(0);
-                document.getElementById('stepsPerMm').textContent = status.stepsPerMm.toFixed(2);
-                document.getElementById('limitsStatus').textContent = status.limitsEnabled ? 'Activées' : 'Désactivées';
-                document.getElementById('limitsStatus').style.color = status.limitsEnabled ? '#28a745' : '#dc3545';
-                
-                const speedInput = document.getElementById('speedInput');
-                if (speedInput && status.speedMin && status.speedMax) {
-                    speedInput.min = status.speedMin;
-                    speedInput.max = status.speedMax;
-                }
-            }
+    int accepted = 0;
+    int at = body.indexOf("\"points\":");
+    if (at >= 0) {
+      at = body.indexOf('[', at) + 1;
+      while (at > 0) {
+        int open = body.indexOf('[', at);
+        int close = open >= 0 ? body.indexOf(']', open) : -1;
+        if (open < 0 || close < 0) break;
+        int comma1 = body.indexOf(',', open);
+        int comma2 = body.indexOf(',', comma1 + 1);
+        if (comma1 < 0 || comma2 < 0 || comma2 > close) {
+          server.send(400, "application/json", "{\"error\":\"invalid_point\",\"accepted\":" + String(accepted) + "}");
+          return;
         }
-
-        // ===== API =====
-        async function apiCall(endpoint, data = null) {
-            try {
-                const config = { method: data ? 'POST' : 'GET' };
-                if (data) {
-                    config.headers = { 'Content-Type': 'application/json' };
-                    config.body = JSON.stringify(data);
-                }
-                const response = await fetch('/api/' + endpoint, config);
-                if (!response.ok) throw new Error(`HTTP ${response.status}`);
-                const result = await response.json();
-                return result;
-            } catch (error) {
-                console.error('Erreur API:', error);
-                alert('Erreur: ' + error.message);
-                return null;
-            }
+        float position = body.substring(open + 1, comma1).toFloat();
+        float speed = body.substring(comma1 + 1, comma2).toFloat();
+        float duration = body.substring(comma2 + 1, close).toFloat();
+        if (pvt.space() == 0) break;
+        if (!pvtQueue(position, speed, duration)) {
+          server.send(400, "application/json", "{\"error\":\"invalid_point\",\"accepted\":" + String(accepted) + "}");
+          return;
         }
+        accepted++;
+        at = close + 1;
+      }
+    }
 
-        // ===== INITIALISATION =====
-        setInterval(updateStatus, 300);
-        setTimeout(() => {
-            updateStatus();
-            updateCalculatedSteps();
-            
-            apiCall('calibration').then(result => {
-                if (result) {
-                    const speedInput = document.getElementById('speedInput');
-                    if (speedInput) {
-                        speedInput.min = result.speedMin;
-                        speedInput.max = result.speedMax;
-                        speedInput.value = result.speedDefault;
-                    }
-                }
-            });
-        }, 500);
-    </script>
-</body>
-</html>
-)rawliteral";
-    server.send(200, "text/html", html);
+    int64_t startAt = parseStartAt(body);
+    if (body.indexOf("\"action\":\"start\"") >= 0 && startAt != 0) {
+      if (isRunning || pvt.count == 0) {
+        server.send(409, "application/json", isRunning ? "{\"error\":\"motor_running\"}" : "{\"error\":\"empty_stream\"}");
+        return;
+      }
+      String error = scheduleStart(startAt, START_PVT, 0, 0, 1);
+      if (error.length() > 0) {
+        server.send(error == "not_synced" ? 409 : 400, "application/json", "{\"error\":\"" + error + "\"}");
+        return;
+      }
+    } else if (body.indexOf("\"action\":\"start\"") >= 0) {
+      if (!pvtStart()) {
+        server.send(409, "application/json", isRunning ? "{\"error\":\"motor_running\"}" : "{\"error\":\"empty_stream\"}");
+        return;
+      }
+      logToFile("PVT démarré");
+    } else if (body.indexOf("\"action\":\"stop\"") >= 0) {
+      if (pvtActive) {
+        stopMotor();
+        journalRecord(JOURNAL_STOP, 0, 0);
+      }
+    } else if (body.indexOf("\"action\":\"clear\"") >= 0) {
+      if (!pvtActive) pvt.clear();
+    } else if (at < 0) {
+      server.send(400, "application/json", "{\"error\":\"invalid_action\"}");
+      return;
+    }
+
+    String json = "{\"accepted\":" + String(accepted) + ",";
+    json += "\"queued\":" + String(pvt.count) + ",";
+    json += "\"free\":" + String(pvt.space()) + ",";
+    json += "\"active\":" + String(pvtActive ? "true" : "false") + "}";
+    server.send(200, "application/json", json);
   });
 
-  // ===== API STATUS =====
-  server.on("/api/status", HTTP_GET, []() {
+  // ===== API SYNCHRONISATION =====
+  // Horloge de référence pour les départs programmés ("startAt" de
+  // /api/move et /api/pvt); la référence se règle par /api/network.
+  server.on("/api/sync", HTTP_GET, []() {
     server.sendHeader("Access-Control-Allow-Origin", "*");
     String json = "{";
-    json += "\"running\":" + String(isRunning ? "true" : "false") + ",";
-    json += "\"position\":" + String(currentPosition, 3) + ",";
-    json += "\"target\":" + String(targetPosition, 3) + ",";
-    json += "\"speed\":" + String(currentSpeed) + ",";
-    json += "\"steps\":" + String(stepper.currentPosition()) + ",";
-    json += "\"remaining\":" + String(stepper.distanceToGo()) + ",";
-    json += "\"stepsPerMm\":" + String(STEPS_PER_MM, 2) + ",";
-    json += "\"speedMin\":" + String(SPEED_MIN) + ",";
-    json += "\"speedMax\":" + String(SPEED_MAX) + ",";
-    json += "\"speedDefault\":" + String(SPEED_DEFAULT) + ",";
-    json += "\"limitsEnabled\":" + String(SOFT_LIMITS_ENABLED ? "true" : "false");
+    json += "\"nowUs\":" + String((double)syncNowUs(), 0) + ",";
+    json += "\"reference\":" + String(syncIsReference() ? "true" : "false") + ",";
+    json += "\"master\":\"" + SYNC_MASTER + "\",";
+    json += "\"synced\":" + String(syncReady() ? "true" : "false") + ",";
+    json += "\"errorUs\":" + String(syncIsReference() ? 0 : clockSync.errorUs) + ",";
+    json += "\"offsetUs\":" + String((double)clockSync.offset(esp_timer_get_time()), 0) + ",";
+    json += "\"driftPpm\":" + String(-clockSync.rate * 1e6, 2) + ",";
+    json += "\"exchanges\":" + String(clockSync.exchanges) + ",";
+    json += "\"restarts\":" + String(clockSync.restarts) + ",";
+    json += "\"served\":" + String(syncServed) + ",";
+    json += "\"rejected\":" + String(syncRejected + clockSync.rejected) + ",";
+    json += "\"pending\":" + String(pendingStart != START_NONE ? "true" : "false") + ",";
+    json += "\"pendingAt\":" + String((double)pendingStartAt, 0) + ",";
+    json += "\"starts\":" + String(scheduledStarts) + ",";
+    json += "\"missed\":" + String(scheduledMissed) + ",";
+    json += "\"lateLastUs\":" + String(startLateLastUs) + ",";
+    json += "\"lateMaxUs\":" + String(startLateMaxUs);
     json += "}";
     server.send(200, "application/json", json);
   });
 
-  // ===== API ADMIN UNLOCK =====
-  server.on("/api/admin/unlock", HTTP_POST, []() {
+  // ===== API RÉSEAU =====
+  server.on("/api/network", HTTP_GET, []() {
     server.sendHeader("Access-Control-Allow-Origin", "*");
-    String body = server.arg("plain");
+    bool staConnected = WiFi.status() == WL_CONNECTED;
+    String json = "{";
+    json += "\"staSsid\":\"" + STA_SSID + "\",";
+    json += "\"staConnected\":" + String(staConnected ? "true" : "false") + ",";
+    json += "\"staIp\":\"" + (staConnected ? WiFi.localIP().toString() : String("")) + "\",";
+    json += "\"mqttHost\":\"" + MQTT_HOST + "\",";
+    json += "\"mqttPort\":" + String(MQTT_PORT) + ",";
+    json += "\"mqttBase\":\"" + MQTT_BASE + "\",";
+    json += "\"syncMaster\":\"" + SYNC_MASTER + "\",";
+    json += "\"mqttConnected\":" + String(mqttSession ? "true" : "false") + ",";
+    json += "\"mqttPublished\":" + String(mqttPublished) + ",";
+    json += "\"mqttDropped\":" + String(mqttDropped) + ",";
+    json += "\"mqttCommands\":" + String(mqttCommands);
+    json += "}";
+    server.send(200, "application/json", json);
+  });
 
-    String password = "";
-    if (body.indexOf("\"password\":\"") >= 0) {
-      int start = body.indexOf("\"password\":\"") + 12;
+  // {"staSsid":"atelier","staPassword":"...","mqttHost":"10.0.0.5","mqttPort":1883,"mqttBase":"axe1"}
+  // SSID vide: point d'accès seul. Hôte vide: MQTT désactivé.
+  server.on("/api/network", HTTP_POST, []() {
+    server.sendHeader("Access-Control-Allow-Origin", "*");
+
+    if (!adminUnlocked) {
+      server.send(403, "application/json", "{\"error\":\"admin_locked\"}");
+      return;
+    }
+
+    String body = server.arg("plain");
+    auto stringField = [&body](const char* key, String& value) {
+      String pattern = "\"" + String(key) + "\":\"";
+      int start = body.indexOf(pattern);
+      if (start < 0) return;
+      start += pattern.length();
       int end = body.indexOf("\"", start);
-      password = body.substring(start, end);
+      if (end >= start) value = body.substring(start, end);
+    };
+
+    String newSsid = STA_SSID;
+    String newPassword = STA_PASSWORD;
+    String newHost = MQTT_HOST;
+    String newBase = MQTT_BASE;
+    long newPort = MQTT_PORT;
+    stringField("staSsid", newSsid);
+    stringField("staPassword", newPassword);
+    stringField("mqttHost", newHost);
+    stringField("mqttBase", newBase);
+    String newSyncMaster = SYNC_MASTER;
+    stringField("syncMaster", newSyncMaster);
+
+    if (body.indexOf("\"mqttPort\":") >= 0) {
+      int start = body.indexOf("\"mqttPort\":") + 11;
+      int end = body.indexOf(",", start);
+      if (end == -1) end = body.indexOf("}", start);
+      newPort = body.substring(start, end).toInt();
     }
 
-    if (password == admin_password) {
-      adminUnlocked = true;
-      Serial.println("✅ Admin déverrouillé");
-      logToFile("Admin déverrouillé");
-      server.send(200, "application/json", "{\"status\":\"unlocked\"}");
-    } else {
-      Serial.println("❌ Mot de passe incorrect");
-      logToFile("Tentative accès admin échouée");
-      server.send(403, "application/json", "{\"status\":\"wrong_password\"}");
+    // Les topics sont composés dans des tampons de 64 octets
+    if (newPort < 1 || newPort > 65535 || newBase.length() == 0 || newBase.length() > 40 ||
+        newBase.indexOf('+') >= 0 || newBase.indexOf('#') >= 0 || newSsid.length() > 32) {
+      server.send(400, "application/json", "{\"error\":\"invalid_network\"}");
+      return;
+    }
+
+    bool staChanged = newSsid != STA_SSID || newPassword != STA_PASSWORD;
+    STA_SSID = newSsid;
+    STA_PASSWORD = newPassword;
+    MQTT_HOST = newHost;
+    MQTT_PORT = newPort;
+    MQTT_BASE = newBase;
+    if (newSyncMaster != SYNC_MASTER) {
+      SYNC_MASTER = newSyncMaster;
+      clockSync.reset();
+      syncPending = false;
+    }
+    saveConfig();
+
+    if (staChanged) {
+      WiFi.disconnect();
+      WiFi.mode(STA_SSID.length() > 0 ? WIFI_AP_STA : WIFI_AP);
+      if (STA_SSID.length() > 0) WiFi.begin(STA_SSID.c_str(), STA_PASSWORD.c_str());
+    }
+    mqttDisconnect();
+    mqttLastAttempt = 0;
+
+    logToFile("Réseau: station '" + STA_SSID + "', MQTT " + (MQTT_HOST.length() > 0 ? MQTT_HOST : String("désactivé")));
+    server.send(200, "application/json", "{\"status\":\"network_updated\"}");
+  });
+
+  // ===== API PLANIFICATION =====
+  // Estimation sans mouvement: {"moves":[{"distance":10,"speed":300},...]}
+  // ou un seul déplacement {"distance":10,"speed":300}
+  server.on("/api/plan", HTTP_POST, []() {
+    server.sendHeader("Access-Control-Allow-Origin", "*");
+    String body = server.arg("plain");
+
+    String json = "{\"moves\":[";
+    float position = (float)stepper.currentPosition() / STEPS_PER_MM;
+    // Sens d'approche suivi d'un déplacement à l'autre: une inversion
+    // ajoute le rattrapage du jeu à la rampe, comme RampStepper::moveTo()
+    long lash = stepper.backlash();
+    long lashOffset = stepper.backlashOffset();
+    unsigned long totalUs = 0;
+    int count = 0;
+    int cursor = 0;
+
+    while (count < 1000) {
+      int start = body.indexOf("\"distance\":", cursor);
+      if (start < 0) break;
+      int end = body.indexOf("}", start);
+      if (end < 0) end = body.length();
+      String item = body.substring(start, end);
+      cursor = end;
+
+      float distance = 0;
+      float speed = SPEED_DEFAULT;
+      int s = item.indexOf("\"distance\":") + 11;
+      int e = item.indexOf(",", s);
+      if (e == -1) e = item.length();
+      distance = item.substring(s, e).toFloat();
+
+      if (item.indexOf("\"speed\":") >= 0) {
+        s = item.indexOf("\"speed\":") + 8;
+        e = item.indexOf(",", s);
+        if (e == -1) e = item.length();
+        speed = item.substring(s, e).toFloat();
+      }
+
+      long steps = (long)(distance * STEPS_PER_MM);
+      int dir = steps > 0 ? 1 : -1;
+      long takeup = steps == 0 ? 0 : MovePlanner::takeup(lashOffset, lash, dir);
+      MovePlan plan = planMove(steps, (speed * STEPS_PER_MM) / 60.0, takeup);
+      if (steps != 0) lashOffset = MovePlanner::offsetAfter(lash, dir);
+      position += distance;
+      totalUs += plan.totalUs;
+
+      if (count > 0) json += ",";
+      json += "{\"steps\":" + String(plan.steps) + ",";
+      json += "\"backlashSteps\":" + String(plan.backlashSteps) + ",";
+      json += "\"durationMs\":" + String(plan.totalUs / 1000.0, 3) + ",";
+      json += "\"accelMs\":" + String(plan.accelUs / 1000.0, 3) + ",";
+      json += "\"cruiseMs\":" + String(plan.cruiseUs / 1000.0, 3) + ",";
+      json += "\"decelMs\":" + String(plan.decelUs / 1000.0, 3) + ",";
+      json += "\"settleMs\":" + String(plan.settleUs / 1000.0, 3) + ",";
+      json += "\"peakSpeed\":" + String(plan.peakSpeed / STEPS_PER_MM * 60.0, 1) + ",";
+      json += "\"withinLimits\":" + String(checkLimits(position) ? "true" : "false") + "}";
+      count++;
     }
-  });
 
-  // ===== API ADMIN LOCK =====
-  server.on("/api/admin/lock", HTTP_POST, []() {
-    server.sendHeader("Access-Control-Allow-Origin", "*");
-    adminUnlocked = false;
-    Serial.println("🔒 Admin verrouillé");
-    logToFile("Admin verrouillé");
-    server.send(200, "application/json", "{\"status\":\"locked\"}");
+    if (count == 0) {
+      server.send(400, "application/json", "{\"error\":\"no_moves\"}");
+      return;
+    }
+
+    json += "],\"totalMs\":" + String(totalUs / 1000.0, 3) + "}";
+    server.send(200, "application/json", json);
   });
 
-  // ===== API CALIBRATION GET =====
-  server.on("/api/calibration", HTTP_GET, []() {
+  // ===== API MISE EN FORME =====
+  server.on("/api/shaper", HTTP_GET, []() {
     server.sendHeader("Access-Control-Allow-Origin", "*");
+    const char* names[] = { "none", "zv", "zvd", "ei" };
     String json = "{";
-    json += "\"stepsPerRev\":" + String(STEPS_PER_REVOLUTION, 1) + ",";
-    json += "\"microsteps\":" + String(MICROSTEPS, 1) + ",";
-    json += "\"pitch\":" + String(LEAD_SCREW_PITCH, 2) + ",";
-    json += "\"stepsPerMm\":" + String(STEPS_PER_MM, 2) + ",";
-    json += "\"speedMin\":" + String(SPEED_MIN, 0) + ",";
-    json += "\"speedMax\":" + String(SPEED_MAX, 0) + ",";
-    json += "\"speedDefault\":" + String(SPEED_DEFAULT, 0) + ",";
-    json += "\"speedHome\":" + String(SPEED_HOME, 0);
+    json += "\"type\":\"" + String(names[SHAPER_TYPE]) + "\",";
+    json += "\"frequency\":" + String(SHAPER_FREQ, 1) + ",";
+    json += "\"damping\":" + String(SHAPER_DAMPING, 3) + ",";
+    json += "\"accelFactor\":" + String(ACCEL_FACTOR, 2);
     json += "}";
     server.send(200, "application/json", json);
   });
 
-  // ===== API CALIBRATION POST =====
-  server.on("/api/calibration", HTTP_POST, []() {
+  // {"type":"zvd","frequency":35,"damping":0.1,"accelFactor":6}
+  server.on("/api/shaper", HTTP_POST, []() {
     server.sendHeader("Access-Control-Allow-Origin", "*");
-    
+
     if (!adminUnlocked) {
-      Serial.println("❌ Accès refusé");
       server.send(403, "application/json", "{\"error\":\"admin_locked\"}");
       return;
     }
-    
-    String body = server.arg("plain");
-    stopMotor();
-
-    float newStepsRev = STEPS_PER_REVOLUTION;
-    float newMicrosteps = MICROSTEPS;
-    float newPitch = LEAD_SCREW_PITCH;
-    float newSpeedMin = SPEED_MIN;
-    float newSpeedMax = SPEED_MAX;
-    float newSpeedDefault = SPEED_DEFAULT;
-    float newSpeedHome = SPEED_HOME;
-
-    // Parse JSON
-    if (body.indexOf("\"stepsPerRev\":") >= 0) {
-      int start = body.indexOf("\"stepsPerRev\":") + 14;
-      int end = body.indexOf(",", start);
-      if (end == -1) end = body.indexOf("}", start);
-      newStepsRev = body.substring(start, end).toFloat();
+    if (isRunning) {
+      server.send(409, "application/json", "{\"error\":\"motor_running\"}");
+      return;
     }
 
-    if (body.indexOf("\"microsteps\":") >= 0) {
-      int start = body.indexOf("\"microsteps\":") + 13;
-      int end = body.indexOf(",", start);
-      if (end == -1) end = body.indexOf("}", start);
-      newMicrosteps = body.substring(start, end).toFloat();
-    }
+    String body = server.arg("plain");
 
-    if (body.indexOf("\"pitch\":") >= 0) {
-      int start = body.indexOf("\"pitch\":") + 8;
-      int end = body.indexOf(",", start);
-      if (end == -1) end = body.indexOf("}", start);
-      newPitch = body.substring(start, end).toFloat();
-    }
+    int newType = SHAPER_TYPE;
+    float newFreq = SHAPER_FREQ;
+    float newDamping = SHAPER_DAMPING;
+    float newAccelFactor = ACCEL_FACTOR;
 
-    if (body.indexOf("\"speedMin\":") >= 0) {
-      int start = body.indexOf("\"speedMin\":") + 11;
-      int end = body.indexOf(",", start);
-      if (end == -1) end = body.indexOf("}", start);
-      newSpeedMin = body.substring(start, end).toFloat();
-    }
+    if (body.indexOf("\"type\":\"none\"") >= 0) newType = SHAPER_NONE;
+    if (body.indexOf("\"type\":\"zv\"") >= 0) newType = SHAPER_ZV;
+    if (body.indexOf("\"type\":\"zvd\"") >= 0) newType = SHAPER_ZVD;
+    if (body.indexOf("\"type\":\"ei\"") >= 0) newType = SHAPER_EI;
 
-    if (body.indexOf("\"speedMax\":") >= 0) {
-      int start = body.indexOf("\"speedMax\":") + 11;
+    if (body.indexOf("\"frequency\":") >= 0) {
+      int start = body.indexOf("\"frequency\":") + 12;
       int end = body.indexOf(",", start);
       if (end == -1) end = body.indexOf("}", start);
-      newSpeedMax = body.substring(start, end).toFloat();
+      newFreq = body.substring(start, end).toFloat();
     }
 
-    if (body.indexOf("\"speedDefault\":") >= 0) {
-      int start = body.indexOf("\"speedDefault\":") + 15;
+    if (body.indexOf("\"damping\":") >= 0) {
+      int start = body.indexOf("\"damping\":") + 10;
       int end = body.indexOf(",", start);
       if (end == -1) end = body.indexOf("}", start);
-      newSpeedDefault = body.substring(start, end).toFloat();
+      newDamping = body.substring(start, end).toFloat();
     }
 
-    if (body.indexOf("\"speedHome\":") >= 0) {
-      int start = body.indexOf("\"speedHome\":") + 12;
+    if (body.indexOf("\"accelFactor\":") >= 0) {
+      int start = body.indexOf("\"accelFactor\":") + 14;
       int end = body.indexOf(",", start);
       if (end == -1) end = body.indexOf("}", start);
-      newSpeedHome = body.substring(start, end).toFloat();
+      newAccelFactor = body.substring(start, end).toFloat();
     }
 
-    // Validation
-    if (newStepsRev <= 0 || newMicrosteps <= 0 || newPitch <= 0) {
-      server.send(400, "application/json", "{\"error\":\"invalid_calibration\"}");
+    if (newFreq < 1 || newFreq > 500 || newDamping < 0 || newDamping >= 0.5 ||
+        newAccelFactor < 0.5 || newAccelFactor > 100) {
+      server.send(400, "application/json", "{\"error\":\"invalid_shaper\"}");
       return;
     }
 
-    if (newSpeedMin <= 0 || newSpeedMax <= 0 || newSpeedMin >= newSpeedMax) {
-      server.send(400, "application/json", "{\"error\":\"invalid_speed\"}");
+    int oldType = SHAPER_TYPE;
+    float oldFreq = SHAPER_FREQ;
+    float oldDamping = SHAPER_DAMPING;
+    SHAPER_TYPE = newType;
+    SHAPER_FREQ = newFreq;
+    SHAPER_DAMPING = newDamping;
+
+    // Retard total limité par l'historique du générateur (~130 ms)
+    if (!configureShaper()) {
+      SHAPER_TYPE = oldType;
+      SHAPER_FREQ = oldFreq;
+      SHAPER_DAMPING = oldDamping;
+      configureShaper();
+      server.send(400, "application/json", "{\"error\":\"frequency_too_low\"}");
       return;
     }
 
-    // Appliquer
-    STEPS_PER_REVOLUTION = newStepsRev;
-    MICROSTEPS = newMicrosteps;
-    LEAD_SCREW_PITCH = newPitch;
-    SPEED_MIN = newSpeedMin;
-    SPEED_MAX = newSpeedMax;
-    SPEED_DEFAULT = newSpeedDefault;
-    SPEED_HOME = newSpeedHome;
-    
+    ACCEL_FACTOR = newAccelFactor;
     calculateStepsPerMm();
+    profilesDerive();
     saveConfig();
 
-    stepper.setCurrentPosition(0);
-    currentPosition = 0.0;
-    targetPosition = 0.0;
-    currentSpeed = SPEED_DEFAULT;
-
-    Serial.println("✅ Configuration appliquée");
-    logToFile("Config: " + String(STEPS_PER_MM, 2) + " steps/mm");
+    logToFile("Shaper " + String(SHAPER_TYPE) + " " + String(SHAPER_FREQ, 1) + "Hz, accel x" + String(ACCEL_FACTOR, 1));
+    server.send(200, "application/json", "{\"status\":\"shaper_updated\"}");
+  });
 
-    String json = "{";
-    json += "\"status\":\"calibration_updated\",";
-    json += "\"stepsPerMm\":" + String(STEPS_PER_MM, 2) + ",";
-    json += "\"speedDefault\":" + String(SPEED_DEFAULT, 0);
-    json += "}";
-    
+  // ===== API ÉVÉNEMENTS SUR POSITION =====
+  server.on("/api/events", HTTP_GET, []() {
+    server.sendHeader("Access-Control-Allow-Origin", "*");
+    String json = "{\"events\":[";
+    for (int i = 0; i < positionEventCount; i++) {
+      PositionEvent& event = positionEvents[i];
+      if (i > 0) json += ",";
+      json += "{\"pos\":" + String(event.positionMm, 3) + ",";
+      json += "\"steps\":" + String(event.steps) + ",";
+      json += "\"pin\":" + String(event.pin) + ",";
+      json += "\"pulse\":" + String(event.pulseUs) + ",";
+      json += "\"dir\":" + String(event.dirFilter) + ",";
+      json += "\"fired\":" + String(event.fired) + "}";
+    }
+    json += "]}";
     server.send(200, "application/json", json);
   });
 
-  // ===== API MOVE =====
-  server.on("/api/move", HTTP_POST, []() {
+  // Remplace toute la table: {"events":[{"pos":12.5,"pin":21,"pulse":500,"dir":1},...]}
+  server.on("/api/events", HTTP_POST, []() {
     server.sendHeader("Access-Control-Allow-Origin", "*");
     String body = server.arg("plain");
 
-    float speed = SPEED_DEFAULT;
-    float distance = 0;
-    int direction = 1;
-    bool continuous = false;
-
-    if (body.indexOf("\"speed\":") >= 0) {
-      int start = body.indexOf("\"speed\":") + 8;
-      int end = body.indexOf(",", start);
-      if (end == -1) end = body.indexOf("}", start);
-      speed = body.substring(start, end).toFloat();
-    }
-
-    if (body.indexOf("\"distance\":") >= 0) {
-      int start = body.indexOf("\"distance\":") + 11;
-      int end = body.indexOf(",", start);
-      if (end == -1) end = body.indexOf("}", start);
-      distance = body.substring(start, end).toFloat();
-    }
-
-    if (body.indexOf("\"direction\":") >= 0) {
-      int start = body.indexOf("\"direction\":") + 12;
-      int end = body.indexOf(",", start);
-      if (end == -1) end = body.indexOf("}", start);
-      direction = body.substring(start, end).toInt();
+    if (isRunning) {
+      server.send(409, "application/json", "{\"error\":\"motor_running\"}");
+      return;
     }
 
-    if (body.indexOf("\"continuous\":true") >= 0) {
-      continuous = true;
+    PositionEvent parsed[MAX_POSITION_EVENTS];
+    int count = 0;
+    int cursor = body.indexOf("\"events\":[");
+    if (cursor < 0) {
+      server.send(400, "application/json", "{\"error\":\"invalid_events\"}");
+      return;
     }
 
-    if (isRunning) {
-      stepper.stop();
-      while (stepper.isRunning()) {
-        stepper.run();
+    while (true) {
+      int start = body.indexOf("{", cursor);
+      if (start < 0) break;
+      int end = body.indexOf("}", start);
+      if (end < 0) break;
+      if (count >= MAX_POSITION_EVENTS) {
+        server.send(400, "application/json", "{\"error\":\"too_many_events\"}");
+        return;
       }
-    }
 
-    isRunning = false;
-    movingToTarget = false;
-    continuousMode = false;
-    currentPosition = (float)stepper.currentPosition() / STEPS_PER_MM;
-    currentSpeed = speed;
-
-    float speedStepsPerSec = (speed * STEPS_PER_MM) / 60.0;
+      String item = body.substring(start, end + 1);
+      PositionEvent& event = parsed[count];
+      event.positionMm = 0;
+      event.pin = 255;
+      event.pulseUs = 1000;
+      event.dirFilter = EVENT_DIR_BOTH;
+      event.fired = 0;
+
+      if (item.indexOf("\"pos\":") >= 0) {
+        int s = item.indexOf("\"pos\":") + 6;
+        int e = item.indexOf(",", s);
+        if (e == -1) e = item.indexOf("}", s);
+        event.positionMm = item.substring(s, e).toFloat();
+      }
+      if (item.indexOf("\"pin\":") >= 0) {
+        int s = item.indexOf("\"pin\":") + 6;
+        int e = item.indexOf(",", s);
+        if (e == -1) e = item.indexOf("}", s);
+        event.pin = item.substring(s, e).toInt();
+      }
+      if (item.indexOf("\"pulse\":") >= 0) {
+        int s = item.indexOf("\"pulse\":") + 8;
+        int e = item.indexOf(",", s);
+        if (e == -1) e = item.indexOf("}", s);
+        event.pulseUs = item.substring(s, e).toInt();
+      }
+      if (item.indexOf("\"dir\":") >= 0) {
+        int s = item.indexOf("\"dir\":") + 6;
+        int e = item.indexOf(",", s);
+        if (e == -1) e = item.indexOf("}", s);
+        event.dirFilter = constrain(item.substring(s, e).toInt(), -1, 1);
+      }
 
-    if (continuous) {
-      continuousMode = true;
-      moveDirection = direction;
-      stepper.setMaxSpeed(speedStepsPerSec * 2);
-      stepper.setSpeed(direction > 0 ? speedStepsPerSec : -speedStepsPerSec);
-      isRunning = true;
-      logToFile("Continu " + String(direction > 0 ? "avant" : "arrière"));
-      server.send(200, "application/json", "{\"status\":\"continuous\"}");
-    } else {
-      float newTarget = currentPosition + distance;
-      if (!checkLimits(newTarget)) {
-        server.send(400, "application/json", "{\"error\":\"limit_exceeded\"}");
+      // Broches 0-31 (registre out_w1ts), hors flash (6-11), moteur et codeur
+      bool validPin = event.pin < 32 && (event.pin < 6 || event.pin > 11) &&
+                      event.pin != PULSE_PIN && event.pin != DIR_PIN &&
+                      !(ENCODER_ENABLED && (event.pin == ENCODER_A_PIN || event.pin == ENCODER_B_PIN));
+      if (!validPin || event.pulseUs < 10 || event.pulseUs > 1000000) {
+        server.send(400, "application/json", "{\"error\":\"invalid_event\",\"index\":" + String(count) + "}");
         return;
       }
 
-      stepper.setMaxSpeed(speedStepsPerSec);
-      stepper.setAcceleration(speedStepsPerSec * 2);
-      long steps = (long)(distance * STEPS_PER_MM);
-      stepper.move(steps);
-      targetPosition = newTarget;
-      movingToTarget = true;
-      isRunning = true;
-      logToFile("Distance " + String(distance) + "mm");
-      server.send(200, "application/json", "{\"status\":\"moving\"}");
+      event.mask = 1UL << event.pin;
+      count++;
+      cursor = end + 1;
+    }
+
+    // Couper les impulsions éventuellement en cours de l'ancienne table
+    for (int i = 0; i < positionEventCount; i++) {
+#ifdef ARDUINO
+      esp_timer_stop(positionEventTimers[i]);
+#endif
+      digitalWrite(positionEvents[i].pin, LOW);
+    }
+
+    for (int i = 0; i < count; i++) {
+      pinMode(parsed[i].pin, OUTPUT);
+      digitalWrite(parsed[i].pin, LOW);
+      positionEvents[i] = parsed[i];
     }
+    positionEventCount = count;
+    positionEventsRebuild();
+
+    logToFile("Événements position: " + String(count));
+    server.send(200, "application/json", "{\"status\":\"events_updated\",\"count\":" + String(count) + "}");
   });
 
-  // ===== API SPEED =====
-  server.on("/api/speed", HTTP_POST, []() {
+  // ===== API TRACE =====
+  // {"action":"start"|"arm"|"stop", "decimation":N, "ring":true}
+  server.on("/api/trace", HTTP_POST, []() {
     server.sendHeader("Access-Control-Allow-Origin", "*");
     String body = server.arg("plain");
 
-    float newSpeed = SPEED_DEFAULT;
-    if (body.indexOf("\"speed\":") >= 0) {
-      int start = body.indexOf("\"speed\":") + 8;
+    if (body.indexOf("\"decimation\":") >= 0) {
+      int start = body.indexOf("\"decimation\":") + 13;
       int end = body.indexOf(",", start);
       if (end == -1) end = body.indexOf("}", start);
-      newSpeed = body.substring(start, end).toFloat();
+      long decimation = body.substring(start, end).toInt();
+      if (decimation < 1 || decimation > 10000) {
+        server.send(400, "application/json", "{\"error\":\"invalid_decimation\"}");
+        return;
+      }
+      traceDecimation = decimation;
     }
 
-    float newSpeedSteps = (newSpeed * STEPS_PER_MM) / 60.0;
-    currentSpeed = newSpeed;
-
-    if (continuousMode && isRunning) {
-      stepper.setMaxSpeed(newSpeedSteps * 2);
-      float finalSpeed = moveDirection > 0 ? newSpeedSteps : -newSpeedSteps;
-      stepper.setSpeed(finalSpeed);
-    } else if (movingToTarget && isRunning) {
-      stepper.setMaxSpeed(newSpeedSteps);
-      stepper.setAcceleration(newSpeedSteps * 2);
+    if (body.indexOf("\"ring\":true") >= 0) traceRing = true;
+    if (body.indexOf("\"ring\":false") >= 0) traceRing = false;
+
+    if (body.indexOf("\"action\":\"start\"") >= 0) {
+      traceStart();
+    } else if (body.indexOf("\"action\":\"arm\"") >= 0) {
+      traceRecording = false;
+      traceArmed = true;
+    } else if (body.indexOf("\"action\":\"stop\"") >= 0) {
+      traceRecording = false;
+      traceArmed = false;
     }
 
-    logToFile("Vitesse: " + String(newSpeed) + "mm/min");
-    server.send(200, "application/json", "{\"status\":\"speed_updated\",\"speed\":" + String(newSpeed) + "}");
+    server.send(200, "application/json", "{\"status\":\"trace_updated\",\"recording\":" + String(traceRecording ? "true" : "false") + ",\"armed\":" + String(traceArmed ? "true" : "false") + "}");
   });
 
-  // ===== API STOP =====
-  server.on("/api/stop", HTTP_POST, []() {
+  server.on("/api/trace/status", HTTP_GET, []() {
     server.sendHeader("Access-Control-Allow-Origin", "*");
-    stopMotor();
-    logToFile("ARRÊT");
-    server.send(200, "application/json", "{\"status\":\"stopped\"}");
+    String json = "{";
+    json += "\"recording\":" + String(traceRecording ? "true" : "false") + ",";
+    json += "\"armed\":" + String(traceArmed ? "true" : "false") + ",";
+    json += "\"ring\":" + String(traceRing ? "true" : "false") + ",";
+    json += "\"decimation\":" + String(traceDecimation) + ",";
+    json += "\"count\":" + String(traceCount) + ",";
+    json += "\"dropped\":" + String(traceDropped) + ",";
+    json += "\"capacity\":" + String(TRACE_CAPACITY);
+    json += "}";
+    server.send(200, "application/json", json);
   });
 
-  // ===== API HOME =====
-  server.on("/api/home", HTTP_POST, []() {
+  // Téléchargement binaire: TraceHeader puis les échantillons du plus ancien au plus récent
+  server.on("/api/trace", HTTP_GET, []() {
     server.sendHeader("Access-Control-Allow-Origin", "*");
+    traceRecording = false;
+    traceArmed = false;
+
+    TraceHeader header;
+    header.magic = TRACE_MAGIC;
+    header.version = TRACE_VERSION;
+    header.sampleSize = sizeof(TraceSample);
+    header.count = traceCount;
+    header.dropped = traceDropped;
+    header.stepsPerMm = STEPS_PER_MM;
+    header.decimation = traceDecimation;
+    header.reserved = 0;
+
+    uint32_t first = (traceHead + TRACE_CAPACITY - traceCount) % TRACE_CAPACITY;
+    uint32_t firstPart = min(traceCount, TRACE_CAPACITY - first);
+
+    server.setContentLength(sizeof(header) + traceCount * sizeof(TraceSample));
+    server.send(200, "application/octet-stream", "");
+    server.sendContent((const char*)&header, sizeof(header));
+    server.sendContent((const char*)&traceBuffer[first], firstPart * sizeof(TraceSample));
+    if (firstPart < traceCount) {
+      server.sendContent((const char*)&traceBuffer[0], (traceCount - firstPart) * sizeof(TraceSample));
+    }
+  });
 
-    currentPosition = (float)stepper.currentPosition() / STEPS_PER_MM;
-    float distanceToHome = -currentPosition;
+  // ===== API JOURNAL =====
+  // {"action":"start"|"stop"|"clear"}; start vide l'anneau
+  server.on("/api/journal", HTTP_POST, []() {
+    server.sendHeader("Access-Control-Allow-Origin", "*");
+    String body = server.arg("plain");
 
-    if (abs(distanceToHome) < 0.001) {
-      server.send(200, "application/json", "{\"status\":\"already_home\"}");
+    if (body.indexOf("\"action\":\"start\"") >= 0) {
+      journalClear();
+      journalRecording = true;
+      logToFile("Journal démarré");
+    } else if (body.indexOf("\"action\":\"stop\"") >= 0) {
+      journalRecording = false;
+    } else if (body.indexOf("\"action\":\"clear\"") >= 0) {
+      journalClear();
+    } else {
+      server.send(400, "application/json", "{\"error\":\"invalid_action\"}");
       return;
     }
 
-    stopMotor();
-    delay(10);
+    server.send(200, "application/json", "{\"status\":\"journal_updated\",\"recording\":" + String(journalRecording ? "true" : "false") + "}");
+  });
 
-    float homeSpeed = (SPEED_HOME * STEPS_PER_MM) / 60.0;
-    stepper.setMaxSpeed(homeSpeed);
-    stepper.setAcceleration(homeSpeed * 2);
+  // ===== API ODOMÈTRE =====
+  server.on("/api/odometer", HTTP_GET, []() {
+    server.sendHeader("Access-Control-Allow-Origin", "*");
+    server.send(200, "application/json", odometerJson());
+  });
 
-    long steps = (long)(distanceToHome * STEPS_PER_MM);
-    stepper.move(steps);
+  // {"action":"save"} écrit tout de suite (avant une coupure prévue);
+  // {"action":"reset"} remet à zéro après un remplacement de vis ou moteur
+  server.on("/api/odometer", HTTP_POST, []() {
+    server.sendHeader("Access-Control-Allow-Origin", "*");
+    String body = server.arg("plain");
 
-    targetPosition = 0.0;
-    movingToTarget = true;
-    isRunning = true;
-    currentSpeed = SPEED_HOME;
+    if (body.indexOf("\"action\":\"save\"") >= 0) {
+      odometerSave();
+    } else if (body.indexOf("\"action\":\"reset\"") >= 0) {
+      if (!adminUnlocked) {
+        server.send(403, "application/json", "{\"error\":\"admin_locked\"}");
+        return;
+      }
+      odometer.fold(STEPS_PER_MM, millis());
+      uint32_t saves = odometer.totals.saves;
+      odometer.totals = OdometerTotals();
+      odometer.totals.saves = saves;
+      odometerSave();
+      logToFile("Odomètre remis à zéro");
+    } else {
+      server.send(400, "application/json", "{\"error\":\"invalid_action\"}");
+      return;
+    }
 
-    logToFile("Retour origine");
-    server.send(200, "application/json", "{\"status\":\"homing\"}");
+    server.send(200, "application/json", odometerJson());
   });
 
-  // ===== API RESET =====
-  server.on("/api/reset", HTTP_POST, []() {
+  server.on("/api/journal/status", HTTP_GET, []() {
     server.sendHeader("Access-Control-Allow-Origin", "*");
-    stopMotor();
-    stepper.setCurrentPosition(0);
-    currentPosition = 0.0;
-    targetPosition = 0.0;
-    logToFile("Position reset");
-    server.send(200, "application/json", "{\"status\":\"reset\"}");
+    String json = "{";
+    json += "\"recording\":" + String(journalRecording ? "true" : "false") + ",";
+    json += "\"count\":" + String(journalCount) + ",";
+    json += "\"dropped\":" + String(journalDropped) + ",";
+    json += "\"capacity\":" + String(JOURNAL_CAPACITY);
+    json += "}";
+    server.send(200, "application/json", json);
   });
 
-  // ===== API LIMITS =====
-  server.on("/api/limits", HTTP_POST, []() {
+  // Téléchargement binaire: JournalHeader puis les entrées de la plus
+  // ancienne à la plus récente. L'enregistrement continue.
+  server.on("/api/journal", HTTP_GET, []() {
     server.sendHeader("Access-Control-Allow-Origin", "*");
-    String body = server.arg("plain");
-
-    float newMin = SOFT_LIMIT_MIN;
-    float newMax = SOFT_LIMIT_MAX;
 
-    if (body.indexOf("\"min\":") >= 0) {
-      int start = body.indexOf("\"min\":") + 6;
-      int end = body.indexOf(",", start);
-      if (end == -1) end = body.indexOf("}", start);
-      newMin = body.substring(start, end).toFloat();
+    JournalHeader header;
+    header.magic = JOURNAL_MAGIC;
+    header.version = JOURNAL_VERSION;
+    header.entrySize = sizeof(JournalEntry);
+    header.count = journalCount;
+    header.dropped = journalDropped;
+    header.stepsPerMm = STEPS_PER_MM;
+    header.accelFactor = ACCEL_FACTOR;
+    header.speedHome = SPEED_HOME;
+    header.limitMin = SOFT_LIMIT_MIN;
+    header.limitMax = SOFT_LIMIT_MAX;
+    header.limitsEnabled = SOFT_LIMITS_ENABLED ? 1 : 0;
+    header.shaperType = SHAPER_TYPE;
+    header.reserved = 0;
+
+    uint32_t first = (journalHead + JOURNAL_CAPACITY - journalCount) % JOURNAL_CAPACITY;
+    uint32_t firstPart = min(journalCount, JOURNAL_CAPACITY - first);
+
+    server.sendHeader("Content-Disposition", "attachment; filename=\"journal.bin\"");
+    server.setContentLength(sizeof(header) + journalCount * sizeof(JournalEntry));
+    server.send(200, "application/octet-stream", "");
+    server.sendContent((const char*)&header, sizeof(header));
+    server.sendContent((const char*)&journalBuffer[first], firstPart * sizeof(JournalEntry));
+    if (firstPart < journalCount) {
+      server.sendContent((const char*)&journalBuffer[0], (journalCount - firstPart) * sizeof(JournalEntry));
     }
+  });
 
-    if (body.indexOf("\"max\":") >= 0) {
-      int start = body.indexOf("\"max\":") + 6;
-      int end = body.indexOf(",", start);
-      if (end == -1) end = body.indexOf("}", start);
-      newMax = body.substring(start, end).toFloat();
-    }
+  // ===== API DIAGNOSTICS =====
+  // Envoyé par morceaux: la réponse complète ferait plusieurs ko de String
+  server.on("/api/diagnostics", HTTP_GET, []() {
+    server.sendHeader("Access-Control-Allow-Origin", "*");
+    server.setContentLength(CONTENT_LENGTH_UNKNOWN);
+    server.send(200, "application/json", "");
 
-    if (newMin < newMax) {
-      SOFT_LIMIT_MIN = newMin;
-      SOFT_LIMIT_MAX = newMax;
-      logToFile("Limites: " + String(newMin) + " à " + String(newMax));
-      server.send(200, "application/json", "{\"status\":\"limits_updated\"}");
-    } else {
-      server.send(400, "application/json", "{\"error\":\"invalid_limits\"}");
+    String json = "{";
+    json += "\"uptimeMs\":" + String(millis() - sessionStart) + ",";
+    json += "\"resetReason\":\"" + String(resetReasonName()) + "\",";
+    json += "\"heap\":{";
+    json += "\"size\":" + String(ESP.getHeapSize()) + ",";
+    json += "\"free\":" + String(ESP.getFreeHeap()) + ",";
+    json += "\"minFree\":" + String(ESP.getMinFreeHeap()) + ",";
+    json += "\"largestBlock\":" + String(ESP.getMaxAllocHeap()) + "},";
+    json += "\"loop\":{";
+    json += "\"minUs\":" + String(diagLoopCount > 0 ? diagLoopMin : 0) + ",";
+    json += "\"avgUs\":" + String(diagLoopCount > 0 ? (uint32_t)(diagLoopSum / diagLoopCount) : 0) + ",";
+    json += "\"maxUs\":" + String(diagLoopMax) + ",";
+    json += "\"maxEverUs\":" + String(diagLoopMaxEver) + ",";
+    json += "\"overruns\":" + String(loopOverruns) + "},";
+    char bootPhases[BOOT_PHASES * 96];
+    bootProfile.json(bootPhases, sizeof(bootPhases));
+    json += "\"boot\":{\"setupUs\":" + String(bootSetupUs) + ",\"phases\":" + String(bootPhases) + "},";
+    int modbusConnected = 0;
+    for (int i = 0; i < MODBUS_MAX_CLIENTS; i++) {
+      if (modbusClients[i].client.connected()) modbusConnected++;
+    }
+    json += "\"modbus\":{\"clients\":" + String(modbusConnected) + ",";
+    json += "\"requests\":" + String(modbusSlave.requests) + ",";
+    json += "\"exceptions\":" + String(modbusSlave.exceptions) + "},";
+    json += "\"odometer\":" + odometerJson() + ",";
+    json += "\"admission\":{\"budgetUs\":" + String(MOTION_BUDGET_US) + ",";
+    json += "\"windowUs\":" + String(MOTION_BUDGET_WINDOW_US) + ",";
+    json += "\"rejected\":" + String(admission.rejected) + ",";
+    json += "\"shed\":" + String(admissionShed) + ",";
+    json += "\"fastStops\":" + String(admission.fastStops) + ",";
+    json += "\"fastStopLastUs\":" + String(admission.fastStopLastUs) + ",";
+    json += "\"fastStopMaxUs\":" + String(admission.fastStopMaxUs) + ",";
+    json += "\"estops\":" + String(estopCount) + "},";
+    json += "\"captive\":{\"dnsQueries\":" + String(captiveDns.queries) + ",";
+    json += "\"dnsAnswered\":" + String(captiveDns.answered) + ",";
+    json += "\"dnsEmpty\":" + String(captiveDns.empty) + ",";
+    json += "\"dnsIgnored\":" + String(captiveDns.ignored) + ",";
+    json += "\"dnsMaxBatch\":" + String(captiveDnsMaxBatch) + ",";
+    json += "\"dnsSendErrors\":" + String(captiveDnsSendErrors) + ",";
+    json += "\"probesFast\":" + String(captiveProbesFast) + ",";
+    json += "\"probesSlow\":" + String(captiveProbesSlow) + ",";
+    json += "\"redirects\":" + String(captiveRedirects) + "},";
+    server.sendContent(json);
+
+    // Marge de pile minimale (octets) des tâches connues
+    static const char* const tasks[] = { "loopTask", "tiT", "wifi", "esp_timer", "IDLE0", "IDLE1" };
+    json = "\"stacks\":[";
+    bool first = true;
+    for (const char* name : tasks) {
+      TaskHandle_t task = xTaskGetHandle(name);
+      if (task == NULL) continue;
+      if (!first) json += ",";
+      first = false;
+      json += "{\"task\":\"" + String(name) + "\",\"freeMin\":" + String(uxTaskGetStackHighWaterMark(task)) + "}";
+    }
+    json += "],\"routes\":[";
+    server.sendContent(json);
+
+    for (int i = 0; i < routeCount; i++) {
+      const RouteStats& route = routeStats[i];
+      json = i > 0 ? "," : "";
+      json += "{\"uri\":\"" + String(route.uri) + "\",";
+      json += "\"method\":" + String((int)route.method) + ",";
+      json += "\"hits\":" + String(route.hits) + ",";
+      json += "\"avgUs\":" + String(route.hits > 0 ? (uint32_t)(route.totalUs / route.hits) : 0) + ",";
+      json += "\"maxUs\":" + String(route.maxUs) + ",";
+      json += "\"bytesRetained\":" + String(route.bytesRetained) + ",";
+      json += "\"blocksRetained\":" + String(route.blocksRetained) + ",";
+      json += "\"freeHeapLow\":" + String(route.hits > 0 ? route.freeHeapLow : 0) + "}";
+      server.sendContent(json);
     }
-  });
 
-  // ===== API LIMITS TOGGLE =====
-  server.on("/api/limits/toggle", HTTP_POST, []() {
-    server.sendHeader("Access-Control-Allow-Origin", "*");
-    SOFT_LIMITS_ENABLED = !SOFT_LIMITS_ENABLED;
-    logToFile("Limites " + String(SOFT_LIMITS_ENABLED ? "ON" : "OFF"));
-    server.send(200, "application/json", "{\"status\":\"" + String(SOFT_LIMITS_ENABLED ? "enabled" : "disabled") + "\"}");
+    // Historique, du plus ancien au plus récent: [t, libre, min, bloc, boucle moy, boucle max]
+    server.sendContent("],\"history\":[");
+    for (int i = 0; i < diagCount; i++) {
+      const DiagSample& sample = diagHistory[(diagHead - diagCount + i + DIAG_HISTORY) % DIAG_HISTORY];
+      json = i > 0 ? ",[" : "[";
+      json += String(sample.uptimeMs) + "," + String(sample.freeHeap) + ",";
+      json += String(sample.minFreeHeap) + "," + String(sample.largestBlock) + ",";
+      json += String(sample.loopAvgUs) + "," + String(sample.loopMaxUs) + "]";
+      server.sendContent(json);
+    }
+    server.sendContent("]}");
+    server.sendContent("");
   });
 
   // ===== API LOGS =====
@@ -1228,24 +6585,55 @@ void setupWebServer() {
 // ===== LOOP =====
 
 void loop() {
-  dnsServer.processNextRequest();
-  server.handleClient();
+  diagLoopTick();
+  if (odometer.tick(millis(), isRunning, STEPS_PER_MM)) odometerSave();
+  handleSerial();
+  if (networkReady) {
+    stopFastPath();
+    if (!startImminent()) {
+      handleJogUdp();
+      handleSyncUdp();
+      handleModbus();
+      handleMqtt();
+      captiveDnsPoll();
+      server.handleClient();
+    }
+  } else if (wifiReady) {
+    startNetworkServices();
+  }
+  updateFeedOverride();
+  checkFollowingError();
+  checkEmergencyStop();  // Juste avant le pas: aucun pas après l'interruption
+  runPendingStart();
 
   if (isRunning) {
-    if (continuousMode) {
-      stepper.runSpeed();
+    if (gearActive) {
+      gearFollow();
+      currentPosition = (float)stepper.currentPosition() / STEPS_PER_MM;
+    } else if (pvtActive) {
+      pvtFollow();
+    } else if (continuousMode) {
+      long before = stepper.currentPosition();
+      stepper.run();
+      if (jogCmdMicros != 0 && stepper.currentPosition() != before) {
+        jogLatencyLast = micros() - jogCmdMicros;
+        jogLatencyMax = max(jogLatencyMax, jogLatencyLast);
+        jogCmdMicros = 0;
+      }
 
       static unsigned long lastCheck = 0;
       if (millis() - lastCheck > 100) {
         lastCheck = millis();
         currentPosition = (float)stepper.currentPosition() / STEPS_PER_MM;
 
-        if (SOFT_LIMITS_ENABLED) {
-          if ((moveDirection > 0 && currentPosition >= SOFT_LIMIT_MAX) || 
-              (moveDirection < 0 && currentPosition <= SOFT_LIMIT_MIN)) {
-            Serial.println("LIMITE ATTEINTE");
-            stopMotor();
-          }
+        // La rampe finit sur la limite logicielle; sans limites, l'horizon
+        // glisse devant l'axe
+        if (!stepper.isRunning()) {
+          Serial.println("LIMITE ATTEINTE");
+          stopMotor();
+          journalRecord(JOURNAL_LIMIT, 0, 0);
+        } else if (!SOFT_LIMITS_ENABLED) {
+          stepper.moveTo(continuousTarget(moveDirection));
         }
       }
 
@@ -1262,9 +6650,12 @@ void loop() {
           currentPosition = targetPosition;
           isRunning = false;
           movingToTarget = false;
+          journalRecord(JOURNAL_ARRIVED, 0, 0);
           logToFile("Arrivé à: " + String(currentPosition, 3) + "mm");
         }
       }
     }
   }
-}
\ No newline at end of file
+}
+
+#endif  // MOTION_CORE_ONLY
@@ -0,0 +1,332 @@
+// Vérification hôte de l'admission des requêtes (RequestAdmission dans main.c)
+//
+// Compilation: g++ -O2 -std=c++17 -o admission_check tools/admission_check.cpp
+// Usage:       admission_check [--seconds N] [--seed S]
+//
+// L'admission et le générateur de pas du firmware (main.c inclus avec
+// MOTION_CORE_ONLY) tournent sur une horloge virtuelle, comme loop(): un
+// tour toutes les 10 µs, stopFastPath() puis au plus une requête servie,
+// puis run(). Le serveur hôte reproduit DiagWebServer: la connexion
+// suivante est lue d'avance (stopRequest()), la requête servie passe par
+// classify(), routeCost(), admit() et charge() comme admitRequest() et
+// chargeRequest(); un handler bloque la boucle pendant sa durée (±20 %).
+// Trafic pendant --seconds (60) s: requêtes légères, lourdes et /api/speed
+// toutes les 3 ms en moyenne, POST /api/stop toutes les 700 ms en moyenne,
+// la moitié en deux segments; un déplacement démarre toutes les 2 s si
+// l'axe est arrêté. Contrôles:
+//  - classify(), routeCost() et stopRequest() sur des cas connus;
+//  - en mouvement, temps des handlers soumis au budget par fenêtre
+//    d'admission sous MOTION_BUDGET_US × 1.25 (durées réelles au-delà du
+//    coût estimé), et des refus (la charge dépasse le budget); une route
+//    lourde jamais servie, qui compte pour tout le budget, n'est admise
+//    que dans une fenêtre vide (fenêtre exclue de la borne); budget
+//    utilisé au moins à moitié en moyenne (la charge le remplit);
+//  - /api/stop et /api/speed jamais refusés, aucune requête refusée à
+//    l'arrêt;
+//  - chaque /api/stop arrête l'axe par stopFastPath(); arrivé en
+//    mouvement, au plus MOTION_BUDGET_US × 1.25 après sa réception
+//    complète (handler en cours et requêtes admises devant lui).
+// Code de sortie 1 si un contrôle échoue.
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <deque>
+#include <map>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "host_core.h"
+
+RampStepper<MotorDriver> stepper;
+
+void onStep(long, int) {}
+
+#define LOOP_US 10
+#define REJECT_US 80           // Envoi d'une réponse 503
+#define SPLIT_US 300           // Écart entre les deux segments d'une requête coupée
+#define LOAD_INTERVAL_US 3000
+#define STOP_INTERVAL_US 700000
+#define MOVE_PERIOD_US 2000000
+#define BUDGET_TOLERANCE 1.25
+
+struct Route {
+  const char* uri;
+  bool get;
+  uint32_t nominalUs;
+  int weight;              // Part du trafic de charge (0: hors charge)
+  uint8_t routeClass = ROUTE_NORMAL;
+  uint32_t hits = 0;
+  uint64_t totalUs = 0;
+  uint32_t maxUs = 0;
+  unsigned long rejected = 0;
+};
+
+static Route routes[] = {
+  { "/", true, 30000, 1 },
+  { "/api/logs", true, 12000, 1 },
+  { "/api/diagnostics", true, 6000, 1 },
+  { "/api/trace", true, 20000, 1 },
+  { "/api/status", true, 1500, 50 },
+  { "/api/status.bin", true, 300, 20 },
+  { "/api/speed", false, 600, 10 },
+  { "/api/stop", false, 400, 0 },
+};
+static const int ROUTE_COUNT = sizeof(routes) / sizeof(routes[0]);
+static const int STOP_ROUTE = ROUTE_COUNT - 1;
+
+struct Connection {
+  int route;
+  std::string head;
+  uint64_t arrivalUs;      // Premier segment
+  uint64_t completeUs;     // Requête entière reçue
+  bool checked;
+  uint64_t acceptedUs;     // Devenue la connexion en attente (0: pas encore)
+  bool moving;             // Axe en mouvement à l'arrivée
+};
+
+// Côté réseau de DiagWebServer: la connexion en tête de file est celle
+// acceptée d'avance, dont le début est lu sans être consommé
+struct HostServer {
+  std::deque<Connection> queue;
+
+  bool pendingStop() {
+    if (queue.empty() || queue.front().checked) return false;
+    Connection& c = queue.front();
+    if (c.acceptedUs == 0) c.acceptedUs = virtualUs;
+    int n = virtualUs >= c.completeUs ? (int)c.head.size() : 9;  // "POST /api"
+    int stop = RequestAdmission::stopRequest(c.head.data(), n);
+    if (stop < 0) return false;
+    c.checked = true;
+    return stop > 0;
+  }
+  uint32_t pendingAgeUs() { return virtualUs - queue.front().acceptedUs; }
+};
+
+static HostServer server;
+static RequestAdmission admission;
+static std::mt19937 rng;
+
+static unsigned long stopsSent = 0, exemptRejected = 0, idleRejected = 0, motionRejected = 0;
+static uint32_t longestHandlerUs = 0;
+static std::map<unsigned long, uint64_t> budgetedUs;  // Fenêtre d'admission -> temps des handlers soumis
+static std::map<unsigned long, bool> probeWindows;    // Fenêtres d'une première route lourde
+static unsigned long probes = 0, probeViolations = 0;
+static uint64_t motionUs = 0;                          // Temps passé axe en mouvement
+
+static std::vector<uint32_t> motionStopUs;  // Arrivée complète -> axe arrêté, arrivés en mouvement
+
+static void stopAxis() { stepper.setCurrentPosition(stepper.currentPosition()); }
+
+// Arrêt par stopFastPath(): la connexion en tête de file est le /api/stop
+static void fastStop() {
+  const Connection& c = server.queue.front();
+  if (c.moving) motionStopUs.push_back(virtualUs - c.completeUs);
+  stopAxis();
+}
+
+static bool budgeted(uint8_t routeClass) { return routeClass == ROUTE_NORMAL || routeClass == ROUTE_HEAVY; }
+
+// Requête servie comme l'enveloppe de DiagWebServer::instrument()
+static void serve(const Connection& c) {
+  Route& r = routes[c.route];
+  admission.stopFastPath(server, fastStop);
+  bool running = stepper.isRunning();
+  bool probe = r.routeClass == ROUTE_HEAVY && r.hits == 0;
+  uint32_t cost = RequestAdmission::routeCost(r.routeClass, r.hits, r.totalUs, r.maxUs);
+  if (!admission.admit(r.routeClass, cost, running, micros())) {
+    r.rejected++;
+    if (!budgeted(r.routeClass)) exemptRejected++;
+    if (running) motionRejected++;
+    else idleRejected++;
+    virtualUs += REJECT_US;
+    if (running) motionUs += REJECT_US;
+    admission.charge(REJECT_US, stepper.isRunning(), micros());
+    return;
+  }
+  unsigned long window = admission.windowStart;
+  if (running && probe) {
+    probes++;
+    if (admission.used != 0) probeViolations++;
+    probeWindows[window] = true;
+  }
+  std::uniform_real_distribution<double> jitter(0.8, 1.2);
+  uint32_t elapsed = (uint32_t)(r.nominalUs * jitter(rng));
+  if (c.route == STOP_ROUTE) stopAxis();
+  virtualUs += elapsed;
+  if (running) motionUs += elapsed;
+  if (running && budgeted(r.routeClass)) budgetedUs[window] += elapsed;
+  longestHandlerUs = max(longestHandlerUs, elapsed);
+  admission.charge(elapsed, stepper.isRunning(), micros());
+  r.hits++;
+  r.totalUs += elapsed;
+  r.maxUs = max(r.maxUs, elapsed);
+}
+
+static bool checkClassify() {
+  struct Case {
+    const char* uri;
+    bool get;
+    uint8_t expected;
+  } cases[] = {
+    { "/api/stop", false, ROUTE_STOP },      { "/api/speed", false, ROUTE_CONTROL },
+    { "/", true, ROUTE_HEAVY },              { "/api/logs", true, ROUTE_HEAVY },
+    { "/api/diagnostics", true, ROUTE_HEAVY }, { "/api/trace", true, ROUTE_HEAVY },
+    { "/api/trace", false, ROUTE_NORMAL },   { "/api/journal", true, ROUTE_HEAVY },
+    { "/api/journal", false, ROUTE_NORMAL }, { "/api/status", true, ROUTE_NORMAL },
+    { "/api/move", false, ROUTE_NORMAL },
+  };
+  bool ok = true;
+  for (const Case& c : cases) {
+    uint8_t got = RequestAdmission::classify(c.uri, c.get);
+    if (got != c.expected) {
+      printf("classify(%s, %s) = %d, attendu %d\n", c.uri, c.get ? "GET" : "POST", got, c.expected);
+      ok = false;
+    }
+  }
+  return ok;
+}
+
+static bool checkRouteCost() {
+  struct Case {
+    uint8_t routeClass;
+    uint32_t hits;
+    uint64_t totalUs;
+    uint32_t maxUs;
+    uint32_t expected;
+  } cases[] = {
+    { ROUTE_HEAVY, 0, 0, 0, MOTION_BUDGET_US }, { ROUTE_NORMAL, 0, 0, 0, 0 },
+    { ROUTE_HEAVY, 4, 8000, 5000, 5000 },       { ROUTE_NORMAL, 4, 8000, 5000, 2000 },
+  };
+  bool ok = true;
+  for (const Case& c : cases) {
+    uint32_t got = RequestAdmission::routeCost(c.routeClass, c.hits, c.totalUs, c.maxUs);
+    if (got != c.expected) {
+      printf("routeCost(%d, %u, %llu, %u) = %u, attendu %u\n", c.routeClass, c.hits, (unsigned long long)c.totalUs,
+             c.maxUs, got, c.expected);
+      ok = false;
+    }
+  }
+  return ok;
+}
+
+static bool checkStopRequest() {
+  struct Case {
+    const char* head;
+    int expected;
+  } cases[] = {
+    { "POST /api/stop HTTP/1.1\r\n", 1 }, { "POST /api/stop", -1 }, { "POST /api/st", -1 }, { "P", -1 },
+    { "POST /api/stopx HTTP/1.1", 0 },    { "GET /api/stop HTTP/1.1", 0 }, { "POST /api/speed HTTP/1.1", 0 },
+    { "GET /", 0 },
+  };
+  bool ok = true;
+  for (const Case& c : cases) {
+    int got = RequestAdmission::stopRequest(c.head, strlen(c.head));
+    if (got != c.expected) {
+      printf("stopRequest(\"%s\") = %d, attendu %d\n", c.head, got, c.expected);
+      ok = false;
+    }
+  }
+  return ok;
+}
+
+int main(int argc, char** argv) {
+  int seconds = 60;
+  unsigned seed = 1;
+  for (int i = 1; i < argc; i++) {
+    if (strcmp(argv[i], "--seconds") == 0 && i + 1 < argc) seconds = max(1, atoi(argv[++i]));
+    else if (strcmp(argv[i], "--seed") == 0 && i + 1 < argc) seed = atoi(argv[++i]);
+    else {
+      fprintf(stderr, "usage: admission_check [--seconds N] [--seed S]\n");
+      return 1;
+    }
+  }
+  rng.seed(seed);
+  for (Route& r : routes) r.routeClass = RequestAdmission::classify(r.uri, r.get);
+
+  bool tablesOk = checkClassify() & checkRouteCost() & checkStopRequest();
+
+  // Arrivées: charge et arrêts, triées par heure d'arrivée
+  std::vector<int> weights;
+  for (const Route& r : routes) weights.push_back(r.weight);
+  std::discrete_distribution<int> routeDist(weights.begin(), weights.end());
+  std::exponential_distribution<double> loadGap(1.0 / LOAD_INTERVAL_US), stopGap(1.0 / STOP_INTERVAL_US);
+  uint64_t end = virtualUs + (uint64_t)seconds * 1000000;
+  std::vector<Connection> arrivals;
+  for (uint64_t t = virtualUs + loadGap(rng); t < end; t += 1 + (uint64_t)loadGap(rng)) {
+    int route = routeDist(rng);
+    std::string head = std::string(routes[route].get ? "GET " : "POST ") + routes[route].uri + " HTTP/1.1\r\n";
+    arrivals.push_back({ route, head, t, t, false, 0, false });
+  }
+  for (uint64_t t = virtualUs + stopGap(rng); t + 1000000 < end; t += 1 + (uint64_t)stopGap(rng)) {
+    uint64_t complete = t + (rng() % 2 ? SPLIT_US : 0);
+    arrivals.push_back({ STOP_ROUTE, "POST /api/stop HTTP/1.1\r\n", t, complete, false, 0, false });
+    stopsSent++;
+  }
+  std::sort(arrivals.begin(), arrivals.end(),
+            [](const Connection& a, const Connection& b) { return a.arrivalUs < b.arrivalUs; });
+
+  float speed = 4000;
+  stepper.setMaxSpeed(speed);
+  stepper.setAcceleration(speed * ACCEL_FACTOR);
+  size_t next = 0;
+  uint64_t nextMove = virtualUs;
+  while (virtualUs < end) {
+    while (next < arrivals.size() && arrivals[next].arrivalUs <= virtualUs) {
+      server.queue.push_back(arrivals[next++]);
+      server.queue.back().moving = stepper.isRunning();
+    }
+    if (virtualUs >= nextMove) {
+      if (!stepper.isRunning()) stepper.move(100000000);
+      nextMove += MOVE_PERIOD_US;
+    }
+
+    admission.stopFastPath(server, fastStop);
+    // Requête servie une fois entière (DiagWebServer en HC_WAIT_READ sinon)
+    if (!server.queue.empty() && server.queue.front().completeUs <= virtualUs) {
+      Connection c = server.queue.front();
+      server.queue.pop_front();
+      serve(c);
+    }
+    stepper.run();
+    if (stepper.isRunning()) motionUs += LOOP_US;
+    virtualUs += LOOP_US;
+  }
+
+  uint64_t worstWindow = 0, budgetedTotal = 0;
+  for (const auto& w : budgetedUs) budgetedTotal += w.second;
+  double budgetUse = (double)budgetedTotal / motionUs * MOTION_BUDGET_WINDOW_US / MOTION_BUDGET_US;
+  for (const auto& w : budgetedUs) {
+    if (!probeWindows.count(w.first)) worstWindow = max(worstWindow, w.second);
+  }
+  uint32_t worstMotionStop = 0;
+  for (uint32_t us : motionStopUs) worstMotionStop = max(worstMotionStop, us);
+  uint32_t stopBound = MOTION_BUDGET_US * BUDGET_TOLERANCE;
+
+  printf("%d s, %zu requêtes, %lu arrêts, plus long handler servi %u µs\n", seconds, arrivals.size(), stopsSent,
+         longestHandlerUs);
+  printf("%-18s %8s %8s %10s\n", "route", "servies", "refusées", "coût µs");
+  for (const Route& r : routes) {
+    printf("%-18s %8u %8lu %10u\n", r.uri, r.hits, r.rejected,
+           RequestAdmission::routeCost(r.routeClass, r.hits, r.totalUs, r.maxUs));
+  }
+  printf("budget: pire fenêtre %.2f ms sur %.2f ms (tolérance × %.2f), utilisé à %.0f %%, %lu refus en mouvement\n",
+         worstWindow / 1000.0, MOTION_BUDGET_US / 1000.0, BUDGET_TOLERANCE, budgetUse * 100, motionRejected);
+  printf("premières routes lourdes admises en mouvement: %lu, hors fenêtre vide %lu\n", probes, probeViolations);
+  printf("refus à tort: %lu /api/stop ou /api/speed, %lu à l'arrêt\n", exemptRejected, idleRejected);
+  printf("arrêt rapide: %lu sur %lu, pire fastStopMaxUs %u µs\n", admission.fastStops, stopsSent,
+         admission.fastStopMaxUs);
+  printf("arrêts reçus en mouvement: %zu, pire délai réception -> arrêt %u µs (borne %u µs)\n",
+         motionStopUs.size(), worstMotionStop, stopBound);
+
+  bool ok = tablesOk && worstWindow <= MOTION_BUDGET_US * BUDGET_TOLERANCE && budgetUse >= 0.5 && motionRejected > 0 &&
+            probeViolations == 0 &&
+            exemptRejected == 0 && idleRejected == 0 && admission.fastStops == stopsSent &&
+            !motionStopUs.empty() && worstMotionStop <= stopBound;
+  printf("%s\n", ok ? "ok" : "ÉCHEC");
+  return ok ? 0 : 1;
+}
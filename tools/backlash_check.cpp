@@ -0,0 +1,260 @@
+// Vérification hôte de la compensation du jeu (RampStepper dans main.c)
+//
+// Compilation: g++ -O2 -std=c++17 -o backlash_check tools/backlash_check.cpp
+// Usage:       backlash_check [--sequences N] [--moves N] [--loop-us N] [--rtt-ms N] [--seed S]
+//
+// Le générateur du firmware (main.c inclus avec MOTION_CORE_ONLY) tourne sur
+// une horloge virtuelle avancée de --loop-us (10) par tour. Chaque pas émis
+// entraîne un modèle mécanique indépendant: vis à jeu (écart moteur - charge
+// dans [-jeu, 0]), position de la charge. --sequences (200) suites de
+// --moves (50) commandes aléatoires, jeu tiré parmi 0, 1, 7, 40 et 160 pas,
+// mise en forme ZV une fois sur deux:
+//  - déplacement depuis l'arrêt: position rapportée égale à la cible,
+//    pas moteur = distance + jeu restant à rattraper dans le nouveau sens;
+//  - changement de cible en mouvement (dépassement puis inversion): arrivée
+//    exacte sur la nouvelle cible;
+//  - stop() en mouvement: arrivée exacte sur targetPosition();
+//  - arrêt immédiat (setCurrentPosition): position logique conservée.
+// À chaque pas, la position passée à onStep() et backlashStep() doivent
+// correspondre au modèle; sans mise en forme, aucun pas d'un mouvement ne
+// doit attendre plus que le premier intervalle de rampe (pas d'arrêt au
+// rattrapage). Puis durée d'une inversion: rattrapage dans la rampe contre
+// le contournement par l'hôte (dépassement de la valeur du jeu, arrêt,
+// retour, plus un aller-retour HTTP de --rtt-ms (30)). Enfin, listes de
+// déplacements estimées comme /api/plan (MovePlanner, sens d'approche suivi
+// d'un déplacement à l'autre) puis exécutées, boucle de 1 µs: rattrapage
+// prévu égal au rattrapage mesuré, durée à moins de 1 ms.
+// Code de sortie 1 si un contrôle échoue.
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <random>
+#include <string>
+
+#include "host_core.h"
+
+RampStepper<MotorDriver> stepper;
+
+// ===== MODÈLE MÉCANIQUE =====
+
+struct Mechanism {
+  long lash = 0;
+  long motor = 0;
+  long load = 0;
+  long gap = 0;               // motor - load, dans [-lash, 0]
+  long motorSteps = 0;
+  long takeupSteps = 0;
+  long mismatches = 0;        // Position ou indicateur de rattrapage faux
+  uint64_t lastStepUs = 0;
+  uint64_t maxGapUs = 0;      // Plus long intervalle entre deux pas d'un mouvement
+};
+
+static Mechanism mech;
+
+void onStep(long position, int dir) {
+  mech.motor += dir;
+  bool takeup = dir > 0 ? mech.gap < 0 : mech.gap > -mech.lash;
+  if (takeup) {
+    mech.gap += dir;
+    mech.takeupSteps++;
+  } else {
+    mech.load += dir;
+  }
+  mech.motorSteps++;
+  if (position != mech.load || takeup != stepper.backlashStep()) mech.mismatches++;
+  if (mech.lastStepUs != 0) mech.maxGapUs = max(mech.maxGapUs, virtualUs - mech.lastStepUs);
+  mech.lastStepUs = virtualUs;
+}
+
+static uint32_t loopUs = 10;
+static int failures = 0;
+
+static void runToEnd() {
+  mech.lastStepUs = 0;
+  for (long i = 0; i < 100000000 && stepper.run(); i++) virtualUs += loopUs;
+  virtualUs += loopUs;
+}
+
+static void runFor(long iterations) {
+  for (long i = 0; i < iterations && stepper.run(); i++) virtualUs += loopUs;
+}
+
+static bool consistent() {
+  return stepper.currentPosition() == mech.load && stepper.motorPosition() == mech.motor &&
+         mech.motor - mech.load == mech.gap;
+}
+
+struct Counts {
+  long moves = 0;
+  long reversals = 0;
+  long retargets = 0;
+  long stops = 0;
+  long halts = 0;
+  long wrongEnd = 0;       // Position finale différente de la cible
+  long wrongSteps = 0;     // Pas moteur différents de distance + jeu
+  long pauses = 0;         // Intervalle au-delà du premier pas de rampe
+};
+
+// Durée (µs) d'un déplacement de n pas depuis l'arrêt, sans jeu
+static uint64_t moveDuration(long n) {
+  stepper.setBacklash(0);
+  mech.lash = 0;
+  mech.gap = 0;
+  mech.motor = mech.load = stepper.currentPosition();
+  uint64_t start = virtualUs;
+  stepper.moveTo(stepper.currentPosition() + n);
+  runToEnd();
+  return virtualUs - start;
+}
+
+int main(int argc, char** argv) {
+  int sequences = 200;
+  int moves = 50;
+  double rttMs = 30;
+  unsigned seed = 1;
+  for (int i = 1; i < argc; i++) {
+    if (strcmp(argv[i], "--sequences") == 0 && i + 1 < argc) sequences = max(1, atoi(argv[++i]));
+    else if (strcmp(argv[i], "--moves") == 0 && i + 1 < argc) moves = max(1, atoi(argv[++i]));
+    else if (strcmp(argv[i], "--loop-us") == 0 && i + 1 < argc) loopUs = max(1, atoi(argv[++i]));
+    else if (strcmp(argv[i], "--rtt-ms") == 0 && i + 1 < argc) rttMs = max(0.0, atof(argv[++i]));
+    else if (strcmp(argv[i], "--seed") == 0 && i + 1 < argc) seed = atoi(argv[++i]);
+    else {
+      fprintf(stderr, "usage: backlash_check [--sequences N] [--moves N] [--loop-us N] [--rtt-ms N] [--seed S]\n");
+      return 1;
+    }
+  }
+  std::mt19937 rng(seed);
+  std::uniform_int_distribution<long> targetDist(-5000, 5000);
+  std::uniform_int_distribution<int> kindDist(0, 9);
+  std::uniform_int_distribution<long> partDist(1, 3000);
+  static const long lashes[] = { 0, 1, 7, 40, 160 };
+
+  stepper.setMaxSpeed(4000);
+  stepper.setAcceleration(8000);
+  const int32_t zvAmp[2] = { 32768, 32768 };
+  const uint32_t zvDelay[2] = { 0, 12500 };  // ZV à 40 Hz
+  uint64_t maxRampGapUs = (stepper.interval(0) >> 8) + loopUs + 1;
+
+  Counts c;
+  for (int s = 0; s < sequences; s++) {
+    bool shaped = s % 2 == 1;
+    stepper.setShaper(shaped ? 2 : 0, zvAmp, zvDelay);
+    long lash = lashes[rng() % 5];
+    stepper.setBacklash(lash);
+    // Jeu changé à l'arrêt: même conversion que le firmware, position conservée
+    mech.lash = lash;
+    mech.gap = max(-lash, min(0L, mech.gap));
+    mech.load = stepper.currentPosition();
+    mech.motor = mech.load + mech.gap;
+    if (!consistent()) c.wrongEnd++;
+
+    for (int m = 0; m < moves; m++) {
+      int kind = kindDist(rng);
+      long target = targetDist(rng);
+      long from = stepper.currentPosition();
+      if (kind < 6) {
+        // Depuis l'arrêt: distance + jeu restant dans le sens du déplacement
+        int dir = target > from ? 1 : -1;
+        long slack = target == from ? 0 : dir > 0 ? -mech.gap : mech.gap + mech.lash;
+        long before = mech.motorSteps;
+        if (slack > 0 && mech.lash > 0) c.reversals++;
+        stepper.moveTo(target);
+        runToEnd();
+        if (mech.motorSteps - before != labs(target - from) + slack) c.wrongSteps++;
+        if (!shaped && mech.maxGapUs > maxRampGapUs) c.pauses++;
+        mech.maxGapUs = 0;
+        c.moves++;
+      } else if (kind < 8) {
+        // Nouvelle cible en mouvement, souvent derrière: inversion en route
+        stepper.moveTo(target);
+        runFor(partDist(rng));
+        target = targetDist(rng);
+        stepper.moveTo(target);
+        runToEnd();
+        mech.maxGapUs = 0;
+        c.retargets++;
+      } else if (kind < 9) {
+        stepper.moveTo(target);
+        runFor(partDist(rng));
+        stepper.stop();
+        target = stepper.targetPosition();
+        runToEnd();
+        mech.maxGapUs = 0;
+        c.stops++;
+      } else {
+        // Arrêt immédiat: les pas en attente de mise en forme sont perdus
+        stepper.moveTo(target);
+        runFor(partDist(rng));
+        long position = stepper.currentPosition();
+        stepper.setCurrentPosition(position);
+        target = position;
+        mech.maxGapUs = 0;
+        c.halts++;
+      }
+      if (stepper.currentPosition() != target || stepper.distanceToGo() != 0 || !consistent()) c.wrongEnd++;
+    }
+  }
+
+  printf("%d suites de %d commandes, boucle %u µs\n", sequences, moves, loopUs);
+  printf("%-34s %8ld  erreurs de pas: %ld, arrêts au rattrapage: %ld\n", "déplacements depuis l'arrêt", c.moves,
+         c.wrongSteps, c.pauses);
+  printf("%-34s %8ld\n", "  dont inversions avec jeu", c.reversals);
+  printf("%-34s %8ld\n", "changements de cible en mouvement", c.retargets);
+  printf("%-34s %8ld\n", "stop() en mouvement", c.stops);
+  printf("%-34s %8ld\n", "arrêts immédiats", c.halts);
+  printf("pas moteur: %ld, dont rattrapage: %ld\n", mech.motorSteps, mech.takeupSteps);
+  printf("positions finales fausses: %ld, pas non conformes au modèle: %ld\n", c.wrongEnd, mech.mismatches);
+  if (c.wrongEnd != 0 || c.wrongSteps != 0 || c.pauses != 0 || mech.mismatches != 0 || c.reversals == 0) failures++;
+
+  // Inversion de n pas avec un jeu de b pas: une rampe de n + b pas, contre
+  // n + b pas, arrêt, b pas de retour et une requête de l'hôte
+  stepper.setShaper(0, zvAmp, zvDelay);
+  printf("\n%-12s %8s %16s %18s\n", "inversion", "jeu", "rampe (ms)", "hôte (ms)");
+  const long cases[][2] = { { 100, 7 }, { 1000, 40 }, { 1000, 160 }, { 10000, 40 } };
+  for (const long* k : cases) {
+    double compensated = moveDuration(k[0] + k[1]) / 1000.0;
+    double workaround = (moveDuration(-(k[0] + k[1])) + moveDuration(k[1])) / 1000.0 + rttMs;
+    printf("%-12ld %8ld %16.1f %18.1f\n", k[0], k[1], compensated, workaround);
+  }
+
+  // Estimation d'une liste de déplacements relatifs, puis exécution
+  loopUs = 1;
+  long planReversals = 0, wrongTakeup = 0;
+  double worstMs = 0;
+  std::uniform_int_distribution<long> stepDist(-3000, 3000);
+  for (int s = 0; s < sequences / 10 + 1; s++) {
+    long lash = lashes[1 + rng() % 4];
+    stepper.setBacklash(lash);
+    mech.lash = lash;
+    mech.gap = max(-lash, min(0L, mech.gap));
+    mech.load = stepper.currentPosition();
+    mech.motor = mech.load + mech.gap;
+    long offset = stepper.backlashOffset();
+    for (int m = 0; m < moves; m++) {
+      long steps = stepDist(rng);
+      int dir = steps > 0 ? 1 : -1;
+      long takeup = steps == 0 ? 0 : MovePlanner::takeup(offset, lash, dir);
+      MovePlan plan = MovePlanner::estimate(stepper, steps, takeup, stepper.maxSpeed(), stepper.acceleration(), 0);
+      if (steps != 0) offset = MovePlanner::offsetAfter(lash, dir);
+
+      long before = mech.takeupSteps;
+      uint64_t start = virtualUs;
+      stepper.move(steps);
+      runToEnd();
+      uint64_t durationUs = steps == 0 ? 0 : mech.lastStepUs - start;
+      if (mech.takeupSteps - before != plan.backlashSteps) wrongTakeup++;
+      if (takeup > 0) planReversals++;
+      worstMs = max(worstMs, fabs((double)plan.totalUs - (double)durationUs) / 1000.0);
+    }
+  }
+  printf("\nestimation: %d listes de %d déplacements, %ld inversions\n", sequences / 10 + 1, moves, planReversals);
+  printf("rattrapages mal prévus: %ld, pire écart de durée: %.3f ms\n", wrongTakeup, worstMs);
+  if (wrongTakeup != 0 || worstMs > 1.0 || planReversals == 0) failures++;
+
+  printf("%s\n", failures == 0 ? "ok" : "ÉCHEC");
+  return failures == 0 ? 0 : 1;
+}
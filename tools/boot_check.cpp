@@ -0,0 +1,169 @@
+// Vérification hôte du profil de démarrage (BootProfile dans main.c)
+//
+// Compilation: g++ -O2 -std=c++17 -o boot_check tools/boot_check.cpp
+// Usage:       boot_check [--boots N] [--seed S]
+//
+// Le profil du firmware (main.c inclus avec MOTION_CORE_ONLY) est rempli
+// sur une horloge virtuelle dans l'ordre du firmware: config et motion dans
+// setup(), puis la tâche réseau (storage, wifi) entrelacée au hasard avec
+// les tours de loop(), qui démarre les services une fois le WiFi prêt.
+// --boots (500) démarrages, durées de phase aléatoires de 0 à 3 s.
+// Après chaque événement, relecture comme la commande série "boot" et
+// /api/diagnostics. Contrôles:
+//  - ordre: chaque phase commence après la fin de celle dont elle dépend;
+//  - durées égales aux durées simulées, 0 tant que la phase n'est pas finie;
+//  - états: "en attente" / "pending" avant le début, "en cours" /
+//    "running" pendant, durée affichée ensuite;
+//  - moteur prêt (fin de motion) dès la sortie de setup();
+//  - JSON complet (5 phases, crochets fermés) même avec des temps
+//    maximaux, dans le tampon de /api/diagnostics.
+// Code de sortie 1 si un contrôle échoue.
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <random>
+#include <string>
+
+#include "host_core.h"
+
+RampStepper<MotorDriver> stepper;
+
+void onStep(long, int) {}
+
+// Phase dont chaque phase attend la fin (-1: aucune)
+static const int dependsOn[BOOT_PHASES] = { -1, BOOT_CONFIG, BOOT_MOTION, BOOT_STORAGE, BOOT_WIFI };
+
+struct Counts {
+  long reads = 0;
+  long badOrder = 0;
+  long badDuration = 0;
+  long badLine = 0;
+  long badJson = 0;
+  long motorNotReady = 0;
+};
+
+static Counts c;
+
+// Relecture du profil pendant le démarrage: ligne série et JSON de chaque
+// phase conformes à son état
+static void readBack(const BootProfile& profile, const uint32_t* expectedUs) {
+  c.reads++;
+  char json[BOOT_PHASES * 96];
+  int length = profile.json(json, sizeof(json));
+  if (length <= 0 || length >= (int)sizeof(json) || json[0] != '[' || json[length - 1] != ']') c.badJson++;
+  for (int i = 0; i < BOOT_PHASES; i++) {
+    BootPhaseId phase = (BootPhaseId)i;
+    char line[64], expected[64], entry[128];
+    profile.line(phase, line, sizeof(line));
+    int state = profile.state[phase];
+    if (state == BOOT_PENDING) {
+      snprintf(expected, sizeof(expected), "%s: en attente", bootPhaseNames[i]);
+    } else if (state == BOOT_RUNNING) {
+      snprintf(expected, sizeof(expected), "%s: +%luus, en cours", bootPhaseNames[i],
+               (unsigned long)profile.startUs[phase]);
+    } else {
+      snprintf(expected, sizeof(expected), "%s: +%luus, %luus", bootPhaseNames[i],
+               (unsigned long)profile.startUs[phase], (unsigned long)expectedUs[i]);
+    }
+    if (strcmp(line, expected) != 0) c.badLine++;
+    snprintf(entry, sizeof(entry), "{\"name\":\"%s\",\"state\":\"%s\",\"startUs\":%lu,\"durationUs\":%lu}",
+             bootPhaseNames[i], bootStateNames[state], (unsigned long)profile.startUs[phase],
+             (unsigned long)(state == BOOT_DONE ? expectedUs[i] : 0));
+    if (!strstr(json, entry)) c.badJson++;
+    if (profile.durationUs(phase) != (state == BOOT_DONE ? expectedUs[i] : 0)) c.badDuration++;
+    if (state != BOOT_PENDING && dependsOn[i] >= 0) {
+      BootPhaseId before = (BootPhaseId)dependsOn[i];
+      if (!profile.done(before) || profile.startUs[phase] < profile.endUs[before]) c.badOrder++;
+    }
+  }
+}
+
+int main(int argc, char** argv) {
+  int boots = 500;
+  unsigned seed = 1;
+  for (int i = 1; i < argc; i++) {
+    if (strcmp(argv[i], "--boots") == 0 && i + 1 < argc) boots = max(1, atoi(argv[++i]));
+    else if (strcmp(argv[i], "--seed") == 0 && i + 1 < argc) seed = atoi(argv[++i]);
+    else {
+      fprintf(stderr, "usage: boot_check [--boots N] [--seed S]\n");
+      return 1;
+    }
+  }
+  std::mt19937 rng(seed);
+  std::uniform_int_distribution<uint32_t> phaseDist(0, 3000000);
+  std::uniform_int_distribution<uint32_t> loopDist(10, 2000);
+
+  for (int b = 0; b < boots; b++) {
+    BootProfile profile;
+    uint32_t durations[BOOT_PHASES];
+    for (int i = 0; i < BOOT_PHASES; i++) durations[i] = phaseDist(rng);
+    virtualUs = 50000 + rng() % 100000;       // Entrée dans setup()
+    readBack(profile, durations);
+
+    // setup(): phases séquentielles
+    for (int i = BOOT_CONFIG; i <= BOOT_MOTION; i++) {
+      BootPhaseId phase = (BootPhaseId)i;
+      profile.begin(phase, micros());
+      readBack(profile, durations);
+      virtualUs += durations[i];
+      profile.end(phase, micros());
+      readBack(profile, durations);
+    }
+    if (!profile.done(BOOT_MOTION)) c.motorNotReady++;
+
+    // Tâche réseau et loop() entrelacées: chaque tour fait avancer l'une
+    // ou l'autre jusqu'à l'échéance de la prochaine étape de la tâche
+    int taskStep = 0;                      // begin/end storage, begin/end wifi
+    uint64_t taskDue = virtualUs;
+    bool wifiReady = false;
+    bool networkReady = false;
+    while (!networkReady) {
+      if (taskStep < 4 && virtualUs >= taskDue) {
+        BootPhaseId phase = taskStep < 2 ? BOOT_STORAGE : BOOT_WIFI;
+        if (taskStep % 2 == 0) {
+          profile.begin(phase, micros());
+          taskDue = virtualUs + durations[phase];
+        } else {
+          profile.end(phase, micros());
+          taskDue = virtualUs;
+        }
+        if (++taskStep == 4) wifiReady = true;
+      } else if (wifiReady) {
+        profile.begin(BOOT_SERVICES, micros());
+        readBack(profile, durations);
+        virtualUs += durations[BOOT_SERVICES];
+        networkReady = true;
+        profile.end(BOOT_SERVICES, micros());
+      } else {
+        virtualUs = min(taskDue, virtualUs + loopDist(rng));   // Tour de loop()
+      }
+      readBack(profile, durations);
+    }
+    for (int i = 0; i < BOOT_PHASES; i++) {
+      if (!profile.done((BootPhaseId)i)) c.badOrder++;
+    }
+  }
+
+  // Temps maximaux: le JSON tient dans le tampon de /api/diagnostics
+  BootProfile full;
+  for (int i = 0; i < BOOT_PHASES; i++) {
+    full.begin((BootPhaseId)i, 0);
+    full.end((BootPhaseId)i, UINT32_MAX);
+  }
+  char json[BOOT_PHASES * 96];
+  int length = full.json(json, sizeof(json));
+  bool fits = length > 0 && length < (int)sizeof(json) && json[length - 1] == ']';
+  printf("JSON temps maximaux: %d / %d octets%s\n", length, (int)sizeof(json), fits ? "" : " <- tronqué");
+
+  printf("%d démarrages, %ld relectures\n", boots, c.reads);
+  printf("ordre faux: %ld, durées fausses: %ld, lignes série fausses: %ld, JSON faux: %ld, moteur non prêt: %ld\n",
+         c.badOrder, c.badDuration, c.badLine, c.badJson, c.motorNotReady);
+  bool ok = fits && c.badOrder == 0 && c.badDuration == 0 && c.badLine == 0 && c.badJson == 0 &&
+            c.motorNotReady == 0;
+  printf("%s\n", ok ? "ok" : "ÉCHEC");
+  return ok ? 0 : 1;
+}
@@ -0,0 +1,355 @@
+// Vérification hôte du portail captif (DnsResponder et CaptiveProbe dans main.c)
+//
+// Compilation: g++ -O2 -std=c++17 -pthread -o captive_check tools/captive_check.cpp
+// Usage:       captive_check [--rate Q] [--seconds S] [--loop-us N] [--seed S]
+//
+// Réponses (main.c inclus avec MOTION_CORE_ONLY):
+//  - DNS: requête A (réponse avec l'adresse de l'AP, question recopiée, ID
+//    et RD conservés), ANY, AAAA (réponse vide), requête EDNS (OPT omis),
+//    paquets refusés: trop court, nom tronqué, compression dans la question,
+//    réponse (QR = 1), opcode non standard, deux questions, plus de 512 o;
+//  - sondes: chaque adresse connue reconnue ("GET /x HTTP/1.1", "GET /x?a"),
+//    préfixes, suffixes, POST et lignes incomplètes refusés.
+// Puis tempête de requêtes sur de vrais sockets UDP locaux: un fil émet
+// --rate (150) requêtes/s par rafales de 20 pendant --seconds (2) par
+// essai (plusieurs téléphones qui s'associent), un autre reçoit les
+// réponses. La boucle simulée tourne sur le fil principal (travail de
+// --loop-us (20) µs par tour) jusqu'à la dernière réponse (1 s au plus
+// après la tempête) et relève le port:
+//  - naïf: un paquet par tour, relève à chaque tour, tampons alloués par
+//    paquet (comme DNSServer avec WiFiUDP::parsePacket());
+//  - firmware: relève espacée et lots bornés de captiveDnsPoll(), au repos
+//    et en mouvement (200 requêtes/s au plus: au-delà, la file du socket
+//    déborde et les clients DNS répètent leur requête).
+// Mesures: temps passé dans la relève par tour (moyenne, p99, max), part du
+// temps de boucle, réponses reçues, latence de réponse (p50, p99).
+// Code de sortie 1 si un contrôle de réponse échoue ou si une requête reste
+// sans réponse avec la relève du firmware.
+
+#include <algorithm>
+#include <arpa/inet.h>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fcntl.h>
+#include <netinet/in.h>
+#include <random>
+#include <string>
+#include <sys/socket.h>
+#include <thread>
+#include <unistd.h>
+#include <vector>
+
+#include "host_core.h"
+
+RampStepper<MotorDriver> stepper;
+
+void onStep(long position, int dir) {
+  (void)position;
+  (void)dir;
+}
+
+// Copies de main.c (section non incluse avec MOTION_CORE_ONLY)
+#define DNS_POLL_IDLE_MS 2
+#define DNS_POLL_MOVING_MS 20
+#define DNS_BATCH_IDLE 16
+#define DNS_BATCH_MOVING 4
+
+typedef std::chrono::steady_clock Clock;
+
+static int failures = 0;
+static const uint8_t apIp[4] = { 192, 168, 4, 1 };
+
+static void check(bool ok, const char* what) {
+  if (!ok) failures++;
+  printf("  %-46s %s\n", what, ok ? "ok" : "ÉCHEC");
+}
+
+// ===== RÉPONSES =====
+
+static std::vector<uint8_t> makeQuery(uint16_t id, const char* name, uint16_t type, bool edns = false) {
+  std::vector<uint8_t> q = { (uint8_t)(id >> 8), (uint8_t)id, 0x01, 0x00, 0, 1, 0, 0, 0, 0, 0, (uint8_t)(edns ? 1 : 0) };
+  const char* label = name;
+  while (*label) {
+    const char* dot = strchr(label, '.');
+    size_t n = dot ? (size_t)(dot - label) : strlen(label);
+    q.push_back(n);
+    q.insert(q.end(), label, label + n);
+    label += n + (dot ? 1 : 0);
+  }
+  q.push_back(0);
+  q.insert(q.end(), { (uint8_t)(type >> 8), (uint8_t)type, 0, DNS_CLASS_IN });
+  if (edns) q.insert(q.end(), { 0, 0, 41, 0x10, 0, 0, 0, 0, 0, 0, 0 });  // OPT, 4096 o
+  return q;
+}
+
+static void responses() {
+  DnsResponder dns;
+  dns.begin(apIp);
+  uint8_t out[DNS_PACKET_MAX + DNS_ANSWER_SIZE];
+  printf("réponses DNS\n");
+
+  std::vector<uint8_t> q = makeQuery(0xBEEF, "connectivitycheck.gstatic.com", DNS_TYPE_A);
+  size_t n = dns.respond(q.data(), q.size(), out);
+  size_t question = q.size() - DNS_HEADER_SIZE;
+  check(n == q.size() + DNS_ANSWER_SIZE && out[0] == 0xBE && out[1] == 0xEF && out[2] == 0x81 && out[3] == 0x80 &&
+            out[5] == 1 && out[7] == 1 && out[9] == 0 && out[11] == 0 &&
+            memcmp(out + DNS_HEADER_SIZE, q.data() + DNS_HEADER_SIZE, question) == 0 &&
+            memcmp(out + n - 4, apIp, 4) == 0 && out[q.size()] == 0xC0 && out[q.size() + 1] == 0x0C,
+        "A: adresse de l'AP, ID, RD et question");
+
+  q = makeQuery(7, "captive.apple.com", DNS_TYPE_ANY);
+  n = dns.respond(q.data(), q.size(), out);
+  check(n == q.size() + DNS_ANSWER_SIZE && out[7] == 1, "ANY: réponse A");
+
+  q = makeQuery(8, "www.msftconnecttest.com", 28);
+  n = dns.respond(q.data(), q.size(), out);
+  check(n == q.size() && out[3] == 0x80 && out[7] == 0, "AAAA: réponse vide NOERROR");
+
+  q = makeQuery(9, "detectportal.firefox.com", DNS_TYPE_A, true);
+  n = dns.respond(q.data(), q.size(), out);
+  check(n == q.size() - 11 + DNS_ANSWER_SIZE && out[7] == 1 && out[11] == 0, "EDNS: réponse A, OPT omis");
+
+  uint32_t ignoredBefore = dns.ignored;
+  q = makeQuery(10, "a.b", DNS_TYPE_A);
+  dns.respond(q.data(), 11, out);
+  std::vector<uint8_t> truncated(q.begin(), q.end() - 3);
+  dns.respond(truncated.data(), truncated.size(), out);
+  std::vector<uint8_t> pointer = q;
+  pointer[DNS_HEADER_SIZE] = 0xC0;
+  dns.respond(pointer.data(), pointer.size(), out);
+  std::vector<uint8_t> reply = q;
+  reply[2] |= 0x80;
+  dns.respond(reply.data(), reply.size(), out);
+  std::vector<uint8_t> update = q;
+  update[2] |= 5 << 3;
+  dns.respond(update.data(), update.size(), out);
+  std::vector<uint8_t> twice = q;
+  twice[5] = 2;
+  dns.respond(twice.data(), twice.size(), out);
+  std::vector<uint8_t> large(DNS_PACKET_MAX + 1, 0);
+  memcpy(large.data(), q.data(), q.size());
+  dns.respond(large.data(), large.size(), out);
+  check(dns.ignored - ignoredBefore == 7, "paquets invalides ignorés (7)");
+
+  printf("sondes HTTP\n");
+  bool all = true;
+  for (size_t i = 0; i < CAPTIVE_PROBES; i++) {
+    std::string line = std::string("GET ") + captiveProbePaths[i] + " HTTP/1.1\r\nHost: x\r\n";
+    std::string query = std::string("GET ") + captiveProbePaths[i] + "?x=1 HTTP/1.1";
+    all = all && CaptiveProbe::match(line.c_str(), line.size()) == (int)i &&
+          CaptiveProbe::match(query.c_str(), query.size()) == (int)i;
+  }
+  check(all, "adresses connues reconnues");
+  const char* refused[] = { "GET /generate_2045 HTTP/1.1", "GET /generate HTTP/1.1", "POST /generate_204 HTTP/1.1",
+                            "GET /generate_204", "GET / HTTP/1.1", "GET /api/status HTTP/1.1", "GET",
+                            "GET /ncsi.txt/x HTTP/1.1" };
+  bool none = true;
+  for (const char* line : refused) none = none && CaptiveProbe::match(line, strlen(line)) < 0;
+  check(none, "autres lignes refusées");
+}
+
+// ===== TEMPÊTE =====
+
+struct Storm {
+  double rate = 150;
+  double seconds = 2;
+  double loopUs = 20;
+};
+
+struct Result {
+  std::vector<double> pollUs;    // Temps de relève par tour
+  double loopSeconds = 0;
+  long iterations = 0;
+  long sent = 0;
+  long answered = 0;
+  std::vector<double> latencyUs;
+};
+
+static int udpSocket(uint16_t port) {
+  int fd = socket(AF_INET, SOCK_DGRAM, 0);
+  sockaddr_in addr;
+  memset(&addr, 0, sizeof(addr));
+  addr.sin_family = AF_INET;
+  addr.sin_port = htons(port);
+  addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+  if (fd < 0 || bind(fd, (sockaddr*)&addr, sizeof(addr)) < 0) {
+    perror("socket");
+    exit(1);
+  }
+  int buffer = 1 << 20;
+  setsockopt(fd, SOL_SOCKET, SO_RCVBUF, &buffer, sizeof(buffer));
+  return fd;
+}
+
+static uint16_t portOf(int fd) {
+  sockaddr_in addr;
+  socklen_t length = sizeof(addr);
+  getsockname(fd, (sockaddr*)&addr, &length);
+  return ntohs(addr.sin_port);
+}
+
+static void spin(double us) {
+  Clock::time_point end = Clock::now() + std::chrono::nanoseconds((long)(us * 1000));
+  while (Clock::now() < end) {
+  }
+}
+
+static double elapsedUs(Clock::time_point since) {
+  return std::chrono::duration<double, std::micro>(Clock::now() - since).count();
+}
+
+enum Policy { NAIVE, FIRMWARE_IDLE, FIRMWARE_MOVING };
+
+static Result storm(Policy policy, const Storm& cfg, std::mt19937& rng) {
+  int server = udpSocket(0);
+  fcntl(server, F_SETFL, O_NONBLOCK);
+  int client = udpSocket(0);
+  timeval timeout = { 0, 100000 };
+  setsockopt(client, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+  sockaddr_in to;
+  memset(&to, 0, sizeof(to));
+  to.sin_family = AF_INET;
+  to.sin_port = htons(portOf(server));
+  to.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+
+  static const char* names[] = { "connectivitycheck.gstatic.com", "captive.apple.com", "www.msftconnecttest.com",
+                                 "clients3.google.com", "detectportal.firefox.com", "nmcheck.gnome.org" };
+  const size_t total = (size_t)(cfg.rate * cfg.seconds);
+  std::vector<std::vector<uint8_t>> queries;
+  for (size_t i = 0; i < total; i++) {
+    queries.push_back(makeQuery(i, names[rng() % 6], rng() % 3 == 0 ? 28 : DNS_TYPE_A, rng() % 4 == 0));
+  }
+  std::vector<Clock::time_point> sentAt(total);
+  std::vector<double> latency(total, -1);
+  std::atomic<bool> sending(true);
+  std::atomic<size_t> received(0);
+  Clock::time_point begin = Clock::now();
+
+  std::thread sender([&]() {
+    const size_t burst = 20;
+    for (size_t i = 0; i < total; i += burst) {
+      std::this_thread::sleep_until(begin + std::chrono::microseconds((long)(i / cfg.rate * 1e6)));
+      for (size_t k = i; k < min(total, i + burst); k++) {
+        sentAt[k] = Clock::now();
+        sendto(client, queries[k].data(), queries[k].size(), 0, (sockaddr*)&to, sizeof(to));
+      }
+    }
+    sending = false;
+  });
+  std::thread receiver([&]() {
+    uint8_t buffer[DNS_PACKET_MAX + DNS_ANSWER_SIZE];
+    for (;;) {
+      ssize_t n = recv(client, buffer, sizeof(buffer), 0);
+      if (n < 0) {
+        if (!sending && received == total) break;
+        if (!sending && elapsedUs(begin) > cfg.seconds * 1e6 + 1000000) break;
+        continue;
+      }
+      size_t id = (buffer[0] << 8) | buffer[1];
+      if (n >= DNS_HEADER_SIZE && id < total && latency[id] < 0) {
+        latency[id] = elapsedUs(sentAt[id]);
+        received++;
+      }
+    }
+  });
+
+  Result result;
+  DnsResponder dns;
+  dns.begin(apIp);
+  static uint8_t query[DNS_PACKET_MAX];
+  static uint8_t reply[DNS_PACKET_MAX + DNS_ANSWER_SIZE];
+  Clock::time_point lastPoll = begin;
+  double pollMs = policy == FIRMWARE_MOVING ? DNS_POLL_MOVING_MS : DNS_POLL_IDLE_MS;
+  uint32_t batch = policy == FIRMWARE_MOVING ? DNS_BATCH_MOVING : DNS_BATCH_IDLE;
+  Clock::time_point end = begin + std::chrono::microseconds((long)(cfg.seconds * 1e6 + 1000000));
+  while (Clock::now() < end && received < total) {
+    spin(cfg.loopUs);
+    Clock::time_point t0 = Clock::now();
+    if (policy == NAIVE) {
+      // Un paquet par tour, tampons alloués comme WiFiUDP::parsePacket()
+      uint8_t* in = new uint8_t[1460];
+      sockaddr_in from;
+      socklen_t fromLength = sizeof(from);
+      ssize_t n = recvfrom(server, in, 1460, MSG_DONTWAIT, (sockaddr*)&from, &fromLength);
+      if (n > 0) {
+        uint8_t* out = new uint8_t[n + DNS_ANSWER_SIZE];
+        size_t length = dns.respond(in, n, out);
+        if (length > 0) sendto(server, out, length, 0, (sockaddr*)&from, fromLength);
+        delete[] out;
+      }
+      delete[] in;
+    } else if (std::chrono::duration<double, std::milli>(t0 - lastPoll).count() >= pollMs) {
+      // Comme captiveDnsPoll()
+      lastPoll = t0;
+      for (uint32_t handled = 0; handled < batch; handled++) {
+        sockaddr_in from;
+        socklen_t fromLength = sizeof(from);
+        ssize_t n = recvfrom(server, query, sizeof(query), MSG_DONTWAIT, (sockaddr*)&from, &fromLength);
+        if (n <= 0) break;
+        size_t length = dns.respond(query, n, reply);
+        if (length > 0) sendto(server, reply, length, 0, (sockaddr*)&from, fromLength);
+      }
+    }
+    result.pollUs.push_back(elapsedUs(t0));
+    result.iterations++;
+  }
+  result.loopSeconds = elapsedUs(begin) * 1e-6;
+  sender.join();
+  receiver.join();
+  close(server);
+  close(client);
+
+  result.sent = total;
+  for (double l : latency) {
+    if (l < 0) continue;
+    result.answered++;
+    result.latencyUs.push_back(l);
+  }
+  return result;
+}
+
+static double percentile(std::vector<double> values, double p) {
+  if (values.empty()) return 0;
+  std::sort(values.begin(), values.end());
+  return values[std::min(values.size() - 1, (size_t)(p * values.size()))];
+}
+
+int main(int argc, char** argv) {
+  Storm cfg;
+  unsigned seed = 1;
+  for (int i = 1; i < argc; i++) {
+    if (strcmp(argv[i], "--rate") == 0 && i + 1 < argc) cfg.rate = max(1.0, atof(argv[++i]));
+    else if (strcmp(argv[i], "--seconds") == 0 && i + 1 < argc) cfg.seconds = max(0.1, atof(argv[++i]));
+    else if (strcmp(argv[i], "--loop-us") == 0 && i + 1 < argc) cfg.loopUs = max(0.0, atof(argv[++i]));
+    else if (strcmp(argv[i], "--seed") == 0 && i + 1 < argc) seed = atoi(argv[++i]);
+    else {
+      fprintf(stderr, "usage: captive_check [--rate Q] [--seconds S] [--loop-us N] [--seed S]\n");
+      return 1;
+    }
+  }
+  std::mt19937 rng(seed);
+  responses();
+
+  printf("\ntempête: %.0f requêtes/s pendant %.1f s, boucle %.0f µs\n", cfg.rate, cfg.seconds, cfg.loopUs);
+  printf("%-20s %10s %9s %9s %9s %8s %12s %10s %10s\n", "relève", "tours", "moy. µs", "p99 µs", "max µs", "part",
+         "réponses", "lat. p50", "lat. p99");
+  const char* labels[] = { "naïve", "firmware (repos)", "firmware (mvt)" };
+  for (int p = NAIVE; p <= FIRMWARE_MOVING; p++) {
+    Result r = storm((Policy)p, cfg, rng);
+    double sum = 0;
+    for (double us : r.pollUs) sum += us;
+    printf("%-20s %10ld %9.2f %9.1f %9.1f %7.2f%% %5ld/%-6ld %8.0fµs %8.0fµs\n", labels[p], r.iterations,
+           sum / r.iterations, percentile(r.pollUs, 0.99), percentile(r.pollUs, 1.0),
+           100 * sum * 1e-6 / r.loopSeconds, r.answered, r.sent, percentile(r.latencyUs, 0.5),
+           percentile(r.latencyUs, 0.99));
+    if (p != NAIVE && r.answered != r.sent) failures++;
+  }
+
+  printf("%s\n", failures == 0 ? "ok" : "ÉCHEC");
+  return failures == 0 ? 0 : 1;
+}
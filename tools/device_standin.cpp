@@ -0,0 +1,291 @@
+// Simulation d'un parc d'axes pour tools/fleet.cpp
+//
+// Compilation: g++ -O2 -std=c++17 -o device_standin tools/device_standin.cpp
+// Usage:       device_standin [--count N] [--port P] [--close] [--delay ms] [--dead K]
+//
+// Un seul processus écoute sur les ports P..P+N-1, un axe simulé par port.
+// Chaque axe répond comme le firmware à GET /api/status, /api/status.bin et
+// à POST /api/move, /api/stop, /api/home; la position avance à la vitesse
+// demandée. --close reproduit le serveur web de l'ESP32 (une requête par
+// connexion, "Connection: close"), --delay ajoute un temps de service par
+// requête sans bloquer les autres axes, --dead rend les K premiers axes
+// muets (connexion acceptée, aucune réponse) pour tester les délais.
+
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/epoll.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <deque>
+#include <map>
+#include <string>
+#include <vector>
+
+#include "status_client.h"
+
+typedef std::chrono::steady_clock Clock;
+
+struct Axis {
+  float stepsPerMm = 800;
+  double position = 0;  // Steps
+  double target = 0;
+  float speed = 300;    // mm/min
+  bool running = false;
+  uint32_t seq = 0;
+  Clock::time_point updated = Clock::now();
+
+  void advance() {
+    Clock::time_point now = Clock::now();
+    double elapsed = std::chrono::duration<double>(now - updated).count();
+    updated = now;
+    if (!running) return;
+    double step = speed * stepsPerMm / 60.0 * elapsed;
+    if (std::fabs(target - position) <= step) {
+      position = target;
+      running = false;
+    } else {
+      position += target > position ? step : -step;
+    }
+  }
+};
+
+struct Connection {
+  size_t device;
+  std::string in;
+  std::deque<std::pair<Clock::time_point, std::string>> replies;
+  std::string out;
+  bool closeAfterReply = false;
+};
+
+static std::vector<Axis> axes;
+static std::map<int, Connection> connections;
+static bool closeMode = false;
+static int delayMs = 0;
+static size_t deadCount = 0;
+static int epollFd = -1;
+
+static std::string fixed(double value, int decimals) {
+  char buffer[32];
+  snprintf(buffer, sizeof(buffer), "%.*f", decimals, value);
+  return buffer;
+}
+
+static double jsonNumber(const std::string& json, const char* key, double fallback) {
+  size_t at = json.find(key);
+  if (at == std::string::npos) return fallback;
+  return strtod(json.c_str() + at + strlen(key), nullptr);
+}
+
+static std::string reply(int status, const char* type, const std::string& body) {
+  std::string out = "HTTP/1.1 " + std::to_string(status) + (status == 200 ? " OK" : " Error") + "\r\n";
+  out += std::string("Content-Type: ") + type + "\r\nContent-Length: " + std::to_string(body.size()) + "\r\n";
+  out += "Access-Control-Allow-Origin: *\r\n";
+  out += closeMode ? "Connection: close\r\n\r\n" : "Connection: keep-alive\r\n\r\n";
+  return out + body;
+}
+
+static std::string handle(Axis& axis, const std::string& method, const std::string& path, const std::string& body) {
+  axis.advance();
+  if (method == "GET" && path == "/api/status") {
+    std::string json = "{";
+    json += "\"running\":" + std::string(axis.running ? "true" : "false") + ",";
+    json += "\"position\":" + fixed(axis.position / axis.stepsPerMm, 3) + ",";
+    json += "\"target\":" + fixed(axis.target / axis.stepsPerMm, 3) + ",";
+    json += "\"speed\":" + fixed(axis.speed, 2) + ",";
+    json += "\"steps\":" + std::to_string((long)axis.position) + ",";
+    json += "\"remaining\":" + std::to_string((long)(axis.target - axis.position)) + ",";
+    json += "\"stepsPerMm\":" + fixed(axis.stepsPerMm, 2) + "}";
+    return reply(200, "application/json", json);
+  }
+  if (method == "GET" && path == "/api/status.bin") {
+    uint8_t rec[STATUS_RECORD_SIZE] = { STATUS_MAGIC, STATUS_VERSION, STATUS_RECORD_SIZE, 0 };
+    auto put32 = [&](int at, uint32_t value) { memcpy(rec + at, &value, 4); };
+    float speed = axis.speed;
+    put32(4, ++axis.seq);
+    put32(8, (uint32_t)std::chrono::duration_cast<std::chrono::milliseconds>(axis.updated.time_since_epoch()).count());
+    put32(12, (int32_t)axis.position);
+    put32(16, (int32_t)axis.target);
+    put32(20, (int32_t)(axis.target - axis.position));
+    memcpy(rec + 24, &speed, 4);
+    memcpy(rec + 28, &axis.stepsPerMm, 4);
+    uint16_t flags = axis.running ? STATUS_FLAG_RUNNING | STATUS_FLAG_NETWORK : STATUS_FLAG_NETWORK;
+    uint16_t overridePct = 100;
+    memcpy(rec + 32, &flags, 2);
+    memcpy(rec + 34, &overridePct, 2);
+    return reply(200, "application/octet-stream", std::string((const char*)rec, sizeof(rec)));
+  }
+  if (method == "POST" && path == "/api/move") {
+    axis.speed = jsonNumber(body, "\"speed\":", 300);
+    axis.target = axis.position + jsonNumber(body, "\"distance\":", 0) * axis.stepsPerMm;
+    axis.running = axis.target != axis.position;
+    return reply(200, "application/json", "{\"status\":\"moving\"}");
+  }
+  if (method == "POST" && path == "/api/stop") {
+    axis.target = axis.position;
+    axis.running = false;
+    return reply(200, "application/json", "{\"status\":\"stopped\"}");
+  }
+  if (method == "POST" && path == "/api/home") {
+    if (std::fabs(axis.position) < 1) return reply(200, "application/json", "{\"status\":\"already_home\"}");
+    axis.target = 0;
+    axis.running = true;
+    return reply(200, "application/json", "{\"status\":\"homing\"}");
+  }
+  return reply(404, "text/plain", "Not found");
+}
+
+static void closeConnection(int fd) {
+  epoll_ctl(epollFd, EPOLL_CTL_DEL, fd, nullptr);
+  close(fd);
+  connections.erase(fd);
+}
+
+// Extrait les requêtes complètes du tampon et programme leurs réponses
+static void parseRequests(int fd, Connection& conn) {
+  for (;;) {
+    if (conn.closeAfterReply) {
+      conn.in.clear();  // Comme l'ESP32: la suite de la connexion est ignorée
+      return;
+    }
+    size_t headerEnd = conn.in.find("\r\n\r\n");
+    if (headerEnd == std::string::npos) return;
+    std::string headers = conn.in.substr(0, headerEnd + 2);
+    std::string lower = headers;
+    std::transform(lower.begin(), lower.end(), lower.begin(), ::tolower);
+    size_t lengthAt = lower.find("\r\ncontent-length:");
+    size_t length = lengthAt == std::string::npos ? 0 : strtoul(lower.c_str() + lengthAt + 17, nullptr, 10);
+    if (conn.in.size() < headerEnd + 4 + length) return;
+
+    size_t space = headers.find(' ');
+    size_t space2 = headers.find(' ', space + 1);
+    std::string method = headers.substr(0, space);
+    std::string path = headers.substr(space + 1, space2 - space - 1);
+    std::string body = conn.in.substr(headerEnd + 4, length);
+    conn.in.erase(0, headerEnd + 4 + length);
+
+    conn.replies.push_back({ Clock::now() + std::chrono::milliseconds(delayMs),
+                             handle(axes[conn.device], method, path, body) });
+    if (closeMode) conn.closeAfterReply = true;
+  }
+  (void)fd;
+}
+
+// Envoie les réponses échues, dans l'ordre des requêtes
+static void flushReplies(int fd, Connection& conn) {
+  Clock::time_point now = Clock::now();
+  while (!conn.replies.empty() && conn.replies.front().first <= now) {
+    conn.out += conn.replies.front().second;
+    conn.replies.pop_front();
+  }
+  while (!conn.out.empty()) {
+    ssize_t sent = send(fd, conn.out.data(), conn.out.size(), MSG_NOSIGNAL);
+    if (sent <= 0) break;
+    conn.out.erase(0, sent);
+  }
+  if (conn.closeAfterReply && conn.replies.empty() && conn.out.empty()) closeConnection(fd);
+}
+
+int main(int argc, char** argv) {
+  size_t count = 10;
+  int basePort = 9000;
+  for (int i = 1; i < argc; i++) {
+    std::string arg = argv[i];
+    if (arg == "--close") closeMode = true;
+    else if (arg == "--count" && i + 1 < argc) count = atoi(argv[++i]);
+    else if (arg == "--port" && i + 1 < argc) basePort = atoi(argv[++i]);
+    else if (arg == "--delay" && i + 1 < argc) delayMs = atoi(argv[++i]);
+    else if (arg == "--dead" && i + 1 < argc) deadCount = atoi(argv[++i]);
+    else {
+      fprintf(stderr, "usage: device_standin [--count N] [--port P] [--close] [--delay ms] [--dead K]\n");
+      return 1;
+    }
+  }
+
+  epollFd = epoll_create1(0);
+  axes.resize(count);
+  std::map<int, size_t> listeners;
+  for (size_t i = 0; i < count; i++) {
+    int fd = socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK, 0);
+    int one = 1;
+    setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+    sockaddr_in addr = {};
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons(basePort + i);
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    if (bind(fd, (sockaddr*)&addr, sizeof(addr)) != 0 || listen(fd, 64) != 0) {
+      fprintf(stderr, "port %zu indisponible: %s\n", basePort + i, strerror(errno));
+      return 1;
+    }
+    epoll_event event = {};
+    event.events = EPOLLIN;
+    event.data.fd = fd;
+    epoll_ctl(epollFd, EPOLL_CTL_ADD, fd, &event);
+    listeners[fd] = i;
+  }
+  printf("%zu axe(s) sur 127.0.0.1:%d-%zu%s\n", count, basePort, basePort + count - 1,
+         closeMode ? ", Connection: close" : "");
+  fflush(stdout);
+
+  epoll_event events[256];
+  for (;;) {
+    int timeout = -1;
+    Clock::time_point now = Clock::now();
+    for (auto& entry : connections) {
+      if (entry.second.replies.empty()) continue;
+      auto wait = std::chrono::duration_cast<std::chrono::milliseconds>(entry.second.replies.front().first - now);
+      int ms = std::max(0, (int)wait.count());
+      timeout = timeout < 0 ? ms : std::min(timeout, ms);
+    }
+
+    int n = epoll_wait(epollFd, events, 256, timeout);
+    for (int i = 0; i < n; i++) {
+      int fd = events[i].data.fd;
+      auto listener = listeners.find(fd);
+      if (listener != listeners.end()) {
+        int client;
+        while ((client = accept4(fd, nullptr, nullptr, SOCK_NONBLOCK)) >= 0) {
+          int one = 1;
+          setsockopt(client, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+          epoll_event event = {};
+          event.events = EPOLLIN;
+          event.data.fd = client;
+          epoll_ctl(epollFd, EPOLL_CTL_ADD, client, &event);
+          connections[client].device = listener->second;
+        }
+        continue;
+      }
+
+      auto it = connections.find(fd);
+      if (it == connections.end()) continue;
+      char buffer[16384];
+      ssize_t received;
+      bool closed = false;
+      while ((received = recv(fd, buffer, sizeof(buffer), 0)) > 0) it->second.in.append(buffer, received);
+      if (received == 0 || (received < 0 && errno != EAGAIN && errno != EWOULDBLOCK)) closed = true;
+      if (closed) {
+        closeConnection(fd);
+        continue;
+      }
+      if (it->second.device < deadCount) {
+        it->second.in.clear();
+        continue;
+      }
+      parseRequests(fd, it->second);
+    }
+
+    std::vector<int> ready;
+    for (auto& entry : connections) {
+      if (!entry.second.replies.empty() || !entry.second.out.empty()) ready.push_back(entry.first);
+    }
+    for (int fd : ready) flushReplies(fd, connections[fd]);
+  }
+}
@@ -0,0 +1,148 @@
+// Vérification hôte des événements sur position (PositionEventCursor dans main.c)
+//
+// Compilation: g++ -O2 -std=c++17 -o event_check tools/event_check.cpp
+// Usage:       event_check [--sequences N] [--moves N] [--seed S]
+//
+// Le générateur de pas et le curseur du firmware (main.c inclus avec
+// MOTION_CORE_ONLY) tournent sur une horloge virtuelle; onStep() avance le
+// curseur comme le chemin de pas du firmware (pas de rattrapage du jeu
+// ignorés). --sequences (200) tables aléatoires de 1 à MAX_POSITION_EVENTS
+// événements sur [-300, 300] pas, positions en double comprises, filtre de
+// sens tiré parmi les deux sens, avant et arrière; jeu de 0 ou 5 pas. Puis
+// --moves (40) commandes: déplacement, changement de cible en mouvement
+// (inversion en route), arrêt immédiat suivi d'un saut de position (seek).
+// À chaque pas, les événements déclenchés doivent être exactement ceux
+// dont la position est celle atteinte et dont le filtre accepte le sens,
+// et le curseur doit rester le premier événement au-dessus de la position.
+// Code de sortie 1 si un contrôle échoue.
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "host_core.h"
+
+RampStepper<MotorDriver> stepper;
+
+static PositionEvent events[MAX_POSITION_EVENTS];
+static int eventCount = 0;
+static int cursor = 0;
+
+struct Counts {
+  long steps = 0;
+  long fired = 0;
+  long filtered = 0;     // Atteints mais refusés par le filtre de sens
+  long missed = 0;       // Attendus, non déclenchés
+  long spurious = 0;     // Déclenchés sans être attendus
+  long badCursor = 0;
+  long seeks = 0;
+};
+
+static Counts c;
+
+void onStep(long position, int dir) {
+  if (stepper.backlashStep()) return;
+  c.steps++;
+  std::vector<int> fired;
+  cursor = PositionEventCursor::step(events, eventCount, cursor, position, dir, [&](int i) { fired.push_back(i); });
+
+  // Référence: parcours complet de la table
+  std::vector<int> expected;
+  for (int i = 0; i < eventCount; i++) {
+    if (events[i].steps != position) continue;
+    if (events[i].dirFilter == EVENT_DIR_BOTH || events[i].dirFilter == dir) expected.push_back(i);
+    else c.filtered++;
+  }
+  std::sort(fired.begin(), fired.end());
+  for (int i : expected) {
+    if (!std::binary_search(fired.begin(), fired.end(), i)) c.missed++;
+  }
+  for (size_t k = 0; k < fired.size(); k++) {
+    if (!std::binary_search(expected.begin(), expected.end(), fired[k]) || (k > 0 && fired[k] == fired[k - 1])) {
+      c.spurious++;
+    }
+  }
+  c.fired += fired.size();
+  if (cursor != PositionEventCursor::seek(events, eventCount, position)) c.badCursor++;
+}
+
+static void runToEnd() {
+  for (long i = 0; i < 100000000 && stepper.run(); i++) virtualUs += 10;
+}
+
+static void runFor(long iterations) {
+  for (long i = 0; i < iterations && stepper.run(); i++) virtualUs += 10;
+}
+
+int main(int argc, char** argv) {
+  int sequences = 200;
+  int moves = 40;
+  unsigned seed = 1;
+  for (int i = 1; i < argc; i++) {
+    if (strcmp(argv[i], "--sequences") == 0 && i + 1 < argc) sequences = max(1, atoi(argv[++i]));
+    else if (strcmp(argv[i], "--moves") == 0 && i + 1 < argc) moves = max(1, atoi(argv[++i]));
+    else if (strcmp(argv[i], "--seed") == 0 && i + 1 < argc) seed = atoi(argv[++i]);
+    else {
+      fprintf(stderr, "usage: event_check [--sequences N] [--moves N] [--seed S]\n");
+      return 1;
+    }
+  }
+  std::mt19937 rng(seed);
+  std::uniform_int_distribution<long> posDist(-300, 300);
+  std::uniform_int_distribution<long> targetDist(-350, 350);
+  std::uniform_int_distribution<int> countDist(1, MAX_POSITION_EVENTS);
+  std::uniform_int_distribution<int> kindDist(0, 9);
+  std::uniform_int_distribution<long> partDist(1, 3000);
+  static const int8_t filters[] = { EVENT_DIR_BOTH, 1, -1 };
+
+  stepper.setMaxSpeed(4000);
+  stepper.setAcceleration(8000);
+
+  for (int s = 0; s < sequences; s++) {
+    stepper.setBacklash(s % 2 ? 5 : 0);
+    // Table dans l'ordre de saisie puis triée, comme positionEventsRebuild()
+    eventCount = countDist(rng);
+    for (int i = 0; i < eventCount; i++) {
+      events[i] = PositionEvent();
+      events[i].steps = i > 0 && rng() % 4 == 0 ? events[rng() % i].steps : posDist(rng);
+      events[i].dirFilter = filters[rng() % 3];
+    }
+    PositionEventCursor::sort(events, eventCount);
+    for (int i = 1; i < eventCount; i++) {
+      if (events[i - 1].steps > events[i].steps) c.badCursor++;
+    }
+    cursor = PositionEventCursor::seek(events, eventCount, stepper.currentPosition());
+
+    for (int m = 0; m < moves; m++) {
+      int kind = kindDist(rng);
+      stepper.moveTo(targetDist(rng));
+      if (kind < 6) {
+        runToEnd();
+      } else if (kind < 9) {
+        runFor(partDist(rng));
+        stepper.moveTo(targetDist(rng));
+        runToEnd();
+      } else {
+        // Arrêt puis nouvelle origine: le curseur est replacé
+        runFor(partDist(rng));
+        stepper.setCurrentPosition(targetDist(rng));
+        cursor = PositionEventCursor::seek(events, eventCount, stepper.currentPosition());
+        c.seeks++;
+      }
+    }
+  }
+
+  printf("%d tables, %d commandes chacune\n", sequences, moves);
+  printf("pas: %ld, déclenchements: %ld, refusés par le filtre: %ld, sauts: %ld\n", c.steps, c.fired, c.filtered,
+         c.seeks);
+  printf("manqués: %ld, en trop: %ld, curseur faux: %ld\n", c.missed, c.spurious, c.badCursor);
+  bool ok = c.missed == 0 && c.spurious == 0 && c.badCursor == 0 && c.fired > 0 && c.filtered > 0;
+  printf("%s\n", ok ? "ok" : "ÉCHEC");
+  return ok ? 0 : 1;
+}
@@ -0,0 +1,154 @@
+// Vérification hôte de la correction d'avance (FeedRamp dans main.c)
+//
+// Compilation: g++ -O2 -std=c++17 -o feed_check tools/feed_check.cpp
+// Usage:       feed_check [--runs N] [--seed S]
+//
+// La rampe de correction et le générateur de pas du firmware (main.c
+// inclus avec MOTION_CORE_ONLY) tournent sur une horloge virtuelle, comme
+// loop(): un tour toutes les 10 µs au plus, FeedRamp::update() à chaque
+// tour, la vitesse effective reportée dans RampStepper::setMaxSpeed().
+// L'horloge s'arrête aussi sur l'échéance exacte de chaque pas: les
+// intervalles ne sont pas arrondis au tour de boucle, qui masquerait la
+// rampe dans la mesure d'accélération. --runs (50) marches
+// continues de 4 s à 500-8000 steps/s, accélération = vitesse ×
+// ACCEL_FACTOR. La correction change toutes les 1 à 50 ms (10 à 200 %, par
+// rafales comme le curseur de l'interface), la boucle s'arrête parfois
+// jusqu'à 100 ms (écriture flash). Contrôles:
+//  - vitesse effective: jamais plus de accel × durée écoulée entre deux
+//    mises à jour, durée bornée à FEED_UPDATE_MAX_S après une boucle
+//    bloquée;
+//  - vitesse effective égale à base × correction une fois la correction
+//    stable le temps de la rejoindre;
+//  - pas émis: accélération mesurée sur des fenêtres de 20 ms (hors
+//    boucles bloquées) sous accel × 1.05.
+// Code de sortie 1 si un contrôle échoue.
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "host_core.h"
+
+RampStepper<MotorDriver> stepper;
+
+#define WINDOW_US 20000
+#define STEP_ACCEL_TOLERANCE 1.05
+
+static std::vector<uint64_t> stepTimes;
+static std::vector<uint64_t> stallTimes;
+
+void onStep(long, int) { stepTimes.push_back(virtualUs); }
+
+// Pire rapport accélération mesurée / accel sur les pas émis: vitesse
+// moyenne de fenêtres consécutives d'au moins WINDOW_US, rapportée à
+// l'écart de leurs milieux. Les fenêtres qui contiennent une boucle
+// bloquée sont écartées (pas retardés, sans rapport avec la rampe).
+static double worstStepAccel(double accel) {
+  double worst = 0;
+  double prevSpeed = 0, prevMid = 0;
+  bool prevValid = false;
+  size_t i = 0;
+  while (true) {
+    size_t j = i + 1;
+    while (j < stepTimes.size() && stepTimes[j] - stepTimes[i] < WINDOW_US) j++;
+    if (j >= stepTimes.size()) break;
+    bool stalled = false;
+    for (uint64_t t : stallTimes) stalled = stalled || (t >= stepTimes[i] && t < stepTimes[j]);
+    double speed = (j - i) / ((stepTimes[j] - stepTimes[i]) / 1e6);
+    double mid = (stepTimes[j] + stepTimes[i]) / 2e6;
+    if (prevValid && !stalled) worst = max(worst, fabs(speed - prevSpeed) / (mid - prevMid) / accel);
+    prevSpeed = speed;
+    prevMid = mid;
+    prevValid = !stalled;
+    i = j;
+  }
+  return worst;
+}
+
+int main(int argc, char** argv) {
+  int runs = 50;
+  unsigned seed = 1;
+  for (int i = 1; i < argc; i++) {
+    if (strcmp(argv[i], "--runs") == 0 && i + 1 < argc) runs = max(1, atoi(argv[++i]));
+    else if (strcmp(argv[i], "--seed") == 0 && i + 1 < argc) seed = atoi(argv[++i]);
+    else {
+      fprintf(stderr, "usage: feed_check [--runs N] [--seed S]\n");
+      return 1;
+    }
+  }
+  std::mt19937 rng(seed);
+  std::uniform_real_distribution<float> speedDist(500, 8000);
+  std::uniform_int_distribution<int> overrideDist(10, 200);
+  std::uniform_int_distribution<int> holdDist(1, 50);
+  std::uniform_int_distribution<int> eventDist(0, 99);
+
+  long slewViolations = 0, unsettled = 0, updates = 0, stalls = 0;
+  double worstSlew = 0, worstStep = 0;
+  for (int r = 0; r < runs; r++) {
+    float base = speedDist(rng);
+    float accel = base * ACCEL_FACTOR;
+    float overridePct = 100;
+    FeedRamp feed;
+    stepper.setCurrentPosition(0);
+    stepper.setMaxSpeed(feed.begin(base, accel, overridePct, micros()));
+    stepper.setAcceleration(accel);
+    stepper.moveTo(100000000);
+    stepTimes.clear();
+    stallTimes.clear();
+
+    uint64_t end = virtualUs + 4000000;
+    uint64_t nextChange = virtualUs;
+    uint64_t lastChange = virtualUs;
+    uint64_t lastApplied = virtualUs;
+    float previous = feed.applied;
+    while (virtualUs < end) {
+      if (virtualUs >= nextChange) {
+        // Rafale du curseur, ou correction tenue assez longtemps pour être
+        // rejointe puis contrôlée
+        overridePct = overrideDist(rng);
+        nextChange = virtualUs + (eventDist(rng) < 80 ? holdDist(rng) * 1000 : 600000);
+        lastChange = virtualUs;
+      }
+      if (eventDist(rng) == 0 && rng() % 200 == 0) {
+        stallTimes.push_back(virtualUs);
+        virtualUs += 100000;   // Boucle bloquée
+        stalls++;
+      }
+      if (feed.update(overridePct, micros())) {
+        updates++;
+        double elapsed = min((virtualUs - lastApplied) / 1e6, (double)FEED_UPDATE_MAX_S);
+        double slew = fabs(feed.applied - previous) / accel / elapsed;
+        worstSlew = max(worstSlew, slew);
+        if (slew > 1.0001) slewViolations++;
+        stepper.setMaxSpeed(feed.applied);
+        previous = feed.applied;
+      }
+      if (feed.lastUpdate == virtualUs) lastApplied = virtualUs;
+      // Correction stable depuis plus que le temps de la rejoindre
+      float target = base * overridePct / 100.0;
+      if (virtualUs - lastChange > 2 * base / accel * 1e6 + 20000 && fabs(feed.applied - target) > 1e-3 * target) {
+        unsettled++;
+      }
+      stepper.run();
+      // Tour suivant dans 10 µs, ou à l'échéance exacte du prochain pas
+      uint64_t next = stepTimes.empty() ? virtualUs + 10 : stepTimes.back() + stepper.stepInterval();
+      virtualUs = min(virtualUs + 10, max(virtualUs + 1, next));
+    }
+    worstStep = max(worstStep, worstStepAccel(accel));
+    stepper.setCurrentPosition(0);
+  }
+
+  printf("%d marches, %ld mises à jour de la vitesse effective, %ld boucles bloquées\n", runs, updates, stalls);
+  printf("vitesse effective: pire variation %.4f × accel, dépassements %ld, cible non rejointe %ld\n", worstSlew,
+         slewViolations, unsettled);
+  printf("pas émis: pire accélération mesurée %.3f × accel (fenêtres de %d ms)\n", worstStep, WINDOW_US / 1000);
+  bool ok = slewViolations == 0 && unsettled == 0 && worstStep < STEP_ACCEL_TOLERANCE && stalls > 0;
+  printf("%s\n", ok ? "ok" : "ÉCHEC");
+  return ok ? 0 : 1;
+}
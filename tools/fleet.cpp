@@ -0,0 +1,237 @@
+// Commande groupée d'un parc d'axes par l'API HTTP (voir tools/fleet.h)
+//
+// Compilation: g++ -O2 -std=c++17 -o fleet tools/fleet.cpp
+// Usage:       fleet [options] <axes...> status
+//              fleet [options] <axes...> poll <secondes> [période ms]
+//              fleet [options] <axes...> bench <secondes>
+//              fleet [options] <axes...> move <mm> [mm/min]
+//              fleet [options] <axes...> stop | home
+//              fleet [options] <axes...> get <chemin>
+// Axes:        10.0.0.5  10.0.0.5:8080  10.0.0.10-60  127.0.0.1:9000-9099
+// Options:     --hosts <fichier>   un axe (ou une plage) par ligne, # commentaire
+//              --timeout <ms>      délai par axe, connexion ou réponse (2000)
+//              --depth <n>         requêtes en pipeline par axe (4)
+//
+// Toutes les requêtes partent en même temps, une connexion par axe. "poll"
+// relève /api/status.bin de tout le parc à chaque période; un axe dont le
+// relevé précédent n'est pas revenu est sauté plutôt qu'empilé.
+// "bench" garde --depth relevés en vol par axe pour mesurer le débit maximal.
+// Chaque commande se termine par le bilan: débit, latences, échecs par axe.
+// Code de sortie 0 si tous les axes ont répondu 2xx.
+//
+// Essai local: device_standin --count 200 --close &
+//              fleet 127.0.0.1:9000-9199 poll 10 100
+
+#include "fleet.h"
+#include "status_client.h"
+
+#include <cstdio>
+#include <fstream>
+#include <map>
+
+using fleet::Clock;
+
+static void printSummary(fleet::Fleet& fleet, double seconds) {
+  const fleet::Stats& stats = fleet.stats;
+  printf("%zu axe(s), %ld requête(s) en %.2fs: %.0f req/s\n", fleet.size(), stats.completed(), seconds,
+         stats.completed() / seconds);
+  printf("ok %ld, erreurs HTTP %ld, échecs %ld, délais dépassés %ld, connexions %ld, renvois %ld\n", stats.ok,
+         stats.httpErrors, stats.failures, stats.timeouts, stats.connects, stats.retries);
+  if (!stats.latenciesMs.empty()) {
+    printf("latence ms: p50 %.2f  p90 %.2f  p99 %.2f  max %.2f\n", stats.percentile(0.5), stats.percentile(0.9),
+           stats.percentile(0.99), stats.percentile(1.0));
+  }
+}
+
+static std::string label(fleet::Fleet& fleet, size_t device) {
+  const fleet::Endpoint& endpoint = fleet.endpoint(device);
+  return endpoint.host + ":" + std::to_string(endpoint.port);
+}
+
+// Échecs regroupés par axe, pour ne pas noyer le bilan sous des centaines de lignes
+static void printFailures(fleet::Fleet& fleet, const std::map<size_t, std::string>& failures) {
+  size_t shown = 0;
+  for (auto& entry : failures) {
+    if (shown++ == 20) {
+      printf("... et %zu autre(s) axe(s) en échec\n", failures.size() - 20);
+      break;
+    }
+    printf("%-22s %s\n", label(fleet, entry.first).c_str(), entry.second.c_str());
+  }
+}
+
+static std::string describe(const fleet::Response& r) {
+  if (r.status != 0) return "HTTP " + std::to_string(r.status) + " " + r.body.substr(0, 60);
+  return r.error;
+}
+
+static int status(fleet::Fleet& fleet) {
+  std::vector<StatusRecord> records(fleet.size());
+  std::vector<std::string> errors(fleet.size());
+  std::vector<double> latencies(fleet.size());
+  Clock::time_point start = Clock::now();
+  for (size_t i = 0; i < fleet.size(); i++) {
+    fleet.request(i, "GET", "/api/status.bin", "", [&](const fleet::Response& r) {
+      latencies[r.device] = r.latencyMs;
+      if (!r.ok()) errors[r.device] = describe(r);
+      else if (!parseStatusRecord((const uint8_t*)r.body.data(), r.body.size(), records[r.device])) {
+        errors[r.device] = "statut illisible";
+      }
+    });
+  }
+  fleet.run();
+  double seconds = std::chrono::duration<double>(Clock::now() - start).count();
+
+  printf("%-22s %12s %10s %8s %8s\n", "axe", "position mm", "reste", "mm/min", "ms");
+  for (size_t i = 0; i < fleet.size(); i++) {
+    if (!errors[i].empty()) {
+      printf("%-22s %s\n", label(fleet, i).c_str(), errors[i].c_str());
+      continue;
+    }
+    const StatusRecord& rec = records[i];
+    printf("%-22s %12.3f %10d %8.0f %8.2f%s\n", label(fleet, i).c_str(), rec.positionMm(), rec.remaining, rec.speed,
+           latencies[i], rec.running() ? "  en mouvement" : "");
+  }
+  printSummary(fleet, seconds);
+  return fleet.stats.ok == (long)fleet.size() ? 0 : 1;
+}
+
+static int pollFleet(fleet::Fleet& fleet, double seconds, int periodMs) {
+  std::map<size_t, std::string> failures;
+  long rounds = 0;
+  long skipped = 0;
+  Clock::time_point start = Clock::now();
+  Clock::time_point end = start + std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(seconds));
+  Clock::time_point next = start;
+
+  while (Clock::now() < end) {
+    if (Clock::now() >= next) {
+      for (size_t i = 0; i < fleet.size(); i++) {
+        if (fleet.outstanding(i) > 0) {
+          skipped++;
+          continue;
+        }
+        fleet.request(i, "GET", "/api/status.bin", "", [&](const fleet::Response& r) {
+          StatusRecord rec;
+          if (!r.ok()) failures[r.device] = describe(r);
+          else if (!parseStatusRecord((const uint8_t*)r.body.data(), r.body.size(), rec)) {
+            failures[r.device] = "statut illisible";
+          }
+        });
+      }
+      rounds++;
+      next += std::chrono::milliseconds(periodMs);
+    }
+    int wait = (int)std::chrono::duration_cast<std::chrono::milliseconds>(std::min(next, end) - Clock::now()).count();
+    fleet.poll(std::max(wait, 0));
+  }
+  fleet.run();
+  double elapsed = std::chrono::duration<double>(Clock::now() - start).count();
+
+  printf("%ld relevé(s) du parc toutes les %d ms, %ld relevé(s) d'axe sauté(s) (précédent en attente)\n", rounds,
+         periodMs, skipped);
+  printSummary(fleet, elapsed);
+  printFailures(fleet, failures);
+  return failures.empty() ? 0 : 1;
+}
+
+// Relevés enchaînés sans période: chaque réponse relance une requête
+static int bench(fleet::Fleet& fleet, double seconds, int depth) {
+  std::map<size_t, std::string> failures;
+  Clock::time_point start = Clock::now();
+  Clock::time_point end = start + std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(seconds));
+  std::function<void(const fleet::Response&)> again = [&](const fleet::Response& r) {
+    if (!r.ok()) failures[r.device] = describe(r);
+    else if (Clock::now() < end) fleet.request(r.device, "GET", "/api/status.bin", "", again);
+  };
+  for (size_t i = 0; i < fleet.size(); i++) {
+    for (int d = 0; d < depth; d++) fleet.request(i, "GET", "/api/status.bin", "", again);
+  }
+  fleet.run();
+  double elapsed = std::chrono::duration<double>(Clock::now() - start).count();
+
+  printSummary(fleet, elapsed);
+  printFailures(fleet, failures);
+  return failures.empty() ? 0 : 1;
+}
+
+// Même requête sur tous les axes, réponses résumées par contenu
+static int broadcast(fleet::Fleet& fleet, const char* method, const std::string& path, const std::string& body) {
+  std::map<std::string, long> outcomes;
+  std::map<size_t, std::string> failures;
+  Clock::time_point start = Clock::now();
+  for (size_t i = 0; i < fleet.size(); i++) {
+    fleet.request(i, method, path, body, [&](const fleet::Response& r) {
+      if (r.ok()) outcomes[r.body.substr(0, 60)]++;
+      else failures[r.device] = describe(r);
+    });
+  }
+  fleet.run();
+  double seconds = std::chrono::duration<double>(Clock::now() - start).count();
+
+  for (auto& entry : outcomes) printf("%5ld x %s\n", entry.second, entry.first.c_str());
+  printSummary(fleet, seconds);
+  printFailures(fleet, failures);
+  return failures.empty() ? 0 : 1;
+}
+
+static bool loadHosts(const char* path, std::vector<fleet::Endpoint>& endpoints) {
+  std::ifstream file(path);
+  if (!file) return false;
+  std::string line;
+  while (std::getline(file, line)) {
+    line = line.substr(0, line.find('#'));
+    line.erase(0, line.find_first_not_of(" \t\r"));
+    line.erase(line.find_last_not_of(" \t\r") + 1);
+    if (!line.empty() && !fleet::parseEndpoints(line, endpoints)) {
+      fprintf(stderr, "axe invalide dans %s: %s\n", path, line.c_str());
+      return false;
+    }
+  }
+  return true;
+}
+
+int main(int argc, char** argv) {
+  static const char* const verbs[] = { "status", "poll", "bench", "move", "stop", "home", "get" };
+  std::vector<std::string> args(argv + 1, argv + argc);
+  std::vector<fleet::Endpoint> endpoints;
+  fleet::Options options;
+  size_t verbAt = 0;
+
+  for (; verbAt < args.size(); verbAt++) {
+    const std::string& arg = args[verbAt];
+    if (std::find(std::begin(verbs), std::end(verbs), arg) != std::end(verbs)) break;
+    bool hasValue = verbAt + 1 < args.size();
+    if (arg == "--timeout" && hasValue) options.timeoutMs = atoi(args[++verbAt].c_str());
+    else if (arg == "--depth" && hasValue) options.pipelineDepth = std::max(1, atoi(args[++verbAt].c_str()));
+    else if (arg == "--hosts" && hasValue) {
+      if (!loadHosts(args[++verbAt].c_str(), endpoints)) return 1;
+    } else if (!fleet::parseEndpoints(arg, endpoints)) {
+      fprintf(stderr, "axe invalide: %s\n", arg.c_str());
+      return 1;
+    }
+  }
+  if (verbAt == args.size() || endpoints.empty()) {
+    fprintf(stderr, "usage: fleet [--hosts f] [--timeout ms] [--depth n] <axes...> status|poll|bench|move|stop|home|get ...\n");
+    return 1;
+  }
+
+  const std::string& verb = args[verbAt];
+  double value = args.size() > verbAt + 1 ? atof(args[verbAt + 1].c_str()) : 0;
+  double extra = args.size() > verbAt + 2 ? atof(args[verbAt + 2].c_str()) : 0;
+  fleet::Fleet fleet(endpoints, options);
+
+  if (verb == "status") return status(fleet);
+  if (verb == "poll") return pollFleet(fleet, value > 0 ? value : 10, extra > 0 ? (int)extra : 200);
+  if (verb == "bench") return bench(fleet, value > 0 ? value : 5, options.pipelineDepth);
+  if (verb == "move") {
+    std::string body = "{\"distance\":" + std::to_string(value);
+    if (extra > 0) body += ",\"speed\":" + std::to_string(extra);
+    return broadcast(fleet, "POST", "/api/move", body + "}");
+  }
+  if (verb == "stop") return broadcast(fleet, "POST", "/api/stop", "");
+  if (verb == "home") return broadcast(fleet, "POST", "/api/home", "");
+  if (verb == "get" && args.size() > verbAt + 1) return broadcast(fleet, "GET", args[verbAt + 1], "");
+  fprintf(stderr, "commande incomplète: %s\n", verb.c_str());
+  return 1;
+}
@@ -0,0 +1,487 @@
+// Pilotage d'un parc d'axes par l'API HTTP existante (voir tools/fleet.cpp)
+//
+// En-tête seul, Linux (epoll). Une connexion persistante par axe, requêtes
+// en pipeline quand l'axe garde la connexion, délai d'expiration par axe.
+//
+//   fleet::Fleet fleet(endpoints);
+//   for (size_t i = 0; i < fleet.size(); i++)
+//     fleet.request(i, "GET", "/api/status.bin", "", [](const fleet::Response& r) { ... });
+//   fleet.run();
+//
+// Le serveur web de l'ESP32 ferme la connexion après chaque réponse
+// ("Connection: close"). Un axe n'est donc servi en pipeline qu'après une
+// première réponse qui garde la connexion; sinon une requête à la fois.
+// Les requêtes envoyées derrière une réponse "close" n'ont pas été traitées
+// (RFC 7230 §6.6) et sont renvoyées sur une nouvelle connexion.
+// Une fermeture inattendue ne renvoie que les GET: un POST peut avoir été
+// exécuté, il est signalé en échec plutôt que rejoué.
+
+#pragma once
+
+#include <arpa/inet.h>
+#include <fcntl.h>
+#include <netdb.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/epoll.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <deque>
+#include <functional>
+#include <string>
+#include <vector>
+
+namespace fleet {
+
+typedef std::chrono::steady_clock Clock;
+
+struct Endpoint {
+  std::string host;
+  uint16_t port = 80;
+};
+
+// "10.0.0.5", "10.0.0.5:8080", "10.0.0.10-60" (plage sur le dernier octet),
+// "127.0.0.1:9000-9099" (plage de ports, pour le serveur de simulation)
+inline bool parseEndpoints(const std::string& spec, std::vector<Endpoint>& out) {
+  size_t colon = spec.find(':');
+  std::string host = spec.substr(0, colon);
+  std::string ports = colon == std::string::npos ? "80" : spec.substr(colon + 1);
+
+  auto range = [](const std::string& text, long& first, long& last) {
+    char* end;
+    first = strtol(text.c_str(), &end, 10);
+    last = first;
+    if (*end == '-') last = strtol(end + 1, &end, 10);
+    return *end == '\0' && first <= last;
+  };
+
+  long portFirst, portLast;
+  if (!range(ports, portFirst, portLast) || portFirst < 1 || portLast > 65535) return false;
+
+  size_t dash = host.find('-');
+  if (dash != std::string::npos) {
+    size_t dot = host.rfind('.', dash);
+    long first, last;
+    if (dot == std::string::npos || !range(host.substr(dot + 1), first, last) || last > 255) return false;
+    for (long octet = first; octet <= last; octet++) {
+      for (long port = portFirst; port <= portLast; port++) {
+        out.push_back({ host.substr(0, dot + 1) + std::to_string(octet), (uint16_t)port });
+      }
+    }
+    return true;
+  }
+  for (long port = portFirst; port <= portLast; port++) out.push_back({ host, (uint16_t)port });
+  return true;
+}
+
+struct Response {
+  size_t device = 0;
+  int status = 0;        // 0: pas de réponse HTTP (voir error)
+  std::string body;
+  double latencyMs = 0;  // Dernier envoi -> réponse complète
+  bool timedOut = false;
+  std::string error;
+
+  bool ok() const { return status >= 200 && status < 300; }
+};
+
+typedef std::function<void(const Response&)> Callback;
+
+struct Options {
+  int timeoutMs = 2000;   // Connexion ou réponse, par axe
+  int pipelineDepth = 4;  // Requêtes envoyées sans attendre, si l'axe garde la connexion
+  int maxRetries = 2;     // Renvois d'un GET après fermeture inattendue
+};
+
+struct Stats {
+  long ok = 0;
+  long httpErrors = 0;
+  long failures = 0;
+  long timeouts = 0;
+  long connects = 0;
+  long retries = 0;
+  std::vector<double> latenciesMs;
+
+  long completed() const { return ok + httpErrors + failures + timeouts; }
+
+  double percentile(double p) const {
+    if (latenciesMs.empty()) return 0;
+    std::vector<double> sorted = latenciesMs;
+    std::sort(sorted.begin(), sorted.end());
+    return sorted[std::min(sorted.size() - 1, (size_t)(p * sorted.size()))];
+  }
+};
+
+class Fleet {
+ public:
+  explicit Fleet(const std::vector<Endpoint>& endpoints, Options options = Options())
+      : options_(options), devices_(endpoints.size()) {
+    epoll_ = epoll_create1(0);
+    for (size_t i = 0; i < endpoints.size(); i++) devices_[i].endpoint = endpoints[i];
+  }
+
+  ~Fleet() {
+    for (Device& device : devices_) {
+      if (device.fd >= 0) close(device.fd);
+    }
+    close(epoll_);
+  }
+
+  size_t size() const { return devices_.size(); }
+  const Endpoint& endpoint(size_t device) const { return devices_[device].endpoint; }
+
+  // Met une requête en file; le rappel est appelé une seule fois, depuis run()/poll()
+  void request(size_t device, const char* method, const std::string& path, const std::string& body,
+               Callback done) {
+    Pending pending;
+    pending.method = method;
+    pending.path = path;
+    pending.body = body;
+    pending.done = done;
+    devices_[device].queued.push_back(pending);
+    outstanding_++;
+    pump(device);
+  }
+
+  size_t outstanding() const { return outstanding_; }
+  size_t outstanding(size_t device) const {
+    return devices_[device].queued.size() + devices_[device].inFlight.size();
+  }
+
+  void run() {
+    while (outstanding_ > 0) poll(100);
+  }
+
+  // Traite les événements pendant au plus maxMs; retourne les requêtes restantes
+  size_t poll(int maxMs) {
+    epoll_event events[64];
+    int count = epoll_wait(epoll_, events, 64, std::min(maxMs, options_.timeoutMs));
+    for (int i = 0; i < count; i++) {
+      size_t index = events[i].data.u64;
+      Device& device = devices_[index];
+      if (device.fd < 0) continue;
+      if (device.connecting) {
+        int error = 0;
+        socklen_t length = sizeof(error);
+        getsockopt(device.fd, SOL_SOCKET, SO_ERROR, &error, &length);
+        if (error != 0) {
+          failAll(index, std::string("connexion: ") + strerror(error), false);
+          continue;
+        }
+        device.connecting = false;
+        stats.connects++;
+        watch(index, EPOLLIN);
+      }
+      if (events[i].events & (EPOLLIN | EPOLLHUP | EPOLLERR)) receive(index);
+      if (device.fd >= 0) pump(index);
+    }
+    expire();
+    return outstanding_;
+  }
+
+  Stats stats;
+
+ private:
+  struct Pending {
+    std::string method;
+    std::string path;
+    std::string body;
+    Callback done;
+    Clock::time_point sent;
+    int retries = 0;
+  };
+
+  struct Device {
+    Endpoint endpoint;
+    sockaddr_in addr = {};
+    bool resolved = false;
+    int fd = -1;
+    bool connecting = false;
+    bool keepAlive = false;  // Confirmé par une réponse sans "Connection: close"
+    Clock::time_point connectStart;
+    std::deque<Pending> queued;
+    std::deque<Pending> inFlight;
+    std::string out;
+    std::string in;
+  };
+
+  void finish(size_t index, Pending& pending, Response& response) {
+    response.device = index;
+    if (response.status != 0) {
+      response.latencyMs = std::chrono::duration<double, std::milli>(Clock::now() - pending.sent).count();
+      stats.latenciesMs.push_back(response.latencyMs);
+      if (response.ok()) stats.ok++;
+      else stats.httpErrors++;
+    } else if (response.timedOut) {
+      stats.timeouts++;
+    } else {
+      stats.failures++;
+    }
+    outstanding_--;
+    if (pending.done) pending.done(response);
+  }
+
+  void fail(size_t index, Pending& pending, const std::string& error, bool timedOut) {
+    Response response;
+    response.error = error;
+    response.timedOut = timedOut;
+    finish(index, pending, response);
+  }
+
+  // Échec de toutes les requêtes de l'axe: injoignable ou muet
+  void failAll(size_t index, const std::string& error, bool timedOut) {
+    Device& device = devices_[index];
+    disconnect(index);
+    std::deque<Pending> pending;
+    pending.swap(device.inFlight);
+    pending.insert(pending.end(), device.queued.begin(), device.queued.end());
+    device.queued.clear();
+    for (Pending& p : pending) fail(index, p, error, timedOut);
+  }
+
+  void disconnect(size_t index) {
+    Device& device = devices_[index];
+    if (device.fd >= 0) {
+      epoll_ctl(epoll_, EPOLL_CTL_DEL, device.fd, nullptr);
+      close(device.fd);
+    }
+    device.fd = -1;
+    device.connecting = false;
+    device.out.clear();
+    device.in.clear();
+  }
+
+  void watch(size_t index, uint32_t events) {
+    epoll_event event = {};
+    event.events = events;
+    event.data.u64 = index;
+    epoll_ctl(epoll_, EPOLL_CTL_MOD, devices_[index].fd, &event);
+  }
+
+  bool connectDevice(size_t index) {
+    Device& device = devices_[index];
+    if (!device.resolved) {
+      addrinfo hints = {};
+      addrinfo* result = nullptr;
+      hints.ai_family = AF_INET;
+      hints.ai_socktype = SOCK_STREAM;
+      if (getaddrinfo(device.endpoint.host.c_str(), nullptr, &hints, &result) != 0 || result == nullptr) {
+        return false;
+      }
+      device.addr = *(sockaddr_in*)result->ai_addr;
+      device.addr.sin_port = htons(device.endpoint.port);
+      device.resolved = true;
+      freeaddrinfo(result);
+    }
+
+    device.fd = socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK, 0);
+    if (device.fd < 0) return false;
+    int one = 1;
+    setsockopt(device.fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+    if (connect(device.fd, (sockaddr*)&device.addr, sizeof(device.addr)) != 0 && errno != EINPROGRESS) {
+      close(device.fd);
+      device.fd = -1;
+      return false;
+    }
+    device.connecting = true;
+    device.connectStart = Clock::now();
+    epoll_event event = {};
+    event.events = EPOLLOUT;
+    event.data.u64 = index;
+    epoll_ctl(epoll_, EPOLL_CTL_ADD, device.fd, &event);
+    return true;
+  }
+
+  // Envoie ce que la fenêtre de pipeline permet
+  void pump(size_t index) {
+    Device& device = devices_[index];
+    if (device.queued.empty() && device.out.empty()) return;
+    if (device.fd < 0) {
+      if (!device.queued.empty() && !connectDevice(index)) failAll(index, "connexion impossible", false);
+      return;
+    }
+    if (device.connecting) return;
+
+    size_t depth = device.keepAlive ? options_.pipelineDepth : 1;
+    while (!device.queued.empty() && device.inFlight.size() < depth) {
+      Pending pending = device.queued.front();
+      device.queued.pop_front();
+      device.out += pending.method + " " + pending.path + " HTTP/1.1\r\nHost: " + device.endpoint.host +
+                    "\r\nConnection: keep-alive\r\n";
+      if (!pending.body.empty() || pending.method == "POST") {
+        device.out += "Content-Type: application/json\r\nContent-Length: " + std::to_string(pending.body.size()) +
+                      "\r\n";
+      }
+      device.out += "\r\n" + pending.body;
+      pending.sent = Clock::now();
+      device.inFlight.push_back(pending);
+    }
+
+    while (!device.out.empty()) {
+      ssize_t sent = send(device.fd, device.out.data(), device.out.size(), MSG_NOSIGNAL);
+      if (sent < 0) {
+        if (errno == EAGAIN || errno == EWOULDBLOCK) break;
+        connectionLost(index, std::string("envoi: ") + strerror(errno));
+        return;
+      }
+      device.out.erase(0, sent);
+    }
+    watch(index, device.out.empty() ? EPOLLIN : EPOLLIN | EPOLLOUT);
+  }
+
+  // Remet en file les requêtes sans réponse; "processed" = le serveur a pu
+  // les traiter (fermeture inattendue), seuls les GET sont alors rejoués
+  void requeueInFlight(size_t index, bool processed, const std::string& error) {
+    Device& device = devices_[index];
+    std::deque<Pending> inFlight;
+    inFlight.swap(device.inFlight);
+    for (auto it = inFlight.rbegin(); it != inFlight.rend(); ++it) {
+      bool replay = !processed || (it->method == "GET" && it->retries < options_.maxRetries);
+      if (replay) {
+        if (processed) it->retries++;
+        stats.retries++;
+        device.queued.push_front(*it);
+      } else {
+        fail(index, *it, error, false);
+      }
+    }
+  }
+
+  void connectionLost(size_t index, const std::string& error) {
+    disconnect(index);
+    requeueInFlight(index, true, error);
+    pump(index);
+  }
+
+  void receive(size_t index) {
+    Device& device = devices_[index];
+    char buffer[16384];
+    bool eof = false;
+    for (;;) {
+      ssize_t n = recv(device.fd, buffer, sizeof(buffer), 0);
+      if (n > 0) {
+        device.in.append(buffer, n);
+        continue;
+      }
+      if (n == 0 || (errno != EAGAIN && errno != EWOULDBLOCK)) eof = true;
+      break;
+    }
+
+    while (!device.inFlight.empty()) {
+      Response response;
+      size_t consumed = 0;
+      bool closeAfter = false;
+      if (!parseResponse(device.in, eof, response, consumed, closeAfter)) break;
+      device.in.erase(0, consumed);
+      Pending pending = device.inFlight.front();
+      device.inFlight.pop_front();
+      device.keepAlive = !closeAfter;
+
+      // Fermeture traitée avant le rappel, qui peut déjà relancer une requête
+      if (closeAfter) {
+        // Les requêtes suivantes n'ont pas été traitées: renvoi sans risque
+        disconnect(index);
+        requeueInFlight(index, false, "fermée par l'axe");
+      }
+      finish(index, pending, response);
+      if (closeAfter) {
+        pump(index);
+        return;
+      }
+    }
+    if (eof) connectionLost(index, "connexion fermée");
+  }
+
+  void expire() {
+    Clock::time_point now = Clock::now();
+    Clock::duration timeout = std::chrono::milliseconds(options_.timeoutMs);
+    for (size_t i = 0; i < devices_.size(); i++) {
+      Device& device = devices_[i];
+      if (device.connecting && now - device.connectStart > timeout) {
+        failAll(i, "délai de connexion dépassé", true);
+      } else if (!device.inFlight.empty() && now - device.inFlight.front().sent > timeout) {
+        // Axe muet: ses requêtes en vol échouent, la file repart sur une nouvelle connexion
+        disconnect(i);
+        std::deque<Pending> inFlight;
+        inFlight.swap(device.inFlight);
+        for (Pending& p : inFlight) fail(i, p, "délai de réponse dépassé", true);
+        pump(i);
+      }
+    }
+  }
+
+  static bool headerIs(const std::string& headers, const char* name, const char* value) {
+    std::string lower = headers;
+    std::transform(lower.begin(), lower.end(), lower.begin(), ::tolower);
+    size_t at = lower.find(std::string("\r\n") + name + ":");
+    if (at == std::string::npos) return false;
+    size_t end = lower.find("\r\n", at + 2);
+    return lower.substr(at, end - at).find(value) != std::string::npos;
+  }
+
+  static long headerNumber(const std::string& headers, const char* name) {
+    std::string lower = headers;
+    std::transform(lower.begin(), lower.end(), lower.begin(), ::tolower);
+    size_t at = lower.find(std::string("\r\n") + name + ":");
+    if (at == std::string::npos) return -1;
+    return strtol(lower.c_str() + at + strlen(name) + 3, nullptr, 10);
+  }
+
+  // Réponse complète en tête de tampon? Content-Length, chunked ou fin de connexion
+  static bool parseResponse(const std::string& in, bool eof, Response& response, size_t& consumed, bool& close) {
+    size_t headerEnd = in.find("\r\n\r\n");
+    if (headerEnd == std::string::npos || in.compare(0, 5, "HTTP/") != 0) return false;
+    std::string headers = in.substr(0, headerEnd + 2);
+    size_t space = headers.find(' ');
+    response.status = space == std::string::npos ? 0 : atoi(headers.c_str() + space + 1);
+    bool http10 = headers.compare(0, 8, "HTTP/1.0") == 0;
+    close = headerIs(headers, "connection", "close") || (http10 && !headerIs(headers, "connection", "keep-alive"));
+    size_t bodyStart = headerEnd + 4;
+
+    if (headerIs(headers, "transfer-encoding", "chunked")) {
+      size_t at = bodyStart;
+      std::string body;
+      for (;;) {
+        size_t lineEnd = in.find("\r\n", at);
+        if (lineEnd == std::string::npos) return false;
+        size_t chunk = strtoul(in.c_str() + at, nullptr, 16);
+        if (in.size() < lineEnd + 2 + chunk + 2) return false;
+        if (chunk == 0) {
+          consumed = lineEnd + 4;
+          break;
+        }
+        body.append(in, lineEnd + 2, chunk);
+        at = lineEnd + 2 + chunk + 2;
+      }
+      response.body = body;
+      return true;
+    }
+
+    long length = headerNumber(headers, "content-length");
+    if (length >= 0) {
+      if (in.size() < bodyStart + length) return false;
+      response.body = in.substr(bodyStart, length);
+      consumed = bodyStart + length;
+      return true;
+    }
+    if (!eof) return false;
+    response.body = in.substr(bodyStart);
+    consumed = in.size();
+    close = true;
+    return true;
+  }
+
+  Options options_;
+  std::vector<Device> devices_;
+  int epoll_ = -1;
+  size_t outstanding_ = 0;
+};
+
+}  // namespace fleet
@@ -0,0 +1,174 @@
+// Vérification hôte de la surveillance d'écart de poursuite (FollowingMonitor dans main.c)
+//
+// Compilation: g++ -O2 -std=c++17 -o following_check tools/following_check.cpp
+// Usage:       following_check [--slips N] [--seed S]
+//
+// Le générateur de pas et la surveillance du firmware (main.c inclus avec
+// MOTION_CORE_ONLY) tournent sur une horloge virtuelle, la surveillance
+// relue à chaque tour de boucle comme checkFollowingError(). Le codeur
+// simulé compte la position de la charge (quadrature, réglages par défaut
+// du firmware: seuils 0.05 et 0.5 mm); le glissement est injecté pas à pas
+// pendant un déplacement de 20000 pas. Contrôles:
+//  - sans glissement: ni avertissement ni défaut, aller et retour;
+//  - seuils exacts: warnSteps - 1 et faultSteps - 1 pas ne déclenchent
+//    rien de plus, warnSteps et faultSteps déclenchent, dans les deux sens;
+//  - avertissement mémorisé: un seul par dépassement, réarmé seulement
+//    sous warnSteps / 2;
+//  - défaut mémorisé: signalé une seule fois, maintenu quand l'écart
+//    revient à zéro, effacé par sync();
+//  - --slips (200) glissements aléatoires, issue prévue par l'amplitude.
+// Code de sortie 1 si un contrôle échoue.
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <random>
+#include <string>
+
+#include "host_core.h"
+
+RampStepper<MotorDriver> stepper;
+
+void onStep(long, int) {}
+
+static FollowingMonitor following;
+static long slip = 0;          // Pas perdus par la charge (signe = sens)
+static int failures = 0;
+
+struct Outcome {
+  long warnings = 0;
+  long faults = 0;
+};
+
+static long encoderCount() { return lround((stepper.motorPosition() - slip) / following.stepsPerCount); }
+
+static void check(Outcome& out) {
+  int result = following.update(stepper.motorPosition(), encoderCount());
+  if (result == FOLLOWING_WARN) out.warnings++;
+  if (result == FOLLOWING_FAULT) out.faults++;
+}
+
+// Déplacement de distance pas; le glissement rejoint slipTo un pas tous les
+// 50 tours à partir du milieu
+static Outcome moveWithSlip(long distance, long slipTo) {
+  Outcome out;
+  long start = stepper.currentPosition();
+  stepper.move(distance);
+  long tick = 0;
+  while (stepper.run()) {
+    virtualUs += 10;
+    if (labs(stepper.currentPosition() - start) > labs(distance) / 2 && ++tick % 50 == 0 && slip != slipTo) {
+      slip += slipTo > slip ? 1 : -1;
+    }
+    check(out);
+  }
+  while (slip != slipTo) {
+    slip += slipTo > slip ? 1 : -1;
+    check(out);
+  }
+  check(out);
+  return out;
+}
+
+static void expect(const char* name, const Outcome& out, long warnings, long faults) {
+  bool ok = out.warnings == warnings && out.faults == faults;
+  printf("%-44s avert. %ld/%ld  défauts %ld/%ld  %s\n", name, out.warnings, warnings, out.faults, faults,
+         ok ? "" : "<- faux");
+  if (!ok) failures++;
+}
+
+static void resync() {
+  slip = 0;
+  following.sync(stepper.motorPosition(), encoderCount());
+}
+
+int main(int argc, char** argv) {
+  int slips = 200;
+  unsigned seed = 1;
+  for (int i = 1; i < argc; i++) {
+    if (strcmp(argv[i], "--slips") == 0 && i + 1 < argc) slips = max(1, atoi(argv[++i]));
+    else if (strcmp(argv[i], "--seed") == 0 && i + 1 < argc) seed = atoi(argv[++i]);
+    else {
+      fprintf(stderr, "usage: following_check [--slips N] [--seed S]\n");
+      return 1;
+    }
+  }
+
+  // Copie de main.c (section non incluse avec MOTION_CORE_ONLY)
+  float stepsPerMm = (STEPS_PER_REVOLUTION * MICROSTEPS) / LEAD_SCREW_PITCH;
+  following.stepsPerCount = (STEPS_PER_REVOLUTION * MICROSTEPS) / ENCODER_COUNTS_PER_REV;
+  following.warnSteps = max(1L, lround(FOLLOWING_WARN_MM * stepsPerMm));
+  following.faultSteps = max(2L, lround(FOLLOWING_FAULT_MM * stepsPerMm));
+  long warn = following.warnSteps;
+  long fault = following.faultSteps;
+  printf("%.3f pas/front, avertissement %ld pas, défaut %ld pas\n\n", following.stepsPerCount, warn, fault);
+
+  stepper.setMaxSpeed(4000);
+  stepper.setAcceleration(8000);
+  resync();
+
+  expect("sans glissement, aller", moveWithSlip(20000, 0), 0, 0);
+  expect("sans glissement, retour", moveWithSlip(-20000, 0), 0, 0);
+  if (following.peakError != 0) failures++;
+
+  for (int sign = 1; sign >= -1; sign -= 2) {
+    const char* dir = sign > 0 ? "+" : "-";
+    char name[64];
+    snprintf(name, sizeof(name), "glissement %s(warnSteps - 1)", dir);
+    resync();
+    expect(name, moveWithSlip(20000 * sign, sign * (warn - 1)), 0, 0);
+    snprintf(name, sizeof(name), "glissement %swarnSteps", dir);
+    resync();
+    expect(name, moveWithSlip(-20000 * sign, sign * warn), 1, 0);
+    snprintf(name, sizeof(name), "glissement %s(faultSteps - 1)", dir);
+    resync();
+    expect(name, moveWithSlip(20000 * sign, sign * (fault - 1)), 1, 0);
+    snprintf(name, sizeof(name), "glissement %sfaultSteps", dir);
+    resync();
+    expect(name, moveWithSlip(-20000 * sign, sign * fault), 1, 1);
+  }
+
+  // Hystérésis: retour à warnSteps / 2 sans réarmement, puis en dessous
+  resync();
+  Outcome h;
+  for (long to : { warn, warn / 2, warn, warn / 2 - 1, warn }) {
+    Outcome part = moveWithSlip(4000, to);
+    h.warnings += part.warnings;
+    h.faults += part.faults;
+  }
+  expect("avertissement réarmé sous warnSteps / 2", h, 2, 0);
+
+  // Défaut maintenu quand l'écart disparaît, effacé par le recalage
+  resync();
+  Outcome latch = moveWithSlip(20000, fault + 3);
+  Outcome back = moveWithSlip(-20000, 0);
+  latch.warnings += back.warnings;
+  latch.faults += back.faults;
+  expect("défaut mémorisé jusqu'au recalage", latch, 1, 1);
+  if (!following.fault || following.error != 0) failures++;
+  resync();
+  if (following.fault || following.error != 0) failures++;
+  expect("après recalage", moveWithSlip(20000, 0), 0, 0);
+
+  std::mt19937 rng(seed);
+  std::uniform_int_distribution<long> slipDist(-2 * fault, 2 * fault);
+  std::uniform_int_distribution<long> distDist(-20000, 20000);
+  long wrong = 0;
+  for (int i = 0; i < slips; i++) {
+    resync();
+    long to = slipDist(rng);
+    long distance = distDist(rng);
+    if (distance == 0) distance = 1;
+    Outcome out = moveWithSlip(distance, to);
+    long magnitude = labs(to);
+    if (out.warnings != (magnitude >= warn ? 1 : 0) || out.faults != (magnitude >= fault ? 1 : 0)) wrong++;
+  }
+  printf("%d glissements aléatoires, issues fausses: %ld\n", slips, wrong);
+  if (wrong != 0) failures++;
+
+  printf("%s\n", failures == 0 ? "ok" : "ÉCHEC");
+  return failures == 0 ? 0 : 1;
+}
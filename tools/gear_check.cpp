@@ -0,0 +1,180 @@
+// Vérification hôte de l'engrenage électronique (GearFollower dans main.c)
+//
+// Compilation: g++ -O2 -std=c++17 -o gear_check tools/gear_check.cpp
+// Usage:       gear_check [--ratio num/den] [--filter ms] [--loop-us N]
+//
+// Le suiveur et le générateur de pas du firmware (main.c inclus avec
+// MOTION_CORE_ONLY) tournent sur une horloge virtuelle avancée de --loop-us
+// (10) par tour, comme loop(): à chaque tour, le compteur maître simulé est
+// lu, GearFollower::update() donne la cible lissée et RampStepper::follow()
+// émet au plus un pas, à SPEED_MAX au plus, comme gearFollow().
+//
+// Flux maître simulés (impulsions entières, comme le PCNT): vitesse
+// constante, rampe, sinusoïde avec inversions, aller-retour. Contrôles:
+//  - exactitude: maître arrêté, l'axe est exactement sur
+//    origine + impulsions × num / den (aucune dérive, aucun pas perdu);
+//  - écart maximal pendant le suivi, sous le seuil d'arrêt;
+//  - limites: un maître qui pousse au-delà tient l'axe sur la limite,
+//    sans dépassement, puis le suivi reprend au retour.
+// Puis recherche du débit d'entrée maximal suivi sans arrêt sur écart,
+// pour le rapport et le lissage donnés, comparé à la borne théorique
+// (vitesse max de l'axe et un pas par tour de boucle, ramenés au maître).
+// Code de sortie 1 si un contrôle échoue.
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <functional>
+#include <string>
+#include <vector>
+
+#include "host_core.h"
+
+RampStepper<MotorDriver> stepper;
+
+void onStep(long position, int dir) {
+  (void)position;
+  (void)dir;
+}
+
+static uint32_t loopUs = 10;
+static uint32_t minIntervalUs = 0;
+static int failures = 0;
+
+// Position maître (impulsions, réelle) en fonction du temps écoulé (s)
+typedef std::function<double(double)> MasterProfile;
+
+struct Run {
+  long peakError = 0;
+  bool faulted = false;
+  bool overshoot = false;
+  bool limited = false;     // Consigne bornée au moins une fois
+  long finalAxis = 0;
+  long finalExact = 0;
+  float peakInputRate = 0;
+};
+
+// Suit le maître pendant "seconds", puis laisse le filtre se vider
+static Run follow(GearFollower& gear, const MasterProfile& master, double seconds) {
+  Run run;
+  stepper.setCurrentPosition(0);
+  gear.engage(0, 0, micros());
+  uint64_t start = virtualUs;
+  uint64_t end = start + (uint64_t)(seconds * 1e6);
+  uint64_t settle = end + 20 * gear.filterUs + 200000;
+  long count = 0;
+  while (virtualUs < settle) {
+    double t = (min(virtualUs, end) - start) * 1e-6;
+    count = (long)std::floor(master(t));
+    long target = gear.update(count, stepper.currentPosition(), micros());
+    stepper.follow(target, minIntervalUs);
+    if (gear.fault()) {
+      run.faulted = true;
+      break;
+    }
+    long pos = stepper.currentPosition();
+    if (pos > gear.maxSteps || pos < gear.minSteps) run.overshoot = true;
+    if (gear.limited) run.limited = true;
+    virtualUs += loopUs;
+  }
+  run.peakError = gear.peakError;
+  run.finalAxis = stepper.currentPosition();
+  long exact = gear.geared(count);
+  run.finalExact = max(gear.minSteps, min(gear.maxSteps, exact));
+  run.peakInputRate = gear.peakInputRate;
+  return run;
+}
+
+static GearFollower makeGear(int32_t num, int32_t den, float filterMs) {
+  GearFollower gear;
+  gear.num = num;
+  gear.den = den;
+  gear.filterUs = (uint32_t)(filterMs * 1000);
+  gear.faultSteps = max(1L, lround(GEAR_FAULT_MM * STEPS_PER_MM));
+  return gear;
+}
+
+static void report(const char* name, const Run& run, bool expectLimit) {
+  bool exact = run.finalAxis == run.finalExact;
+  bool ok = exact && !run.faulted && !run.overshoot && (!expectLimit || run.limited);
+  if (!ok) failures++;
+  printf("%-14s %10ld %10ld %10.0f %10ld  %s%s%s%s\n", name, run.finalAxis, run.finalExact, run.peakInputRate,
+         run.peakError, ok ? "ok" : "ÉCHEC", exact ? "" : " position", run.faulted ? " arrêt sur écart" : "",
+         run.overshoot ? " dépassement de limite" : "");
+}
+
+int main(int argc, char** argv) {
+  int32_t num = GEAR_NUM;
+  int32_t den = GEAR_DEN;
+  float filterMs = GEAR_FILTER_MS;
+  for (int i = 1; i < argc; i++) {
+    if (strcmp(argv[i], "--ratio") == 0 && i + 1 < argc) {
+      if (sscanf(argv[++i], "%d/%d", &num, &den) != 2 || num == 0 || den < 1) {
+        fprintf(stderr, "rapport invalide: %s\n", argv[i]);
+        return 1;
+      }
+    } else if (strcmp(argv[i], "--filter") == 0 && i + 1 < argc) {
+      filterMs = atof(argv[++i]);
+    } else if (strcmp(argv[i], "--loop-us") == 0 && i + 1 < argc) {
+      loopUs = max(1, atoi(argv[++i]));
+    } else {
+      fprintf(stderr, "usage: gear_check [--ratio num/den] [--filter ms] [--loop-us N]\n");
+      return 1;
+    }
+  }
+
+  minIntervalUs = (uint32_t)(60000000.0 / (SPEED_MAX * STEPS_PER_MM));
+  double axisMaxRate = min(1e6 / minIntervalUs, 1e6 / loopUs);  // pas/s
+  double masterMaxRate = axisMaxRate * den / std::fabs((double)num);
+  double rate = masterMaxRate / 2;  // Débit des scénarios: moitié de la borne
+
+  printf("rapport %d/%d, lissage %.1f ms, boucle %u µs, seuil d'écart %ld pas\n", num, den, filterMs, loopUs,
+         makeGear(num, den, filterMs).faultSteps);
+  printf("%-14s %10s %10s %10s %10s\n", "scénario", "axe", "attendu", "imp/s max", "écart max");
+
+  struct Scenario {
+    const char* name;
+    MasterProfile master;
+    double seconds;
+    bool limits;
+  };
+  std::vector<Scenario> scenarios = {
+    { "constant", [&](double t) { return rate * t; }, 1.0, false },
+    { "rampe", [&](double t) { return t < 0.5 ? rate * t * t : rate * (t - 0.25); }, 1.5, false },
+    { "sinus", [&](double t) { return rate / (2 * M_PI * 2) * std::sin(2 * M_PI * 2 * t); }, 2.2, false },
+    { "aller-retour", [&](double t) { return t < 1 ? rate * t : rate * (2 - t); }, 2.0, false },
+    { "limite", [&](double t) { return t < 1.5 ? rate * t : rate * (3 - t); }, 2.5, true },
+  };
+  for (Scenario& sc : scenarios) {
+    GearFollower gear = makeGear(num, den, filterMs);
+    if (sc.limits) {
+      // Limite franchie vers la moitié de l'aller, reprise au retour
+      long reach = std::labs(gear.geared((long)(rate * 0.75)));
+      gear.maxSteps = num > 0 ? reach : LONG_MAX;
+      gear.minSteps = num > 0 ? LONG_MIN : -reach;
+    }
+    Run run = follow(gear, sc.master, sc.seconds);
+    report(sc.name, run, sc.limits);
+  }
+
+  // Débit d'entrée maximal suivi: vitesse maître constante, établie en 50 ms
+  double low = 0;
+  double high = masterMaxRate * 2;
+  for (int i = 0; i < 24; i++) {
+    double test = (low + high) / 2;
+    GearFollower gear = makeGear(num, den, filterMs);
+    auto ramped = [&](double t) { return t < 0.05 ? test * t * t / 0.1 : test * (t - 0.025); };
+    Run run = follow(gear, ramped, 2.0);
+    if (run.faulted || run.finalAxis != run.finalExact) high = test;
+    else low = test;
+  }
+  printf("\ndébit d'entrée maximal suivi: %.0f imp/s (borne théorique %.0f imp/s: axe %.0f pas/s)\n", low,
+         masterMaxRate, axisMaxRate);
+  if (low < masterMaxRate * 0.9) failures++;
+
+  printf("%s\n", failures == 0 ? "ok" : "ÉCHEC");
+  return failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,44 @@
+// Cœur de mouvement du firmware (main.c avec MOTION_CORE_ONLY) pour les
+// outils hôte
+//
+// En-tête seul, inclus une fois par outil, avant tout usage du cœur:
+//
+//   #include "host_core.h"
+//   RampStepper<MotorDriver> stepper;
+//
+// Par défaut, micros() et millis() lisent l'horloge virtuelle virtualUs,
+// que l'outil avance lui-même (contrôles reproductibles, sans attente).
+// Avec HOST_CORE_WALL_CLOCK défini avant l'inclusion, elles lisent
+// l'horloge monotone de l'hôte (stand-ins réseau).
+
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+
+// Ce que main.c attend de l'environnement Arduino, en version hôte
+typedef std::string String;
+using std::abs;
+using std::max;
+using std::min;
+
+#ifdef HOST_CORE_WALL_CLOCK
+#include <chrono>
+
+typedef std::chrono::steady_clock Clock;
+static const Clock::time_point origin = Clock::now();
+unsigned long micros() {
+  return (unsigned long)std::chrono::duration_cast<std::chrono::microseconds>(Clock::now() - origin).count();
+}
+#else
+static uint64_t virtualUs = 1000000;
+unsigned long micros() { return virtualUs; }
+#endif
+unsigned long millis() { return micros() / 1000; }
+
+#define MOTION_CORE_ONLY
+#include "../main.c"
@@ -0,0 +1,255 @@
+// Vérification hôte de la marche continue (startContinuous() dans main.c)
+//
+// Compilation: g++ -O2 -std=c++17 -o jog_check tools/jog_check.cpp
+// Usage:       jog_check [--speed mm/min] [--tolerance %] [--csv scénario]
+//
+// Le générateur de pas du firmware (main.c inclus avec MOTION_CORE_ONLY)
+// tourne sur une horloge virtuelle avancée d'1 µs par appel: les pas sont
+// émis exactement à l'intervalle commandé. Chaque scénario pilote l'axe
+// comme startContinuous() et stopContinuous(): démarrage, inversion (à la
+// même vitesse ou à une autre, donc avec changement d'accélération en
+// pleine décélération), changement de vitesse, reprise d'un déplacement,
+// arrêt sur la limite logicielle.
+//
+// Contrôles, sur la position en fonction du temps:
+//  - saut de vitesse: entre deux pas, la vitesse (1 pas / intervalle) ne
+//    varie pas plus que l'accélération ne le permet, à l'arrondi d'1 µs près;
+//  - accélération: vitesse moyenne sur des fenêtres de 10 ms (égale à la
+//    vitesse au milieu de la fenêtre sous accélération constante), dérivée
+//    entre fenêtres voisines, bornée par l'accélération programmée;
+//  - vitesse maximale et, pour la limite, arrêt exact sans dépassement.
+// Code de sortie 1 si un contrôle échoue. --csv écrit les pas d'un scénario
+// (temps µs, position) sur la sortie d'erreur, le tableau restant sur la sortie standard.
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <functional>
+#include <string>
+#include <vector>
+
+#include "host_core.h"
+
+#define CONTINUOUS_HORIZON_STEPS 1000000L
+#define WINDOW_US 10000
+
+struct StepSample {
+  uint64_t timeUs;
+  long position;
+};
+
+RampStepper<MotorDriver> stepper;
+std::vector<StepSample> samples;
+
+void onStep(long position, int dir) {
+  samples.push_back({ virtualUs, position });
+  (void)dir;
+}
+
+// ===== COMMANDES (copies de main.c) =====
+
+int moveDirection = 1;
+
+long continuousTarget(int direction) {
+  if (SOFT_LIMITS_ENABLED) {
+    return lround((direction > 0 ? SOFT_LIMIT_MAX : SOFT_LIMIT_MIN) * STEPS_PER_MM);
+  }
+  return stepper.currentPosition() + direction * CONTINUOUS_HORIZON_STEPS;
+}
+
+bool startContinuous(int direction, float speed) {
+  long target = continuousTarget(direction);
+  if ((target - stepper.currentPosition()) * direction <= 0) return false;
+  float speedStepsPerSec = (speed * STEPS_PER_MM) / 60.0;
+  moveDirection = direction;
+  stepper.setMaxSpeed(speedStepsPerSec);
+  stepper.setAcceleration(speedStepsPerSec * ACCEL_FACTOR);
+  stepper.moveTo(target);
+  return true;
+}
+
+void startMove(float distance, float speed) {
+  float speedStepsPerSec = (speed * STEPS_PER_MM) / 60.0;
+  stepper.setMaxSpeed(speedStepsPerSec);
+  stepper.setAcceleration(speedStepsPerSec * ACCEL_FACTOR);
+  stepper.move((long)(distance * STEPS_PER_MM));
+}
+
+// Vitesse programmée, comme la rampe de correction d'avance une fois rejointe
+void setSpeed(float speed) {
+  stepper.setMaxSpeed((speed * STEPS_PER_MM) / 60.0);
+}
+
+// ===== SCÉNARIOS =====
+
+struct Scenario {
+  const char* name;
+  bool limits;
+  std::function<void()> run;
+  float maxSpeed;   // mm/min, plus grande vitesse commandée
+  float maxAccel;   // steps/s², plus grande accélération commandée
+  long limitSteps;  // Position d'arrêt attendue (limites actives)
+};
+
+static void runFor(double ms) {
+  uint64_t end = virtualUs + (uint64_t)(ms * 1000);
+  while (virtualUs < end) {
+    stepper.run();
+    virtualUs++;
+  }
+}
+
+static void runToStop() {
+  while (stepper.isRunning()) {
+    stepper.run();
+    virtualUs++;
+  }
+}
+
+struct Result {
+  size_t steps = 0;
+  double peakSpeed = 0;    // steps/s, fenêtres de 10 ms
+  double peakAccel = 0;    // steps/s², fenêtres de 10 ms
+  double worstJump = 0;    // Saut de vitesse entre deux pas / saut permis
+  long finalPosition = 0;
+  long extreme = 0;        // Position la plus loin dans le sens de la limite
+};
+
+static Result analyse(double accel) {
+  Result r;
+  r.steps = samples.size();
+  r.finalPosition = stepper.currentPosition();
+  for (const StepSample& s : samples) r.extreme = max(r.extreme, s.position);
+
+  // Vitesse entre pas successifs: un saut au-delà de a·Δt (plus l'arrondi
+  // d'1 µs de chacun des deux intervalles) est une discontinuité
+  for (size_t i = 2; i < samples.size(); i++) {
+    double dt1 = (samples[i - 1].timeUs - samples[i - 2].timeUs) * 1e-6;
+    double dt2 = (samples[i].timeUs - samples[i - 1].timeUs) * 1e-6;
+    double v1 = (samples[i - 1].position - samples[i - 2].position) / dt1;
+    double v2 = (samples[i].position - samples[i - 1].position) / dt2;
+    double allowed = accel * (dt1 + dt2) / 2 + 1e-6 * (v1 * v1 + v2 * v2);
+    r.worstJump = max(r.worstJump, std::fabs(v2 - v1) / allowed);
+  }
+
+  // Vitesse moyenne par fenêtre alignée sur les pas
+  std::vector<std::pair<double, double>> windows;  // (milieu s, vitesse)
+  size_t begin = 0;
+  for (size_t i = 1; i < samples.size(); i++) {
+    if (samples[i].timeUs - samples[begin].timeUs < WINDOW_US) continue;
+    double dt = (samples[i].timeUs - samples[begin].timeUs) * 1e-6;
+    double mid = (samples[i].timeUs + samples[begin].timeUs) * 0.5e-6;
+    windows.push_back({ mid, (samples[i].position - samples[begin].position) / dt });
+    begin = i;
+  }
+  for (size_t i = 0; i < windows.size(); i++) {
+    r.peakSpeed = max(r.peakSpeed, std::fabs(windows[i].second));
+    if (i == 0) continue;
+    double a = (windows[i].second - windows[i - 1].second) / (windows[i].first - windows[i - 1].first);
+    r.peakAccel = max(r.peakAccel, std::fabs(a));
+  }
+  return r;
+}
+
+int main(int argc, char** argv) {
+  float speed = SPEED_MAX;
+  double tolerance = 5;
+  const char* csvScenario = nullptr;
+  for (int i = 1; i < argc; i++) {
+    if (strcmp(argv[i], "--speed") == 0 && i + 1 < argc) speed = atof(argv[++i]);
+    else if (strcmp(argv[i], "--tolerance") == 0 && i + 1 < argc) tolerance = atof(argv[++i]);
+    else if (strcmp(argv[i], "--csv") == 0 && i + 1 < argc) csvScenario = argv[++i];
+    else {
+      fprintf(stderr, "usage: jog_check [--speed mm/min] [--tolerance %%] [--csv scénario]\n");
+      return 1;
+    }
+  }
+
+  float slow = max(SPEED_MIN, speed / 4);
+  auto accelOf = [](float mmPerMin) -> float { return mmPerMin * STEPS_PER_MM / 60.0 * ACCEL_FACTOR; };
+  long limit = lround(SOFT_LIMIT_MAX * STEPS_PER_MM);
+
+  std::vector<Scenario> scenarios = {
+    { "demarrage", false, [&] {
+        startContinuous(1, speed);
+        runFor(1000);
+        stepper.stop();
+        runToStop();
+      }, speed, accelOf(speed), 0 },
+    { "inversion", false, [&] {
+        startContinuous(1, speed);
+        runFor(1000);
+        startContinuous(-1, speed);
+        runFor(1500);
+        stepper.stop();
+        runToStop();
+      }, speed, accelOf(speed), 0 },
+    { "inversion-lente", false, [&] {
+        startContinuous(1, speed);
+        runFor(1000);
+        startContinuous(-1, slow);
+        runFor(3000);
+        startContinuous(1, speed);
+        runFor(1000);
+        stepper.stop();
+        runToStop();
+      }, speed, accelOf(speed), 0 },
+    { "vitesse", false, [&] {
+        startContinuous(1, slow);
+        runFor(1000);
+        setSpeed(speed);
+        runFor(1000);
+        setSpeed(slow);
+        runFor(1000);
+        stepper.stop();
+        runToStop();
+      }, speed, accelOf(slow), 0 },
+    { "reprise", false, [&] {
+        startMove(50, speed);
+        runFor(300);
+        startContinuous(-1, speed);
+        runFor(1500);
+        stepper.stop();
+        runToStop();
+      }, speed, accelOf(speed), 0 },
+    { "limite", true, [&] {
+        startContinuous(1, speed);
+        runToStop();
+      }, speed, accelOf(speed), limit },
+  };
+
+  printf("%-16s %8s %12s %12s %10s %10s  %s\n", "scénario", "pas", "v max st/s", "a max st/s²", "a/a prog",
+         "saut/perm", "résultat");
+  int failures = 0;
+  for (Scenario& sc : scenarios) {
+    samples.clear();
+    SOFT_LIMITS_ENABLED = sc.limits;
+    // Départ: à l'origine, ou à 20 mm de la limite
+    long start = sc.limits ? limit - lround(20 * STEPS_PER_MM) : 0;
+    stepper.setCurrentPosition(start);
+    samples.push_back({ virtualUs, start });
+    sc.run();
+
+    Result r = analyse(sc.maxAccel);
+    double speedLimit = sc.maxSpeed * STEPS_PER_MM / 60.0;
+    double margin = 1 + tolerance / 100;
+    std::string verdict;
+    if (r.worstJump > margin) verdict += " saut de vitesse";
+    if (r.peakAccel > sc.maxAccel * margin) verdict += " accélération";
+    if (r.peakSpeed > speedLimit * margin) verdict += " vitesse";
+    if (sc.limits && (r.finalPosition != sc.limitSteps || r.extreme > sc.limitSteps)) {
+      verdict += " limite (arrêt " + std::to_string(r.finalPosition) + ", max " + std::to_string(r.extreme) + ")";
+    }
+    if (!verdict.empty()) failures++;
+    printf("%-16s %8zu %12.0f %12.0f %10.3f %10.3f  %s\n", sc.name, r.steps - 1, r.peakSpeed, r.peakAccel,
+           r.peakAccel / sc.maxAccel, r.worstJump, verdict.empty() ? "ok" : ("ÉCHEC:" + verdict).c_str());
+
+    if (csvScenario && strcmp(csvScenario, sc.name) == 0) {
+      for (const StepSample& s : samples) fprintf(stderr, "%llu,%ld\n", (unsigned long long)s.timeUs, s.position);
+    }
+  }
+  return failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,149 @@
+// Client Linux du protocole jog UDP (voir "PROTOCOLE JOG BINAIRE" dans main.c)
+//
+// Compilation: g++ -O2 -std=c++17 -o jog_client tools/jog_client.cpp
+// Usage:       jog_client <ip> <vitesse mm/min> <durée ms> [période heartbeat ms] [--drop]
+//
+// Envoie des paquets JOG à la période donnée pendant la durée, puis STOP.
+// Avec --drop, n'envoie pas de STOP: vérifie que l'homme-mort arrête l'axe.
+// Affiche le temps aller-retour des acquittements et la latence
+// commande -> premier pas mesurée par le firmware.
+
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <map>
+#include <thread>
+
+#define JOG_UDP_PORT 4210
+#define JOG_MAGIC 0xA5
+#define JOG_VERSION 1
+#define JOG_CMD_JOG 1
+#define JOG_CMD_STOP 2
+#define JOG_CMD_HEARTBEAT 3
+#define JOG_ACK 0x80
+
+struct __attribute__((packed)) JogPacket {
+  uint8_t magic;
+  uint8_t version;
+  uint8_t type;
+  uint8_t flags;
+  uint16_t seq;
+  uint16_t latencyUs;
+  int32_t value;
+};
+static_assert(sizeof(JogPacket) == 12, "JogPacket doit faire 12 octets");
+
+typedef std::chrono::steady_clock Clock;
+
+static int sock = -1;
+static sockaddr_in device;
+static uint16_t seq = 0;
+static std::map<uint16_t, Clock::time_point> pending;
+
+static double rttMin = 1e9, rttMax = 0, rttSum = 0;
+static unsigned long acks = 0;
+static unsigned latencyMax = 0;
+static JogPacket lastAck;
+
+static void sendPacket(uint8_t type, int32_t value) {
+  JogPacket pkt;
+  pkt.magic = JOG_MAGIC;
+  pkt.version = JOG_VERSION;
+  pkt.type = type;
+  pkt.flags = 0;
+  pkt.seq = ++seq;
+  pkt.latencyUs = 0;
+  pkt.value = value;
+  pending[pkt.seq] = Clock::now();
+  sendto(sock, &pkt, sizeof(pkt), 0, (sockaddr*)&device, sizeof(device));
+}
+
+static void receiveAcks(int timeoutMs) {
+  pollfd pfd = { sock, POLLIN, 0 };
+  while (poll(&pfd, 1, timeoutMs) > 0) {
+    JogPacket ack;
+    if (recv(sock, &ack, sizeof(ack), 0) != sizeof(ack)) continue;
+    if (ack.magic != JOG_MAGIC || !(ack.type & JOG_ACK)) continue;
+
+    auto it = pending.find(ack.seq);
+    if (it != pending.end()) {
+      double rtt = std::chrono::duration<double, std::milli>(Clock::now() - it->second).count();
+      rttMin = std::min(rttMin, rtt);
+      rttMax = std::max(rttMax, rtt);
+      rttSum += rtt;
+      acks++;
+      pending.erase(it);
+    }
+    latencyMax = std::max<unsigned>(latencyMax, ack.latencyUs);
+    lastAck = ack;
+    timeoutMs = 0;
+  }
+}
+
+int main(int argc, char** argv) {
+  if (argc < 4) {
+    fprintf(stderr, "Usage: %s <ip> <vitesse mm/min> <durée ms> [période heartbeat ms] [--drop]\n", argv[0]);
+    return 1;
+  }
+
+  float speed = atof(argv[2]);
+  int durationMs = atoi(argv[3]);
+  int periodMs = 50;
+  bool drop = false;
+  for (int i = 4; i < argc; i++) {
+    if (strcmp(argv[i], "--drop") == 0) drop = true;
+    else periodMs = atoi(argv[i]);
+  }
+
+  sock = socket(AF_INET, SOCK_DGRAM, 0);
+  memset(&device, 0, sizeof(device));
+  device.sin_family = AF_INET;
+  device.sin_port = htons(JOG_UDP_PORT);
+  if (sock < 0 || inet_pton(AF_INET, argv[1], &device.sin_addr) != 1) {
+    fprintf(stderr, "Adresse invalide: %s\n", argv[1]);
+    return 1;
+  }
+
+  int32_t velocity = (int32_t)(speed * 100.0f);
+  auto start = Clock::now();
+  auto next = start;
+  unsigned long sent = 0;
+
+  while (Clock::now() - start < std::chrono::milliseconds(durationMs)) {
+    sendPacket(JOG_CMD_JOG, velocity);
+    sent++;
+    next += std::chrono::milliseconds(periodMs);
+    auto wait = std::chrono::duration_cast<std::chrono::milliseconds>(next - Clock::now()).count();
+    receiveAcks(std::max<long>(0, wait));
+  }
+
+  if (drop) {
+    // Silence volontaire: l'axe doit s'arrêter seul après la fenêtre homme-mort
+    std::this_thread::sleep_for(std::chrono::milliseconds(1000));
+    receiveAcks(0);
+    sendPacket(JOG_CMD_HEARTBEAT, 0);
+  } else {
+    sendPacket(JOG_CMD_STOP, 0);
+  }
+  sent++;
+  receiveAcks(200);
+
+  printf("Paquets envoyés: %lu, acquittés: %lu\n", sent, acks);
+  if (acks > 0) {
+    printf("Aller-retour: min %.2f ms, moy %.2f ms, max %.2f ms\n", rttMin, rttSum / acks, rttMax);
+  }
+  printf("Latence commande -> premier pas: dernière %u µs, max %u µs\n", lastAck.latencyUs, latencyMax);
+  printf("Position finale: %d steps, %s\n", lastAck.value, (lastAck.flags & 0x01) ? "EN MOUVEMENT" : "arrêté");
+
+  close(sock);
+  return drop && (lastAck.flags & 0x01) ? 2 : 0;
+}
@@ -0,0 +1,367 @@
+// Vérification hôte du jog UDP: latence et homme-mort (JogSession dans main.c)
+//
+// Compilation: g++ -O2 -std=c++17 -o jog_latency_check tools/jog_latency_check.cpp
+// Usage:       jog_latency_check [--speed mm/min] [--seed S]
+//
+// Le protocole jog (JogSession: contrôle du paquet, séquence, session,
+// fenêtre homme-mort) et le générateur de pas du firmware (main.c inclus
+// avec MOTION_CORE_ONLY) tournent sur une horloge virtuelle, comme loop():
+// un tour toutes les 10 µs, relève des datagrammes arrivés comme
+// handleJogUdp(), puis le pas de la marche continue. Un client envoie
+// JOG puis des HEARTBEAT toutes les 50 ms (±20 ms, 10 % perdus) pendant
+// 1 s, puis se tait. Scénarios: départ, reprise après l'homme-mort (autre
+// port, séquence repartie de 0), inversion tardive rejouée avec une
+// séquence périmée, STOP à séquence périmée, second expéditeur pendant un
+// jog (séquence plus basse), paquets malformés.
+//
+// Contrôles:
+//  - premier pas (onStep(), appelé par le générateur au front STEP) à
+//    moins de 10 ms du paquet JOG reçu à l'arrêt;
+//  - pas d'arrêt tant que les paquets arrivent dans la fenêtre;
+//  - homme-mort déclenché entre JOG_HEARTBEAT_MS et JOG_HEARTBEAT_MS + 2 ms
+//    après le dernier paquet, puis axe arrêté sur la rampe (vitesse /
+//    accélération, + 10 %) sans pas dans l'autre sens;
+//  - paquet périmé ou malformé écarté, STOP appliqué même périmé;
+//  - séquence d'un nouvel expéditeur acceptée sans attendre la fenêtre.
+// Code de sortie 1 si un contrôle échoue.
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <deque>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "host_core.h"
+
+#define CONTINUOUS_HORIZON_STEPS 1000000L
+#define LOOP_US 10
+#define FIRST_STEP_MAX_US 10000
+#define HEARTBEAT_US 50000
+#define HEARTBEAT_JITTER_US 20000
+#define HEARTBEAT_LOSS 0.1
+#define STREAM_US 1000000
+#define DEADMAN_SLACK_US 2000
+
+RampStepper<MotorDriver> stepper;
+
+struct StepSample {
+  uint64_t timeUs;
+  int dir;
+};
+static std::vector<StepSample> steps;
+
+void onStep(long, int dir) { steps.push_back({ virtualUs, dir }); }
+
+// ===== RÉSEAU =====
+
+struct Datagram {
+  uint64_t atUs;
+  JogPacket pkt;
+  int size;
+  uint32_t ip;
+  uint16_t port;
+};
+static std::deque<Datagram> network;  // Par heure d'arrivée
+
+struct Client {
+  uint32_t ip;
+  uint16_t port;
+  uint16_t seq;
+
+  Datagram packet(uint8_t type, int32_t value, uint64_t atUs) {
+    Datagram d = {};
+    d.atUs = atUs;
+    d.pkt.magic = JOG_MAGIC;
+    d.pkt.version = JOG_VERSION;
+    d.pkt.type = type;
+    d.pkt.seq = ++seq;
+    d.pkt.value = value;
+    d.size = sizeof(JogPacket);
+    d.ip = ip;
+    d.port = port;
+    return d;
+  }
+};
+
+static void deliver(const Datagram& d) {
+  auto at = std::upper_bound(network.begin(), network.end(), d,
+                             [](const Datagram& a, const Datagram& b) { return a.atUs < b.atUs; });
+  network.insert(at, d);
+}
+
+// ===== COMMANDES (copies de main.c) =====
+
+FeedRamp feedRamp;
+bool isRunning = false;
+bool continuousMode = false;
+bool movingToTarget = false;
+bool jogActive = false;
+int moveDirection = 1;
+unsigned long jogCmdMicros = 0;
+unsigned long jogLatencyLast = 0;
+JogSession jog;
+uint64_t deadmanAtUs = 0;  // Dernier déclenchement de l'homme-mort
+
+void stopMotor() {
+  stepper.setCurrentPosition(stepper.currentPosition());
+  isRunning = false;
+  movingToTarget = false;
+  continuousMode = false;
+  jogActive = false;
+  jogCmdMicros = 0;
+}
+
+long continuousTarget(int direction) { return stepper.currentPosition() + direction * CONTINUOUS_HORIZON_STEPS; }
+
+bool startContinuous(int direction, float speedStepsPerSec) {
+  long target = continuousTarget(direction);
+  moveDirection = direction;
+  stepper.setMaxSpeed(feedRamp.begin(speedStepsPerSec, speedStepsPerSec * ACCEL_FACTOR, 100, micros()));
+  stepper.setAcceleration(speedStepsPerSec * ACCEL_FACTOR);
+  stepper.moveTo(target);
+  movingToTarget = false;
+  continuousMode = true;
+  isRunning = true;
+  return true;
+}
+
+void stopContinuous() {
+  if (!continuousMode) return;
+  stepper.stop();
+  continuousMode = false;
+  jogActive = false;
+  jogCmdMicros = 0;
+  movingToTarget = true;
+}
+
+void startJog(float speed) {
+  int direction = speed >= 0 ? 1 : -1;
+  float speedStepsPerSec = (abs(speed) * STEPS_PER_MM) / 60.0;
+  if (jogActive && moveDirection == direction) {
+    feedRamp.baseSpeed = speedStepsPerSec;
+    return;
+  }
+  if (!startContinuous(direction, speedStepsPerSec)) {
+    stopContinuous();
+    return;
+  }
+  jogCmdMicros = micros();
+  jogActive = true;
+}
+
+void handleJogUdp() {
+  while (!network.empty() && network.front().atUs <= virtualUs) {
+    Datagram d = network.front();
+    network.pop_front();
+    if (!jog.accept(d.pkt, d.size, d.ip, d.port, millis())) continue;
+    if (d.pkt.type == JOG_CMD_JOG) {
+      float speed = JogSession::speed(d.pkt);
+      if (speed == 0) {
+        if (jogActive) stopContinuous();
+      } else {
+        startJog(speed);
+      }
+    } else if (d.pkt.type == JOG_CMD_STOP) {
+      stopMotor();
+    }
+  }
+  if (jog.expired(jogActive, millis())) {
+    deadmanAtUs = virtualUs;
+    stopContinuous();
+  }
+}
+
+// Un tour de loop(): réseau, puis pas de la marche continue ou de la fin
+// de rampe
+static void loopOnce() {
+  handleJogUdp();
+  if (isRunning) {
+    if (continuousMode) {
+      long before = stepper.currentPosition();
+      stepper.run();
+      if (jogCmdMicros != 0 && stepper.currentPosition() != before) {
+        jogLatencyLast = micros() - jogCmdMicros;
+        jogCmdMicros = 0;
+      }
+    } else if (movingToTarget) {
+      stepper.run();
+      static unsigned long lastCheck = 0;
+      if (millis() - lastCheck > 50) {
+        lastCheck = millis();
+        if (stepper.distanceToGo() == 0) {
+          isRunning = false;
+          movingToTarget = false;
+        }
+      }
+    }
+  }
+  virtualUs += LOOP_US;
+}
+
+static void runUntil(uint64_t t) {
+  while (virtualUs < t) loopOnce();
+}
+
+// ===== SCÉNARIOS =====
+
+static std::mt19937 rng;
+static int failures = 0;
+
+static void verdict(const char* name, const std::string& problems) {
+  if (!problems.empty()) failures++;
+  printf("%-22s %s\n", name, problems.empty() ? "ok" : ("ÉCHEC:" + problems).c_str());
+}
+
+// Premier pas émis à partir de l'instant from (µs), 0 si aucun
+static uint64_t firstStepAfter(uint64_t from) {
+  for (const StepSample& s : steps) {
+    if (s.timeUs >= from) return s.timeUs;
+  }
+  return 0;
+}
+
+// JOG à l'arrêt, flux de HEARTBEAT pendant STREAM_US puis silence; contrôle
+// latence, absence d'arrêt pendant le flux, homme-mort et arrêt sur la rampe
+static std::string jogSession(Client& client, float speed) {
+  std::string problems;
+  std::uniform_int_distribution<int> jitter(-HEARTBEAT_JITTER_US, HEARTBEAT_JITTER_US);
+  std::uniform_real_distribution<double> loss(0, 1);
+
+  steps.clear();
+  uint64_t start = virtualUs + 1000;
+  deliver(client.packet(JOG_CMD_JOG, lround(speed * 100), start));
+  uint64_t last = start;
+  for (uint64_t t = start + HEARTBEAT_US; t < start + STREAM_US; t += HEARTBEAT_US) {
+    if (loss(rng) < HEARTBEAT_LOSS) continue;
+    // Retard borné: l'écart entre deux paquets reçus reste dans la fenêtre
+    uint64_t at = max(last + 1, min(last + JOG_HEARTBEAT_MS * 1000 - 30000, t + jitter(rng)));
+    deliver(client.packet(JOG_CMD_HEARTBEAT, 0, at));
+    last = at;
+  }
+
+  runUntil(last + 1);
+  uint64_t first = firstStepAfter(start);
+  uint64_t latency = first == 0 ? UINT64_MAX : first - start;
+  if (latency > FIRST_STEP_MAX_US) problems += " premier pas";
+  if (!continuousMode || deadmanAtUs > start) problems += " arrêt pendant le flux";
+
+  uint64_t deadline = last + (JOG_HEARTBEAT_MS * 1000 + DEADMAN_SLACK_US);
+  float stepsPerSec = abs(speed) * STEPS_PER_MM / 60.0;
+  uint64_t rampUs = (uint64_t)(stepsPerSec / (stepsPerSec * ACCEL_FACTOR) * 1.1e6);
+  runUntil(deadline + rampUs);
+  uint64_t trip = deadmanAtUs > last ? deadmanAtUs - last : 0;
+  if (trip <= JOG_HEARTBEAT_MS * 1000 || trip > JOG_HEARTBEAT_MS * 1000 + DEADMAN_SLACK_US) {
+    problems += " homme-mort";
+  }
+  if (isRunning || stepper.isRunning() || steps.back().timeUs > deadmanAtUs + rampUs) problems += " axe non arrêté";
+  int dir = speed > 0 ? 1 : -1;
+  for (const StepSample& s : steps) {
+    if (s.dir != dir) {
+      problems += " pas à rebours";
+      break;
+    }
+  }
+
+  printf("  latence %.3f ms (boucle %.3f ms), homme-mort %.1f ms après le dernier paquet, %zu pas\n",
+         latency == UINT64_MAX ? -1.0 : latency / 1000.0, jogLatencyLast / 1000.0, trip / 1000.0, steps.size());
+  return problems;
+}
+
+int main(int argc, char** argv) {
+  float speed = SPEED_MAX;
+  unsigned seed = 1;
+  for (int i = 1; i < argc; i++) {
+    if (strcmp(argv[i], "--speed") == 0 && i + 1 < argc) speed = atof(argv[++i]);
+    else if (strcmp(argv[i], "--seed") == 0 && i + 1 < argc) seed = atoi(argv[++i]);
+    else {
+      fprintf(stderr, "usage: jog_latency_check [--speed mm/min] [--seed S]\n");
+      return 1;
+    }
+  }
+  rng.seed(seed);
+  SOFT_LIMITS_ENABLED = false;
+
+  Client pendant = { 0x0A00000A, 50000, 0 };
+  verdict("depart", jogSession(pendant, speed));
+
+  // Autre port, séquence repartie de 0 après le silence: nouvelle session
+  Client reprise = { 0x0A00000A, 50001, 0 };
+  verdict("reprise", jogSession(reprise, -speed));
+
+  // Inversion envoyée avant un JOG plus récent mais reçue après lui:
+  // périmée, elle est écartée
+  {
+    std::string problems;
+    Client client = { 0x0A00000B, 50000, 0 };
+    steps.clear();
+    unsigned long rejected = jog.rejected;
+    Datagram reverse = client.packet(JOG_CMD_JOG, lround(-speed * 100), 0);
+    Datagram forward = client.packet(JOG_CMD_JOG, lround(speed * 100), virtualUs + 1000);
+    reverse.atUs = forward.atUs + 5000;
+    deliver(forward);
+    deliver(reverse);
+    runUntil(reverse.atUs + 100000);
+    if (jog.rejected != rejected + 1) problems += " paquet périmé appliqué";
+    if (moveDirection != 1) problems += " inversion";
+
+    // STOP périmé: appliqué quand même, aucun pas ensuite
+    Datagram stop = client.packet(JOG_CMD_STOP, 0, 0);
+    stop.pkt.seq = forward.pkt.seq - 1;
+    stop.atUs = virtualUs + 1000;
+    deliver(stop);
+    runUntil(stop.atUs + 100000);
+    if (isRunning || jogActive) problems += " STOP ignoré";
+    if (!steps.empty() && steps.back().timeUs > stop.atUs + LOOP_US) problems += " pas après STOP";
+    verdict("perime-stop", problems);
+    runUntil(virtualUs + JOG_HEARTBEAT_MS * 2000);
+  }
+
+  // Second expéditeur pendant le jog d'un premier (autre port, séquence
+  // plus basse): nouvelle session, sa commande est appliquée
+  {
+    std::string problems;
+    Client first = { 0x0A00000D, 50000, 100 };
+    Client second = { 0x0A00000D, 50001, 0 };
+    Datagram forward = first.packet(JOG_CMD_JOG, lround(speed * 100), virtualUs + 1000);
+    Datagram reverse = second.packet(JOG_CMD_JOG, lround(-speed * 100), forward.atUs + 50000);
+    deliver(forward);
+    deliver(reverse);
+    runUntil(reverse.atUs + LOOP_US * 2);
+    if (moveDirection != -1) problems += " commande du second expéditeur écartée";
+    deliver(second.packet(JOG_CMD_STOP, 0, virtualUs + 1000));
+    runUntil(virtualUs + 100000);
+    if (isRunning) problems += " STOP ignoré";
+    verdict("autre-expediteur", problems);
+    runUntil(virtualUs + JOG_HEARTBEAT_MS * 2000);
+  }
+
+  // Paquets malformés: ni mouvement ni réarmement
+  {
+    std::string problems;
+    Client client = { 0x0A00000C, 50000, 0 };
+    steps.clear();
+    unsigned long rejected = jog.rejected;
+    Datagram shortPacket = client.packet(JOG_CMD_JOG, lround(speed * 100), virtualUs + 1000);
+    shortPacket.size = sizeof(JogPacket) - 1;
+    Datagram badMagic = client.packet(JOG_CMD_JOG, lround(speed * 100), virtualUs + 2000);
+    badMagic.pkt.magic = 0x5A;
+    Datagram badType = client.packet(9, lround(speed * 100), virtualUs + 3000);
+    deliver(shortPacket);
+    deliver(badMagic);
+    deliver(badType);
+    runUntil(virtualUs + 100000);
+    if (jog.rejected != rejected + 3) problems += " paquet malformé accepté";
+    if (!steps.empty() || isRunning) problems += " mouvement";
+    verdict("malformes", problems);
+  }
+
+  printf("%lu paquets acceptés, %lu écartés, %lu déclenchements de l'homme-mort\n", jog.packets, jog.rejected,
+         jog.deadmanTrips);
+  printf("%s\n", failures == 0 ? "ok" : "ÉCHEC");
+  return failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,274 @@
+// Maître Modbus TCP minimal pour l'axe (voir "MODBUS TCP" dans main.c)
+//
+// Compilation: g++ -O2 -std=c++17 -pthread -o modbus_master tools/modbus_master.cpp
+// Usage:       modbus_master <ip> [--port N] status
+//              modbus_master <ip> move <mm> [mm/min]     déplacement relatif
+//              modbus_master <ip> goto <mm> [mm/min]     déplacement absolu
+//              modbus_master <ip> stop | home | reset
+//              modbus_master <ip> override <pct>
+//              modbus_master <ip> bench <secondes> [connexions]
+//
+// Les commandes de mouvement lisent les registres de maintien puis les
+// réécrivent avec la commande en un seul FC16: paramètres et commande
+// arrivent dans la même requête. "bench" enchaîne des lectures FC04 sur
+// plusieurs connexions simultanées et affiche débit et latences.
+// Essai sans axe: tools/modbus_standin.cpp (--port 1502).
+
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#define MODBUS_PORT 502
+
+#define MB_FC_READ_HOLDING 0x03
+#define MB_FC_READ_INPUT 0x04
+#define MB_FC_WRITE_MULTIPLE 0x10
+
+#define MB_IN_POSITION 0
+#define MB_IN_TARGET 2
+#define MB_IN_REMAINING 4
+#define MB_IN_POSITION_UM 6
+#define MB_IN_SPEED 8
+#define MB_IN_FLAGS 9
+#define MB_IN_OVERRIDE 10
+#define MB_IN_COUNT 11
+
+#define MB_HR_DISTANCE 0
+#define MB_HR_SPEED 2
+#define MB_HR_OVERRIDE 3
+#define MB_HR_COMMAND 9
+#define MB_HR_RESULT 10
+#define MB_HR_COUNT 11
+
+#define MB_CMD_MOVE 1
+#define MB_CMD_GOTO 2
+#define MB_CMD_STOP 3
+#define MB_CMD_HOME 4
+#define MB_CMD_RESET 5
+
+typedef std::chrono::steady_clock Clock;
+
+class ModbusMaster {
+ public:
+  ~ModbusMaster() {
+    if (sock_ >= 0) close(sock_);
+  }
+
+  bool connectTo(const char* host, uint16_t port) {
+    sock_ = socket(AF_INET, SOCK_STREAM, 0);
+    sockaddr_in addr = {};
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons(port);
+    if (sock_ < 0 || inet_pton(AF_INET, host, &addr.sin_addr) != 1) return false;
+    if (connect(sock_, (sockaddr*)&addr, sizeof(addr)) != 0) return false;
+    int one = 1;
+    setsockopt(sock_, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+    return true;
+  }
+
+  // Retourne false sur erreur réseau ou exception (code dans lastException)
+  bool readRegisters(uint8_t function, uint16_t address, uint16_t count, uint16_t* out) {
+    uint8_t pdu[5] = { function, (uint8_t)(address >> 8), (uint8_t)address, (uint8_t)(count >> 8), (uint8_t)count };
+    std::vector<uint8_t> response;
+    if (!transact(pdu, sizeof(pdu), response)) return false;
+    if (response.size() != 2 + count * 2u || response[1] != count * 2) return false;
+    for (int i = 0; i < count; i++) out[i] = (response[2 + 2 * i] << 8) | response[3 + 2 * i];
+    return true;
+  }
+
+  bool writeRegisters(uint16_t address, uint16_t count, const uint16_t* values) {
+    std::vector<uint8_t> pdu = { MB_FC_WRITE_MULTIPLE, (uint8_t)(address >> 8), (uint8_t)address,
+                                 (uint8_t)(count >> 8), (uint8_t)count, (uint8_t)(count * 2) };
+    for (int i = 0; i < count; i++) {
+      pdu.push_back(values[i] >> 8);
+      pdu.push_back(values[i]);
+    }
+    std::vector<uint8_t> response;
+    return transact(pdu.data(), pdu.size(), response);
+  }
+
+  int lastException = 0;
+
+ private:
+  bool transact(const uint8_t* pdu, size_t length, std::vector<uint8_t>& response) {
+    uint8_t frame[260];
+    uint16_t transaction = ++transaction_;
+    frame[0] = transaction >> 8;
+    frame[1] = transaction;
+    frame[2] = frame[3] = 0;
+    frame[4] = (length + 1) >> 8;
+    frame[5] = length + 1;
+    frame[6] = 1;
+    memcpy(frame + 7, pdu, length);
+    if (send(sock_, frame, 7 + length, 0) != (ssize_t)(7 + length)) return false;
+
+    uint8_t header[7];
+    if (!receive(header, 7)) return false;
+    uint16_t responseLength = (header[4] << 8) | header[5];
+    if (((header[0] << 8) | header[1]) != transaction || responseLength < 2) return false;
+    response.resize(responseLength - 1);
+    if (!receive(response.data(), response.size())) return false;
+    lastException = response[0] & 0x80 ? response[1] : 0;
+    return lastException == 0;
+  }
+
+  bool receive(uint8_t* out, size_t length) {
+    size_t received = 0;
+    while (received < length) {
+      pollfd pfd = { sock_, POLLIN, 0 };
+      if (poll(&pfd, 1, 1000) <= 0) return false;
+      ssize_t n = recv(sock_, out + received, length - received, 0);
+      if (n <= 0) return false;
+      received += n;
+    }
+    return true;
+  }
+
+  int sock_ = -1;
+  uint16_t transaction_ = 0;
+};
+
+static int32_t get32(const uint16_t* regs, int address) {
+  return (int32_t)(((uint32_t)regs[address] << 16) | regs[address + 1]);
+}
+
+static int printStatus(ModbusMaster& master) {
+  uint16_t in[MB_IN_COUNT];
+  uint16_t hr[MB_HR_COUNT];
+  if (!master.readRegisters(MB_FC_READ_INPUT, 0, MB_IN_COUNT, in) ||
+      !master.readRegisters(MB_FC_READ_HOLDING, 0, MB_HR_COUNT, hr)) {
+    fprintf(stderr, "lecture impossible (exception %d)\n", master.lastException);
+    return 1;
+  }
+  printf("position  %d steps (%.3f mm)\n", get32(in, MB_IN_POSITION), get32(in, MB_IN_POSITION_UM) / 1000.0);
+  printf("cible     %d steps, reste %d\n", get32(in, MB_IN_TARGET), get32(in, MB_IN_REMAINING));
+  printf("vitesse   %u mm/min, correction %u%%\n", in[MB_IN_SPEED], in[MB_IN_OVERRIDE]);
+  printf("état      0x%04x\n", in[MB_IN_FLAGS]);
+  printf("commande  %u -> résultat %u\n", hr[MB_HR_COMMAND], hr[MB_HR_RESULT]);
+  return 0;
+}
+
+// Lecture-modification-écriture des registres 0..9, commande comprise
+static int command(ModbusMaster& master, uint16_t cmd, double mm, double speed) {
+  uint16_t hr[MB_HR_COUNT];
+  if (!master.readRegisters(MB_FC_READ_HOLDING, 0, MB_HR_COUNT, hr)) {
+    fprintf(stderr, "lecture impossible (exception %d)\n", master.lastException);
+    return 1;
+  }
+  int32_t um = (int32_t)(mm * 1000.0 + (mm < 0 ? -0.5 : 0.5));
+  hr[MB_HR_DISTANCE] = (uint32_t)um >> 16;
+  hr[MB_HR_DISTANCE + 1] = um;
+  hr[MB_HR_SPEED] = (uint16_t)speed;
+  hr[MB_HR_COMMAND] = cmd;
+  if (!master.writeRegisters(0, MB_HR_COMMAND + 1, hr)) {
+    fprintf(stderr, "écriture refusée (exception %d)\n", master.lastException);
+    return 1;
+  }
+  master.readRegisters(MB_FC_READ_HOLDING, MB_HR_RESULT, 1, &hr[MB_HR_RESULT]);
+  static const char* const results[] = { "ok", "axe en mouvement", "hors limites" };
+  printf("résultat: %s\n", hr[MB_HR_RESULT] < 3 ? results[hr[MB_HR_RESULT]] : "?");
+  return hr[MB_HR_RESULT] == 0 ? 0 : 2;
+}
+
+static int bench(const char* host, uint16_t port, double seconds, int connections) {
+  std::atomic<bool> stop(false);
+  std::atomic<long> errors(0);
+  std::mutex mutex;
+  std::vector<double> latencies;
+  std::vector<std::thread> threads;
+
+  for (int c = 0; c < connections; c++) {
+    threads.emplace_back([&]() {
+      ModbusMaster master;
+      if (!master.connectTo(host, port)) {
+        errors++;
+        return;
+      }
+      std::vector<double> local;
+      uint16_t regs[MB_IN_COUNT];
+      while (!stop) {
+        Clock::time_point start = Clock::now();
+        if (!master.readRegisters(MB_FC_READ_INPUT, 0, MB_IN_COUNT, regs)) {
+          errors++;
+          break;
+        }
+        local.push_back(std::chrono::duration<double, std::micro>(Clock::now() - start).count());
+      }
+      std::lock_guard<std::mutex> lock(mutex);
+      latencies.insert(latencies.end(), local.begin(), local.end());
+    });
+  }
+  std::this_thread::sleep_for(std::chrono::duration<double>(seconds));
+  stop = true;
+  for (std::thread& t : threads) t.join();
+
+  if (latencies.empty()) {
+    fprintf(stderr, "aucune réponse (%ld erreurs)\n", errors.load());
+    return 1;
+  }
+  std::sort(latencies.begin(), latencies.end());
+  auto pct = [&](double p) { return latencies[std::min(latencies.size() - 1, (size_t)(p * latencies.size()))]; };
+  printf("%d connexion(s), %zu requêtes FC04 en %.1fs: %.0f req/s, %ld erreur(s)\n", connections,
+         latencies.size(), seconds, latencies.size() / seconds, errors.load());
+  printf("latence µs: min %.0f  p50 %.0f  p99 %.0f  max %.0f\n", latencies.front(), pct(0.5), pct(0.99),
+         latencies.back());
+  return errors == 0 ? 0 : 1;
+}
+
+int main(int argc, char** argv) {
+  std::vector<std::string> args(argv + 1, argv + argc);
+  uint16_t port = MODBUS_PORT;
+  for (size_t i = 0; i + 1 < args.size(); i++) {
+    if (args[i] == "--port") {
+      port = atoi(args[i + 1].c_str());
+      args.erase(args.begin() + i, args.begin() + i + 2);
+      break;
+    }
+  }
+  if (args.size() < 2) {
+    fprintf(stderr, "usage: modbus_master <ip> [--port N] status|move|goto|stop|home|reset|override|bench ...\n");
+    return 1;
+  }
+
+  const char* host = args[0].c_str();
+  const std::string& verb = args[1];
+  double value = args.size() > 2 ? atof(args[2].c_str()) : 0;
+  double extra = args.size() > 3 ? atof(args[3].c_str()) : 0;
+
+  if (verb == "bench") return bench(host, port, value > 0 ? value : 5, extra > 0 ? (int)extra : 1);
+
+  ModbusMaster master;
+  if (!master.connectTo(host, port)) {
+    fprintf(stderr, "connexion impossible à %s:%u\n", host, port);
+    return 1;
+  }
+  if (verb == "status") return printStatus(master);
+  if (verb == "move") return command(master, MB_CMD_MOVE, value, extra);
+  if (verb == "goto") return command(master, MB_CMD_GOTO, value, extra);
+  if (verb == "stop") return command(master, MB_CMD_STOP, 0, 0);
+  if (verb == "home") return command(master, MB_CMD_HOME, 0, 0);
+  if (verb == "reset") return command(master, MB_CMD_RESET, 0, 0);
+  if (verb == "override") {
+    uint16_t pct = (uint16_t)value;
+    if (master.writeRegisters(MB_HR_OVERRIDE, 1, &pct)) return 0;
+    fprintf(stderr, "écriture refusée (exception %d)\n", master.lastException);
+    return 1;
+  }
+  fprintf(stderr, "commande inconnue: %s\n", verb.c_str());
+  return 1;
+}
@@ -0,0 +1,315 @@
+// Esclave Modbus TCP local pour tools/modbus_master.cpp
+//
+// Compilation: g++ -O2 -std=c++17 -o modbus_standin tools/modbus_standin.cpp
+// Usage:       modbus_standin [--port P] [--steps-per-mm S]
+//
+// Le découpage des trames et le traitement des PDU sont ceux du firmware
+// (ModbusSlave, main.c inclus avec MOTION_CORE_ONLY), servis sur
+// 127.0.0.1:P (1502) comme handleModbus(): au plus MODBUS_MAX_CLIENTS
+// maîtres, lecture non bloquante, au plus une trame par maître et par tour
+// de boucle, trame invalide ou erreur de lecture = connexion fermée,
+// maître muet libéré après MODBUS_IDLE_MS. Les registres pilotent un axe
+// simulé par le générateur de pas du firmware sur l'horloge réelle, avec
+// les mêmes contrôles que modbusWriteHolding() (copie de main.c, section
+// non incluse avec MOTION_CORE_ONLY). Compteurs de requêtes et
+// d'exceptions affichés toutes les 5 s s'ils ont changé.
+//
+// Essai local: modbus_standin &
+//              modbus_master 127.0.0.1 --port 1502 move 10 600
+//              modbus_master 127.0.0.1 --port 1502 bench 5 4
+
+#include <arpa/inet.h>
+#include <fcntl.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+
+#define HOST_CORE_WALL_CLOCK
+#include "host_core.h"
+
+RampStepper<MotorDriver> stepper;
+
+void onStep(long, int) {}
+
+// Copie de main.c (section non incluse avec MOTION_CORE_ONLY)
+#define FEED_OVERRIDE_MIN 10.0
+#define FEED_OVERRIDE_MAX 200.0
+#define STATUS_FLAG_RUNNING 0x0001
+#define STATUS_FLAG_TARGET 0x0002
+#define STATUS_FLAG_LIMITS 0x0010
+#define STATUS_FLAG_NETWORK 0x0080
+
+// Axe simulé derrière les registres, mêmes règles que le firmware
+struct SimulatedAxis {
+  FeedRamp feed;
+  float speed = 0;                 // Consigne mm/min
+  float overridePct = 100;
+  bool running = false;
+  int32_t distanceUm = 0;
+  uint16_t speedRegister = 0;
+  uint16_t lastCommand = MB_CMD_NONE;
+  uint16_t result = MB_RESULT_OK;
+
+  void start(long steps, float mmPerMin) {
+    float stepsPerSec = mmPerMin * STEPS_PER_MM / 60.0;
+    speed = mmPerMin;
+    stepper.setMaxSpeed(feed.begin(stepsPerSec, stepsPerSec * ACCEL_FACTOR, overridePct, micros()));
+    stepper.setAcceleration(stepsPerSec * ACCEL_FACTOR);
+    stepper.move(steps);
+    running = true;
+  }
+
+  void stop() {
+    stepper.setCurrentPosition(stepper.currentPosition());
+    running = false;
+  }
+
+  // Un tour de loop()
+  void run() {
+    if (feed.update(overridePct, micros())) stepper.setMaxSpeed(feed.applied);
+    if (running && !stepper.run()) running = false;
+  }
+
+  void readInputs(uint16_t* regs) {
+    long position = stepper.currentPosition();
+    long target = stepper.targetPosition();
+    long remaining = stepper.distanceToGo();
+    int32_t positionUm = lround(position * 1000.0 / STEPS_PER_MM);
+    uint16_t flags = STATUS_FLAG_NETWORK;
+    if (running) flags |= STATUS_FLAG_RUNNING | STATUS_FLAG_TARGET;
+    if (SOFT_LIMITS_ENABLED) flags |= STATUS_FLAG_LIMITS;
+
+    regs[MB_IN_POSITION] = (uint32_t)position >> 16;
+    regs[MB_IN_POSITION + 1] = position;
+    regs[MB_IN_TARGET] = (uint32_t)target >> 16;
+    regs[MB_IN_TARGET + 1] = target;
+    regs[MB_IN_REMAINING] = (uint32_t)remaining >> 16;
+    regs[MB_IN_REMAINING + 1] = remaining;
+    regs[MB_IN_POSITION_UM] = (uint32_t)positionUm >> 16;
+    regs[MB_IN_POSITION_UM + 1] = positionUm;
+    regs[MB_IN_SPEED] = (uint16_t)lround(speed);
+    regs[MB_IN_FLAGS] = flags;
+    regs[MB_IN_OVERRIDE] = (uint16_t)lround(overridePct);
+  }
+
+  void readHolding(uint16_t* regs) {
+    int32_t limitMin = lround(SOFT_LIMIT_MIN * 1000.0);
+    int32_t limitMax = lround(SOFT_LIMIT_MAX * 1000.0);
+
+    regs[MB_HR_DISTANCE] = (uint32_t)distanceUm >> 16;
+    regs[MB_HR_DISTANCE + 1] = distanceUm;
+    regs[MB_HR_SPEED] = speedRegister;
+    regs[MB_HR_OVERRIDE] = (uint16_t)lround(overridePct);
+    regs[MB_HR_LIMIT_MIN] = (uint32_t)limitMin >> 16;
+    regs[MB_HR_LIMIT_MIN + 1] = limitMin;
+    regs[MB_HR_LIMIT_MAX] = (uint32_t)limitMax >> 16;
+    regs[MB_HR_LIMIT_MAX + 1] = limitMax;
+    regs[MB_HR_LIMITS_ON] = SOFT_LIMITS_ENABLED ? 1 : 0;
+    regs[MB_HR_COMMAND] = lastCommand;
+    regs[MB_HR_RESULT] = result;
+  }
+
+  void execute(uint16_t command) {
+    float mmPerMin = speedRegister != 0 ? speedRegister : SPEED_DEFAULT;
+    float distance = distanceUm / 1000.0;
+    float position = (float)stepper.currentPosition() / STEPS_PER_MM;
+    lastCommand = command;
+    result = MB_RESULT_OK;
+
+    switch (command) {
+      case MB_CMD_MOVE:
+      case MB_CMD_GOTO:
+        if (running) {
+          result = MB_RESULT_BUSY;
+          break;
+        }
+        if (command == MB_CMD_GOTO) distance -= position;
+        if (SOFT_LIMITS_ENABLED && (position + distance < SOFT_LIMIT_MIN || position + distance > SOFT_LIMIT_MAX)) {
+          result = MB_RESULT_LIMIT;
+          break;
+        }
+        start((long)(distance * STEPS_PER_MM), mmPerMin);
+        break;
+      case MB_CMD_STOP:
+        stop();
+        break;
+      case MB_CMD_HOME:
+        if (running) result = MB_RESULT_BUSY;
+        else start(-stepper.currentPosition(), SPEED_HOME);
+        break;
+      case MB_CMD_RESET:
+        stop();
+        stepper.setCurrentPosition(0);
+        break;
+    }
+  }
+
+  uint8_t writeHolding(uint16_t first, uint16_t count, const uint8_t* data) {
+    if (first + count > MB_HR_RESULT) return MB_EX_ILLEGAL_ADDRESS;
+
+    uint16_t regs[MB_HR_COUNT];
+    readHolding(regs);
+    for (int i = 0; i < count; i++) regs[first + i] = (data[2 * i] << 8) | data[2 * i + 1];
+    auto touches = [first, count](int address, int size) {
+      return first < address + size && first + count > address;
+    };
+    auto get32 = [&regs](int address) { return (int32_t)(((uint32_t)regs[address] << 16) | regs[address + 1]); };
+
+    int32_t limitMin = get32(MB_HR_LIMIT_MIN);
+    int32_t limitMax = get32(MB_HR_LIMIT_MAX);
+    if (regs[MB_HR_SPEED] != 0 && (regs[MB_HR_SPEED] < SPEED_MIN || regs[MB_HR_SPEED] > SPEED_MAX)) {
+      return MB_EX_ILLEGAL_VALUE;
+    }
+    if (regs[MB_HR_OVERRIDE] < FEED_OVERRIDE_MIN || regs[MB_HR_OVERRIDE] > FEED_OVERRIDE_MAX) {
+      return MB_EX_ILLEGAL_VALUE;
+    }
+    if (limitMin >= limitMax || regs[MB_HR_LIMITS_ON] > 1) return MB_EX_ILLEGAL_VALUE;
+    if (touches(MB_HR_COMMAND, 1) && regs[MB_HR_COMMAND] > MB_CMD_RESET) return MB_EX_ILLEGAL_VALUE;
+
+    distanceUm = get32(MB_HR_DISTANCE);
+    speedRegister = regs[MB_HR_SPEED];
+    overridePct = regs[MB_HR_OVERRIDE];
+    SOFT_LIMIT_MIN = limitMin / 1000.0;
+    SOFT_LIMIT_MAX = limitMax / 1000.0;
+    SOFT_LIMITS_ENABLED = regs[MB_HR_LIMITS_ON] != 0;
+    if (touches(MB_HR_COMMAND, 1)) execute(regs[MB_HR_COMMAND]);
+    return 0;
+  }
+};
+
+struct Master {
+  int fd = -1;
+  uint8_t frame[MODBUS_FRAME_MAX];
+  size_t length = 0;
+  unsigned long lastActivity = 0;
+};
+
+static SimulatedAxis axis;
+static ModbusSlave slave;
+static Master masters[MODBUS_MAX_CLIENTS];
+static unsigned long refused = 0;
+
+static void closeMaster(Master& mb) {
+  close(mb.fd);
+  mb.fd = -1;
+}
+
+// Un passage de handleModbus()
+static void serve(int listener) {
+  int incoming = accept(listener, nullptr, nullptr);
+  if (incoming >= 0) {
+    Master* slot = nullptr;
+    for (Master& mb : masters) {
+      if (mb.fd < 0) {
+        slot = &mb;
+        break;
+      }
+    }
+    if (slot == nullptr) {
+      close(incoming);
+      refused++;
+    } else {
+      int one = 1;
+      setsockopt(incoming, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+      fcntl(incoming, F_SETFL, O_NONBLOCK);
+      slot->fd = incoming;
+      slot->length = 0;
+      slot->lastActivity = millis();
+    }
+  }
+
+  for (Master& mb : masters) {
+    if (mb.fd < 0) continue;
+    if (millis() - mb.lastActivity > MODBUS_IDLE_MS) {
+      closeMaster(mb);
+      continue;
+    }
+
+    ssize_t n = recv(mb.fd, mb.frame + mb.length, ModbusSlave::needed(mb.frame, mb.length), 0);
+    if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) continue;
+    if (n <= 0) {
+      closeMaster(mb);
+      continue;
+    }
+    mb.length += n;
+    mb.lastActivity = millis();
+
+    int frame = ModbusSlave::check(mb.frame, mb.length);
+    if (frame == MB_FRAME_INVALID) {
+      closeMaster(mb);
+      continue;
+    }
+    if (frame == MB_FRAME_PARTIAL) continue;
+
+    uint8_t response[MODBUS_FRAME_MAX];
+    size_t responseLength = slave.process(mb.frame, response, axis);
+    if (send(mb.fd, response, responseLength, MSG_NOSIGNAL) != (ssize_t)responseLength) closeMaster(mb);
+    else mb.length = 0;
+  }
+}
+
+int main(int argc, char** argv) {
+  int port = 1502;
+  for (int i = 1; i < argc; i++) {
+    if (strcmp(argv[i], "--port") == 0 && i + 1 < argc) port = atoi(argv[++i]);
+    else if (strcmp(argv[i], "--steps-per-mm") == 0 && i + 1 < argc) STEPS_PER_MM = atof(argv[++i]);
+    else {
+      fprintf(stderr, "usage: modbus_standin [--port P] [--steps-per-mm S]\n");
+      return 1;
+    }
+  }
+
+  int listener = socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK, 0);
+  int one = 1;
+  setsockopt(listener, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+  sockaddr_in addr = {};
+  addr.sin_family = AF_INET;
+  addr.sin_port = htons(port);
+  addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+  if (bind(listener, (sockaddr*)&addr, sizeof(addr)) != 0 || listen(listener, 8) != 0) {
+    fprintf(stderr, "port %d indisponible: %s\n", port, strerror(errno));
+    return 1;
+  }
+  printf("esclave Modbus TCP sur 127.0.0.1:%d, %d maîtres au plus, %.1f steps/mm\n", port, MODBUS_MAX_CLIENTS,
+         STEPS_PER_MM);
+  fflush(stdout);
+
+  uint32_t reported = 0;
+  unsigned long lastReport = millis();
+  for (;;) {
+    // Axe à l'arrêt: attente des sockets au lieu de tourner à vide
+    if (!axis.running) {
+      pollfd fds[MODBUS_MAX_CLIENTS + 1];
+      int count = 0;
+      fds[count++] = { listener, POLLIN, 0 };
+      for (Master& mb : masters) {
+        if (mb.fd >= 0) fds[count++] = { mb.fd, POLLIN, 0 };
+      }
+      poll(fds, count, 100);
+    }
+    serve(listener);
+    axis.run();
+
+    if (millis() - lastReport >= 5000) {
+      if (slave.requests != reported) {
+        printf("%u requêtes (%.0f/s), %u exceptions, %lu connexions refusées, position %.3f mm\n",
+               slave.requests, (slave.requests - reported) * 1000.0 / (millis() - lastReport), slave.exceptions,
+               refused, stepper.currentPosition() / STEPS_PER_MM);
+        fflush(stdout);
+        reported = slave.requests;
+      }
+      lastReport = millis();
+    }
+  }
+}
@@ -0,0 +1,427 @@
+// Broker MQTT 3.1.1 local pour le client MQTT du firmware (voir "MQTT" dans main.c)
+//
+// Compilation: g++ -O2 -std=c++17 -o mqtt_broker tools/mqtt_broker.cpp
+// Usage:       mqtt_broker [--port P] [--read-rate octets/s] [--quiet]
+//
+// Broker minimal mais strict, écrit indépendamment du firmware: chaque
+// paquet reçu est contrôlé (longueur restante, drapeaux réservés, CONNECT
+// niveau 4 "MQTT", CONNECT unique et en premier, identifiant de paquet des
+// SUBSCRIBE, sujets sans joker en publication) et tout écart est affiché
+// comme "protocole: ..." puis la connexion est fermée. QoS 0 et 1
+// (PUBACK), messages retenus, jokers + et #, testament publié si la
+// connexion tombe sans DISCONNECT ou si le keepalive × 1.5 expire.
+// Les lignes "<sujet> <charge>" lues sur l'entrée standard sont publiées
+// aux abonnés, par exemple: stepper/cmd/move {"distance":10,"speed":600}
+// --read-rate limite la lecture de chaque connexion (broker lent: le
+// client doit sauter de la télémétrie sans jamais bloquer le pas).
+// Chaque publication reçue est affichée (sauf --quiet), avec un bilan
+// toutes les 5 s. Les publications retenues sont servies aux nouveaux
+// abonnés; une file de sortie au-delà de 64 Kio perd les messages QoS 0.
+
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <map>
+#include <string>
+#include <vector>
+
+#define OUT_QUEUE_MAX 65536
+#define PACKET_MAX (1 << 20)
+
+typedef std::chrono::steady_clock Clock;
+
+struct Session {
+  int fd = -1;
+  std::string in;
+  std::string out;
+  std::string clientId;
+  bool connected = false;       // CONNECT accepté
+  uint16_t keepAlive = 0;
+  Clock::time_point lastPacket = Clock::now();
+  bool hasWill = false;
+  std::string willTopic, willPayload;
+  bool willRetain = false;
+  std::vector<std::string> filters;
+  double readBudget = 0;        // Octets encore lisibles (--read-rate)
+  bool closing = false;
+  const char* reason = "";
+};
+
+static std::vector<Session> sessions;
+static std::map<std::string, std::string> retained;
+static double readRate = 0;
+static bool quiet = false;
+static long received = 0, delivered = 0, dropped = 0, violations = 0;
+static const Clock::time_point origin = Clock::now();
+
+static double elapsedMs() { return std::chrono::duration<double, std::milli>(Clock::now() - origin).count(); }
+
+static bool violation(Session& s, const char* what) {
+  printf("%9.1f protocole: %s (%s)\n", elapsedMs(), what, s.clientId.empty() ? "?" : s.clientId.c_str());
+  fflush(stdout);
+  violations++;
+  s.closing = true;
+  s.reason = "écart de protocole";
+  return false;
+}
+
+static void putLength(std::string& out, size_t length) {
+  do {
+    uint8_t digit = length & 0x7F;
+    length >>= 7;
+    out += (char)(length > 0 ? digit | 0x80 : digit);
+  } while (length > 0);
+}
+
+static void putString(std::string& out, const std::string& text) {
+  out += (char)(text.size() >> 8);
+  out += (char)text.size();
+  out += text;
+}
+
+// Sujet conforme au filtre (+: un niveau, #: la suite)
+static bool matches(const std::string& filter, const std::string& topic) {
+  size_t f = 0, t = 0;
+  while (f < filter.size()) {
+    if (filter[f] == '#') return true;
+    if (filter[f] == '+') {
+      while (t < topic.size() && topic[t] != '/') t++;
+      f++;
+    } else {
+      if (t >= topic.size() || topic[t] != filter[f]) return false;
+      f++;
+      t++;
+    }
+    if (f == filter.size()) return t == topic.size();
+    if (t == topic.size()) return filter.compare(f, std::string::npos, "/#") == 0;
+  }
+  return t == topic.size();
+}
+
+static void deliverTo(Session& s, const std::string& topic, const std::string& payload, bool retain) {
+  std::string packet(1, (char)(0x30 | (retain ? 0x01 : 0)));
+  putLength(packet, 2 + topic.size() + payload.size());
+  putString(packet, topic);
+  packet += payload;
+  if (s.out.size() + packet.size() > OUT_QUEUE_MAX) {
+    dropped++;
+    return;
+  }
+  s.out += packet;
+  delivered++;
+}
+
+static void publish(const std::string& topic, const std::string& payload, bool retain) {
+  if (retain) {
+    if (payload.empty()) retained.erase(topic);
+    else retained[topic] = payload;
+  }
+  for (Session& s : sessions) {
+    if (!s.connected || s.closing) continue;
+    for (const std::string& filter : s.filters) {
+      if (matches(filter, topic)) {
+        deliverTo(s, topic, payload, false);
+        break;
+      }
+    }
+  }
+}
+
+static bool readString(const uint8_t*& p, const uint8_t* end, std::string& out) {
+  if (end - p < 2) return false;
+  size_t length = (p[0] << 8) | p[1];
+  if ((size_t)(end - p - 2) < length) return false;
+  out.assign((const char*)p + 2, length);
+  p += 2 + length;
+  return true;
+}
+
+static bool handleConnect(Session& s, const uint8_t* p, const uint8_t* end) {
+  std::string name, clientId;
+  if (!readString(p, end, name) || end - p < 4) return violation(s, "CONNECT tronqué");
+  uint8_t level = p[0], flags = p[1];
+  s.keepAlive = (p[2] << 8) | p[3];
+  p += 4;
+  if (name != "MQTT" || level != 4) {
+    s.out += std::string("\x20\x02\x00\x01", 4);  // Version refusée
+    return violation(s, "CONNECT autre que MQTT 3.1.1");
+  }
+  if (flags & 0x01) return violation(s, "CONNECT: bit réservé");
+  if (!readString(p, end, clientId)) return violation(s, "CONNECT: identifiant");
+  s.clientId = clientId;
+  s.hasWill = (flags & 0x04) != 0;
+  if (!s.hasWill && (flags & 0x38)) return violation(s, "CONNECT: QoS/retain du testament sans testament");
+  if (s.hasWill) {
+    if (!readString(p, end, s.willTopic) || !readString(p, end, s.willPayload)) {
+      return violation(s, "CONNECT: testament");
+    }
+    if (((flags >> 3) & 0x03) == 3) return violation(s, "CONNECT: QoS 3");
+    s.willRetain = (flags & 0x20) != 0;
+  }
+  std::string user, password;
+  if ((flags & 0x80) && !readString(p, end, user)) return violation(s, "CONNECT: utilisateur");
+  if ((flags & 0x40) && !readString(p, end, password)) return violation(s, "CONNECT: mot de passe");
+  if (p != end) return violation(s, "CONNECT: octets en trop");
+
+  s.connected = true;
+  s.out += std::string("\x20\x02\x00\x00", 4);
+  printf("%9.1f connexion %s, keepalive %us%s%s\n", elapsedMs(), clientId.c_str(), s.keepAlive,
+         s.hasWill ? ", testament sur " : "", s.hasWill ? s.willTopic.c_str() : "");
+  fflush(stdout);
+  return true;
+}
+
+static bool handlePacket(Session& s, uint8_t header, const uint8_t* p, size_t length) {
+  const uint8_t* end = p + length;
+  uint8_t type = header >> 4, flags = header & 0x0F;
+  if (!s.connected && type != 1) return violation(s, "paquet avant CONNECT");
+  switch (type) {
+    case 1:
+      if (s.connected) return violation(s, "second CONNECT");
+      if (flags != 0) return violation(s, "CONNECT: drapeaux d'en-tête");
+      return handleConnect(s, p, end);
+    case 3: {
+      uint8_t qos = (flags >> 1) & 0x03;
+      std::string topic;
+      if (qos == 3) return violation(s, "PUBLISH QoS 3");
+      if (!readString(p, end, topic) || topic.empty()) return violation(s, "PUBLISH: sujet");
+      if (topic.find_first_of("+#") != std::string::npos) return violation(s, "PUBLISH: joker dans le sujet");
+      uint16_t packetId = 0;
+      if (qos > 0) {
+        if (end - p < 2) return violation(s, "PUBLISH: identifiant");
+        packetId = (p[0] << 8) | p[1];
+        p += 2;
+      }
+      std::string payload((const char*)p, end - p);
+      received++;
+      if (!quiet) {
+        printf("%9.1f %s%s %s\n", elapsedMs(), topic.c_str(), flags & 0x01 ? " (retenu)" : "", payload.c_str());
+        fflush(stdout);
+      }
+      if (qos == 1) {
+        s.out += std::string("\x40\x02", 2);
+        s.out += (char)(packetId >> 8);
+        s.out += (char)packetId;
+      } else if (qos == 2) {
+        return violation(s, "PUBLISH QoS 2 non pris en charge");
+      }
+      publish(topic, payload, flags & 0x01);
+      return true;
+    }
+    case 8: {
+      if (flags != 0x02) return violation(s, "SUBSCRIBE: drapeaux d'en-tête");
+      if (end - p < 2) return violation(s, "SUBSCRIBE: identifiant");
+      uint16_t packetId = (p[0] << 8) | p[1];
+      p += 2;
+      std::string granted;
+      std::vector<std::string> added;
+      while (p < end) {
+        std::string filter;
+        if (!readString(p, end, filter) || filter.empty() || p >= end) return violation(s, "SUBSCRIBE: filtre");
+        if (*p++ > 2) return violation(s, "SUBSCRIBE: QoS");
+        size_t hash = filter.find('#');
+        if (hash != std::string::npos && hash != filter.size() - 1) return violation(s, "SUBSCRIBE: # hors fin");
+        added.push_back(filter);
+        granted += '\0';
+      }
+      if (added.empty()) return violation(s, "SUBSCRIBE vide");
+      std::string suback(1, (char)0x90);
+      putLength(suback, 2 + granted.size());
+      suback += (char)(packetId >> 8);
+      suback += (char)packetId;
+      s.out += suback + granted;
+      for (const std::string& filter : added) {
+        printf("%9.1f abonnement %s: %s\n", elapsedMs(), s.clientId.c_str(), filter.c_str());
+        s.filters.push_back(filter);
+        for (auto& entry : retained) {
+          if (matches(filter, entry.first)) deliverTo(s, entry.first, entry.second, true);
+        }
+      }
+      fflush(stdout);
+      return true;
+    }
+    case 12:
+      if (flags != 0 || length != 0) return violation(s, "PINGREQ mal formé");
+      s.out += std::string("\xD0\x00", 2);
+      return true;
+    case 14:
+      if (flags != 0 || length != 0) return violation(s, "DISCONNECT mal formé");
+      s.hasWill = false;
+      s.closing = true;
+      s.reason = "DISCONNECT";
+      return true;
+    default:
+      return violation(s, "type de paquet inattendu");
+  }
+}
+
+// Paquets complets du tampon d'entrée
+static void parse(Session& s) {
+  while (!s.closing && s.in.size() >= 2) {
+    size_t remaining = 0, index = 1;
+    int shift = 0;
+    bool complete = false;
+    while (index < s.in.size() && index <= 4) {
+      uint8_t digit = s.in[index++];
+      remaining |= (size_t)(digit & 0x7F) << shift;
+      shift += 7;
+      if ((digit & 0x80) == 0) {
+        complete = true;
+        break;
+      }
+    }
+    if (!complete) {
+      if (index > 4) violation(s, "longueur restante sur plus de 4 octets");
+      return;
+    }
+    if (remaining > PACKET_MAX) {
+      violation(s, "paquet trop long");
+      return;
+    }
+    if (s.in.size() < index + remaining) return;
+    s.lastPacket = Clock::now();
+    handlePacket(s, s.in[0], (const uint8_t*)s.in.data() + index, remaining);
+    s.in.erase(0, index + remaining);
+  }
+}
+
+static void closeSession(Session& s, const char* why) {
+  if (s.connected) {
+    printf("%9.1f déconnexion %s: %s%s\n", elapsedMs(), s.clientId.c_str(), why,
+           s.hasWill ? ", testament publié" : "");
+    fflush(stdout);
+  }
+  if (s.connected && s.hasWill) publish(s.willTopic, s.willPayload, s.willRetain);
+  close(s.fd);
+  s.fd = -1;
+}
+
+int main(int argc, char** argv) {
+  int port = 1883;
+  for (int i = 1; i < argc; i++) {
+    if (strcmp(argv[i], "--port") == 0 && i + 1 < argc) port = atoi(argv[++i]);
+    else if (strcmp(argv[i], "--read-rate") == 0 && i + 1 < argc) readRate = atof(argv[++i]);
+    else if (strcmp(argv[i], "--quiet") == 0) quiet = true;
+    else {
+      fprintf(stderr, "usage: mqtt_broker [--port P] [--read-rate octets/s] [--quiet]\n");
+      return 1;
+    }
+  }
+
+  int listener = socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK, 0);
+  int one = 1;
+  setsockopt(listener, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+  sockaddr_in addr = {};
+  addr.sin_family = AF_INET;
+  addr.sin_port = htons(port);
+  addr.sin_addr.s_addr = htonl(INADDR_ANY);
+  if (bind(listener, (sockaddr*)&addr, sizeof(addr)) != 0 || listen(listener, 16) != 0) {
+    fprintf(stderr, "port %d indisponible: %s\n", port, strerror(errno));
+    return 1;
+  }
+  printf("broker MQTT sur le port %d%s\n", port, readRate > 0 ? ", lecture limitée" : "");
+  fflush(stdout);
+
+  std::string input;
+  int inputFd = STDIN_FILENO;    // -1 une fois l'entrée standard fermée
+  Clock::time_point lastTick = Clock::now();
+  double lastReport = elapsedMs();
+  long reportedReceived = 0;
+  for (;;) {
+    std::vector<pollfd> fds = { { listener, POLLIN, 0 }, { inputFd, POLLIN, 0 } };
+    for (Session& s : sessions) {
+      short events = s.readBudget >= 1 || readRate <= 0 ? POLLIN : 0;
+      if (!s.out.empty()) events |= POLLOUT;
+      fds.push_back({ s.fd, events, 0 });
+    }
+    poll(fds.data(), fds.size(), 10);
+
+    Clock::time_point now = Clock::now();
+    double dt = std::chrono::duration<double>(now - lastTick).count();
+    lastTick = now;
+
+    if (fds[0].revents & POLLIN) {
+      int fd;
+      while ((fd = accept4(listener, nullptr, nullptr, SOCK_NONBLOCK)) >= 0) {
+        setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+        Session s;
+        s.fd = fd;
+        sessions.push_back(s);
+      }
+    }
+    if (fds[1].revents & (POLLIN | POLLHUP)) {
+      char buffer[1024];
+      ssize_t n = read(inputFd, buffer, sizeof(buffer));
+      if (n > 0) input.append(buffer, n);
+      else inputFd = -1;
+      size_t eol;
+      while ((eol = input.find('\n')) != std::string::npos) {
+        std::string line = input.substr(0, eol);
+        input.erase(0, eol + 1);
+        size_t space = line.find(' ');
+        if (line.empty()) continue;
+        publish(line.substr(0, space), space == std::string::npos ? "" : line.substr(space + 1), false);
+      }
+    }
+
+    for (size_t i = 0; i < sessions.size(); i++) {
+      Session& s = sessions[i];
+      short revents = fds[i + 2].revents;
+      if (readRate > 0) s.readBudget = std::min(s.readBudget + readRate * dt, std::max(readRate * 0.05, 1.0));
+      if (revents & (POLLIN | POLLHUP | POLLERR)) {
+        char buffer[4096];
+        size_t want = readRate > 0 ? std::min(sizeof(buffer), (size_t)s.readBudget) : sizeof(buffer);
+        ssize_t n = want > 0 ? recv(s.fd, buffer, want, 0) : -1;
+        if (n == 0 || (n < 0 && errno != EAGAIN && errno != EWOULDBLOCK && want > 0)) {
+          closeSession(s, "connexion perdue");
+          continue;
+        }
+        if (n > 0) {
+          s.in.append(buffer, n);
+          if (readRate > 0) s.readBudget -= n;
+          parse(s);
+        }
+      }
+      if (s.connected && s.keepAlive > 0 &&
+          std::chrono::duration<double>(now - s.lastPacket).count() > s.keepAlive * 1.5) {
+        violation(s, "keepalive expiré");
+      }
+    }
+
+    // Envoi après traitement de toutes les entrées (publications croisées)
+    for (Session& s : sessions) {
+      if (s.fd < 0) continue;
+      while (!s.out.empty()) {
+        ssize_t sent = send(s.fd, s.out.data(), s.out.size(), MSG_NOSIGNAL);
+        if (sent <= 0) break;
+        s.out.erase(0, sent);
+      }
+      if (s.closing) closeSession(s, s.reason);
+    }
+    sessions.erase(std::remove_if(sessions.begin(), sessions.end(), [](const Session& s) { return s.fd < 0; }),
+                   sessions.end());
+
+    if (elapsedMs() - lastReport >= 5000) {
+      if (received != reportedReceived) {
+        printf("%9.1f bilan: %ld publications reçues (%.0f/s), %ld distribuées, %ld perdues (file pleine), "
+               "%ld écarts de protocole\n",
+               elapsedMs(), received, (received - reportedReceived) * 1000.0 / (elapsedMs() - lastReport), delivered,
+               dropped, violations);
+        fflush(stdout);
+        reportedReceived = received;
+      }
+      lastReport = elapsedMs();
+    }
+  }
+}
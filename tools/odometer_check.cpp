@@ -0,0 +1,184 @@
+// Vérification hôte de l'odomètre (voir "ODOMÈTRE" dans main.c)
+//
+// Compilation: g++ -O2 -std=c++17 -o odometer_check tools/odometer_check.cpp
+// Usage:       odometer_check [--hours N] [--seed S]
+//
+// Exactitude: le générateur de pas du firmware (main.c inclus avec
+// MOTION_CORE_ONLY) exécute une suite de déplacements sur une horloge
+// virtuelle, le chemin de pas alimentant l'odomètre comme onStep(), la
+// boucle appelant tick() comme loop(). Pas, distance (y compris après un
+// changement de pas/mm en cours de route), inversions, nombre de
+// mouvements, temps de mouvement et vitesse crête sont comparés aux valeurs
+// attendues.
+//
+// Écritures: --hours (48) heures d'activité aléatoire (mouvements de 0,1 à
+// 120 s, pauses de 0 à 60 s, tours de boucle d'1 ms) comptent les demandes
+// d'écriture. Contrôles: au plus 3600000 / ODOMETER_SAVE_INTERVAL_MS
+// écritures sur toute fenêtre d'une heure, et jamais plus de
+// ODOMETER_SAVE_MAX_MS de données non écrites.
+// Code de sortie 1 si un contrôle échoue.
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "host_core.h"
+
+RampStepper<MotorDriver> stepper;
+Odometer odometer;
+
+void onStep(long position, int dir) {
+  odometer.step(dir, stepper.stepInterval());
+  (void)position;
+}
+
+static int failures = 0;
+
+static void check(const char* name, double value, double expected, double tolerance) {
+  bool ok = std::fabs(value - expected) <= tolerance;
+  if (!ok) failures++;
+  printf("%-22s %16.3f %16.3f  %s\n", name, value, expected, ok ? "ok" : "ÉCHEC");
+}
+
+// ===== EXACTITUDE =====
+
+struct Move {
+  float distance;  // mm
+  float speed;     // mm/min
+};
+
+static void accuracy() {
+  const Move moves[] = { { 10, 600 }, { 25, 1200 }, { -5, 300 }, { -30, 2000 }, { 12.5, 900 }, { 12.5, 900 } };
+  const float stepsPerMmChange = 160;  // Appliqué avant les deux derniers mouvements
+
+  long expectedSteps = 0;
+  double expectedMm = 0;
+  long expectedReversals = 0;
+  double expectedMotionMs = 0;
+  float expectedPeak = 0;
+  int lastDir = 0;
+
+  STEPS_PER_MM = 100;
+  stepper.setCurrentPosition(0);
+  for (size_t i = 0; i < sizeof(moves) / sizeof(moves[0]); i++) {
+    const Move& m = moves[i];
+    if (i == 4) {
+      // Comme calculateStepsPerMm(): report à l'ancien pas/mm, puis changement
+      odometer.fold(STEPS_PER_MM, millis());
+      STEPS_PER_MM = stepsPerMmChange;
+    }
+    float speedStepsPerSec = m.speed * STEPS_PER_MM / 60.0;
+    long steps = (long)(m.distance * STEPS_PER_MM);
+    stepper.setMaxSpeed(speedStepsPerSec);
+    stepper.setAcceleration(speedStepsPerSec * ACCEL_FACTOR);
+    stepper.move(steps);
+    odometer.moveStarted();
+
+    int dir = steps > 0 ? 1 : -1;
+    if (lastDir != 0 && dir != lastDir) expectedReversals++;
+    lastDir = dir;
+    expectedSteps += labs(steps);
+    expectedMm += labs(steps) / STEPS_PER_MM;
+    expectedPeak = max(expectedPeak, m.speed);
+
+    uint64_t start = virtualUs;
+    while (stepper.isRunning()) {
+      stepper.run();
+      odometer.tick(millis(), true, STEPS_PER_MM);
+      virtualUs++;
+    }
+    expectedMotionMs += (virtualUs - start) / 1000.0;
+    // Pause: la boucle continue au repos
+    for (int ms = 0; ms < 1500; ms++) {
+      virtualUs += 1000;
+      odometer.tick(millis(), false, STEPS_PER_MM);
+    }
+  }
+  odometer.fold(STEPS_PER_MM, millis());
+
+  const OdometerTotals& t = odometer.totals;
+  printf("%-22s %16s %16s\n", "compteur", "odomètre", "attendu");
+  check("pas", (double)t.steps, expectedSteps, 0);
+  check("distance mm", t.distanceUm / 1000.0, expectedMm, 0.001);
+  check("inversions", t.reversals, expectedReversals, 0);
+  check("mouvements", t.moves, sizeof(moves) / sizeof(moves[0]), 0);
+  // Arrêt constaté au tour de boucle suivant: 1 ms par mouvement au plus
+  check("temps mouvement ms", (double)t.motionMs, expectedMotionMs, sizeof(moves) / sizeof(moves[0]));
+  // Intervalle commandé arrondi à la µs: à 2000 mm/min et 100 pas/mm, 300 µs
+  check("vitesse crête mm/min", t.peakSpeed, expectedPeak, expectedPeak * 0.005);
+}
+
+// ===== ÉCRITURES =====
+
+static void writes(double hours, unsigned seed) {
+  std::mt19937 rng(seed);
+  std::uniform_int_distribution<int> moveMs(100, 120000);
+  std::uniform_int_distribution<int> pauseMs(0, 60000);
+
+  Odometer odo;
+  std::vector<uint64_t> saves;
+  uint64_t nowMs = 0;
+  uint64_t endMs = (uint64_t)(hours * 3600000);
+  uint64_t worstUnsavedMs = 0;
+  uint64_t firstUnsavedMs = 0;
+  bool unsaved = false;
+
+  while (nowMs < endMs) {
+    uint64_t moveEnd = nowMs + moveMs(rng);
+    uint64_t pauseEnd = moveEnd + pauseMs(rng);
+    odo.moveStarted();
+    for (; nowMs < pauseEnd && nowMs < endMs; nowMs++) {
+      bool running = nowMs < moveEnd;
+      if (running) {
+        odo.step(1, 500);
+        odo.step(1, 500);
+        if (!unsaved) firstUnsavedMs = nowMs;
+        unsaved = true;
+      }
+      if (odo.tick((unsigned long)nowMs, running, 100)) {
+        odo.saved((unsigned long)nowMs);
+        saves.push_back(nowMs);
+        if (unsaved) worstUnsavedMs = max(worstUnsavedMs, nowMs - firstUnsavedMs);
+        unsaved = false;
+      }
+    }
+  }
+
+  size_t worstHour = 0;
+  size_t first = 0;
+  for (size_t i = 0; i < saves.size(); i++) {
+    while (saves[i] - saves[first] >= 3600000) first++;
+    worstHour = max(worstHour, i - first + 1);
+  }
+  size_t bound = 3600000 / ODOMETER_SAVE_INTERVAL_MS;
+  printf("\n%.0f h simulées: %zu écriture(s), %.2f/h en moyenne, au plus %zu sur une heure (borne %zu)\n", hours,
+         saves.size(), saves.size() / hours, worstHour, bound);
+  printf("données non écrites au plus %.1f min (borne %.1f min)\n", worstUnsavedMs / 60000.0,
+         ODOMETER_SAVE_MAX_MS / 60000.0);
+  if (worstHour > bound) failures++;
+  if (worstUnsavedMs > ODOMETER_SAVE_MAX_MS + ODOMETER_TICK_MS) failures++;
+  if (saves.empty()) failures++;
+}
+
+int main(int argc, char** argv) {
+  double hours = 48;
+  unsigned seed = 1;
+  for (int i = 1; i < argc; i++) {
+    if (strcmp(argv[i], "--hours") == 0 && i + 1 < argc) hours = atof(argv[++i]);
+    else if (strcmp(argv[i], "--seed") == 0 && i + 1 < argc) seed = atoi(argv[++i]);
+    else {
+      fprintf(stderr, "usage: odometer_check [--hours N] [--seed S]\n");
+      return 1;
+    }
+  }
+  accuracy();
+  writes(hours, seed);
+  printf("%s\n", failures == 0 ? "ok" : "ÉCHEC");
+  return failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,113 @@
+// Vérification hôte de l'estimation de durée (MovePlanner dans main.c)
+//
+// Compilation: g++ -O2 -std=c++17 -o plan_check tools/plan_check.cpp
+// Usage:       plan_check [--moves N] [--seed S]
+//
+// Le générateur du firmware (main.c inclus avec MOTION_CORE_ONLY) tourne sur
+// une horloge virtuelle qui saute au pas suivant (équivalent d'une boucle de
+// 1 µs). --moves (300) déplacements aléatoires depuis l'arrêt, 50 à 8050
+// steps/s, jusqu'à 20000 pas, accélération = vitesse × ACCEL_FACTOR, réglés
+// comme startMove(). Chaque déplacement est estimé comme /api/plan puis
+// exécuté; l'estimation (premier pas -> dernier pas) doit tomber à moins de
+// 1 ms de l'exécution:
+//  - table de rampe déjà construite pour l'accélération du déplacement;
+//  - table construite pour une autre accélération (celle du déplacement
+//    précédent, remise à l'échelle par l'estimation).
+// Puis non-régression de l'accélération (n'accélère que si
+// remaining > rampN + 1): chaque déplacement de 1 à 400 pas doit émettre
+// exactement n pas, sans dépasser la cible.
+// Code de sortie 1 si un contrôle échoue.
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <random>
+#include <string>
+
+#include "host_core.h"
+
+RampStepper<MotorDriver> stepper;
+
+static long emitted = 0;
+static long overshoot = 0;       // Plus grand dépassement de la cible (pas)
+static uint64_t lastStepUs = 0;
+
+void onStep(long position, int dir) {
+  emitted++;
+  overshoot = max(overshoot, (position - stepper.targetPosition()) * dir);
+  lastStepUs = virtualUs;
+}
+
+// Exécute le déplacement; retourne la durée premier pas -> dernier pas (µs)
+static uint64_t execute(long steps) {
+  emitted = 0;
+  overshoot = 0;
+  uint64_t start = virtualUs;
+  stepper.move(steps);
+  while (stepper.run()) virtualUs = max(virtualUs + 1, lastStepUs + stepper.stepInterval());
+  virtualUs += 1000;
+  return lastStepUs - start;
+}
+
+int main(int argc, char** argv) {
+  int moves = 300;
+  unsigned seed = 1;
+  for (int i = 1; i < argc; i++) {
+    if (strcmp(argv[i], "--moves") == 0 && i + 1 < argc) moves = max(1, atoi(argv[++i]));
+    else if (strcmp(argv[i], "--seed") == 0 && i + 1 < argc) seed = atoi(argv[++i]);
+    else {
+      fprintf(stderr, "usage: plan_check [--moves N] [--seed S]\n");
+      return 1;
+    }
+  }
+  std::mt19937 rng(seed);
+  std::uniform_real_distribution<float> speedDist(50, 8050);
+  std::uniform_int_distribution<long> stepDist(1, 20000);
+  int failures = 0;
+
+  printf("%-28s %8s %14s %14s %10s\n", "table", "moves", "pire (ms)", "moyen (ms)", "pas faux");
+  for (int otherTable = 0; otherTable < 2; otherTable++) {
+    double worstMs = 0, sumMs = 0;
+    long wrongSteps = 0;
+    int dir = 1;
+    for (int m = 0; m < moves; m++) {
+      float speed = speedDist(rng);
+      float accel = speed * ACCEL_FACTOR;
+      long steps = dir * stepDist(rng);
+      dir = -dir;
+      // Table en place au moment de l'estimation: celle du déplacement, ou
+      // celle laissée par un autre
+      stepper.setMaxSpeed(speed);
+      stepper.setAcceleration(otherTable ? speedDist(rng) * ACCEL_FACTOR : accel);
+      MovePlan plan = MovePlanner::estimate(stepper, steps, 0, speed, accel, 0);
+
+      stepper.setAcceleration(accel);
+      uint64_t durationUs = execute(steps);
+      double errorMs = fabs((double)plan.totalUs - (double)durationUs) / 1000.0;
+      worstMs = max(worstMs, errorMs);
+      sumMs += errorMs;
+      if (emitted != labs(steps) || overshoot > 0) wrongSteps++;
+    }
+    printf("%-28s %8d %14.3f %14.3f %10ld\n", otherTable ? "autre accélération" : "accélération du déplacement",
+           moves, worstMs, sumMs / moves, wrongSteps);
+    if (worstMs > 1.0 || wrongSteps != 0) failures++;
+  }
+
+  // Courts déplacements, pairs et impairs: la rampe redescend à zéro
+  // exactement sur la cible
+  long wrongShort = 0;
+  stepper.setMaxSpeed(4000);
+  stepper.setAcceleration(8000);
+  for (long n = 1; n <= 400; n++) {
+    execute(n % 2 ? n : -n);
+    if (emitted != n || overshoot > 0) wrongShort++;
+  }
+  printf("déplacements de 1 à 400 pas: %ld avec dépassement ou pas en trop\n", wrongShort);
+  if (wrongShort != 0) failures++;
+
+  printf("%s\n", failures == 0 ? "ok" : "ÉCHEC");
+  return failures == 0 ? 0 : 1;
+}
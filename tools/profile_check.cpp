@@ -0,0 +1,161 @@
+// Vérification hôte des changements de profil (PositionCarry dans main.c)
+//
+// Compilation: g++ -O2 -std=c++17 -o profile_check tools/profile_check.cpp
+// Usage:       profile_check [--chains N] [--hops N] [--seed S]
+//
+// Profils aléatoires (200 ou 400 pas/tour, 1 à 256 micropas, vis de 0,8 à
+// 8 mm, CalibrationProfile::derive() du firmware, main.c inclus avec
+// MOTION_CORE_ONLY). --chains (10000) suites de --hops (8) changements de
+// profil, position de départ aléatoire sur ±300 mm, converties comme
+// profileApply():
+//  - sans mouvement: à chaque changement, la position physique ne s'écarte
+//    de celle du départ que d'un demi-pas du profil d'arrivée au plus, et
+//    le retour au profil de départ rend exactement le même nombre de pas;
+//  - avec mouvement entre deux changements: la conversion repart de la
+//    nouvelle position (même borne d'un demi-pas).
+// En comparaison, la conversion naïve (arrondi depuis la position courante
+// à chaque changement) est mesurée: écart accumulé et retours inexacts.
+// Code de sortie 1 si un contrôle échoue.
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "host_core.h"
+
+RampStepper<MotorDriver> stepper;
+
+void onStep(long position, int dir) {
+  (void)position;
+  (void)dir;
+}
+
+static std::mt19937 rng(1);
+
+template <typename T, size_t N>
+static T pick(const T (&values)[N]) {
+  return values[std::uniform_int_distribution<size_t>(0, N - 1)(rng)];
+}
+
+static CalibrationProfile randomProfile() {
+  static const float stepsPerRev[] = { 200, 400 };
+  static const float microsteps[] = { 1, 2, 4, 8, 10, 16, 32, 64, 256 };
+  static const float pitch[] = { 0.8, 1, 1.25, 1.5, 2, 2.5, 4, 5, 8 };
+  CalibrationProfile p;
+  strcpy(p.name, "essai");
+  p.stepsPerRev = pick(stepsPerRev);
+  p.microsteps = pick(microsteps);
+  p.pitch = pick(pitch);
+  p.limitMin = -400;
+  p.limitMax = 400;
+  p.derive(ACCEL_FACTOR);
+  return p;
+}
+
+struct Stats {
+  long hops = 0;
+  long returns = 0;
+  long exactReturns = 0;
+  double worstHalfSteps = 0;   // Écart physique / demi-pas du profil d'arrivée
+};
+
+int main(int argc, char** argv) {
+  int chains = 10000;
+  int hops = 8;
+  unsigned seed = 1;
+  for (int i = 1; i < argc; i++) {
+    if (strcmp(argv[i], "--chains") == 0 && i + 1 < argc) chains = max(1, atoi(argv[++i]));
+    else if (strcmp(argv[i], "--hops") == 0 && i + 1 < argc) hops = max(2, atoi(argv[++i]));
+    else if (strcmp(argv[i], "--seed") == 0 && i + 1 < argc) seed = atoi(argv[++i]);
+    else {
+      fprintf(stderr, "usage: profile_check [--chains N] [--hops N] [--seed S]\n");
+      return 1;
+    }
+  }
+  rng.seed(seed);
+  std::uniform_real_distribution<double> startMm(-300, 300);
+  std::uniform_real_distribution<double> moveMm(-50, 50);
+
+  Stats carried, naive, moving;
+  for (int c = 0; c < chains; c++) {
+    std::vector<CalibrationProfile> chain;
+    for (int h = 0; h < hops; h++) chain.push_back(randomProfile());
+    chain.push_back(chain[0]);  // Retour au profil de départ
+
+    // Sans mouvement: conversion du firmware et conversion naïve
+    long start = llround(startMm(rng) * chain[0].stepsPerMm);
+    double physical = start / chain[0].stepsPerMm;
+    PositionCarry carry;
+    long steps = start;
+    long naiveSteps = start;
+    for (size_t h = 1; h < chain.size(); h++) {
+      const CalibrationProfile& from = chain[h - 1];
+      const CalibrationProfile& to = chain[h];
+      steps = carry.rescale(steps, from.stepsPerMm, to.stepsPerMm);
+      naiveSteps = llround(naiveSteps * to.stepsPerMm / from.stepsPerMm);
+      double halfStep = 0.5 / to.stepsPerMm;
+      carried.worstHalfSteps = max(carried.worstHalfSteps, std::fabs(steps / to.stepsPerMm - physical) / halfStep);
+      naive.worstHalfSteps = max(naive.worstHalfSteps, std::fabs(naiveSteps / to.stepsPerMm - physical) / halfStep);
+      carried.hops++;
+      naive.hops++;
+    }
+    carried.returns++;
+    naive.returns++;
+    if (steps == start) carried.exactReturns++;
+    if (naiveSteps == start) naive.exactReturns++;
+
+    // Avec mouvement dans chaque profil: la référence physique suit l'axe
+    steps = llround(startMm(rng) * chain[0].stepsPerMm);
+    PositionCarry carryMoving;
+    for (size_t h = 1; h < chain.size(); h++) {
+      const CalibrationProfile& from = chain[h - 1];
+      const CalibrationProfile& to = chain[h];
+      // Déplacement de moins d'un demi-pas: l'axe n'a pas bougé, la
+      // référence reste la position d'avant les changements
+      long delta = llround(moveMm(rng) * from.stepsPerMm);
+      if (h == 1 || delta != 0) physical = (steps + delta) / from.stepsPerMm;
+      steps += delta;
+      steps = carryMoving.rescale(steps, from.stepsPerMm, to.stepsPerMm);
+      double halfStep = 0.5 / to.stepsPerMm;
+      moving.worstHalfSteps = max(moving.worstHalfSteps, std::fabs(steps / to.stepsPerMm - physical) / halfStep);
+      moving.hops++;
+    }
+  }
+
+  // Coût d'un changement: conversion de position et constantes précalculées
+  typedef std::chrono::steady_clock Clock;
+  CalibrationProfile a = randomProfile();
+  CalibrationProfile b = randomProfile();
+  PositionCarry carry;
+  long steps = 123456;
+  const long rounds = 10000000;
+  Clock::time_point begin = Clock::now();
+  for (long i = 0; i < rounds; i++) {
+    const CalibrationProfile& from = i & 1 ? b : a;
+    const CalibrationProfile& to = i & 1 ? a : b;
+    steps = carry.rescale(steps, from.stepsPerMm, to.stepsPerMm);
+  }
+  double ns = std::chrono::duration<double, std::nano>(Clock::now() - begin).count() / rounds;
+
+  printf("%d suites de %d changements\n", chains, hops);
+  printf("%-24s %10s %14s %18s\n", "conversion", "changements", "retours exacts", "écart max/demi-pas");
+  printf("%-24s %10ld %7ld/%-6ld %18.3f\n", "firmware (sans mvt)", carried.hops, carried.exactReturns, carried.returns,
+         carried.worstHalfSteps);
+  printf("%-24s %10ld %14s %18.3f\n", "firmware (avec mvt)", moving.hops, "-", moving.worstHalfSteps);
+  printf("%-24s %10ld %7ld/%-6ld %18.3f\n", "naïve (sans mvt)", naive.hops, naive.exactReturns, naive.returns,
+         naive.worstHalfSteps);
+  printf("\nconversion: %.1f ns par changement (hôte)  [%ld]\n", ns, steps & 1);
+
+  const double slack = 1 + 1e-6;  // Demi-pas exact (égalité) au calcul en double près
+  bool ok = carried.exactReturns == carried.returns && carried.worstHalfSteps <= slack &&
+            moving.worstHalfSteps <= slack;
+  printf("%s\n", ok ? "ok" : "ÉCHEC");
+  return ok ? 0 : 1;
+}
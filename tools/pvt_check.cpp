@@ -0,0 +1,288 @@
+// Vérification hôte du flux PVT (PvtStream dans main.c)
+//
+// Compilation: g++ -O2 -std=c++17 -o pvt_check tools/pvt_check.cpp
+// Usage:       pvt_check [--streams N] [--points N] [--seed S] [--loop-us N]
+//
+// Le flux et le générateur de pas du firmware (main.c inclus avec
+// MOTION_CORE_ONLY) tournent sur une horloge virtuelle avancée de --loop-us
+// (10) par tour, comme loop(): la file est remplie par lots dès que de la
+// place se libère, comme un client de POST /api/pvt, PvtStream::update()
+// donne la consigne et RampStepper::follow() émet au plus un pas, à
+// SPEED_MAX au plus, comme pvtFollow().
+//
+// Contrôles, sur --streams (20) flux aléatoires de --points (500) points:
+//  - consigne: à chaque tour, égale à l'Hermite cubique calculée en double
+//    précision, à un pas près (coefficients en float sur le firmware);
+//  - continuité aux points: position exacte sur le point, vitesse d'arrivée
+//    d'un segment égale à la vitesse de départ du suivant;
+//  - suivi: l'axe termine exactement sur le dernier point, retard maximal
+//    sous PVT_LAG_FAULT_MM, sans rupture de flux;
+//  - rupture: une file vidée en pleine vitesse est signalée une fois et la
+//    consigne tient le dernier point; des points ajoutés plus tard
+//    repartent de l'instant de reprise, sans bond.
+// Puis débit: points/s mis en file et chargés (push + load), évaluations/s
+// de la consigne (update). Code de sortie 1 si un contrôle échoue.
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "host_core.h"
+
+// Copie de main.c (section non incluse avec MOTION_CORE_ONLY)
+#define PVT_LAG_FAULT_MM 1.0
+
+RampStepper<MotorDriver> stepper;
+
+void onStep(long position, int dir) {
+  (void)position;
+  (void)dir;
+}
+
+static uint32_t loopUs = 10;
+static int failures = 0;
+
+// ===== FLUX =====
+
+// Trajectoire lisse (somme de sinusoïdes) échantillonnée à pas de temps
+// aléatoires: positions et vitesses exactes, vitesse crête sous 80% de
+// SPEED_MAX; le dernier point est à vitesse nulle.
+static std::vector<PvtPoint> makeStream(std::mt19937& rng, size_t count) {
+  std::uniform_real_distribution<double> unit(0, 1);
+  std::uniform_int_distribution<int> durationMs(5, 40);
+  double vmax = SPEED_MAX * STEPS_PER_MM / 60.0 * 0.8;
+  double amplitude[3], omega[3], phase[3];
+  double peak = 0;
+  for (int k = 0; k < 3; k++) {
+    omega[k] = 2 * M_PI * (0.2 + 2 * unit(rng));
+    amplitude[k] = 1 + unit(rng);
+    phase[k] = 2 * M_PI * unit(rng);
+    peak += amplitude[k] * omega[k];
+  }
+  for (int k = 0; k < 3; k++) amplitude[k] *= vmax / peak;
+
+  std::vector<PvtPoint> points;
+  double t = 0;
+  for (size_t i = 0; i < count; i++) {
+    uint32_t dt = durationMs(rng) * 1000;
+    t += dt * 1e-6;
+    double x = 0, v = 0;
+    for (int k = 0; k < 3; k++) {
+      x += amplitude[k] * (std::sin(omega[k] * t + phase[k]) - std::sin(phase[k]));
+      v += amplitude[k] * omega[k] * std::cos(omega[k] * t + phase[k]);
+    }
+    PvtPoint p;
+    p.position = lround(x);
+    p.velocity = i + 1 == count ? 0 : (float)v;
+    p.durationUs = dt;
+    points.push_back(p);
+  }
+  return points;
+}
+
+// Hermite cubique de référence entre (x0, v0) et le point p, à t µs du départ
+static double reference(double x0, double v0, const PvtPoint& p, double t) {
+  double T = p.durationUs * 1e-6;
+  double s = t / p.durationUs;
+  double h00 = 2 * s * s * s - 3 * s * s + 1;
+  double h10 = s * s * s - 2 * s * s + s;
+  double h01 = -2 * s * s * s + 3 * s * s;
+  double h11 = s * s * s - s * s;
+  return h00 * x0 + h10 * v0 * T + h01 * p.position + h11 * p.velocity * T;
+}
+
+struct Run {
+  long worstError = 0;       // Consigne / référence, pas
+  double worstKnot = 0;      // Écart de vitesse aux points, pas/s
+  long worstKnotPos = 0;     // Écart de position aux points, pas
+  long maxLag = 0;
+  long finalAxis = 0;
+  long lastPoint = 0;
+  uint32_t underruns = 0;
+  bool faulted = false;
+};
+
+// Suivi d'un flux comme pvtFollow(), file remplie par lots de "batch"
+static Run follow(PvtStream& pvt, const std::vector<PvtPoint>& points, size_t batch) {
+  Run run;
+  uint32_t minIntervalUs = (uint32_t)(60000000.0 / (SPEED_MAX * STEPS_PER_MM));
+  long lagFault = lround(PVT_LAG_FAULT_MM * STEPS_PER_MM);
+  stepper.setCurrentPosition(0);
+  pvt.clear();
+  size_t sent = 0;
+  while (sent < points.size() && pvt.push(points[sent])) sent++;
+  pvt.start(0, micros());
+
+  // Référence: segment courant (départ, point d'arrivée, instant de départ)
+  size_t seg = 0;
+  double x0 = 0, v0 = 0;
+  uint64_t segStart = virtualUs;
+  uint32_t lastSegments = pvt.segments;
+
+  for (;;) {
+    if (pvt.space() >= batch) {
+      for (size_t i = 0; i < batch && sent < points.size(); i++) pvt.push(points[sent++]);
+    }
+    long target;
+    int state = pvt.update(micros(), target);
+
+    // Points franchis: continuité des coefficients au raccord
+    while (seg < points.size() && virtualUs - segStart >= points[seg].durationUs) {
+      segStart += points[seg].durationUs;
+      x0 = points[seg].position;
+      v0 = points[seg].velocity;
+      seg++;
+    }
+    if (pvt.segments != lastSegments && state == PVT_RUNNING) {
+      lastSegments = pvt.segments;
+      double T = pvt.segUs * 1e-6;
+      double end = pvt.p0 + (double)pvt.c1 + pvt.c2 + pvt.c3;
+      run.worstKnotPos = max(run.worstKnotPos, labs(pvt.p0 - lround(x0)));
+      run.worstKnotPos = max(run.worstKnotPos, lround(std::fabs(end - pvt.p1)));
+      run.worstKnot = max(run.worstKnot, std::fabs(pvt.c1 / T - v0));
+      run.worstKnot = max(run.worstKnot, std::fabs((pvt.c1 + 2 * pvt.c2 + 3 * pvt.c3) / T - pvt.v1));
+    }
+    if (state == PVT_RUNNING && seg < points.size()) {
+      long exact = lround(reference(x0, v0, points[seg], (double)(virtualUs - segStart)));
+      run.worstError = max(run.worstError, labs(target - exact));
+    }
+
+    stepper.follow(target, minIntervalUs);
+    long lag = labs(target - stepper.currentPosition());
+    run.maxLag = max(run.maxLag, lag);
+    if (state == PVT_RUNNING && lag >= lagFault) {
+      run.faulted = true;
+      break;
+    }
+    virtualUs += loopUs;
+    if (state != PVT_RUNNING && lag == 0) break;
+  }
+  run.finalAxis = stepper.currentPosition();
+  run.lastPoint = points.back().position;
+  run.underruns = pvt.underruns;
+  return run;
+}
+
+static void underrun() {
+  PvtStream pvt;
+  pvt.start(0, micros());
+  PvtPoint p;
+  p.position = 200;
+  p.velocity = 3000;  // File vide en pleine vitesse
+  p.durationUs = 100000;
+  pvt.push(p);
+  long target = 0;
+  int state = PVT_RUNNING;
+  int transitions = 0;
+  for (int i = 0; i < 20000 && transitions < 3; i++, virtualUs += loopUs) {
+    int next = pvt.update(micros(), target);
+    if (next != state) transitions++;
+    state = next;
+  }
+  bool ok = state == PVT_DONE && pvt.underruns == 1 && target == p.position;
+  // Après la rupture, la consigne tient le dernier point
+  long held;
+  virtualUs += 500000;
+  pvt.update(micros(), held);
+  ok = ok && held == p.position && pvt.underruns == 1;
+  if (!ok) failures++;
+  printf("rupture de flux: %u signalée(s), consigne %ld (attendu 200)  %s\n", pvt.underruns, held, ok ? "ok" : "ÉCHEC");
+
+  // Reprise tardive: le segment part de l'instant de reprise, la consigne
+  // ne saute pas vers le point suivant
+  PvtPoint next;
+  next.position = 400;
+  next.velocity = 0;
+  next.durationUs = 100000;
+  pvt.push(next);
+  long resumed, half;
+  int resumeState = pvt.update(micros(), resumed);
+  virtualUs += 50000;
+  pvt.update(micros(), half);
+  bool resumeOk = resumeState == PVT_RUNNING && resumed == p.position && half == 300;
+  if (!resumeOk) failures++;
+  printf("reprise après rupture: consigne %ld puis %ld à mi-segment (attendu 200, 300)  %s\n", resumed, half,
+         resumeOk ? "ok" : "ÉCHEC");
+}
+
+// ===== DÉBIT =====
+
+static void bench(std::mt19937& rng) {
+  typedef std::chrono::steady_clock Clock;
+  std::vector<PvtPoint> points = makeStream(rng, PVT_CAPACITY);
+  PvtStream pvt;
+  const long rounds = 200000;
+  Clock::time_point start = Clock::now();
+  long checksum = 0;
+  for (long r = 0; r < rounds; r++) {
+    pvt.clear();
+    for (const PvtPoint& p : points) pvt.push(p);
+    while (pvt.load()) checksum += pvt.p1;
+  }
+  double pushLoad = rounds * points.size() / std::chrono::duration<double>(Clock::now() - start).count();
+
+  pvt.clear();
+  for (const PvtPoint& p : points) pvt.push(p);
+  pvt.start(0, 0);
+  uint64_t total = 0;
+  for (const PvtPoint& p : points) total += p.durationUs;
+  const long evaluations = 20000000;
+  long target;
+  start = Clock::now();
+  for (long i = 0; i < evaluations; i++) {
+    // Temps croissant sur la durée du flux, sans le terminer
+    pvt.update((uint32_t)(i * (total - 1) / evaluations), target);
+    checksum += target;
+  }
+  double updates = evaluations / std::chrono::duration<double>(Clock::now() - start).count();
+  printf("\ndébit hôte: %.2f M points/s (push + load), %.1f M évaluations/s (update)  [%ld]\n", pushLoad / 1e6,
+         updates / 1e6, checksum & 1);
+}
+
+int main(int argc, char** argv) {
+  int streams = 20;
+  size_t count = 500;
+  unsigned seed = 1;
+  for (int i = 1; i < argc; i++) {
+    if (strcmp(argv[i], "--streams") == 0 && i + 1 < argc) streams = max(1, atoi(argv[++i]));
+    else if (strcmp(argv[i], "--points") == 0 && i + 1 < argc) count = max(2, atoi(argv[++i]));
+    else if (strcmp(argv[i], "--seed") == 0 && i + 1 < argc) seed = atoi(argv[++i]);
+    else if (strcmp(argv[i], "--loop-us") == 0 && i + 1 < argc) loopUs = max(1, atoi(argv[++i]));
+    else {
+      fprintf(stderr, "usage: pvt_check [--streams N] [--points N] [--seed S] [--loop-us N]\n");
+      return 1;
+    }
+  }
+
+  std::mt19937 rng(seed);
+  printf("%-6s %8s %8s %10s %10s %10s %8s  %s\n", "flux", "lot", "fin", "attendu", "consigne", "v raccord",
+         "retard", "résultat");
+  for (int s = 0; s < streams; s++) {
+    std::vector<PvtPoint> points = makeStream(rng, count);
+    size_t batch = 1 + s % 32;
+    PvtStream pvt;
+    Run run = follow(pvt, points, batch);
+    std::string verdict;
+    if (run.worstError > 1) verdict += " consigne";
+    if (run.worstKnotPos > 0 || run.worstKnot > 0.01) verdict += " raccord";
+    if (run.finalAxis != run.lastPoint) verdict += " position finale";
+    if (run.faulted) verdict += " arrêt sur retard";
+    if (run.underruns != 0) verdict += " rupture";
+    if (!verdict.empty()) failures++;
+    printf("%-6d %8zu %8ld %10ld %10ld %10.4f %8ld  %s\n", s, batch, run.finalAxis, run.lastPoint, run.worstError,
+           run.worstKnot, run.maxLag, verdict.empty() ? "ok" : ("ÉCHEC:" + verdict).c_str());
+  }
+  printf("\n");
+  underrun();
+  bench(rng);
+
+  printf("%s\n", failures == 0 ? "ok" : "ÉCHEC");
+  return failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,107 @@
+// Vérification hôte de la table de rampe (RampStepper dans main.c)
+//
+// Compilation: g++ -O2 -std=c++17 -o ramp_check tools/ramp_check.cpp
+// Usage:       ramp_check [--iterations N]
+//
+// Précision: pour des accélérations de 166 à 2e5 steps/s², chaque
+// intervalle de la table 24.8 interpolée (main.c inclus avec
+// MOTION_CORE_ONLY) est comparé à la formule exacte
+// K·(sqrt(n+1) - sqrt(n)), K = sqrt(2/a)·1e6 µs, sur toute la rampe
+// jusqu'à RAMP_MAX_SPEED (50000 steps/s) ou la fin de la table; l'erreur
+// relative doit rester sous 2.2e-3.
+// Coût: temps par pas de la recherche dans la table contre la mise à jour
+// flottante à la AccelStepper (c = c - 2c/(4n+1)), sur --iterations
+// (10000000) pas. Affiché seulement, non contrôlé: sur l'hôte les deux se
+// valent (FPU rapide, division matérielle). Le gain de la table n'existe
+// que côté ESP32: le FPU du LX6 n'a pas d'instruction de division, et un
+// chemin de pas sans flottant peut passer sous interruption de timer, où
+// le FPU est interdit. L'hôte ne peut pas le montrer.
+// Code de sortie 1 si un contrôle échoue.
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+
+#include "host_core.h"
+
+RampStepper<MotorDriver> stepper;
+
+void onStep(long, int) {}
+
+// Vitesse la plus haute contrôlée: au-delà, l'ESP32 n'émet plus les pas
+#define RAMP_MAX_SPEED 50000.0
+#define RAMP_ERROR_MAX 2.2e-3
+// Fin de la table: au-delà, l'intervalle reste celui de la dernière entrée
+#define RAMP_TABLE_END ((uint32_t)RAMP_HEAD_STEPS << RAMP_OCTAVES)
+
+typedef std::chrono::steady_clock Clock;
+
+static double nsPerStep(Clock::time_point start, long iterations) {
+  return std::chrono::duration<double, std::nano>(Clock::now() - start).count() / iterations;
+}
+
+int main(int argc, char** argv) {
+  long iterations = 10000000;
+  for (int i = 1; i < argc; i++) {
+    if (strcmp(argv[i], "--iterations") == 0 && i + 1 < argc) iterations = max(1L, atol(argv[++i]));
+    else {
+      fprintf(stderr, "usage: ramp_check [--iterations N]\n");
+      return 1;
+    }
+  }
+  int failures = 0;
+
+  static const double accels[] = { 166, 500, 1000, 4000, 16000, 50000, 100000, 200000 };
+  printf("%-12s %10s %14s %10s\n", "accél.", "pas", "erreur max", "au pas");
+  for (double accel : accels) {
+    stepper.setAcceleration(accel);
+    double k = sqrt(2.0 / accel) * 1000000.0;
+    uint32_t steps = (uint32_t)min(RAMP_MAX_SPEED * RAMP_MAX_SPEED / (2.0 * accel), (double)RAMP_TABLE_END);
+    double worst = 0;
+    uint32_t worstN = 0;
+    for (uint32_t n = 0; n < steps; n++) {
+      double exact = k * (sqrt((double)n + 1) - sqrt((double)n));
+      double error = fabs(stepper.interval(n) / 256.0 - exact) / exact;
+      if (error > worst) {
+        worst = error;
+        worstN = n;
+      }
+    }
+    printf("%-12.0f %10u %14.2e %10u\n", accel, steps, worst, worstN);
+    if (worst > RAMP_ERROR_MAX) failures++;
+  }
+
+  // Même parcours de rampe pour les deux: accélération sur rampN pas
+  stepper.setAcceleration(8000);
+  const uint32_t rampN = 100000;
+  volatile uint32_t sink = 0;
+  Clock::time_point start = Clock::now();
+  for (long i = 0; i < iterations; i++) sink = stepper.interval((uint32_t)(i % rampN));
+  double tableNs = nsPerStep(start, iterations);
+
+  float c0 = 0.676 * sqrt(2.0 / 8000) * 1000000.0;
+  float c = c0;
+  long n = 0;
+  start = Clock::now();
+  for (long i = 0; i < iterations; i++) {
+    if (++n == (long)rampN) {
+      n = 1;
+      c = c0;
+    }
+    c = c - 2.0f * c / (4.0f * n + 1.0f);
+    sink = (uint32_t)c;
+  }
+  double floatNs = nsPerStep(start, iterations);
+  (void)sink;
+
+  printf("\n%-30s %8.1f ns/pas\n", "table 24.8 interpolée", tableNs);
+  printf("%-30s %8.1f ns/pas\n", "mise à jour flottante", floatNs);
+
+  printf("%s\n", failures == 0 ? "ok" : "ÉCHEC");
+  return failures == 0 ? 0 : 1;
+}
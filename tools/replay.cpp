@@ -0,0 +1,480 @@
+// Rejeu du journal de commandes (GET /api/journal, voir "JOURNAL DE COMMANDES" dans main.c)
+//
+// Compilation: g++ -O2 -std=c++17 -o replay tools/replay.cpp
+// Usage:       curl -X POST -d '{"action":"start"}' http://192.168.4.1/api/journal
+//              ... trafic de production ...
+//              curl -o journal.bin http://192.168.4.1/api/journal
+//              replay journal.bin [--loop-us N] [--tolerance steps] [--csv] [--write sortie.bin]
+//
+// Le générateur de pas et le driver STEP/DIR sont ceux du firmware: main.c
+// est inclus avec MOTION_CORE_ONLY, sur une horloge virtuelle que la boucle
+// de rejeu avance de --loop-us (10) par tour, comme un tour de loop(). Les
+// commandes sont appliquées à leur horodatage de la même façon que
+// startMove(), applySpeed(), stopMotor(), startHoming() et resetPosition();
+// la boucle reproduit la partie mouvement de loop(): rampe de correction
+// d'avance, arrivée constatée toutes les 50 ms, limites du mode continu
+// toutes les 100 ms. La mise en forme de consigne n'est pas rejouée.
+//
+// Rapport: retard des pas sur l'intervalle commandé, latence commande ->
+// premier pas, écart de position à chaque entrée et en fin de rejeu, écart
+// de durée des mouvements. Code de sortie 1 si l'écart final dépasse
+// --tolerance (0 par défaut): deux versions du générateur rejouées sur le
+// même journal doivent donner le même résultat.
+//
+// --write enregistre le journal tel que rejoué (positions du rejeu, arrivées
+// et arrêts sur limite constatés par le rejeu) dans le même format: rejoué à
+// nouveau, il ne doit présenter aucun écart. C'est la référence à comparer
+// après une modification du générateur.
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+
+#include "host_core.h"
+
+#define JOURNAL_MAGIC 0x314E524A  // "JRN1"
+#define JOURNAL_VERSION 1
+
+#define JOURNAL_MOVE 1
+#define JOURNAL_CONTINUOUS 2
+#define JOURNAL_SPEED 3
+#define JOURNAL_OVERRIDE 4
+#define JOURNAL_STOP 5
+#define JOURNAL_HOME 6
+#define JOURNAL_RESET 7
+#define JOURNAL_ARRIVED 8
+#define JOURNAL_LIMIT 9
+#define JOURNAL_FAULT 10
+
+#define CONTINUOUS_HORIZON_STEPS 1000000L
+
+struct __attribute__((packed)) JournalEntry {
+  uint32_t timeUs;
+  uint8_t command;
+  uint8_t reserved;
+  uint16_t overridePct;
+  float a;
+  float b;
+  int32_t position;
+  int32_t target;
+};
+
+struct __attribute__((packed)) JournalHeader {
+  uint32_t magic;
+  uint16_t version;
+  uint16_t entrySize;
+  uint32_t count;
+  uint32_t dropped;
+  float stepsPerMm;
+  float accelFactor;
+  float speedHome;
+  float limitMin;
+  float limitMax;
+  uint8_t limitsEnabled;
+  uint8_t shaperType;
+  uint16_t reserved;
+};
+
+static const char* commandName(uint8_t command) {
+  static const char* const names[] = { "?", "move", "continuous", "speed", "override", "stop",
+                                       "home", "reset", "arrived", "limit", "fault" };
+  return command <= JOURNAL_FAULT ? names[command] : "?";
+}
+
+// ===== ÉTAT MOUVEMENT (mêmes noms que main.c) =====
+RampStepper<MotorDriver> stepper;
+bool isRunning = false;
+bool movingToTarget = false;
+bool continuousMode = false;
+int moveDirection = 1;
+float currentPosition = 0.0;
+float targetPosition = 0.0;
+float feedOverride = 100.0;
+float motionBaseSpeed = 0;
+float motionAccel = 0;
+float feedSpeedApplied = 0;
+unsigned long feedLastUpdate = 0;
+unsigned long lastCheckContinuous = 0;
+unsigned long lastCheckTarget = 0;
+
+// ===== MESURES =====
+struct MoveTiming {
+  uint64_t deviceStart;
+  uint64_t replayStart;
+  double deviceMs = -1;
+  double replayMs = -1;
+};
+
+std::vector<double> stepLatenessUs;
+std::vector<double> commandLatencyUs;
+std::vector<MoveTiming> moves;
+std::vector<JournalEntry> replayed;   // Pour --write
+uint64_t replayStartUs = 0;
+uint32_t journalStartUs = 0;          // Horodatage de la première entrée (horloge de l'axe)
+uint64_t commandUs = 0;
+bool firstStepPending = false;
+uint64_t lastStepUs = 0;
+bool lastStepValid = false;
+uint32_t minIntervalUs = UINT32_MAX;
+long stepsEmitted = 0;
+long limitStops = 0;
+
+void onStep(long position, int dir) {
+  stepsEmitted++;
+  if (firstStepPending) {
+    commandLatencyUs.push_back(virtualUs - commandUs);
+    firstStepPending = false;
+  }
+  // Intervalle commandé du pas qui vient d'être émis, mis à jour après onStep()
+  uint32_t commanded = stepper.stepInterval();
+  if (lastStepValid && commanded != 0) {
+    uint64_t actual = virtualUs - lastStepUs;
+    stepLatenessUs.push_back((double)actual - commanded);
+    minIntervalUs = min(minIntervalUs, (uint32_t)actual);
+  }
+  lastStepUs = virtualUs;
+  lastStepValid = true;
+  (void)position;
+  (void)dir;
+}
+
+// Entrée du journal rejoué, horodatée dans l'horloge de l'axe
+void replayedEntry(uint32_t timeUs, uint8_t command, float a, float b) {
+  JournalEntry entry;
+  entry.timeUs = timeUs;
+  entry.command = command;
+  entry.reserved = 0;
+  entry.overridePct = (uint16_t)feedOverride;
+  entry.a = a;
+  entry.b = b;
+  entry.position = stepper.currentPosition();
+  entry.target = stepper.targetPosition();
+  replayed.push_back(entry);
+}
+
+void replayedEvent(uint8_t command) {
+  replayedEntry(journalStartUs + (uint32_t)(virtualUs - replayStartUs), command, 0, 0);
+}
+
+void motionStarted() {
+  commandUs = virtualUs;
+  firstStepPending = true;
+  lastStepValid = false;
+}
+
+// ===== COMMANDES (copies de main.c) =====
+
+float beginFeed(float baseStepsPerSec) {
+  motionBaseSpeed = baseStepsPerSec;
+  motionAccel = baseStepsPerSec * ACCEL_FACTOR;
+  feedSpeedApplied = baseStepsPerSec * feedOverride / 100.0;
+  feedLastUpdate = micros();
+  return feedSpeedApplied;
+}
+
+void updateFeedOverride() {
+  if (!isRunning || motionBaseSpeed <= 0) return;
+
+  unsigned long now = micros();
+  float dt = (now - feedLastUpdate) / 1000000.0;
+  if (dt < 0.001) return;
+  feedLastUpdate = now;
+  dt = min(dt, 0.02f);
+
+  float target = motionBaseSpeed * feedOverride / 100.0;
+  if (target == feedSpeedApplied) return;
+
+  float maxDelta = motionAccel * dt;
+  if (target > feedSpeedApplied) {
+    feedSpeedApplied = min(target, feedSpeedApplied + maxDelta);
+  } else {
+    feedSpeedApplied = max(target, feedSpeedApplied - maxDelta);
+  }
+
+  if (continuousMode || movingToTarget) {
+    stepper.setMaxSpeed(feedSpeedApplied);
+  }
+}
+
+void stopMotor() {
+  stepper.setCurrentPosition(stepper.currentPosition());
+  isRunning = false;
+  movingToTarget = false;
+  continuousMode = false;
+  currentPosition = (float)stepper.currentPosition() / STEPS_PER_MM;
+  targetPosition = currentPosition;
+}
+
+void startMove(float distance, float speed) {
+  currentPosition = (float)stepper.currentPosition() / STEPS_PER_MM;
+  float speedStepsPerSec = (speed * STEPS_PER_MM) / 60.0;
+  stepper.setMaxSpeed(beginFeed(speedStepsPerSec));
+  stepper.setAcceleration(speedStepsPerSec * ACCEL_FACTOR);
+  stepper.move((long)(distance * STEPS_PER_MM));
+  targetPosition = currentPosition + distance;
+  movingToTarget = true;
+  isRunning = true;
+}
+
+long continuousTarget(int direction) {
+  if (SOFT_LIMITS_ENABLED) {
+    return lround((direction > 0 ? SOFT_LIMIT_MAX : SOFT_LIMIT_MIN) * STEPS_PER_MM);
+  }
+  return stepper.currentPosition() + direction * CONTINUOUS_HORIZON_STEPS;
+}
+
+// /api/move continu: nouvelle cible, comme un déplacement
+void startContinuous(int direction, float speed) {
+  long target = continuousTarget(direction);
+  if ((target - stepper.currentPosition()) * direction <= 0) return;
+  float speedStepsPerSec = (speed * STEPS_PER_MM) / 60.0;
+  moveDirection = direction;
+  stepper.setMaxSpeed(beginFeed(speedStepsPerSec));
+  stepper.setAcceleration(speedStepsPerSec * ACCEL_FACTOR);
+  stepper.moveTo(target);
+  movingToTarget = false;
+  continuousMode = true;
+  isRunning = true;
+}
+
+void applySpeed(float newSpeed) {
+  if (isRunning && (continuousMode || movingToTarget)) {
+    motionBaseSpeed = (newSpeed * STEPS_PER_MM) / 60.0;
+  }
+}
+
+void startHoming() {
+  stopMotor();
+  float homeSpeed = (SPEED_HOME * STEPS_PER_MM) / 60.0;
+  stepper.setMaxSpeed(beginFeed(homeSpeed));
+  stepper.setAcceleration(homeSpeed * ACCEL_FACTOR);
+  stepper.move((long)(-currentPosition * STEPS_PER_MM));
+  targetPosition = 0.0;
+  movingToTarget = true;
+  isRunning = true;
+}
+
+void resetPosition() {
+  stopMotor();
+  stepper.setCurrentPosition(0);
+  currentPosition = 0.0;
+  targetPosition = 0.0;
+}
+
+// Partie mouvement de loop()
+void loopMotion() {
+  updateFeedOverride();
+  if (!isRunning) return;
+
+  if (continuousMode) {
+    stepper.run();
+    if (millis() - lastCheckContinuous > 100) {
+      lastCheckContinuous = millis();
+      currentPosition = (float)stepper.currentPosition() / STEPS_PER_MM;
+      if (!stepper.isRunning()) {
+        stopMotor();
+        limitStops++;
+        replayedEvent(JOURNAL_LIMIT);
+      } else if (!SOFT_LIMITS_ENABLED) {
+        stepper.moveTo(continuousTarget(moveDirection));
+      }
+    }
+  } else if (movingToTarget) {
+    stepper.run();
+    if (millis() - lastCheckTarget > 50) {
+      lastCheckTarget = millis();
+      if (stepper.distanceToGo() == 0) {
+        isRunning = false;
+        movingToTarget = false;
+        replayedEvent(JOURNAL_ARRIVED);
+        if (!moves.empty() && moves.back().replayMs < 0) {
+          moves.back().replayMs = (virtualUs - moves.back().replayStart) / 1000.0;
+        }
+      }
+    }
+  }
+}
+
+// ===== REJEU =====
+
+static double percentile(std::vector<double> values, double p) {
+  if (values.empty()) return 0;
+  std::sort(values.begin(), values.end());
+  return values[min(values.size() - 1, (size_t)(p * values.size()))];
+}
+
+int main(int argc, char** argv) {
+  const char* path = nullptr;
+  uint32_t loopUs = 10;
+  long tolerance = 0;
+  bool csv = false;
+  const char* writePath = nullptr;
+  for (int i = 1; i < argc; i++) {
+    if (strcmp(argv[i], "--loop-us") == 0 && i + 1 < argc) loopUs = max(1, atoi(argv[++i]));
+    else if (strcmp(argv[i], "--tolerance") == 0 && i + 1 < argc) tolerance = atol(argv[++i]);
+    else if (strcmp(argv[i], "--csv") == 0) csv = true;
+    else if (strcmp(argv[i], "--write") == 0 && i + 1 < argc) writePath = argv[++i];
+    else path = argv[i];
+  }
+  if (path == nullptr) {
+    fprintf(stderr, "usage: replay journal.bin [--loop-us N] [--tolerance steps] [--csv] [--write sortie.bin]\n");
+    return 1;
+  }
+
+  FILE* f = fopen(path, "rb");
+  if (!f) {
+    perror(path);
+    return 1;
+  }
+  JournalHeader header;
+  if (fread(&header, sizeof(header), 1, f) != 1 || header.magic != JOURNAL_MAGIC ||
+      header.version != JOURNAL_VERSION || header.entrySize != sizeof(JournalEntry)) {
+    fprintf(stderr, "%s: journal invalide ou version non supportée\n", path);
+    return 1;
+  }
+  std::vector<JournalEntry> entries(header.count);
+  if (fread(entries.data(), sizeof(JournalEntry), header.count, f) != header.count) {
+    fprintf(stderr, "%s: journal tronqué\n", path);
+    return 1;
+  }
+  fclose(f);
+  if (entries.empty()) {
+    fprintf(stderr, "%s: journal vide\n", path);
+    return 1;
+  }
+
+  STEPS_PER_MM = header.stepsPerMm;
+  ACCEL_FACTOR = header.accelFactor;
+  SPEED_HOME = header.speedHome;
+  SOFT_LIMIT_MIN = header.limitMin;
+  SOFT_LIMIT_MAX = header.limitMax;
+  SOFT_LIMITS_ENABLED = header.limitsEnabled != 0;
+  if (header.dropped > 0) {
+    fprintf(stderr, "attention: %u entrée(s) écrasée(s), l'état initial est supposé à l'arrêt\n", header.dropped);
+  }
+  if (header.shaperType != SHAPER_NONE) {
+    fprintf(stderr, "attention: mise en forme %u active sur l'axe, rejouée sans\n", header.shaperType);
+  }
+
+  stepper.begin();
+  stepper.setCurrentPosition(entries[0].position);
+  feedOverride = entries[0].overridePct;
+
+  long maxDivergence = 0;
+  long divergent = 0;
+  long late = 0;
+  const uint64_t startUs = virtualUs;
+  uint64_t entryUs = startUs;
+  replayStartUs = startUs;
+  journalStartUs = entries[0].timeUs;
+  if (csv) printf("temps_ms,commande,a,b,position_axe,position_rejeu,ecart\n");
+
+  for (size_t i = 0; i < entries.size(); i++) {
+    const JournalEntry& e = entries[i];
+    if (i > 0) entryUs += (uint32_t)(e.timeUs - entries[i - 1].timeUs);  // Retour à zéro de micros() compris
+    while (virtualUs < entryUs) {
+      loopMotion();
+      virtualUs += loopUs;
+    }
+    if (virtualUs > entryUs + loopUs) late++;
+
+    switch (e.command) {
+      case JOURNAL_MOVE:
+        startMove(e.a, e.b);  // Depuis un mouvement en cours: nouvelle cible
+        continuousMode = false;
+        moves.push_back({ entryUs, virtualUs });
+        motionStarted();
+        break;
+      case JOURNAL_CONTINUOUS:
+        startContinuous((int)e.a, e.b);
+        motionStarted();
+        break;
+      case JOURNAL_SPEED:
+        applySpeed(e.a);
+        break;
+      case JOURNAL_OVERRIDE:
+        feedOverride = e.a;
+        break;
+      case JOURNAL_STOP:
+      case JOURNAL_FAULT:
+        stopMotor();
+        break;
+      case JOURNAL_HOME:
+        startHoming();
+        moves.push_back({ entryUs, virtualUs });
+        motionStarted();
+        break;
+      case JOURNAL_RESET:
+        resetPosition();
+        break;
+      case JOURNAL_ARRIVED:
+        if (!moves.empty() && moves.back().deviceMs < 0) {
+          moves.back().deviceMs = (entryUs - moves.back().deviceStart) / 1000.0;
+        }
+        break;
+    }
+
+    if (e.command != JOURNAL_ARRIVED && e.command != JOURNAL_LIMIT) replayedEntry(e.timeUs, e.command, e.a, e.b);
+
+    long divergence = stepper.currentPosition() - e.position;
+    maxDivergence = max(maxDivergence, labs(divergence));
+    if (divergence != 0) divergent++;
+    if (csv) {
+      printf("%.3f,%s,%g,%g,%d,%ld,%ld\n", (entryUs - startUs) / 1000.0,
+             commandName(e.command), e.a, e.b, e.position, stepper.currentPosition(), divergence);
+    }
+  }
+
+  // Fin des mouvements en cours (10 min virtuelles au plus)
+  uint64_t tailEnd = virtualUs + 600000000ULL;
+  while (isRunning && virtualUs < tailEnd) {
+    loopMotion();
+    virtualUs += loopUs;
+  }
+
+  const JournalEntry& last = entries.back();
+  bool lastMoving = last.command == JOURNAL_MOVE || last.command == JOURNAL_HOME;
+  long expected = lastMoving ? last.target : last.position;
+  long finalDivergence = stepper.currentPosition() - expected;
+
+  std::vector<double> durationDiffMs;
+  for (const MoveTiming& m : moves) {
+    if (m.deviceMs >= 0 && m.replayMs >= 0) durationDiffMs.push_back(std::fabs(m.replayMs - m.deviceMs));
+  }
+
+  if (writePath != nullptr) {
+    JournalHeader written = header;
+    written.count = replayed.size();
+    written.dropped = 0;
+    FILE* w = fopen(writePath, "wb");
+    if (!w || fwrite(&written, sizeof(written), 1, w) != 1 ||
+        fwrite(replayed.data(), sizeof(JournalEntry), replayed.size(), w) != replayed.size()) {
+      perror(writePath);
+      return 1;
+    }
+    fclose(w);
+  }
+
+  FILE* out = csv ? stderr : stdout;
+  fprintf(out, "%zu entrée(s) sur %.3f s, %ld pas émis, boucle virtuelle %u µs\n", entries.size(),
+          (entryUs - startUs) / 1e6, stepsEmitted, loopUs);
+  fprintf(out, "retard des pas µs: p50 %.1f  p99 %.1f  max %.1f  (intervalle min %u µs)\n",
+          percentile(stepLatenessUs, 0.5), percentile(stepLatenessUs, 0.99), percentile(stepLatenessUs, 1.0),
+          minIntervalUs == UINT32_MAX ? 0 : minIntervalUs);
+  fprintf(out, "latence commande -> premier pas µs: p50 %.1f  max %.1f  (%zu mouvement(s))\n",
+          percentile(commandLatencyUs, 0.5), percentile(commandLatencyUs, 1.0), commandLatencyUs.size());
+  fprintf(out, "durée des mouvements, écart axe/rejeu ms: p50 %.1f  max %.1f  (%zu comparé(s))\n",
+          percentile(durationDiffMs, 0.5), percentile(durationDiffMs, 1.0), durationDiffMs.size());
+  fprintf(out, "écart de position aux entrées: max %ld steps, %ld entrée(s) divergente(s), %ld appliquée(s) en retard\n",
+          maxDivergence, divergent, late);
+  if (limitStops > 0) fprintf(out, "%ld arrêt(s) sur limite pendant le rejeu\n", limitStops);
+  fprintf(out, "position finale: rejeu %ld, attendue %ld, écart %ld steps (%.3f mm) -> %s\n",
+          stepper.currentPosition(), expected, finalDivergence, finalDivergence / STEPS_PER_MM,
+          labs(finalDivergence) <= tolerance ? "ok" : "DIVERGENCE");
+  return labs(finalDivergence) <= tolerance ? 0 : 1;
+}
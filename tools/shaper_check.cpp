@@ -0,0 +1,166 @@
+// Vérification hôte de la mise en forme de consigne (ShaperDesign et RampStepper dans main.c)
+//
+// Compilation: g++ -O2 -std=c++17 -o shaper_check tools/shaper_check.cpp
+// Usage:       shaper_check [--freq Hz] [--damping z] [--accel A] [--speed V] [--distance N]
+//
+// Le générateur du firmware (main.c inclus avec MOTION_CORE_ONLY) tourne sur
+// une horloge virtuelle de 1 µs; les pas émis déplacent le point d'attache
+// d'un modèle masse-ressort (--freq 30 Hz, --damping 0.05, intégré à pas
+// de 1 µs). Déplacements de 500 à 8000 pas, ou de --distance pas, à
+// --speed (12000) steps/s et --accel (150000) steps/s², sans filtre puis
+// avec ZV, ZVD et EI réglés sur le modèle par ShaperDesign::impulses()
+// comme configureShaper(). Vibration résiduelle = plus grand écart
+// masse - consigne (pas) après le dernier pas émis, pire cas des
+// déplacements. Contrôles: chaque filtre divise la pire vibration par 5 au
+// moins et la ramène sous 0.35 pas (ZVD) ou 0.6 pas (ZV, EI); la position
+// finale est la cible dans tous les cas.
+// Puis coût du filtre: temps hôte par appel de run() en mouvement, sans et
+// avec ZVD (ordre de grandeur, non contrôlé).
+// Code de sortie 1 si un contrôle échoue.
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+
+#include "host_core.h"
+
+RampStepper<MotorDriver> stepper;
+
+static long emitted = 0;       // Position émise (point d'attache du ressort)
+
+void onStep(long position, int) { emitted = position; }
+
+struct SpringMass {
+  double omega, damping;
+  double x = 0, v = 0;
+
+  // Intégration semi-implicite sur dt secondes, attache en u
+  void advance(double u, double dt) {
+    v += (omega * omega * (u - x) - 2.0 * damping * omega * v) * dt;
+    x += v * dt;
+  }
+};
+
+struct Result {
+  double residual;             // Écart max après le dernier pas (pas)
+  double durationMs;           // Départ -> dernier pas
+  long finalPosition;
+};
+
+static Result simulate(double freq, double damping, long distance) {
+  SpringMass mass = { 2.0 * M_PI * freq, damping };
+  long start = stepper.currentPosition();
+  mass.x = start;
+  emitted = start;
+  uint64_t begin = virtualUs;
+  uint64_t lastStep = virtualUs;
+  stepper.moveTo(start + distance);
+  bool running = true;
+  while (running) {
+    long before = emitted;
+    running = stepper.run();
+    if (emitted != before) lastStep = virtualUs;
+    mass.advance(emitted, 1e-6);
+    virtualUs++;
+  }
+  Result r = {};
+  r.durationMs = (lastStep - begin) / 1000.0;
+  r.finalPosition = stepper.currentPosition();
+  for (int i = 0; i < 300000; i++) {
+    mass.advance(emitted, 1e-6);
+    r.residual = max(r.residual, fabs(mass.x - emitted));
+  }
+  virtualUs += 300000;
+  return r;
+}
+
+typedef std::chrono::steady_clock Clock;
+
+// ns par appel de run() pendant un déplacement, un appel toutes les 10 µs
+// comme loop()
+static double runCost(long distance) {
+  long calls = 0;
+  stepper.moveTo(stepper.currentPosition() + distance);
+  Clock::time_point t0 = Clock::now();
+  while (stepper.run()) {
+    virtualUs += 10;
+    calls++;
+  }
+  return std::chrono::duration<double, std::nano>(Clock::now() - t0).count() / calls;
+}
+
+int main(int argc, char** argv) {
+  double freq = 30, damping = 0.05, accel = 150000, speed = 12000;
+  long distance = 0;
+  for (int i = 1; i < argc; i++) {
+    if (strcmp(argv[i], "--freq") == 0 && i + 1 < argc) freq = atof(argv[++i]);
+    else if (strcmp(argv[i], "--damping") == 0 && i + 1 < argc) damping = atof(argv[++i]);
+    else if (strcmp(argv[i], "--accel") == 0 && i + 1 < argc) accel = atof(argv[++i]);
+    else if (strcmp(argv[i], "--speed") == 0 && i + 1 < argc) speed = atof(argv[++i]);
+    else if (strcmp(argv[i], "--distance") == 0 && i + 1 < argc) distance = atol(argv[++i]);
+    else {
+      fprintf(stderr, "usage: shaper_check [--freq Hz] [--damping z] [--accel A] [--speed V] [--distance N]\n");
+      return 1;
+    }
+  }
+  stepper.setMaxSpeed(speed);
+  stepper.setAcceleration(accel);
+  int failures = 0;
+
+  // Un déplacement donné, ou un balayage: la vibration laissée sans
+  // filtre dépend de la phase du mode à la fin de la rampe
+  long sweep[] = { 500, 1000, 2000, 4000, 8000 };
+  int sweepCount = distance > 0 ? 1 : 5;
+  if (distance > 0) sweep[0] = distance;
+
+  printf("modèle %.0f Hz / %.0f %%, %.0f steps/s, %.0f steps/s²\n", freq, damping * 100, speed, accel);
+  printf("%-8s %8s %16s %10s %14s\n", "filtre", "impuls.", "résiduel (pas)", "au dépl.", "durée (ms)");
+  const char* names[] = { "aucun", "ZV", "ZVD", "EI" };
+  const double limits[] = { 0, 0.6, 0.35, 0.6 };
+  double unshaped = 0;
+  for (int type = SHAPER_NONE; type <= SHAPER_EI; type++) {
+    int32_t amplitudes[SHAPER_MAX_IMPULSES];
+    uint32_t delays[SHAPER_MAX_IMPULSES];
+    int count = ShaperDesign::impulses(type, freq, damping, amplitudes, delays);
+    if (count < 0) {
+      printf("%-8s retard au-delà de l'historique\n", names[type]);
+      failures++;
+      continue;
+    }
+    stepper.setShaper(count, amplitudes, delays);
+    Result worst = {};
+    long worstDistance = 0;
+    for (int i = 0; i < sweepCount; i++) {
+      long target = stepper.currentPosition() + sweep[i];
+      Result r = simulate(freq, damping, sweep[i]);
+      if (r.finalPosition != target) failures++;
+      if (r.residual > worst.residual) {
+        worst = r;
+        worstDistance = sweep[i];
+      }
+    }
+    printf("%-8s %8d %16.3f %10ld %14.1f\n", names[type], count, worst.residual, worstDistance, worst.durationMs);
+    if (type == SHAPER_NONE) {
+      unshaped = worst.residual;
+    } else if (worst.residual * 5 > unshaped || worst.residual >= limits[type]) {
+      failures++;
+    }
+  }
+
+  int32_t amplitudes[SHAPER_MAX_IMPULSES] = {};
+  uint32_t delays[SHAPER_MAX_IMPULSES] = {};
+  stepper.setShaper(0, amplitudes, delays);
+  double plainNs = runCost(20000);
+  int count = ShaperDesign::impulses(SHAPER_ZVD, freq, damping, amplitudes, delays);
+  stepper.setShaper(count, amplitudes, delays);
+  double shapedNs = runCost(-20000);
+  printf("\nrun() en mouvement: %.1f ns sans filtre, %.1f ns avec ZVD\n", plainNs, shapedNs);
+
+  printf("%s\n", failures == 0 ? "ok" : "ÉCHEC");
+  return failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,214 @@
+// Banc de comparaison statut JSON / binaire / CBOR (voir "STATUT BINAIRE" dans main.c)
+//
+// Compilation: g++ -O2 -std=c++17 -o status_bench tools/status_bench.cpp
+// Usage:       status_bench [itérations]
+//
+// Les encodeurs reproduisent ceux du firmware: JSON par concaténation comme
+// /api/status, enregistrement binaire à disposition fixe, map CBOR. Les
+// décodeurs sont ceux d'une passerelle: recherche de clés pour le JSON,
+// status_client.h pour les deux autres. Mesure la taille et le temps par
+// opération sur l'hôte; l'ordre de grandeur entre formats vaut pour l'ESP32.
+
+#include "status_client.h"
+
+#include <chrono>
+#include <cstdlib>
+#include <string>
+
+struct __attribute__((packed)) WireRecord {
+  uint8_t magic;
+  uint8_t version;
+  uint16_t size;
+  uint32_t seq;
+  uint32_t timestampMs;
+  int32_t position;
+  int32_t target;
+  int32_t remaining;
+  float speed;
+  float stepsPerMm;
+  uint16_t flags;
+  uint16_t overridePct;
+};
+static_assert(sizeof(WireRecord) == STATUS_RECORD_SIZE, "WireRecord doit faire 36 octets");
+
+// État simulé de l'axe, modifié à chaque itération pour éviter les constantes
+struct Axis {
+  bool running = true;
+  int32_t steps = 12345;
+  int32_t target = 80000;
+  float speed = 300;
+  float stepsPerMm = 800;
+  float override = 100;
+  bool limits = true;
+  uint32_t seq = 0;
+  uint32_t millis = 0;
+};
+
+static std::string fixed(double value, int decimals) {
+  char buffer[32];
+  snprintf(buffer, sizeof(buffer), "%.*f", decimals, value);
+  return buffer;
+}
+
+// Même construction que /api/status (sans les champs codeur)
+static std::string encodeJson(const Axis& a) {
+  std::string json = "{";
+  json += "\"running\":" + std::string(a.running ? "true" : "false") + ",";
+  json += "\"position\":" + fixed(a.steps / a.stepsPerMm, 3) + ",";
+  json += "\"target\":" + fixed(a.target / a.stepsPerMm, 3) + ",";
+  json += "\"speed\":" + fixed(a.speed, 2) + ",";
+  json += "\"override\":" + fixed(a.override, 0) + ",";
+  json += "\"steps\":" + std::to_string(a.steps) + ",";
+  json += "\"remaining\":" + std::to_string(a.target - a.steps) + ",";
+  json += "\"stepsPerMm\":" + fixed(a.stepsPerMm, 2) + ",";
+  json += "\"speedMin\":" + fixed(50, 2) + ",";
+  json += "\"speedMax\":" + fixed(2000, 2) + ",";
+  json += "\"speedDefault\":" + fixed(300, 2) + ",";
+  json += "\"limitsEnabled\":" + std::string(a.limits ? "true" : "false");
+  json += "}";
+  return json;
+}
+
+static double jsonNumber(const std::string& json, const char* key) {
+  size_t at = json.find(key);
+  if (at == std::string::npos) return 0;
+  return strtod(json.c_str() + at + strlen(key), nullptr);
+}
+
+static bool decodeJson(const std::string& json, StatusRecord& rec) {
+  rec.stepsPerMm = jsonNumber(json, "\"stepsPerMm\":");
+  rec.position = (int32_t)jsonNumber(json, "\"steps\":");
+  rec.remaining = (int32_t)jsonNumber(json, "\"remaining\":");
+  rec.target = (int32_t)(jsonNumber(json, "\"target\":") * rec.stepsPerMm + 0.5);
+  rec.speed = jsonNumber(json, "\"speed\":");
+  rec.overridePct = (uint16_t)jsonNumber(json, "\"override\":");
+  rec.flags = json.find("\"running\":true") != std::string::npos ? STATUS_FLAG_RUNNING : 0;
+  if (json.find("\"limitsEnabled\":true") != std::string::npos) rec.flags |= STATUS_FLAG_LIMITS;
+  return rec.stepsPerMm > 0;
+}
+
+static void encodeBinary(Axis& a, WireRecord& rec) {
+  rec.magic = STATUS_MAGIC;
+  rec.version = STATUS_VERSION;
+  rec.size = sizeof(WireRecord);
+  rec.seq = ++a.seq;
+  rec.timestampMs = a.millis;
+  rec.position = a.steps;
+  rec.target = a.target;
+  rec.remaining = a.target - a.steps;
+  rec.speed = a.speed;
+  rec.stepsPerMm = a.stepsPerMm;
+  rec.flags = (a.running ? STATUS_FLAG_RUNNING : 0) | (a.limits ? STATUS_FLAG_LIMITS : 0);
+  rec.overridePct = (uint16_t)a.override;
+}
+
+// Copie de l'encodeur CBOR du firmware
+static uint8_t* cborHead(uint8_t* out, uint8_t major, uint32_t value) {
+  major <<= 5;
+  if (value < 24) {
+    *out++ = major | value;
+  } else if (value <= 0xFF) {
+    *out++ = major | 24;
+    *out++ = value;
+  } else if (value <= 0xFFFF) {
+    *out++ = major | 25;
+    *out++ = value >> 8;
+    *out++ = value;
+  } else {
+    *out++ = major | 26;
+    *out++ = value >> 24;
+    *out++ = value >> 16;
+    *out++ = value >> 8;
+    *out++ = value;
+  }
+  return out;
+}
+
+static uint8_t* cborInt(uint8_t* out, int32_t value) {
+  if (value >= 0) return cborHead(out, 0, value);
+  return cborHead(out, 1, (uint32_t)(-1 - value));
+}
+
+static uint8_t* cborFloat(uint8_t* out, float value) {
+  uint32_t bits;
+  memcpy(&bits, &value, sizeof(bits));
+  *out++ = 0xFA;
+  *out++ = bits >> 24;
+  *out++ = bits >> 16;
+  *out++ = bits >> 8;
+  *out++ = bits;
+  return out;
+}
+
+static uint8_t* cborKey(uint8_t* out, const char* key) {
+  size_t length = strlen(key);
+  out = cborHead(out, 3, length);
+  memcpy(out, key, length);
+  return out + length;
+}
+
+static size_t encodeCbor(const WireRecord& rec, uint8_t* out) {
+  uint8_t* p = cborHead(out, 5, 10);
+  p = cborKey(p, "v");   p = cborInt(p, rec.version);
+  p = cborKey(p, "seq"); p = cborHead(p, 0, rec.seq);
+  p = cborKey(p, "t");   p = cborHead(p, 0, rec.timestampMs);
+  p = cborKey(p, "pos"); p = cborInt(p, rec.position);
+  p = cborKey(p, "tgt"); p = cborInt(p, rec.target);
+  p = cborKey(p, "rem"); p = cborInt(p, rec.remaining);
+  p = cborKey(p, "spd"); p = cborFloat(p, rec.speed);
+  p = cborKey(p, "spm"); p = cborFloat(p, rec.stepsPerMm);
+  p = cborKey(p, "flg"); p = cborHead(p, 0, rec.flags);
+  p = cborKey(p, "ovr"); p = cborHead(p, 0, rec.overridePct);
+  return p - out;
+}
+
+typedef std::chrono::steady_clock Clock;
+
+template <class F>
+static double nsPerOp(long iterations, F body) {
+  Clock::time_point start = Clock::now();
+  for (long i = 0; i < iterations; i++) body(i);
+  return std::chrono::duration<double, std::nano>(Clock::now() - start).count() / iterations;
+}
+
+static volatile int32_t sink;
+
+int main(int argc, char** argv) {
+  long iterations = argc > 1 ? atol(argv[1]) : 1000000;
+  Axis axis;
+
+  std::string json;
+  WireRecord wire;
+  uint8_t cbor[96];
+  size_t cborLength = 0;
+  StatusRecord rec;
+
+  double jsonEncode = nsPerOp(iterations, [&](long i) { axis.steps = i; json = encodeJson(axis); });
+  double binEncode = nsPerOp(iterations, [&](long i) { axis.steps = i; encodeBinary(axis, wire); sink = wire.seq; });
+  double cborEncode = nsPerOp(iterations, [&](long i) {
+    axis.steps = i;
+    encodeBinary(axis, wire);
+    cborLength = encodeCbor(wire, cbor);
+  });
+
+  double jsonDecode = nsPerOp(iterations, [&](long) { decodeJson(json, rec); sink = rec.position; });
+  double binDecode = nsPerOp(iterations, [&](long) {
+    parseStatusRecord((const uint8_t*)&wire, sizeof(wire), rec);
+    sink = rec.position;
+  });
+  double cborDecode = nsPerOp(iterations, [&](long) { parseStatusCbor(cbor, cborLength, rec); sink = rec.position; });
+
+  // Les trois formats doivent donner la même position
+  StatusRecord fromJson, fromBin, fromCbor;
+  bool agree = decodeJson(json, fromJson) && parseStatusRecord((const uint8_t*)&wire, sizeof(wire), fromBin) &&
+               parseStatusCbor(cbor, cborLength, fromCbor) && fromJson.position == fromBin.position &&
+               fromBin.position == fromCbor.position && fromBin.target == fromCbor.target &&
+               fromJson.target == fromBin.target && fromBin.flags == fromCbor.flags;
+
+  printf("format   octets  encodage(ns)  décodage(ns)\n");
+  printf("json     %6zu  %12.1f  %12.1f\n", json.size(), jsonEncode, jsonDecode);
+  printf("binaire  %6zu  %12.1f  %12.1f\n", sizeof(wire), binEncode, binDecode);
+  printf("cbor     %6zu  %12.1f  %12.1f\n", cborLength, cborEncode, cborDecode);
+  printf("cohérence: %s\n", agree ? "ok" : "ÉCHEC");
+  return agree ? 0 : 1;
+}
@@ -0,0 +1,181 @@
+// Client du statut binaire (voir "STATUT BINAIRE" dans main.c)
+//
+// En-tête seul, sans dépendance: à inclure dans une passerelle PLC.
+//
+//   StatusRecord rec;
+//   if (fetchStatus("192.168.4.1", rec)) printf("%d\n", rec.position);
+//
+// parseStatusRecord() décode GET /api/status.bin, parseStatusCbor() décode
+// GET /api/status.cbor. Les deux lisent octet par octet: valables quel que
+// soit l'endianness de l'hôte.
+
+#pragma once
+
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+
+#define STATUS_MAGIC 0x53
+#define STATUS_VERSION 1
+#define STATUS_RECORD_SIZE 36
+
+#define STATUS_FLAG_RUNNING 0x0001
+#define STATUS_FLAG_TARGET 0x0002
+#define STATUS_FLAG_CONTINUOUS 0x0004
+#define STATUS_FLAG_JOG 0x0008
+#define STATUS_FLAG_LIMITS 0x0010
+#define STATUS_FLAG_ENCODER 0x0020
+#define STATUS_FLAG_ENCODER_FAULT 0x0040
+#define STATUS_FLAG_NETWORK 0x0080
+#define STATUS_FLAG_GEAR 0x0100
+
+struct StatusRecord {
+  uint8_t version;
+  uint32_t seq;
+  uint32_t timestampMs;
+  int32_t position;   // Steps émis
+  int32_t target;     // Steps
+  int32_t remaining;  // Steps
+  float speed;        // Consigne mm/min
+  float stepsPerMm;
+  uint16_t flags;
+  uint16_t overridePct;
+
+  double positionMm() const { return position / stepsPerMm; }
+  bool running() const { return flags & STATUS_FLAG_RUNNING; }
+};
+
+namespace status_detail {
+
+inline uint32_t le32(const uint8_t* p) {
+  return p[0] | (p[1] << 8) | (p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+inline uint16_t le16(const uint8_t* p) { return p[0] | (p[1] << 8); }
+
+inline float bitsToFloat(uint32_t bits) {
+  float value;
+  memcpy(&value, &bits, sizeof(value));
+  return value;
+}
+
+// Lit une tête CBOR; retourne false si tronquée ou hors du sous-ensemble émis
+inline bool cborHead(const uint8_t*& p, const uint8_t* end, uint8_t& major, uint32_t& value) {
+  if (p >= end) return false;
+  major = *p >> 5;
+  uint8_t info = *p++ & 0x1F;
+  int bytes = info < 24 ? 0 : info == 24 ? 1 : info == 25 ? 2 : info == 26 ? 4 : -1;
+  if (bytes < 0 || end - p < bytes) return false;
+  value = bytes == 0 ? info : 0;
+  for (int i = 0; i < bytes; i++) value = (value << 8) | *p++;
+  return true;
+}
+
+}  // namespace status_detail
+
+// Décode l'enregistrement binaire little-endian (36 octets en version 1).
+// Un enregistrement plus long d'une version future est accepté: seuls les
+// champs connus sont lus.
+inline bool parseStatusRecord(const uint8_t* data, size_t length, StatusRecord& rec) {
+  using namespace status_detail;
+  if (length < STATUS_RECORD_SIZE || data[0] != STATUS_MAGIC || data[1] < STATUS_VERSION) return false;
+  if (le16(data + 2) < STATUS_RECORD_SIZE || le16(data + 2) > length) return false;
+  rec.version = data[1];
+  rec.seq = le32(data + 4);
+  rec.timestampMs = le32(data + 8);
+  rec.position = (int32_t)le32(data + 12);
+  rec.target = (int32_t)le32(data + 16);
+  rec.remaining = (int32_t)le32(data + 20);
+  rec.speed = bitsToFloat(le32(data + 24));
+  rec.stepsPerMm = bitsToFloat(le32(data + 28));
+  rec.flags = le16(data + 32);
+  rec.overridePct = le16(data + 34);
+  return true;
+}
+
+// Décode la map CBOR de /api/status.cbor; les clés inconnues sont ignorées
+inline bool parseStatusCbor(const uint8_t* data, size_t length, StatusRecord& rec) {
+  using namespace status_detail;
+  const uint8_t* p = data;
+  const uint8_t* end = data + length;
+  uint8_t major;
+  uint32_t pairs;
+  if (!cborHead(p, end, major, pairs) || major != 5) return false;
+
+  memset(&rec, 0, sizeof(rec));
+  for (uint32_t i = 0; i < pairs; i++) {
+    uint32_t keyLength;
+    if (!cborHead(p, end, major, keyLength) || major != 3 || (uint32_t)(end - p) < keyLength) return false;
+    const char* key = (const char*)p;
+    p += keyLength;
+
+    uint32_t raw;
+    if (p < end && *p == 0xFA) {
+      if (end - p < 5) return false;
+      raw = ((uint32_t)p[1] << 24) | (p[2] << 16) | (p[3] << 8) | p[4];
+      p += 5;
+      major = 7;
+    } else if (!cborHead(p, end, major, raw) || major > 1) {
+      return false;
+    }
+    int32_t integer = major == 1 ? -1 - (int32_t)raw : (int32_t)raw;
+
+#define STATUS_KEY(name) (keyLength == sizeof(name) - 1 && memcmp(key, name, keyLength) == 0)
+    if (STATUS_KEY("v")) rec.version = integer;
+    else if (STATUS_KEY("seq")) rec.seq = raw;
+    else if (STATUS_KEY("t")) rec.timestampMs = raw;
+    else if (STATUS_KEY("pos")) rec.position = integer;
+    else if (STATUS_KEY("tgt")) rec.target = integer;
+    else if (STATUS_KEY("rem")) rec.remaining = integer;
+    else if (STATUS_KEY("spd")) rec.speed = bitsToFloat(raw);
+    else if (STATUS_KEY("spm")) rec.stepsPerMm = bitsToFloat(raw);
+    else if (STATUS_KEY("flg")) rec.flags = raw;
+    else if (STATUS_KEY("ovr")) rec.overridePct = raw;
+#undef STATUS_KEY
+  }
+  return rec.version >= STATUS_VERSION;
+}
+
+// GET /api/status.bin en HTTP/1.0; false si l'axe ne répond pas à temps
+inline bool fetchStatus(const char* host, StatusRecord& rec, int timeoutMs = 500, uint16_t port = 80) {
+  int sock = socket(AF_INET, SOCK_STREAM, 0);
+  if (sock < 0) return false;
+
+  sockaddr_in addr = {};
+  addr.sin_family = AF_INET;
+  addr.sin_port = htons(port);
+  uint8_t response[512];
+  size_t received = 0;
+  bool ok = inet_pton(AF_INET, host, &addr.sin_addr) == 1 &&
+            connect(sock, (sockaddr*)&addr, sizeof(addr)) == 0;
+
+  if (ok) {
+    char request[128];
+    int length = snprintf(request, sizeof(request), "GET /api/status.bin HTTP/1.0\r\nHost: %s\r\n\r\n", host);
+    ok = send(sock, request, length, 0) == length;
+  }
+  while (ok && received < sizeof(response)) {
+    pollfd pfd = { sock, POLLIN, 0 };
+    if (poll(&pfd, 1, timeoutMs) <= 0) break;
+    ssize_t n = recv(sock, response + received, sizeof(response) - received, 0);
+    if (n <= 0) break;
+    received += n;
+  }
+  close(sock);
+  if (!ok) return false;
+
+  for (size_t i = 0; i + 4 <= received; i++) {
+    if (memcmp(response + i, "\r\n\r\n", 4) == 0) {
+      if (strncmp((const char*)response, "HTTP/1.1 200", 12) != 0 &&
+          strncmp((const char*)response, "HTTP/1.0 200", 12) != 0) return false;
+      return parseStatusRecord(response + i + 4, received - i - 4, rec);
+    }
+  }
+  return false;
+}
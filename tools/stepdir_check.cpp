@@ -0,0 +1,183 @@
+// Vérification hôte des fronts STEP/DIR (StepDirDriver dans main.c)
+//
+// Compilation: g++ -O2 -std=c++17 -o stepdir_check tools/stepdir_check.cpp
+// Usage:       stepdir_check [--moves N] [--seed S]
+//
+// Le générateur de pas du firmware (main.c inclus avec MOTION_CORE_ONLY)
+// pilote MotorDriver, instancié hors ARDUINO sur RecordingGpioPort: chaque
+// front est horodaté sur l'horloge du port, recalée sur l'horloge virtuelle
+// avant chaque tour. --moves (300) déplacements aléatoires, changements de
+// cible en mouvement (inversions) et marche à vitesse constante. Pour
+// chaque pas, relevé dans la suite des fronts:
+//  - impulsion STEP haute exactement STEP_PULSE_US (2 µs);
+//  - niveau de DIR au front montant conforme au sens passé à onStep();
+//  - front DIR uniquement à une inversion, suivi du front STEP après
+//    exactement STEP_DIR_SETUP_US (5 µs); aucune attente sinon.
+// Puis les mêmes contrôles pour une instance à paramètres de template
+// différents (impulsion 3 µs, établissement 10 µs).
+// Code de sortie 1 si un contrôle échoue.
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <random>
+#include <string>
+
+#include "host_core.h"
+
+RampStepper<MotorDriver> stepper;
+
+typedef RecordingGpioPort Port;
+
+struct Counts {
+  long steps = 0;
+  long reversals = 0;
+  long badPulse = 0;       // Largeur d'impulsion STEP fausse
+  long badDirLevel = 0;    // DIR au front montant différent du sens
+  long badSetup = 0;       // Établissement DIR -> STEP faux à une inversion
+  long strayDir = 0;       // Front DIR sans inversion, ou attente sans front DIR
+  long badSequence = 0;    // Fronts manquants ou inattendus
+};
+
+// Fronts relevés pour chaque pas d'un driver, comparés au sens du pas
+struct EdgeChecker {
+  uint8_t stepPin, dirPin;
+  uint32_t pulseUs, setupUs;
+  int dirLevel = 1;            // Niveau DIR courant (après begin(): haut)
+  int lastDir = 1;
+  Counts c;
+
+  EdgeChecker(uint8_t step, uint8_t dir, uint32_t pulse, uint32_t setup)
+      : stepPin(step), dirPin(dir), pulseUs(pulse), setupUs(setup) {}
+
+  void stepped(const Port::Edge* edges, size_t count, int dir) {
+    c.steps++;
+    size_t i = 0;
+    bool dirEdge = false;
+    uint32_t dirTime = 0;
+    if (i < count && edges[i].pin == dirPin) {
+      dirEdge = true;
+      dirTime = edges[i].timeUs;
+      dirLevel = edges[i].level;
+      i++;
+    }
+    if (count - i != 2 || edges[i].pin != stepPin || edges[i].level != 1 || edges[i + 1].pin != stepPin ||
+        edges[i + 1].level != 0) {
+      c.badSequence++;
+      return;
+    }
+    if (edges[i + 1].timeUs - edges[i].timeUs != pulseUs) c.badPulse++;
+    if ((dirLevel ? 1 : -1) != dir) c.badDirLevel++;
+    bool reversal = dir != lastDir;
+    if (reversal) c.reversals++;
+    if (reversal != dirEdge) c.strayDir++;
+    if (dirEdge && edges[i].timeUs - dirTime != setupUs) c.badSetup++;
+    lastDir = dir;
+  }
+
+  bool ok() const {
+    return c.badPulse == 0 && c.badDirLevel == 0 && c.badSetup == 0 && c.strayDir == 0 && c.badSequence == 0 &&
+           c.reversals > 0;
+  }
+
+  void print(const char* name) const {
+    printf("%s: %ld pas, %ld inversions\n", name, c.steps, c.reversals);
+    printf("  impulsions fausses: %ld, DIR faux: %ld, établissement faux: %ld, fronts DIR parasites: %ld, "
+           "séquences fausses: %ld\n",
+           c.badPulse, c.badDirLevel, c.badSetup, c.strayDir, c.badSequence);
+  }
+};
+
+static EdgeChecker motor(PULSE_PIN, DIR_PIN, STEP_PULSE_US, STEP_DIR_SETUP_US);
+
+// Fronts du pas qui vient d'être émis (le port est vidé à chaque tour)
+void onStep(long, int dir) {
+  motor.stepped(Port::edges, Port::count, dir);
+  Port::count = 0;
+}
+
+static void tick() {
+  Port::clockUs = max(Port::clockUs, (uint32_t)virtualUs);
+  Port::count = 0;
+  virtualUs += 10;
+}
+
+static void runToEnd() {
+  while (stepper.run()) tick();
+}
+
+static void runFor(long iterations) {
+  for (long i = 0; i < iterations && stepper.run(); i++) tick();
+}
+
+int main(int argc, char** argv) {
+  int moves = 300;
+  unsigned seed = 1;
+  for (int i = 1; i < argc; i++) {
+    if (strcmp(argv[i], "--moves") == 0 && i + 1 < argc) moves = max(1, atoi(argv[++i]));
+    else if (strcmp(argv[i], "--seed") == 0 && i + 1 < argc) seed = atoi(argv[++i]);
+    else {
+      fprintf(stderr, "usage: stepdir_check [--moves N] [--seed S]\n");
+      return 1;
+    }
+  }
+  std::mt19937 rng(seed);
+  std::uniform_int_distribution<long> targetDist(-3000, 3000);
+  std::uniform_int_distribution<int> kindDist(0, 9);
+  std::uniform_int_distribution<long> partDist(1, 2000);
+  int failures = 0;
+
+  // Niveaux au démarrage: STEP bas, DIR haut (sens avant)
+  stepper.begin();
+  bool idle = Port::count == 2 && Port::edges[0].pin == PULSE_PIN && Port::edges[0].level == 0 &&
+              Port::edges[1].pin == DIR_PIN && Port::edges[1].level == 1;
+  printf("begin(): %s\n", idle ? "STEP bas, DIR haut" : "niveaux faux");
+  if (!idle) failures++;
+  Port::count = 0;
+
+  stepper.setMaxSpeed(4000);
+  stepper.setAcceleration(8000);
+  for (int m = 0; m < moves; m++) {
+    int kind = kindDist(rng);
+    stepper.moveTo(targetDist(rng));
+    if (kind < 6) {
+      runToEnd();
+    } else if (kind < 9) {
+      runFor(partDist(rng));
+      stepper.moveTo(targetDist(rng));
+      runToEnd();
+    } else {
+      stepper.setSpeed(kind % 2 ? -1500 : 1500);
+      for (long i = partDist(rng); i > 0; i--) {
+        stepper.runSpeed();
+        tick();
+      }
+      stepper.setSpeed(0);
+      stepper.setCurrentPosition(stepper.currentPosition());
+    }
+  }
+  motor.print("MotorDriver");
+  if (!motor.ok()) failures++;
+
+  // Autres paramètres de template, pas émis directement
+  StepDirDriver<13, 14, Port, 3, 10> custom;
+  EdgeChecker other(13, 14, 3, 10);
+  Port::count = 0;
+  custom.begin();
+  Port::count = 0;
+  for (int i = 0; i < 2000; i++) {
+    int dir = (i / (1 + i % 7)) % 3 == 0 ? -1 : 1;
+    Port::clockUs += 50;
+    custom.step(dir);
+    other.stepped(Port::edges, Port::count, dir);
+    Port::count = 0;
+  }
+  other.print("StepDirDriver<13, 14, Port, 3, 10>");
+  if (!other.ok()) failures++;
+
+  printf("%s\n", failures == 0 ? "ok" : "ÉCHEC");
+  return failures == 0 ? 0 : 1;
+}
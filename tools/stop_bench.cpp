@@ -0,0 +1,143 @@
+// Latence de l'arrêt sous charge HTTP (admission des requêtes, voir main.c)
+//
+// Compilation: g++ -O2 -std=c++17 -o stop_bench tools/stop_bench.cpp
+// Usage:       stop_bench [--load N] [--count K] [--distance mm] [--timeout ms] <axe>
+//
+// N connexions saturent l'axe de requêtes lourdes et légères (/, /api/logs,
+// /api/status), chacune relancée dès sa réponse. Pendant ce temps, K fois:
+// un déplacement est lancé, puis POST /api/stop est envoyé sur une connexion
+// à part et son aller-retour est chronométré. Le bilan donne les percentiles
+// de l'arrêt, les 503 reçus par la charge (refus pendant le mouvement) et les
+// compteurs d'admission relevés dans /api/diagnostics.
+//
+// À lancer contre un axe réel: device_standin ne reproduit ni l'admission
+// ni l'arrêt rapide (essai du protocole seulement). La logique d'admission
+// du firmware est vérifiée sur l'hôte par tools/admission_check.cpp.
+//
+// Essai du protocole: device_standin --count 1 --delay 2 &
+//                     stop_bench --load 16 127.0.0.1:9000
+
+#include "fleet.h"
+
+#include <cstdio>
+#include <map>
+
+using fleet::Clock;
+
+static const char* const loadPaths[] = { "/", "/api/logs", "/api/status" };
+
+static double percentile(std::vector<double> values, double p) {
+  if (values.empty()) return 0;
+  std::sort(values.begin(), values.end());
+  return values[std::min(values.size() - 1, (size_t)(p * values.size()))];
+}
+
+// Valeur numérique d'une clé dans l'objet "admission" de /api/diagnostics
+static std::string admissionField(const std::string& json, const char* key) {
+  size_t section = json.find("\"admission\":{");
+  if (section == std::string::npos) return "-";
+  size_t at = json.find(std::string("\"") + key + "\":", section);
+  if (at == std::string::npos) return "-";
+  at += strlen(key) + 3;
+  return json.substr(at, json.find_first_of(",}", at) - at);
+}
+
+int main(int argc, char** argv) {
+  size_t load = 8;
+  int count = 50;
+  double distance = 50;
+  fleet::Options options;
+  options.pipelineDepth = 1;
+  options.maxRetries = 0;
+  std::vector<fleet::Endpoint> target;
+
+  for (int i = 1; i < argc; i++) {
+    std::string arg = argv[i];
+    bool hasValue = i + 1 < argc;
+    if (arg == "--load" && hasValue) load = atoi(argv[++i]);
+    else if (arg == "--count" && hasValue) count = std::max(1, atoi(argv[++i]));
+    else if (arg == "--distance" && hasValue) distance = atof(argv[++i]);
+    else if (arg == "--timeout" && hasValue) options.timeoutMs = atoi(argv[++i]);
+    else if (!target.empty() || !fleet::parseEndpoints(arg, target) || target.size() != 1) {
+      fprintf(stderr, "usage: stop_bench [--load N] [--count K] [--distance mm] [--timeout ms] <axe>\n");
+      return 1;
+    }
+  }
+  if (target.empty()) {
+    fprintf(stderr, "usage: stop_bench [--load N] [--count K] [--distance mm] [--timeout ms] <axe>\n");
+    return 1;
+  }
+
+  // Connexions 0..N-1: charge; connexion N: commandes mesurées
+  std::vector<fleet::Endpoint> endpoints(load + 1, target[0]);
+  const size_t control = load;
+  fleet::Fleet fleet(endpoints, options);
+
+  bool loading = true;
+  std::map<int, long> loadStatus;
+  long loadFailures = 0;
+  size_t nextPath = 0;
+  std::function<void(const fleet::Response&)> again = [&](const fleet::Response& r) {
+    if (r.status != 0) loadStatus[r.status]++;
+    else loadFailures++;
+    if (loading) fleet.request(r.device, "GET", loadPaths[nextPath++ % 3], "", again);
+  };
+  for (size_t i = 0; i < load; i++) fleet.request(i, "GET", loadPaths[nextPath++ % 3], "", again);
+
+  // Attente active d'une réponse sur la connexion de commande, la charge continue
+  auto command = [&](const char* method, const char* path, const std::string& body, fleet::Response& out) {
+    bool done = false;
+    fleet.request(control, method, path, body, [&](const fleet::Response& r) {
+      out = r;
+      done = true;
+    });
+    while (!done) fleet.poll(50);
+  };
+  auto settle = [&](int ms) {
+    Clock::time_point until = Clock::now() + std::chrono::milliseconds(ms);
+    while (Clock::now() < until) fleet.poll(10);
+  };
+
+  settle(500);  // Charge établie avant la première mesure
+  std::vector<double> stopMs;
+  long moveRefused = 0;
+  long stopFailures = 0;
+  Clock::time_point start = Clock::now();
+  for (int i = 0; i < count; i++) {
+    fleet::Response r;
+    command("POST", "/api/move", "{\"distance\":" + std::to_string(i % 2 ? -distance : distance) + "}", r);
+    if (!r.ok()) {
+      moveRefused++;
+      settle(50);
+      continue;
+    }
+    settle(100);
+    command("POST", "/api/stop", "", r);
+    if (r.ok()) stopMs.push_back(r.latencyMs);
+    else stopFailures++;
+    settle(20);
+  }
+  double seconds = std::chrono::duration<double>(Clock::now() - start).count();
+
+  loading = false;
+  fleet.run();
+  fleet::Response diag;
+  command("GET", "/api/diagnostics", "", diag);
+
+  printf("%zu connexion(s) de charge, %d arrêt(s) en %.1fs\n", load, count, seconds);
+  printf("arrêt ms: p50 %.2f  p99 %.2f  max %.2f  (%zu mesuré(s), %ld échec(s), %ld déplacement(s) refusé(s))\n",
+         percentile(stopMs, 0.5), percentile(stopMs, 0.99), percentile(stopMs, 1.0), stopMs.size(), stopFailures,
+         moveRefused);
+  printf("charge:");
+  for (auto& entry : loadStatus) printf("  HTTP %d x %ld", entry.first, entry.second);
+  printf("  échecs x %ld\n", loadFailures);
+  if (diag.ok()) {
+    printf("axe: refusées %s, délestées %s, arrêts anticipés %s (dernier %s us, max %s us), entrée %s\n",
+           admissionField(diag.body, "rejected").c_str(), admissionField(diag.body, "shed").c_str(),
+           admissionField(diag.body, "fastStops").c_str(), admissionField(diag.body, "fastStopLastUs").c_str(),
+           admissionField(diag.body, "fastStopMaxUs").c_str(), admissionField(diag.body, "estops").c_str());
+  } else {
+    printf("axe: /api/diagnostics indisponible\n");
+  }
+  return stopMs.empty() ? 1 : 0;
+}
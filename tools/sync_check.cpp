@@ -0,0 +1,218 @@
+// Vérification hôte du départ synchronisé (ClockSync dans main.c)
+//
+// Compilation: g++ -O2 -std=c++17 -o sync_check tools/sync_check.cpp
+// Usage:       sync_check [--devices N] [--starts K] [--delay-ms D] [--jitter-ms J]
+//                         [--spikes %] [--loss %] [--loop-us N] [--max-skew-us S] [--seed S]
+//
+// --devices (4) unités simulées, l'unité 0 servant de référence: chacune a
+// son horloge locale (instant de démarrage aléatoire, dérive du quartz
+// jusqu'à ±50 ppm) et un ClockSync du firmware (main.c inclus avec
+// MOTION_CORE_ONLY). Toutes les secondes, chaque unité fait un échange à
+// quatre temps avec la référence sur un réseau simulé: délai aller et retour
+// indépendants (--delay-ms 1.5 + exponentielle de moyenne --jitter-ms 1),
+// --spikes (5)% de pointes de 20 à 80 ms (retransmissions WiFi), --loss
+// (5)% de pertes, latence de relève du paquet par la boucle (0 à 200 µs).
+//
+// Après 60 s de mise en route (dérive mesurée), --starts (50) départs sont
+// programmés toutes les 10 s: l'hôte lit l'horloge de référence, ajoute
+// 500 ms et envoie "startAt" à toutes les unités, chaque requête HTTP
+// arrivant entre 5 et 60 ms plus tard. Chaque unité démarre au premier tour
+// de boucle (--loop-us 50, ±50%) où son horloge estimée atteint startAt.
+// Mesures, en temps vrai:
+//  - écart de départ entre unités (max - min), comparé au départ immédiat
+//    à la réception de la requête (sans startAt);
+//  - erreur de chaque unité sur l'instant demandé, comparée à l'erreur
+//    annoncée (errorUs, demi aller-retour du meilleur échange).
+// Code de sortie 1 si l'écart maximal dépasse --max-skew-us (1000) ou si un
+// départ est manqué (unité non synchronisée).
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "host_core.h"
+
+RampStepper<MotorDriver> stepper;
+
+void onStep(long position, int dir) {
+  (void)position;
+  (void)dir;
+}
+
+// Copies de main.c (section non incluse avec MOTION_CORE_ONLY)
+#define SYNC_INTERVAL_MS 1000
+#define SYNC_VALID_MS 10000
+
+static std::mt19937 rng(1);
+static double delayMs = 1.5;
+static double jitterMs = 1.0;
+static double spikePercent = 5;
+static double lossPercent = 5;
+static double loopUs = 50;
+
+static double uniform(double a, double b) { return std::uniform_real_distribution<double>(a, b)(rng); }
+
+// Délai réseau d'un paquet (µs), négatif si perdu
+static double networkDelay() {
+  if (uniform(0, 100) < lossPercent) return -1;
+  double d = delayMs * 1000 + std::exponential_distribution<double>(1.0 / (jitterMs * 1000))(rng);
+  if (uniform(0, 100) < spikePercent) d += uniform(20000, 80000);
+  return d;
+}
+
+struct Device {
+  double bootUs;    // Instant vrai de l'horloge locale 0
+  double drift;     // Dérive relative du quartz
+  ClockSync sync;
+  double nextExchange = 0;
+
+  int64_t local(double t) const { return (int64_t)std::floor((t - bootUs) * (1 + drift)); }
+  double trueTime(int64_t localUs) const { return localUs / (1 + drift) + bootUs; }
+};
+
+static std::vector<Device> devices;
+
+// Horloge de référence estimée par l'unité i (comme syncNowUs())
+static int64_t syncNow(Device& d, int64_t localUs, bool reference) {
+  return reference ? localUs : d.sync.now(localUs);
+}
+
+// Échange de l'unité i parti à l'instant vrai t (comme handleSyncUdp())
+static void exchange(size_t i, double t) {
+  Device& d = devices[i];
+  Device& ref = devices[0];
+  double out = networkDelay();
+  double back = networkDelay();
+  if (out < 0 || back < 0) return;
+  double atRef = t + out + uniform(0, 200);       // Relève par la boucle de la référence
+  int64_t t1 = d.local(t);
+  int64_t t2 = ref.local(atRef);
+  double sent = atRef + uniform(5, 40);           // Traitement de la requête
+  int64_t t3 = ref.local(sent);
+  int64_t t4 = d.local(sent + back + uniform(0, 200));
+  d.sync.sample(t1, t2, t3, t4);
+}
+
+// Échanges de toutes les unités jusqu'à l'instant vrai t
+static void runExchanges(double t) {
+  for (size_t i = 1; i < devices.size(); i++) {
+    Device& d = devices[i];
+    while (d.nextExchange <= t) {
+      exchange(i, d.nextExchange);
+      d.nextExchange += SYNC_INTERVAL_MS * 1000.0;
+    }
+  }
+}
+
+static double percentile(std::vector<double> values, double p) {
+  if (values.empty()) return 0;
+  std::sort(values.begin(), values.end());
+  return values[std::min(values.size() - 1, (size_t)(p * values.size()))];
+}
+
+int main(int argc, char** argv) {
+  size_t count = 4;
+  int starts = 50;
+  double maxSkewUs = 1000;
+  unsigned seed = 1;
+  for (int i = 1; i < argc; i++) {
+    std::string arg = argv[i];
+    bool hasValue = i + 1 < argc;
+    if (arg == "--devices" && hasValue) count = max(2, atoi(argv[++i]));
+    else if (arg == "--starts" && hasValue) starts = max(1, atoi(argv[++i]));
+    else if (arg == "--delay-ms" && hasValue) delayMs = atof(argv[++i]);
+    else if (arg == "--jitter-ms" && hasValue) jitterMs = max(0.001, atof(argv[++i]));
+    else if (arg == "--spikes" && hasValue) spikePercent = atof(argv[++i]);
+    else if (arg == "--loss" && hasValue) lossPercent = atof(argv[++i]);
+    else if (arg == "--loop-us" && hasValue) loopUs = max(1.0, atof(argv[++i]));
+    else if (arg == "--max-skew-us" && hasValue) maxSkewUs = atof(argv[++i]);
+    else if (arg == "--seed" && hasValue) seed = atoi(argv[++i]);
+    else {
+      fprintf(stderr,
+              "usage: sync_check [--devices N] [--starts K] [--delay-ms D] [--jitter-ms J] [--spikes %%] [--loss %%]\n"
+              "                  [--loop-us N] [--max-skew-us S] [--seed S]\n");
+      return 1;
+    }
+  }
+  rng.seed(seed);
+
+  for (size_t i = 0; i < count; i++) {
+    Device d;
+    d.bootUs = -uniform(0, 3600e6);
+    d.drift = i == 0 ? 0 : uniform(-50e-6, 50e-6);
+    d.nextExchange = uniform(0, SYNC_INTERVAL_MS * 1000.0);
+    devices.push_back(d);
+  }
+
+  std::vector<double> syncedSkew, immediateSkew, deviceError;
+  long withinBound = 0, measured = 0, missed = 0;
+  double t = 60e6;  // Mise en route: dérive mesurée après 30 s d'historique
+  for (int k = 0; k < starts; k++, t += 10e6) {
+    runExchanges(t);
+    int64_t startAt = devices[0].local(t) + 500000;
+
+    std::vector<double> synced, immediate;
+    for (size_t i = 0; i < count; i++) {
+      Device& d = devices[i];
+      bool reference = i == 0;
+      double arrival = t + uniform(5000, 60000);  // Requête HTTP (connexion TCP comprise)
+      immediate.push_back(arrival);
+
+      // Échanges terminés avant le départ, puis tours de boucle jusqu'à startAt
+      double expected = d.trueTime(startAt - (reference ? 0 : d.sync.offset(d.local(arrival))));
+      if (!reference) {
+        runExchanges(expected - 20000);
+        bool ready = d.sync.valid && d.local(arrival) - d.sync.lastLocalUs < SYNC_VALID_MS * 1000LL;
+        if (!ready) {
+          missed++;
+          continue;
+        }
+      }
+      double now = max(arrival, expected - 20000);
+      while (syncNow(d, d.local(now), reference) < startAt) now += loopUs * uniform(0.5, 1.5);
+      synced.push_back(now);
+
+      double error = devices[0].local(now) - startAt;  // En µs de la référence
+      deviceError.push_back(std::fabs(error));
+      if (!reference) {
+        measured++;
+        if (std::fabs(error) <= d.sync.errorUs + 1.5 * loopUs) withinBound++;
+      }
+    }
+    if (synced.size() > 1) {
+      syncedSkew.push_back(*std::max_element(synced.begin(), synced.end()) -
+                           *std::min_element(synced.begin(), synced.end()));
+    }
+    immediateSkew.push_back(*std::max_element(immediate.begin(), immediate.end()) -
+                            *std::min_element(immediate.begin(), immediate.end()));
+  }
+
+  printf("%zu unités, %d départs, réseau %.1f ms + %.1f ms (moy.), pointes %.0f%%, pertes %.0f%%, boucle %.0f µs\n",
+         count, starts, delayMs, jitterMs, spikePercent, lossPercent, loopUs);
+  printf("%-22s %10s %10s %10s\n", "écart de départ µs", "p50", "p99", "max");
+  printf("%-22s %10.0f %10.0f %10.0f\n", "immédiat", percentile(immediateSkew, 0.5), percentile(immediateSkew, 0.99),
+         percentile(immediateSkew, 1.0));
+  printf("%-22s %10.0f %10.0f %10.0f\n", "startAt", percentile(syncedSkew, 0.5), percentile(syncedSkew, 0.99),
+         percentile(syncedSkew, 1.0));
+  printf("%-22s %10.0f %10.0f %10.0f\n", "erreur par unité", percentile(deviceError, 0.5),
+         percentile(deviceError, 0.99), percentile(deviceError, 1.0));
+
+  printf("\n%-8s %10s %10s %10s %10s %10s\n", "unité", "dérive ppm", "estimée", "errorUs", "échanges", "relances");
+  for (size_t i = 1; i < count; i++) {
+    Device& d = devices[i];
+    printf("%-8zu %10.2f %10.2f %10u %10u %10u\n", i, d.drift * 1e6, -d.sync.rate * 1e6, d.sync.errorUs,
+           d.sync.exchanges, d.sync.restarts);
+  }
+  printf("\nerreur sous l'erreur annoncée (+ 1,5 tour de boucle): %ld/%ld départs; manqués: %ld\n", withinBound,
+         measured, missed);
+
+  bool ok = missed == 0 && !syncedSkew.empty() && percentile(syncedSkew, 1.0) <= maxSkewUs;
+  printf("%s\n", ok ? "ok" : "ÉCHEC");
+  return ok ? 0 : 1;
+}
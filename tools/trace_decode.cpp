@@ -0,0 +1,90 @@
+// Décodeur de trace moteur (GET /api/trace, voir "ENREGISTREUR DE TRACE" dans main.c)
+//
+// Compilation: g++ -O2 -std=c++17 -o trace_decode tools/trace_decode.cpp
+// Usage:       curl -o trace.bin http://192.168.4.1/api/trace
+//              trace_decode trace.bin > trace.csv
+
+#include <cstdint>
+#include <cstdio>
+#include <vector>
+
+#define TRACE_MAGIC 0x31435254  // "TRC1"
+#define TRACE_VERSION 1
+
+#define TRACE_STATE_RUNNING 0x01
+#define TRACE_STATE_TARGET 0x02
+#define TRACE_STATE_CONTINUOUS 0x04
+#define TRACE_STATE_JOG 0x08
+#define TRACE_STATE_REVERSE 0x10
+
+struct __attribute__((packed)) TraceSample {
+  uint32_t timeUs;
+  int32_t steps;
+  uint32_t intervalUs;
+  uint8_t state;
+  uint8_t reserved[3];
+};
+
+struct __attribute__((packed)) TraceHeader {
+  uint32_t magic;
+  uint16_t version;
+  uint16_t sampleSize;
+  uint32_t count;
+  uint32_t dropped;
+  float stepsPerMm;
+  uint16_t decimation;
+  uint16_t reserved;
+};
+
+static const char* stateName(uint8_t state) {
+  if (state & TRACE_STATE_JOG) return "jog";
+  if (state & TRACE_STATE_CONTINUOUS) return "continu";
+  if (state & TRACE_STATE_TARGET) return "cible";
+  if (state & TRACE_STATE_RUNNING) return "marche";
+  return "arret";
+}
+
+int main(int argc, char** argv) {
+  if (argc < 2) {
+    fprintf(stderr, "Usage: %s <trace.bin>\n", argv[0]);
+    return 1;
+  }
+
+  FILE* file = fopen(argv[1], "rb");
+  if (!file) {
+    perror(argv[1]);
+    return 1;
+  }
+
+  TraceHeader header;
+  if (fread(&header, sizeof(header), 1, file) != 1 || header.magic != TRACE_MAGIC) {
+    fprintf(stderr, "Fichier de trace invalide\n");
+    return 1;
+  }
+  if (header.version != TRACE_VERSION || header.sampleSize != sizeof(TraceSample)) {
+    fprintf(stderr, "Version de trace non supportée: %u (échantillon %u octets)\n",
+            header.version, header.sampleSize);
+    return 1;
+  }
+
+  std::vector<TraceSample> samples(header.count);
+  size_t read = fread(samples.data(), sizeof(TraceSample), header.count, file);
+  fclose(file);
+  if (read != header.count) {
+    fprintf(stderr, "Trace tronquée: %zu/%u échantillons\n", read, header.count);
+  }
+
+  fprintf(stderr, "%zu échantillons, décimation %u, %u écrasés, %.2f steps/mm\n",
+          read, header.decimation, header.dropped, header.stepsPerMm);
+
+  printf("time_us,steps,position_mm,speed_mm_min,direction,state\n");
+  uint32_t t0 = read > 0 ? samples[0].timeUs : 0;
+  for (size_t i = 0; i < read; i++) {
+    const TraceSample& s = samples[i];
+    double speed = s.intervalUs > 0 ? 1e6 / s.intervalUs / header.stepsPerMm * 60.0 : 0.0;
+    printf("%u,%d,%.4f,%.1f,%d,%s\n",
+           (uint32_t)(s.timeUs - t0), s.steps, s.steps / header.stepsPerMm, speed,
+           (s.state & TRACE_STATE_REVERSE) ? -1 : 1, stateName(s.state));
+  }
+  return 0;
+}